@@ -22,37 +22,518 @@
 
 #include "LogFile.h"
 
+#include <QFileInfo>
+#include <QDateTime>
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QList>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <atomic>
+#include <string.h>
+
+// ============================================================================
+
+namespace {
+	// Log type prefixes as written by CFrskySportIO::logMessage(), in LOG_TYPE order:
+	const char *conarrLogTypePrefixes[BinaryLog::LOG_TYPE_COUNT] = {
+		"Recv: ",
+		"Send: ",
+		"Echo: ",
+		"Push: ",
+		"Poll: ",
+		"Stat: ",
+	};
+
+	// Finds the port (or session) number and LOG_TYPE of a log message from
+	//	its prefix, which is "[<port>: |Session <n>: ]<type>: ...":
+	void parseLogPrefix(const QByteArray &baMessage, uint8_t &nPort, uint8_t &nLogType)
+	{
+		const char *p = baMessage.constData();
+		const char *pEnd = p + baMessage.size();
+
+		nPort = 0;
+		nLogType = BinaryLog::LOG_TYPE_NONE;
+
+		if ((pEnd - p >= 8) && (memcmp(p, "Session ", 8) == 0)) p += 8;
+		const char *pPort = p;
+		int nPortValue = 0;
+		while ((p < pEnd) && (*p >= '0') && (*p <= '9') && (nPortValue < 256)) nPortValue = nPortValue*10 + (*p++ - '0');
+		if ((p > pPort) && (nPortValue < 256) && (pEnd - p >= 2) && (p[0] == ':') && (p[1] == ' ')) {
+			nPort = static_cast<uint8_t>(nPortValue);
+			p += 2;
+		} else {
+			p = pPort;
+		}
+
+		if (pEnd - p < 6) return;
+		for (int i = 0; i < BinaryLog::LOG_TYPE_COUNT; ++i) {
+			if (memcmp(p, conarrLogTypePrefixes[i], 6) == 0) {
+				nLogType = static_cast<uint8_t>(i);
+				break;
+			}
+		}
+	}
+
+	// Bytes of the UTF-8 encoding of a string, without encoding it:
+	qint64 utf8Size(const QString &str)
+	{
+		qint64 nBytes = str.size();
+		for (QChar ch : str) {
+			ushort nCode = ch.unicode();
+			if (nCode >= 0x80) {
+				// Two bytes up to 0x7FF, else three, and surrogate pairs are four (two each):
+				nBytes += ((nCode < 0x800) || ch.isSurrogate()) ? 1 : 2;
+			}
+		}
+		return nBytes;
+	}
+};
+
+// ============================================================================
+
+#ifdef HAVE_ZLIB
+
+// Gzip output device for a text log.  The QTextStream writes its buffer to
+//	this device, which queues it for a worker thread that deflates it to the
+//	file, so compression doesn't hold up the thread doing the logging.  The
+//	queue is bounded, so a writer that outruns the compressor waits rather
+//	than growing the queue without limit.
+class CLogCompressor : public QIODevice
+{
+public:
+	static constexpr qint64 MAX_QUEUED_BYTES = 8*1024*1024;
+	static constexpr int OUTPUT_BUFFER_SIZE = 64*1024;
+
+	CLogCompressor(QFile *pFile)
+		:	m_pFile(pFile),
+			m_worker(*this)
+	{
+		memset(&m_zStream, 0, sizeof(m_zStream));
+	}
+
+	virtual ~CLogCompressor()
+	{
+		finish();
+	}
+
+	bool start()
+	{
+		if (deflateInit2(&m_zStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15+16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+			setErrorString(QObject::tr("Failed to initialize gzip compression"));
+			return false;
+		}
+		m_bStarted = true;
+		open(QIODevice::WriteOnly);
+		m_worker.start();
+		return true;
+	}
+
+	// Makes everything written so far readable from the file:
+	void sync()
+	{
+		QMutexLocker locker(&m_mutex);
+		m_bSync = true;
+		m_cndWork.wakeAll();
+	}
+
+	// Ends the gzip stream and waits for it to be written:
+	bool finish()
+	{
+		if (!m_bStarted) return !m_bError;
+		{
+			QMutexLocker locker(&m_mutex);
+			m_bFinish = true;
+			m_cndWork.wakeAll();
+		}
+		m_worker.wait();
+		deflateEnd(&m_zStream);
+		m_bStarted = false;
+		close();
+		return !m_bError;
+	}
+
+	virtual bool isSequential() const override { return true; }
+
+protected:
+	virtual qint64 readData(char *data, qint64 maxSize) override
+	{
+		Q_UNUSED(data);
+		Q_UNUSED(maxSize);
+		return -1;
+	}
+
+	virtual qint64 writeData(const char *data, qint64 maxSize) override
+	{
+		QMutexLocker locker(&m_mutex);
+		if (m_bError) return -1;
+		while (m_nQueuedBytes >= MAX_QUEUED_BYTES) m_cndSpace.wait(&m_mutex);
+		m_lstChunks.append(QByteArray(data, maxSize));
+		m_nQueuedBytes += maxSize;
+		m_cndWork.wakeAll();
+		return maxSize;
+	}
+
+private:
+	class CWorker : public QThread
+	{
+	public:
+		CWorker(CLogCompressor &compressor)
+			:	m_compressor(compressor)
+		{ }
+	protected:
+		virtual void run() override { m_compressor.compressLoop(); }
+	private:
+		CLogCompressor &m_compressor;
+	};
+
+	void compressLoop()
+	{
+		bool bDone = false;
+		while (!bDone) {
+			QList<QByteArray> lstChunks;
+			bool bSync;
+			{
+				QMutexLocker locker(&m_mutex);
+				while (m_lstChunks.isEmpty() && !m_bSync && !m_bFinish) m_cndWork.wait(&m_mutex);
+				lstChunks.swap(m_lstChunks);
+				m_nQueuedBytes = 0;
+				m_cndSpace.wakeAll();
+				bSync = m_bSync;
+				m_bSync = false;
+				bDone = m_bFinish;
+			}
+
+			for (const QByteArray &baChunk : lstChunks) deflateData(baChunk.constData(), baChunk.size(), Z_NO_FLUSH);
+			if (bDone) {
+				deflateData(nullptr, 0, Z_FINISH);
+			} else if (bSync) {
+				deflateData(nullptr, 0, Z_SYNC_FLUSH);
+			}
+			if ((bDone || bSync) && !m_pFile->flush()) m_bError = true;
+		}
+	}
+
+	void deflateData(const char *pData, int nSize, int nFlush)
+	{
+		m_zStream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(pData));
+		m_zStream.avail_in = nSize;
+		do {
+			m_zStream.next_out = reinterpret_cast<Bytef *>(m_arrOutput);
+			m_zStream.avail_out = sizeof(m_arrOutput);
+			int nResult = deflate(&m_zStream, nFlush);
+			if (nResult == Z_STREAM_ERROR) {
+				m_bError = true;
+				return;
+			}
+			qint64 nOutput = sizeof(m_arrOutput) - m_zStream.avail_out;
+			if (nOutput && (m_pFile->write(m_arrOutput, nOutput) != nOutput)) m_bError = true;
+		} while ((m_zStream.avail_out == 0) || (m_zStream.avail_in != 0));
+	}
+
+	QFile *m_pFile;
+	CWorker m_worker;
+	z_stream m_zStream;
+	char m_arrOutput[OUTPUT_BUFFER_SIZE];
+	bool m_bStarted = false;
+	// ---- Shared with the worker:
+	QMutex m_mutex;
+	QWaitCondition m_cndWork;				// Signaled when there's data to compress, a sync or finish
+	QWaitCondition m_cndSpace;				// Signaled when the worker takes the queue
+	QList<QByteArray> m_lstChunks;
+	qint64 m_nQueuedBytes = 0;
+	bool m_bSync = false;
+	bool m_bFinish = false;
+	std::atomic<bool> m_bError{false};		// Set by the worker on a write or deflate failure
+};
+
+#else
+
+// Placeholder without zlib, a ".gz" log fails to open:
+class CLogCompressor : public QIODevice
+{
+public:
+	CLogCompressor(QFile *pFile) { Q_UNUSED(pFile); }
+	bool start() { return false; }
+	void sync() { }
+	bool finish() { return true; }
+
+protected:
+	virtual qint64 readData(char *data, qint64 maxSize) override { Q_UNUSED(data); Q_UNUSED(maxSize); return -1; }
+	virtual qint64 writeData(const char *data, qint64 maxSize) override { Q_UNUSED(data); Q_UNUSED(maxSize); return -1; }
+};
+
+#endif
+
 // ============================================================================
 
 CLogFile::CLogFile(QObject *pParent)
 	:	QObject(pParent)
 {
 	m_timerLogFile.start();
+	m_timerFlush.setSingleShot(true);
+	connect(&m_timerFlush, &QTimer::timeout, this, &CLogFile::flushLogFile);
 }
 
 CLogFile::~CLogFile()
 {
+	closeLogFile();
+}
+
+void CLogFile::setRotation(qint64 nMaxBytes, qint64 nMaxMsecs, int nKeepFiles)
+{
+	m_nRotateBytes = qMax<qint64>(nMaxBytes, 0);
+	m_nRotateNsecs = qMax<qint64>(nMaxMsecs, 0) * 1000000;
+	m_nRotateKeep = qMax(nKeepFiles, 0);
 }
 
-bool CLogFile::openLogFile(const QString &strFilePathName, QIODevice::OpenMode nOpenMode)
+QString CLogFile::numberedFileName(const QString &strFilePathName, int nNumber)
 {
+	// "<name>.log" -> "<name>.<n>.log", "<name>.log.gz" -> "<name>.<n>.log.gz", and "<name>" -> "<name>.<n>":
+	QString strBase = strFilePathName;
+	QString strGzip;
+	if (strBase.endsWith(".gz", Qt::CaseInsensitive)) {
+		strGzip = strBase.right(3);
+		strBase.chop(3);
+	}
+	QString strSuffix = QFileInfo(strBase).suffix();
+	if (!strSuffix.isEmpty()) {
+		strBase.chop(strSuffix.size() + 1);
+		strSuffix.prepend('.');
+	}
+	return strBase + QString(".%1").arg(nNumber) + strSuffix + strGzip;
+}
+
+bool CLogFile::openLogFile(const QString &strFilePathName, QIODevice::OpenMode nOpenMode, LOG_FILE_FORMAT nFormat)
+{
+	closeLogFile();
+	m_strLastError.clear();
+
+	if (nFormat == LFF_AUTO) {
+		nFormat = (QFileInfo(strFilePathName).suffix().compare("slog", Qt::CaseInsensitive) == 0) ? LFF_BINARY : LFF_TEXT;
+	}
+	m_nFormat = nFormat;
+	m_strFilePathName = strFilePathName;
+	m_nOpenMode = nOpenMode;
+
+	bool bCompress = (m_nFormat == LFF_TEXT) && strFilePathName.endsWith(".gz", Qt::CaseInsensitive);
+#ifndef HAVE_ZLIB
+	if (bCompress) {
+		m_strLastError = tr("Compressed log files aren't supported in this build");
+		return false;
+	}
+#endif
+
 	m_fileLogFile.setFileName(strFilePathName);
+	if ((m_nFormat == LFF_BINARY) || bCompress) {
+		// The binary format is append-only from a fresh file, and not a text stream,
+		//	and a gzip stream also has to start a fresh file:
+		nOpenMode = QIODevice::WriteOnly | QIODevice::Truncate;
+	}
 	if (!m_fileLogFile.open(nOpenMode)) return false;
-	m_pLogFile.reset(new QTextStream(static_cast<QIODevice *>(&m_fileLogFile)));
+	m_nFileBytes = 0;
+	m_nFileOpenedNsecs = m_timerLogFile.nsecsElapsed();
+
+	if (m_nFormat == LFF_BINARY) {
+		BinaryLog::TFileHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.m_arrMagic, BinaryLog::FILE_MAGIC, sizeof(header.m_arrMagic));
+		header.m_nByteOrderMark = BinaryLog::BYTE_ORDER_MARK;
+		header.m_nVersion = BinaryLog::VERSION;
+		header.m_nHeaderSize = sizeof(header);
+		if (m_nIndexInterval < 1) m_nIndexInterval = 1;
+		header.m_nIndexInterval = m_nIndexInterval;
+		header.m_nStartMsecsSinceEpoch = QDateTime::currentMSecsSinceEpoch() - (m_timerLogFile.nsecsElapsed() / 1000000);
+		m_fileLogFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		m_nFileBytes = sizeof(header);
+		memset(&m_blockCurrent, 0, sizeof(m_blockCurrent));
+		m_arrBlocks.clear();
+	} else if (bCompress) {
+		m_pCompressor.reset(new CLogCompressor(&m_fileLogFile));
+		if (!m_pCompressor->start()) {
+			m_strLastError = m_pCompressor->errorString();
+			m_pCompressor.reset();
+			m_fileLogFile.close();
+			return false;
+		}
+		m_pLogFile.reset(new QTextStream(static_cast<QIODevice *>(m_pCompressor.data())));
+	} else {
+		m_pLogFile.reset(new QTextStream(static_cast<QIODevice *>(&m_fileLogFile)));
+	}
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+	// UTF-8 like the binary log (and Qt 6's default), so m_nFileBytes is exact:
+	if (!m_pLogFile.isNull()) m_pLogFile->setCodec("UTF-8");
+#endif
 	return true;
 }
 
 void CLogFile::closeLogFile()
 {
+	m_timerFlush.stop();
+	m_bReopenPending = false;
+
+	if ((m_nFormat == LFF_BINARY) && m_fileLogFile.isOpen() && m_fileLogFile.isWritable()) {
+		// Finish the last block and append the index of all blocks:
+		if (m_blockCurrent.m_nMessages) writeBlockSummary();
+		BinaryLog::TFooter footer;
+		memset(&footer, 0, sizeof(footer));
+		memcpy(footer.m_arrMagic, BinaryLog::INDEX_MAGIC, sizeof(footer.m_arrMagic));
+		footer.m_nIndexOffset = m_fileLogFile.pos();
+		footer.m_nBlockCount = m_arrBlocks.size();
+		if (!m_arrBlocks.isEmpty()) {
+			m_fileLogFile.write(reinterpret_cast<const char *>(m_arrBlocks.constData()), m_arrBlocks.size() * sizeof(BinaryLog::TBlock));
+		}
+		m_fileLogFile.write(reinterpret_cast<const char *>(&footer), sizeof(footer));
+		m_arrBlocks.clear();
+	}
+
+	if (!m_pLogFile.isNull()) m_pLogFile->flush();
 	m_pLogFile.reset();
+	if (!m_pCompressor.isNull()) {
+		if (!m_pCompressor->finish()) m_strLastError = tr("Failed writing compressed log file");
+		m_pCompressor.reset();
+	}
 	m_fileLogFile.close();
 }
 
 void CLogFile::writeLogString(const QString &strLogString)
 {
-	if (!m_pLogFile.isNull() && m_pLogFile->device()->isOpen() && m_pLogFile->device()->isWritable()) {
-		(*m_pLogFile) << QString("%1").arg(elapsedTime(), 0, 'f', 4) << ": " << strLogString << Qt::endl;
+	if (m_bReopenPending && !retryReopen()) {
+		++m_nLostMessages;
+		return;
+	}
+
+	if (m_nFormat == LFF_BINARY) {
+		if (!isWritable()) return;
+		writeBinaryRecord(strLogString);
+	} else {
+		if (m_pLogFile.isNull() || !m_pLogFile->device()->isOpen() || !m_pLogFile->device()->isWritable()) return;
+		QString strTimestamp = QString("%1").arg(elapsedTime(), 0, 'f', 4);
+		// Note: '\n' rather than Qt::endl, which flushes, for the same output without a write per line:
+		(*m_pLogFile) << strTimestamp << ": " << strLogString << '\n';
+		m_nFileBytes += strTimestamp.size() + 2 + utf8Size(strLogString) + 1;		// Note: the timestamp is ASCII
+		if (m_nFlushInterval <= 0) {
+			flushLogFile();
+		} else if (!m_timerFlush.isActive()) {
+			m_timerFlush.start(m_nFlushInterval);
+		}
+	}
+
+	if (((m_nRotateBytes > 0) && (m_nFileBytes >= m_nRotateBytes)) ||
+		((m_nRotateNsecs > 0) && ((m_timerLogFile.nsecsElapsed() - m_nFileOpenedNsecs) >= m_nRotateNsecs))) {
+		rotateLogFile();
 	}
 }
 
+void CLogFile::flushLogFile()
+{
+	m_timerFlush.stop();
+	if (m_pLogFile.isNull()) return;
+	m_pLogFile->flush();			// Also flushes the file for an uncompressed log
+	if (!m_pCompressor.isNull()) m_pCompressor->sync();
+}
+
+void CLogFile::rotateLogFile()
+{
+	QString strFilePathName = m_strFilePathName;
+	closeLogFile();
+
+	// Shift the numbered files up one, dropping the oldest beyond the keep
+	//	count, or with no limit, up to the first unused number:
+	int nTop = m_nRotateKeep;
+	if (nTop == 0) {
+		nTop = 1;
+		while (QFile::exists(numberedFileName(strFilePathName, nTop))) ++nTop;
+	}
+	QFile::remove(numberedFileName(strFilePathName, nTop));
+	for (int nNumber = nTop-1; nNumber >= 1; --nNumber) {
+		QFile::rename(numberedFileName(strFilePathName, nNumber), numberedFileName(strFilePathName, nNumber+1));
+	}
+	QFile::rename(strFilePathName, numberedFileName(strFilePathName, 1));
+
+	if (!openLogFile(strFilePathName, m_nOpenMode, m_nFormat)) {
+		// Keep the file's settings and retry as messages are written:
+		m_bReopenPending = true;
+		m_nReopenRetryNsecs = m_timerLogFile.nsecsElapsed();
+		m_nLostMessages = 0;
+		emit logFileError(tr("Failed to reopen log file \"%1\" after rotating it: %2\nRetrying, messages are lost until then.")
+							.arg(strFilePathName, getLastError()));
+	}
+}
+
+bool CLogFile::retryReopen()
+{
+	qint64 nNowNsecs = m_timerLogFile.nsecsElapsed();
+	if ((nNowNsecs >= m_nReopenRetryNsecs) &&		// Unless resetTimer() was called
+		((nNowNsecs - m_nReopenRetryNsecs) < static_cast<qint64>(REOPEN_RETRY_INTERVAL) * 1000000)) return false;
+	m_nReopenRetryNsecs = nNowNsecs;
+
+	int nLostMessages = m_nLostMessages;
+	if (!openLogFile(m_strFilePathName, m_nOpenMode, m_nFormat)) {
+		m_bReopenPending = true;			// Cleared by openLogFile()
+		return false;
+	}
+	writeLogString(QString("*** %1 log message(s) lost while reopening the log file after rotating it").arg(nLostMessages));
+	return true;
+}
+
+void CLogFile::writeBinaryRecord(const QString &strLogString)
+{
+	QByteArray baText = strLogString.toUtf8();
+
+	BinaryLog::TRecordHeader header;
+	memset(&header, 0, sizeof(header));
+	header.m_nSize = (sizeof(header) + baText.size() + 7) & ~7;
+	header.m_nRecordType = BinaryLog::RT_MESSAGE;
+	parseLogPrefix(baText, header.m_nPort, header.m_nLogType);
+	if (baText.contains("***")) header.m_nFlags |= BinaryLog::RF_ERROR;
+	if (baText.contains("*** Expected CRC")) header.m_nFlags |= BinaryLog::RF_CRC_ERROR;
+	header.m_nTextSize = baText.size();
+	header.m_nTimestampNsecs = m_timerLogFile.nsecsElapsed();
+
+	if (m_blockCurrent.m_nMessages == 0) {
+		m_blockCurrent.m_nFirstOffset = m_fileLogFile.pos();
+		m_blockCurrent.m_nFirstNsecs = header.m_nTimestampNsecs;
+	}
+	m_blockCurrent.m_nLastNsecs = header.m_nTimestampNsecs;
+	++m_blockCurrent.m_nMessages;
+	if (header.m_nFlags & BinaryLog::RF_ERROR) ++m_blockCurrent.m_nErrors;
+	if (header.m_nFlags & BinaryLog::RF_CRC_ERROR) ++m_blockCurrent.m_nCrcErrors;
+	if (header.m_nLogType < BinaryLog::LOG_TYPE_COUNT) {
+		++m_blockCurrent.m_arrLogTypeCounts[header.m_nLogType];
+	} else {
+		++m_blockCurrent.m_nOtherCount;
+	}
+
+	static const char conarrPadding[8] = {};
+	m_fileLogFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	m_fileLogFile.write(baText);
+	m_fileLogFile.write(conarrPadding, header.m_nSize - sizeof(header) - baText.size());
+	m_nFileBytes += header.m_nSize;
+
+	if (m_blockCurrent.m_nMessages >= static_cast<uint32_t>(m_nIndexInterval)) writeBlockSummary();
+}
+
+void CLogFile::writeBlockSummary()
+{
+	BinaryLog::TRecordHeader header;
+	memset(&header, 0, sizeof(header));
+	header.m_nSize = sizeof(header) + sizeof(BinaryLog::TBlock);
+	header.m_nRecordType = BinaryLog::RT_BLOCK;
+	header.m_nLogType = BinaryLog::LOG_TYPE_NONE;
+	header.m_nTimestampNsecs = m_blockCurrent.m_nLastNsecs;
+	m_fileLogFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	m_fileLogFile.write(reinterpret_cast<const char *>(&m_blockCurrent), sizeof(m_blockCurrent));
+	m_nFileBytes += header.m_nSize;
+	m_fileLogFile.flush();			// So a reader (or a crash) sees whole blocks
+
+	m_arrBlocks.append(m_blockCurrent);
+	memset(&m_blockCurrent, 0, sizeof(m_blockCurrent));
+}
+
 // ============================================================================
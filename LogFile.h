@@ -29,35 +29,182 @@
 #include <QFile>
 #include <QElapsedTimer>
 #include <QTextStream>
+#include <QTimer>
+#include <QVector>
+
+#include <stdint.h>
 
 // ============================================================================
 
+//
+// Binary log format, an alternative to the text log for long sessions.  The
+//	file is append-only: a file header, then one record per logged message,
+//	with a block summary record after every "index interval" messages that
+//	has the block's time range and its counts by LOG_TYPE and of errors.
+//	When the file is closed, an index of all of the block summaries and a
+//	footer pointing to it are appended, so a reader can map the file and
+//	binary search the blocks by time or error count instead of reading every
+//	message.  If the footer is missing (the writer didn't close the file),
+//	the reader rebuilds the index by walking the record headers.  All
+//	structures are 8-byte aligned and in host byte order, which the header's
+//	byte order mark records.  Each message record keeps the complete text
+//	that would have been written to a text log, after the timestamp.
+//
+namespace BinaryLog {
+	constexpr char FILE_MAGIC[8] = { 'F', 'R', 'S', 'K', 'Y', 'L', 'O', 'G' };
+	constexpr char INDEX_MAGIC[8] = { 'F', 'R', 'S', 'K', 'Y', 'I', 'D', 'X' };
+	constexpr uint32_t BYTE_ORDER_MARK = 0x1A2B3C4D;
+	constexpr uint32_t VERSION = 1;
+	constexpr int DEFAULT_INDEX_INTERVAL = 1024;		// Messages per block summary
+	constexpr int LOG_TYPE_COUNT = 6;					// CFrskySportIO::LOG_TYPE values
+	constexpr uint8_t LOG_TYPE_NONE = 0xFF;				// Message without a LOG_TYPE prefix
+
+	enum RECORD_TYPE {
+		RT_MESSAGE = 0,			// Logged message, followed by its UTF-8 text
+		RT_BLOCK = 1,			// Block summary, followed by a TBlock
+	};
+
+	enum RECORD_FLAGS {
+		RF_ERROR = 0x01,		// Message has an error annotation ("***")
+		RF_CRC_ERROR = 0x02,	// Message has a CRC error
+	};
+
+	struct TFileHeader {
+		char m_arrMagic[8];
+		uint32_t m_nByteOrderMark;
+		uint32_t m_nVersion;
+		uint32_t m_nHeaderSize;				// sizeof(TFileHeader), records start here
+		uint32_t m_nIndexInterval;
+		int64_t m_nStartMsecsSinceEpoch;	// Wall-clock time of timestamp zero
+	};
+
+	struct TRecordHeader {
+		uint32_t m_nSize;					// Size of the record, including this header and padding to a multiple of 8
+		uint8_t m_nRecordType;				// RECORD_TYPE
+		uint8_t m_nLogType;					// CFrskySportIO::LOG_TYPE or LOG_TYPE_NONE
+		uint8_t m_nPort;					// Port (or session) number from the message prefix, 0 if none
+		uint8_t m_nFlags;					// RECORD_FLAGS
+		uint32_t m_nTextSize;				// Bytes of text following the header (RT_MESSAGE)
+		uint32_t m_nReserved;
+		int64_t m_nTimestampNsecs;			// Time since the log was opened
+	};
+
+	struct TBlock {
+		int64_t m_nFirstOffset;				// File offset of the block's first message record
+		int64_t m_nFirstNsecs;				// Timestamp of the first message
+		int64_t m_nLastNsecs;				// Timestamp of the last message
+		uint32_t m_nMessages;
+		uint32_t m_nErrors;					// Messages with RF_ERROR
+		uint32_t m_nCrcErrors;				// Messages with RF_CRC_ERROR
+		uint32_t m_arrLogTypeCounts[LOG_TYPE_COUNT];
+		uint32_t m_nOtherCount;				// Messages without a LOG_TYPE
+		uint32_t m_nReserved;
+	};
+
+	struct TFooter {
+		char m_arrMagic[8];
+		int64_t m_nIndexOffset;				// File offset of the TBlock array
+		uint32_t m_nBlockCount;
+		uint32_t m_nReserved;
+	};
+
+	static_assert((sizeof(TFileHeader) % 8) == 0, "Binary log structures must be 8-byte aligned");
+	static_assert((sizeof(TRecordHeader) % 8) == 0, "Binary log structures must be 8-byte aligned");
+	static_assert((sizeof(TBlock) % 8) == 0, "Binary log structures must be 8-byte aligned");
+	static_assert((sizeof(TFooter) % 8) == 0, "Binary log structures must be 8-byte aligned");
+};
+
+// ============================================================================
+
+class CLogCompressor;			// Background gzip writer, in LogFile.cpp
+
+//
+// Text logs are written through a buffer that's flushed to the file every
+//	"flush interval" msecs (0 flushes every line, as the log originally did),
+//	rather than with a system call per line.  A ".gz" suffix on a text log
+//	writes it as a gzip stream, compressed on a background thread, with a
+//	sync point at each flush so the file can be read while it's written.
+//	Both formats can rotate when the file reaches a size (of uncompressed
+//	log text) or an age: the current file is renamed "<name>.1.<suffix>",
+//	previous ones are shifted to "<name>.2.<suffix>" and up, with the
+//	oldest beyond the keep count deleted, and logging continues in a new
+//	file with the original name and the same timestamp base.  If the new
+//	file can't be opened, logFileError is signaled and the open is retried
+//	as messages are written, with a count of the messages lost until then.
+//
 class CLogFile : public QObject
 {
 	Q_OBJECT
 public:
+	enum LOG_FILE_FORMAT {
+		LFF_AUTO = 0,			// Binary for a ".slog" suffix, else text
+		LFF_TEXT = 1,
+		LFF_BINARY = 2,
+	};
+
+	static constexpr int DEFAULT_FLUSH_INTERVAL = 1000;		// msecs
+	static constexpr int REOPEN_RETRY_INTERVAL = 1000;		// msecs between retries of a failed reopen after rotation
+
 	CLogFile(QObject *pParent = nullptr);
 	virtual ~CLogFile();
 
-	bool openLogFile(const QString &strFilePathName, QIODevice::OpenMode nOpenMode);
+	bool openLogFile(const QString &strFilePathName, QIODevice::OpenMode nOpenMode, LOG_FILE_FORMAT nFormat = LFF_AUTO);
 	void closeLogFile();
 
-	QString getLastError() const { return m_fileLogFile.errorString(); }
+	LOG_FILE_FORMAT format() const { return m_nFormat; }
+	bool isCompressed() const { return !m_pCompressor.isNull(); }
+	void setIndexInterval(int nMessages) { m_nIndexInterval = nMessages; }		// Binary format messages per block, takes effect on next open
+	void setFlushInterval(int nMsecs) { m_nFlushInterval = nMsecs; }			// 0 = flush every line
+	void setRotation(qint64 nMaxBytes, qint64 nMaxMsecs, int nKeepFiles);		// 0 = no limit for each
 
-	bool isOpen() const { return (!m_pLogFile.isNull() && (m_pLogFile->device() != nullptr) && m_pLogFile->device()->isOpen()); }
-	bool isWritable() const { return (!m_pLogFile.isNull() && (m_pLogFile->device() != nullptr) && m_pLogFile->device()->isOpen() && m_pLogFile->device()->isWritable()); }
-	bool isReadable() const { return (!m_pLogFile.isNull() && (m_pLogFile->device() != nullptr) && m_pLogFile->device()->isOpen() && m_pLogFile->device()->isReadable()); }
+	QString getLastError() const { return m_strLastError.isEmpty() ? m_fileLogFile.errorString() : m_strLastError; }
+
+	bool isOpen() const { return m_fileLogFile.isOpen(); }
+	bool isWritable() const { return (m_bReopenPending || (m_fileLogFile.isOpen() && m_fileLogFile.isWritable())); }	// Including while retrying a reopen after rotation
+	bool isReadable() const { return (m_fileLogFile.isOpen() && m_fileLogFile.isReadable()); }
 
 	double elapsedTime() const { return static_cast<double>(m_timerLogFile.nsecsElapsed())/1000000.0; }		// in msecs
 
+	static QString numberedFileName(const QString &strFilePathName, int nNumber);		// Name of a rotated log file
+
 public slots:
 	void writeLogString(const QString &strLogString);
-	void resetTimer() { m_timerLogFile.restart(); }
+	void flushLogFile();
+	void resetTimer() { m_timerLogFile.restart(); m_nFileOpenedNsecs = 0; }
+
+signals:
+	void logFileError(const QString &strError);		// Reopening the file after a rotation failed
 
 protected:
+	void writeBinaryRecord(const QString &strLogString);
+	void writeBlockSummary();
+	void rotateLogFile();
+	bool retryReopen();								// Retries a failed reopen after rotation, true if the file is open again
+
 	QFile m_fileLogFile;
-	QScopedPointer<QTextStream> m_pLogFile;			// Currently open log file
+	QScopedPointer<CLogCompressor> m_pCompressor;	// Gzip stream for a compressed text log
+	QScopedPointer<QTextStream> m_pLogFile;			// Currently open text log file
 	QElapsedTimer m_timerLogFile;					// LogFile timestamp keeper
+	LOG_FILE_FORMAT m_nFormat = LFF_TEXT;
+	QString m_strLastError;
+	// ----
+	int m_nFlushInterval = DEFAULT_FLUSH_INTERVAL;
+	QTimer m_timerFlush;							// Flushes the text buffer after m_nFlushInterval
+	// ----
+	QString m_strFilePathName;						// For reopening on rotation
+	QIODevice::OpenMode m_nOpenMode = QIODevice::NotOpen;
+	qint64 m_nRotateBytes = 0;
+	qint64 m_nRotateNsecs = 0;
+	int m_nRotateKeep = 0;
+	qint64 m_nFileBytes = 0;						// Bytes of (encoded, uncompressed) log text written to the current file
+	qint64 m_nFileOpenedNsecs = 0;					// m_timerLogFile time the current file was opened
+	bool m_bReopenPending = false;					// Reopening after rotation failed and is being retried
+	qint64 m_nReopenRetryNsecs = 0;					// m_timerLogFile time of the last reopen attempt
+	int m_nLostMessages = 0;						// Messages not written while the reopen is pending
+	// ----
+	int m_nIndexInterval = BinaryLog::DEFAULT_INDEX_INTERVAL;
+	BinaryLog::TBlock m_blockCurrent;				// Summary of the binary block being written
+	QVector<BinaryLog::TBlock> m_arrBlocks;			// Summaries of the binary blocks written
 };
 
 // ============================================================================
@@ -0,0 +1,310 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#include "LogFileReader.h"
+
+#include <algorithm>
+#include <string.h>
+
+// ============================================================================
+
+QString CLogFileReader::TMessage::logLine() const
+{
+	return QString("%1").arg(static_cast<double>(m_nTimestampNsecs)/1000000.0, 0, 'f', 4) + ": " + QString::fromUtf8(m_baText);
+}
+
+// ============================================================================
+
+CLogFileReader::CLogFileReader()
+{
+	memset(&m_header, 0, sizeof(m_header));
+}
+
+CLogFileReader::~CLogFileReader()
+{
+	close();
+}
+
+bool CLogFileReader::open(const QString &strFilename, QString *pstrError)
+{
+	close();
+
+	m_file.setFileName(strFilename);
+	if (!m_file.open(QIODevice::ReadOnly)) {
+		if (pstrError) *pstrError = m_file.errorString();
+		return false;
+	}
+
+	m_nSize = m_file.size();
+	if (m_nSize < static_cast<qint64>(sizeof(BinaryLog::TFileHeader))) {
+		if (pstrError) *pstrError = QString("Not a binary log file, too short");
+		m_file.close();
+		return false;
+	}
+	m_pData = m_file.map(0, m_nSize);
+	if (m_pData == nullptr) {
+		if (pstrError) *pstrError = m_file.errorString();
+		m_file.close();
+		return false;
+	}
+
+	memcpy(&m_header, m_pData, sizeof(m_header));
+	if ((memcmp(m_header.m_arrMagic, BinaryLog::FILE_MAGIC, sizeof(m_header.m_arrMagic)) != 0) ||
+		(m_header.m_nByteOrderMark != BinaryLog::BYTE_ORDER_MARK) ||
+		(m_header.m_nVersion != BinaryLog::VERSION) ||
+		(m_header.m_nHeaderSize < sizeof(m_header)) || (m_header.m_nHeaderSize > m_nSize)) {
+		if (pstrError) *pstrError = QString("Not a binary log file, or from an incompatible version or host byte order");
+		close();
+		return false;
+	}
+
+	// Use the index from the footer if the writer closed the file, else
+	//	rebuild it from the block summary records:
+	m_bHadIndex = false;
+	if (m_nSize >= static_cast<qint64>(m_header.m_nHeaderSize + sizeof(BinaryLog::TFooter))) {
+		BinaryLog::TFooter footer;
+		memcpy(&footer, m_pData + m_nSize - sizeof(footer), sizeof(footer));
+		qint64 nIndexSize = static_cast<qint64>(footer.m_nBlockCount) * sizeof(BinaryLog::TBlock);
+		if ((memcmp(footer.m_arrMagic, BinaryLog::INDEX_MAGIC, sizeof(footer.m_arrMagic)) == 0) &&
+			(footer.m_nIndexOffset >= m_header.m_nHeaderSize) &&
+			(footer.m_nIndexOffset + nIndexSize + static_cast<qint64>(sizeof(footer)) == m_nSize)) {
+			m_arrBlocks.resize(footer.m_nBlockCount);
+			if (nIndexSize) memcpy(m_arrBlocks.data(), m_pData + footer.m_nIndexOffset, nIndexSize);
+			m_nRecordsEnd = footer.m_nIndexOffset;
+			m_bHadIndex = true;
+		}
+	}
+	if (!m_bHadIndex) rebuildIndex();
+
+	m_arrErrorsBefore.resize(m_arrBlocks.size());
+	m_arrCrcErrorsBefore.resize(m_arrBlocks.size());
+	m_nMessages = 0;
+	qint64 nErrors = 0;
+	qint64 nCrcErrors = 0;
+	for (int i = 0; i < m_arrBlocks.size(); ++i) {
+		m_arrErrorsBefore[i] = nErrors;
+		m_arrCrcErrorsBefore[i] = nCrcErrors;
+		nErrors += m_arrBlocks.at(i).m_nErrors;
+		nCrcErrors += m_arrBlocks.at(i).m_nCrcErrors;
+		m_nMessages += m_arrBlocks.at(i).m_nMessages;
+	}
+
+	return true;
+}
+
+void CLogFileReader::close()
+{
+	if (m_pData) m_file.unmap(const_cast<uchar *>(m_pData));
+	m_pData = nullptr;
+	m_file.close();
+	m_nSize = 0;
+	m_nRecordsEnd = 0;
+	m_arrBlocks.clear();
+	m_arrErrorsBefore.clear();
+	m_arrCrcErrorsBefore.clear();
+	m_nMessages = 0;
+}
+
+void CLogFileReader::rebuildIndex()
+{
+	// Walks the record headers only, keeping the block summaries and
+	//	summarizing the messages after the last one, which the writer
+	//	didn't get to write:
+	BinaryLog::TBlock blockPartial;
+	memset(&blockPartial, 0, sizeof(blockPartial));
+
+	qint64 nOffset = m_header.m_nHeaderSize;
+	const BinaryLog::TRecordHeader *pRecord;
+	while ((pRecord = recordAt(nOffset)) != nullptr) {
+		if (pRecord->m_nRecordType == BinaryLog::RT_BLOCK) {
+			if (pRecord->m_nSize >= sizeof(BinaryLog::TRecordHeader) + sizeof(BinaryLog::TBlock)) {
+				BinaryLog::TBlock block;
+				memcpy(&block, m_pData + nOffset + sizeof(BinaryLog::TRecordHeader), sizeof(block));
+				m_arrBlocks.append(block);
+			}
+			memset(&blockPartial, 0, sizeof(blockPartial));
+		} else if (pRecord->m_nRecordType == BinaryLog::RT_MESSAGE) {
+			if (blockPartial.m_nMessages == 0) {
+				blockPartial.m_nFirstOffset = nOffset;
+				blockPartial.m_nFirstNsecs = pRecord->m_nTimestampNsecs;
+			}
+			blockPartial.m_nLastNsecs = pRecord->m_nTimestampNsecs;
+			++blockPartial.m_nMessages;
+			if (pRecord->m_nFlags & BinaryLog::RF_ERROR) ++blockPartial.m_nErrors;
+			if (pRecord->m_nFlags & BinaryLog::RF_CRC_ERROR) ++blockPartial.m_nCrcErrors;
+			if (pRecord->m_nLogType < BinaryLog::LOG_TYPE_COUNT) {
+				++blockPartial.m_arrLogTypeCounts[pRecord->m_nLogType];
+			} else {
+				++blockPartial.m_nOtherCount;
+			}
+		}
+		nOffset += pRecord->m_nSize;
+	}
+	if (blockPartial.m_nMessages) m_arrBlocks.append(blockPartial);
+	m_nRecordsEnd = nOffset;		// Anything after this is a truncated record
+}
+
+// ----------------------------------------------------------------------------
+
+const BinaryLog::TRecordHeader *CLogFileReader::recordAt(qint64 nOffset) const
+{
+	qint64 nEnd = m_bHadIndex ? m_nRecordsEnd : m_nSize;
+	if ((nOffset < m_header.m_nHeaderSize) || (nOffset + static_cast<qint64>(sizeof(BinaryLog::TRecordHeader)) > nEnd)) return nullptr;
+	const BinaryLog::TRecordHeader *pRecord = reinterpret_cast<const BinaryLog::TRecordHeader *>(m_pData + nOffset);
+	if ((pRecord->m_nSize < sizeof(BinaryLog::TRecordHeader)) || (pRecord->m_nSize % 8) ||
+		(nOffset + pRecord->m_nSize > nEnd)) return nullptr;
+	if ((pRecord->m_nRecordType == BinaryLog::RT_MESSAGE) &&
+		(sizeof(BinaryLog::TRecordHeader) + pRecord->m_nTextSize > pRecord->m_nSize)) return nullptr;
+	return pRecord;
+}
+
+qint64 CLogFileReader::skipToMessage(qint64 nOffset) const
+{
+	const BinaryLog::TRecordHeader *pRecord;
+	while ((pRecord = recordAt(nOffset)) != nullptr) {
+		if (pRecord->m_nRecordType == BinaryLog::RT_MESSAGE) return nOffset;
+		nOffset += pRecord->m_nSize;
+	}
+	return -1;
+}
+
+int CLogFileReader::blockOf(qint64 nOffset) const
+{
+	auto itr = std::upper_bound(m_arrBlocks.cbegin(), m_arrBlocks.cend(), nOffset,
+				[](qint64 nValue, const BinaryLog::TBlock &block)->bool { return nValue < block.m_nFirstOffset; });
+	return static_cast<int>(itr - m_arrBlocks.cbegin()) - 1;
+}
+
+qint64 CLogFileReader::errorCount(bool bCrcOnly) const
+{
+	if (m_arrBlocks.isEmpty()) return 0;
+	const BinaryLog::TBlock &blockLast = m_arrBlocks.last();
+	return bCrcOnly ? (m_arrCrcErrorsBefore.last() + blockLast.m_nCrcErrors) :
+					  (m_arrErrorsBefore.last() + blockLast.m_nErrors);
+}
+
+int64_t CLogFileReader::firstTimestamp() const
+{
+	return m_arrBlocks.isEmpty() ? 0 : m_arrBlocks.first().m_nFirstNsecs;
+}
+
+int64_t CLogFileReader::lastTimestamp() const
+{
+	return m_arrBlocks.isEmpty() ? 0 : m_arrBlocks.last().m_nLastNsecs;
+}
+
+qint64 CLogFileReader::firstMessage() const
+{
+	if (!isOpen()) return -1;
+	return skipToMessage(m_header.m_nHeaderSize);
+}
+
+qint64 CLogFileReader::nextMessage(qint64 nOffset) const
+{
+	const BinaryLog::TRecordHeader *pRecord = recordAt(nOffset);
+	if (pRecord == nullptr) return -1;
+	return skipToMessage(nOffset + pRecord->m_nSize);
+}
+
+qint64 CLogFileReader::findTime(int64_t nTimestampNsecs) const
+{
+	// The last block starting before the time has the message, unless the
+	//	time falls after its last message, in which case it's the first
+	//	message of the next block:
+	auto itr = std::lower_bound(m_arrBlocks.cbegin(), m_arrBlocks.cend(), nTimestampNsecs,
+				[](const BinaryLog::TBlock &block, int64_t nValue)->bool { return block.m_nFirstNsecs < nValue; });
+	int nBlock = std::max(static_cast<int>(itr - m_arrBlocks.cbegin()) - 1, 0);
+	if (nBlock >= m_arrBlocks.size()) return -1;
+	if (m_arrBlocks.at(nBlock).m_nLastNsecs < nTimestampNsecs) {
+		++nBlock;
+		return (nBlock < m_arrBlocks.size()) ? m_arrBlocks.at(nBlock).m_nFirstOffset : -1;
+	}
+
+	for (qint64 nOffset = m_arrBlocks.at(nBlock).m_nFirstOffset; nOffset >= 0; nOffset = nextMessage(nOffset)) {
+		if (recordAt(nOffset)->m_nTimestampNsecs >= nTimestampNsecs) return nOffset;
+	}
+	return -1;
+}
+
+qint64 CLogFileReader::findError(qint64 nError, bool bCrcOnly) const
+{
+	if ((nError < 0) || (nError >= errorCount(bCrcOnly))) return -1;
+
+	const QVector<qint64> &arrBefore = bCrcOnly ? m_arrCrcErrorsBefore : m_arrErrorsBefore;
+	int nBlock = static_cast<int>(std::upper_bound(arrBefore.cbegin(), arrBefore.cend(), nError) - arrBefore.cbegin()) - 1;
+	qint64 nRemaining = nError - arrBefore.at(nBlock);
+	uint8_t nFlag = bCrcOnly ? BinaryLog::RF_CRC_ERROR : BinaryLog::RF_ERROR;
+	for (qint64 nOffset = m_arrBlocks.at(nBlock).m_nFirstOffset; nOffset >= 0; nOffset = nextMessage(nOffset)) {
+		if (recordAt(nOffset)->m_nFlags & nFlag) {
+			if (nRemaining == 0) return nOffset;
+			--nRemaining;
+		}
+	}
+	return -1;
+}
+
+qint64 CLogFileReader::findPrevious(qint64 nOffset, int nCount) const
+{
+	// Records only link forward, so start far enough back by whole blocks
+	//	and walk forward, keeping the last nCount offsets:
+	if (nCount <= 0) return nOffset;
+	int nBlock = blockOf(nOffset);
+	if (nBlock < 0) return firstMessage();
+	qint64 nAvailable = 0;
+	for (qint64 nScan = m_arrBlocks.at(nBlock).m_nFirstOffset; (nScan >= 0) && (nScan < nOffset); nScan = nextMessage(nScan)) ++nAvailable;
+	while ((nAvailable < nCount) && (nBlock > 0)) {
+		--nBlock;
+		nAvailable += m_arrBlocks.at(nBlock).m_nMessages;
+	}
+	qint64 nSkip = std::max<qint64>(nAvailable - nCount, 0);
+	qint64 nScan = m_arrBlocks.at(nBlock).m_nFirstOffset;
+	while ((nSkip > 0) && (nScan >= 0)) {
+		nScan = nextMessage(nScan);
+		--nSkip;
+	}
+	return nScan;
+}
+
+bool CLogFileReader::readMessage(qint64 nOffset, TMessage &msg) const
+{
+	const BinaryLog::TRecordHeader *pRecord = recordAt(nOffset);
+	if ((pRecord == nullptr) || (pRecord->m_nRecordType != BinaryLog::RT_MESSAGE)) return false;
+
+	msg.m_nOffset = nOffset;
+	msg.m_nTimestampNsecs = pRecord->m_nTimestampNsecs;
+	msg.m_nLogType = pRecord->m_nLogType;
+	msg.m_nPort = pRecord->m_nPort;
+	msg.m_nFlags = pRecord->m_nFlags;
+	msg.m_baText = QByteArray::fromRawData(reinterpret_cast<const char *>(pRecord + 1), pRecord->m_nTextSize);
+	return true;
+}
+
+QString CLogFileReader::summary() const
+{
+	return QString("%1 messages in %2 blocks (index %3), %4 errors, %5 CRC errors, %6 ms to %7 ms")
+			.arg(m_nMessages).arg(m_arrBlocks.size()).arg(m_bHadIndex ? "read" : "rebuilt")
+			.arg(errorCount(false)).arg(errorCount(true))
+			.arg(static_cast<double>(firstTimestamp())/1000000.0, 0, 'f', 4)
+			.arg(static_cast<double>(lastTimestamp())/1000000.0, 0, 'f', 4);
+}
+
+// ============================================================================
@@ -0,0 +1,103 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#ifndef LOG_FILE_READER_H
+#define LOG_FILE_READER_H
+
+#include "LogFile.h"
+
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+#include <QVector>
+
+#include <stdint.h>
+
+// ============================================================================
+
+//
+// Reader for the binary log format written by CLogFile.  The file is mapped
+//	into memory and located through its block index: finding the first
+//	message at a time or the Nth error is a binary search of the blocks
+//	followed by a walk of at most one block's records.  Record offsets
+//	returned here are file offsets of message records, -1 for none.
+//
+class CLogFileReader
+{
+public:
+	struct TMessage {
+		qint64 m_nOffset = -1;
+		int64_t m_nTimestampNsecs = 0;
+		uint8_t m_nLogType = BinaryLog::LOG_TYPE_NONE;
+		uint8_t m_nPort = 0;
+		uint8_t m_nFlags = 0;
+		QByteArray m_baText;			// Message text, referencing the mapped file
+
+		QString logLine() const;		// The line as CLogFile writes it to a text log (without the line ending)
+	};
+
+	CLogFileReader();
+	~CLogFileReader();
+
+	bool open(const QString &strFilename, QString *pstrError = nullptr);
+	void close();
+	bool isOpen() const { return (m_pData != nullptr); }
+
+	const BinaryLog::TFileHeader &header() const { return m_header; }
+	bool hadIndex() const { return m_bHadIndex; }		// False if the index was rebuilt from the records
+	int blockCount() const { return m_arrBlocks.size(); }
+	const BinaryLog::TBlock &block(int nBlock) const { return m_arrBlocks.at(nBlock); }
+	qint64 messageCount() const { return m_nMessages; }
+	qint64 errorCount(bool bCrcOnly) const;
+	int64_t firstTimestamp() const;
+	int64_t lastTimestamp() const;
+
+	qint64 firstMessage() const;										// Offset of the first message
+	qint64 nextMessage(qint64 nOffset) const;							// Offset of the message after nOffset
+	qint64 findTime(int64_t nTimestampNsecs) const;						// First message at or after nTimestampNsecs
+	qint64 findError(qint64 nError, bool bCrcOnly) const;				// nError'th (0-based) error message
+	qint64 findPrevious(qint64 nOffset, int nCount) const;				// Message nCount messages before nOffset (or the first)
+	bool readMessage(qint64 nOffset, TMessage &msg) const;
+
+	QString summary() const;			// Single line summary for display
+
+private:
+	const BinaryLog::TRecordHeader *recordAt(qint64 nOffset) const;		// Null if no complete record at nOffset
+	int blockOf(qint64 nOffset) const;									// Block containing the message at nOffset
+	qint64 skipToMessage(qint64 nOffset) const;							// nOffset, or the next message after it if it's not one
+	void rebuildIndex();
+
+	QFile m_file;
+	const uchar *m_pData = nullptr;
+	qint64 m_nSize = 0;
+	qint64 m_nRecordsEnd = 0;			// End of the records (start of the index)
+	BinaryLog::TFileHeader m_header;
+	bool m_bHadIndex = false;
+	QVector<BinaryLog::TBlock> m_arrBlocks;
+	QVector<qint64> m_arrErrorsBefore;		// Errors in the blocks before each block
+	QVector<qint64> m_arrCrcErrorsBefore;	// CRC errors in the blocks before each block
+	qint64 m_nMessages = 0;
+};
+
+// ============================================================================
+
+#endif	// LOG_FILE_READER_H
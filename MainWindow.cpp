@@ -31,12 +31,15 @@
 #include "frsky_sport_io.h"
 #include "frsky_sport_firmware.h"
 #include "ProgDlg.h"
+#include "TelemetryMonitorThread.h"
+#include "TelemetryPlotDock.h"
 
 #include "AboutDlg.h"
 
 #ifdef LUA_SUPPORT
 #include "LuaScriptDlg.h"
 #include "LuaLCD.h"
+#include "LuaEngine.h"
 #endif
 
 #include <QMessageBox>
@@ -57,6 +60,8 @@ CMainWindow::CMainWindow(QWidget *parent) :
 
 	for (int nSport = 0; nSport < SPIDE_COUNT; ++nSport) {
 		m_arrpSport[nSport] = new CFrskySportIO(static_cast<SPORT_ID_ENUM>(nSport), this);
+		// Note: an invalid filter spec leaves the filter logging everything:
+		m_arrpSport[nSport]->logFilter().parse(CPersistentSettings::instance()->getLogFileFilter());
 		connect(m_arrpSport[nSport], SIGNAL(writeLogString(SPORT_ID_ENUM,QString)),
 				this, SLOT(writeLogString(SPORT_ID_ENUM,QString)));
 	}
@@ -81,6 +86,10 @@ CMainWindow::CMainWindow(QWidget *parent) :
 	m_pWriteLogFileAction = pConnectionMenu->addAction(tr("Write &Log File..."));
 	m_pWriteLogFileAction->setCheckable(true);
 	connect(m_pWriteLogFileAction, SIGNAL(toggled(bool)), this, SLOT(en_writeLogFile(bool)));	// Toggled instead of triggered so that it works with software as well as user
+	// Note: queued, so the message box doesn't run an event loop while the log is being written:
+	connect(&m_logFile, &CLogFile::logFileError, this, [this](const QString &strError)->void {
+		QMessageBox::warning(this, tr("Writing Log File"), strError);
+	}, Qt::QueuedConnection);
 
 	// ----------
 
@@ -113,11 +122,40 @@ CMainWindow::CMainWindow(QWidget *parent) :
 
 	// --------------------------------
 
+	QMenu *pTelemetryMenu = ui->menuBar->addMenu(tr("&Telemetry"));
+
+	for (int nSport = 0; nSport < SPIDE_COUNT; ++nSport) {
+		m_arrpMonitorTelemetryAction[nSport] = pTelemetryMenu->addAction(tr("&Monitor Telemetry on Sport #%1").arg(nSport+1));
+		m_arrpMonitorTelemetryAction[nSport]->setCheckable(true);
+		m_arrpMonitorTelemetryAction[nSport]->setEnabled(m_pConnectAction->isChecked());
+		connect(m_arrpMonitorTelemetryAction[nSport], &QAction::toggled, this, [this, nSport](bool bChecked)->void {
+			en_monitorTelemetry(static_cast<SPORT_ID_ENUM>(nSport), bChecked);
+		});
+	}
+
+	pTelemetryMenu->addSeparator();
+
+	m_pTelemetryPlotDock = new CTelemetryPlotDock(m_arrTimeSeries, this);
+	addDockWidget(Qt::BottomDockWidgetArea, m_pTelemetryPlotDock);
+	m_pTelemetryPlotDock->hide();
+	pAction = m_pTelemetryPlotDock->toggleViewAction();
+	pAction->setText(tr("&Plot Telemetry"));
+	pTelemetryMenu->addAction(pAction);
+
+	pTelemetryMenu->addAction(tr("&Clear Telemetry History"), this, SLOT(en_clearTelemetryHistory()));
+
+	// --------------------------------
+
 #ifdef LUA_SUPPORT
 	QMenu *pLuaScriptMenu = ui->menuBar->addMenu(tr("&Lua Script"));
 
-	m_pRunLuaScriptAction = pLuaScriptMenu->addAction(tr("&Run Lua Script..."), this, SLOT(en_runLuaScript()));
-	m_pRunLuaScriptAction->setEnabled(m_pConnectAction->isChecked());
+	for (int nSport = 0; nSport < SPIDE_COUNT; ++nSport) {
+		m_arrpRunLuaScriptAction[nSport] = pLuaScriptMenu->addAction(tr("&Run Lua Script on Sport #%1...").arg(nSport+1));
+		m_arrpRunLuaScriptAction[nSport]->setEnabled(m_pConnectAction->isChecked());
+		connect(m_arrpRunLuaScriptAction[nSport], &QAction::triggered, this, [this, nSport]()->void {
+			en_runLuaScript(static_cast<SPORT_ID_ENUM>(nSport));
+		});
+	}
 
 	QMenu *pLuaScreenThemeMenu = pLuaScriptMenu->addMenu(tr("Screen &Theme"));
 	QActionGroup *pLSTMActionGroup = new QActionGroup(pLuaScreenThemeMenu);
@@ -137,6 +175,22 @@ CMainWindow::CMainWindow(QWidget *parent) :
 		});
 	}
 
+	pAction = pLuaScriptMenu->addAction(tr("&Wake Script on Received Packets"));
+	pAction->setCheckable(true);
+	pAction->setChecked(CPersistentSettings::instance()->getLuaWakeOnRxRate() != 0);
+	connect(pAction, &QAction::toggled, this, [](bool bChecked)->void {
+		CPersistentSettings::instance()->setLuaWakeOnRxRate(bChecked ? 1 : 0);
+	});
+
+	pAction = pLuaScriptMenu->addAction(tr("&Profile Scripts"));
+	pAction->setCheckable(true);
+	pAction->setChecked(CLuaEngine::isProfilingEnabled());
+	connect(pAction, &QAction::toggled, this, [](bool bChecked)->void {
+		CLuaEngine::setProfilingEnabled(bChecked);
+	});
+
+	pLuaScriptMenu->addAction(tr("&Save Script Profile..."), this, SLOT(en_saveLuaProfile()));
+
 	// Support for /scripts/ folder in AppImage:
 	QString strAppDir = qgetenv("APPDIR");
 	if (!strAppDir.isEmpty()) {
@@ -170,8 +224,13 @@ CMainWindow::CMainWindow(QWidget *parent) :
 		m_pFirmwareIDAction->setEnabled(bConnected);
 		m_pFirmwareProgramAction->setEnabled(bConnected);
 		m_pFirmwareReadAction->setEnabled(bConnected);
+		for (int nSport = 0; nSport < SPIDE_COUNT; ++nSport) {
+			m_arrpMonitorTelemetryAction[nSport]->setEnabled(bConnected);
+		}
 #ifdef LUA_SUPPORT
-		m_pRunLuaScriptAction->setEnabled(bConnected);
+		for (int nSport = 0; nSport < SPIDE_COUNT; ++nSport) {
+			m_arrpRunLuaScriptAction[nSport]->setEnabled(bConnected);
+		}
 #endif
 	});
 
@@ -182,6 +241,18 @@ CMainWindow::CMainWindow(QWidget *parent) :
 
 CMainWindow::~CMainWindow()
 {
+	// Telemetry monitors must end first, returning their ports to this thread:
+	for (int nSport = 0; nSport < SPIDE_COUNT; ++nSport) {
+		delete m_arrpTelemetryMonitor[nSport];
+	}
+	delete m_pTelemetryPlotDock;		// Before the stores it plots
+#ifdef LUA_SUPPORT
+	// Script sessions must end first, returning their ports to this thread:
+	for (int nSport = 0; nSport < SPIDE_COUNT; ++nSport) {
+		delete m_arrpLuaScriptDlg[nSport];
+	}
+#endif
+
 	delete ui;
 	ui = nullptr;
 }
@@ -196,6 +267,10 @@ void CMainWindow::en_connect(bool bConnect)
 
 	if (!bConnect) {
 		for (int i = 0; i < SPIDE_COUNT; ++i) {
+			stopTelemetryMonitor(static_cast<SPORT_ID_ENUM>(i));
+#ifdef LUA_SUPPORT
+			delete m_arrpLuaScriptDlg[i];		// End any script session using the port
+#endif
 			m_arrpSport[i]->closePort();
 		}
 		return;
@@ -232,13 +307,17 @@ void CMainWindow::en_writeLogFile(bool bOpen)
 					this,
 					tr("Save Log File", "FileFilters"),
 					CPersistentSettings::instance()->getLogFileLastPath(),
-					tr("Log Files (*.log)", "FileFilters"),
+					tr("Log Files (*.log);;Compressed Log Files (*.log.gz);;Binary Log Files (*.slog)", "FileFilters"),
 					"log",
 					nullptr,
 					QFileDialog::Options());
 		if (!strFilePathName.isEmpty()) {
 			CPersistentSettings::instance()->setLogFileLastPath(strFilePathName);
 
+			m_logFile.setFlushInterval(CPersistentSettings::instance()->getLogFileFlushInterval());
+			m_logFile.setRotation(static_cast<qint64>(CPersistentSettings::instance()->getLogFileRotateSize())*1024*1024,
+								static_cast<qint64>(CPersistentSettings::instance()->getLogFileRotateMinutes())*60000,
+								CPersistentSettings::instance()->getLogFileRotateKeep());
 			if (!m_logFile.openLogFile(strFilePathName, QIODevice::WriteOnly)) {
 				QMessageBox::warning(this, tr("Opening Log File"), tr("Error: Couldn't open Log File \"%1\" for writing.").arg(strFilePathName));
 				// Note: Even though the above 'if' will guard against re-entrancy if
@@ -277,10 +356,7 @@ void CMainWindow::en_firmwareID()
 {
 	assert(!m_arrpSport[CPersistentSettings::instance()->getFirmwareSportPort()].isNull());
 
-	if (!m_arrpSport[CPersistentSettings::instance()->getFirmwareSportPort()]->isOpen()) {
-		QMessageBox::critical(this, windowTitle(), tr("Sport #%1 is not open.  Check configuration!").arg(CPersistentSettings::instance()->getFirmwareSportPort()+1));
-		return;
-	}
+	if (!firmwarePortAvailable()) return;
 
 	CProgDlg dlgProg(tr("ID Device Firmware"), this);
 	CFrskyDeviceFirmwareUpdate fsm(*m_arrpSport[CPersistentSettings::instance()->getFirmwareSportPort()], &dlgProg, this);
@@ -293,10 +369,7 @@ void CMainWindow::en_firmwareProgram()
 {
 	assert(!m_arrpSport[CPersistentSettings::instance()->getFirmwareSportPort()].isNull());
 
-	if (!m_arrpSport[CPersistentSettings::instance()->getFirmwareSportPort()]->isOpen()) {
-		QMessageBox::critical(this, windowTitle(), tr("Sport #%1 is not open.  Check configuration!").arg(CPersistentSettings::instance()->getFirmwareSportPort()+1));
-		return;
-	}
+	if (!firmwarePortAvailable()) return;
 
 	QString strFilePathName = CSaveLoadFileDialog::getOpenFileName(
 				this,
@@ -335,10 +408,7 @@ void CMainWindow::en_firmwareRead()
 
 	QMessageBox::warning(this, "Read Firmware", "WARNING: This function is experimental and exploits undocumented Frsky Protocol details and may destroy the Frsky Device!  Proceed with caution...");
 
-	if (!m_arrpSport[CPersistentSettings::instance()->getFirmwareSportPort()]->isOpen()) {
-		QMessageBox::critical(this, windowTitle(), tr("Sport #%1 is not open.  Check configuration!").arg(CPersistentSettings::instance()->getFirmwareSportPort()+1));
-		return;
-	}
+	if (!firmwarePortAvailable()) return;
 
 	QString strFilePathName = CSaveLoadFileDialog::getSaveFileName(
 				this,
@@ -370,13 +440,141 @@ void CMainWindow::en_firmwareRead()
 
 // ----------------------------------------------------------------------------
 
+void CMainWindow::en_monitorTelemetry(SPORT_ID_ENUM nSport, bool bMonitor)
+{
+	assert(!m_arrpSport[nSport].isNull());
+
+	if (!bMonitor) {
+		delete m_arrpTelemetryMonitor[nSport];		// Returns the port to this thread
+		return;
+	}
+	if (!m_arrpTelemetryMonitor[nSport].isNull()) return;
+
+	QString strError;
 #ifdef LUA_SUPPORT
-void CMainWindow::en_runLuaScript()
+	if (!m_arrpLuaScriptDlg[nSport].isNull()) {
+		strError = tr("Sport #%1 is in use by a Lua Script, which is already recording its telemetry.").arg(nSport+1);
+	}
+#endif
+	if (strError.isEmpty() && !m_arrpSport[nSport]->isOpen()) {
+		strError = tr("Sport #%1 is not open.  Check configuration!").arg(nSport+1);
+	}
+	if (!strError.isEmpty()) {
+		QMessageBox::critical(this, windowTitle(), strError);
+		// Note: Even though the above 'if' will guard against re-entrancy if
+		//	we were to just call setChecked here directly, we must do this on
+		//	a singleShot or else Qt won't propagate the toggled() signal to
+		//	the connections for the other controls to get reenabled:
+		QTimer::singleShot(1, m_arrpMonitorTelemetryAction[nSport], [this, nSport](){ m_arrpMonitorTelemetryAction[nSport]->setChecked(false); });
+		return;
+	}
+
+	CTelemetryMonitorThread *pMonitor = new CTelemetryMonitorThread(*m_arrpSport[nSport], m_arrTimeSeries[nSport], openShmPublisher(nSport), openStreamServer(), this);
+	m_arrpTelemetryMonitor[nSport] = pMonitor;
+	// The port must be pushed to the worker from its current thread,
+	//	it's returned by the worker when the monitor ends:
+	m_arrpSport[nSport]->port().moveToThread(pMonitor);
+	pMonitor->start();
+}
+
+void CMainWindow::stopTelemetryMonitor(SPORT_ID_ENUM nSport)
 {
-	assert(!m_arrpSport[CPersistentSettings::instance()->getDataConfigSportPort()].isNull());
+	// Unchecking the action ends the monitor, see en_monitorTelemetry():
+	if (m_arrpMonitorTelemetryAction[nSport]->isChecked()) {
+		m_arrpMonitorTelemetryAction[nSport]->setChecked(false);
+	}
+	delete m_arrpTelemetryMonitor[nSport];
+}
+
+bool CMainWindow::firmwarePortAvailable()
+{
+	SPORT_ID_ENUM nSport = CPersistentSettings::instance()->getFirmwareSportPort();
+
+	QString strError;
+#ifdef LUA_SUPPORT
+	// A script session has the port on its own thread, so it can't be
+	//	shared with the firmware operation:
+	if (!m_arrpLuaScriptDlg[nSport].isNull()) {
+		strError = tr("Sport #%1 is in use by a Lua Script.  Close it first!").arg(nSport+1);
+	}
+#endif
+	if (strError.isEmpty()) {
+		stopTelemetryMonitor(nSport);
+		if (!m_arrpSport[nSport]->isOpen()) {
+			strError = tr("Sport #%1 is not open.  Check configuration!").arg(nSport+1);
+		}
+	}
+	if (!strError.isEmpty()) {
+		QMessageBox::critical(this, windowTitle(), strError);
+		return false;
+	}
+
+	return true;
+}
+
+CSportShmPublisher *CMainWindow::openShmPublisher(SPORT_ID_ENUM nSport)
+{
+	// Opened when the port's monitor or script session starts, so a name
+	//	changed in the configuration takes effect then.  Nothing else on
+	//	the port can be publishing to it at that point:
+	CSportShmPublisher &publisher = m_arrShmPublisher[nSport];
+	QString strName = CPersistentSettings::instance()->getDataConfigSharedMemory();
+	if (strName.isEmpty()) {
+		publisher.close();
+		return nullptr;
+	}
+	strName += QString::number(nSport+1);
+	if (!strName.startsWith('/')) strName.prepend('/');
+	if (publisher.isOpen() && (publisher.name() == strName)) return &publisher;
+
+	QString strError;
+	if (!publisher.open(strName, CSportShmPublisher::DEFAULT_RING_SIZE, &strError)) {
+		QMessageBox::warning(this, tr("Shared Memory"), tr("Telemetry on Sport #%1 won't be published in shared memory.").arg(nSport+1) + "\n" + strError);
+		return nullptr;
+	}
+	return &publisher;
+}
+
+CSportStreamQueue *CMainWindow::openStreamServer()
+{
+	// Started by the first monitor or script session that needs it, and
+	//	then runs until exit, since the sessions on both ports share it:
+	if (m_streamServer.isListening()) return &m_streamServer.queue();
+	int nPort = CPersistentSettings::instance()->getDataConfigStreamPort();
+	if (nPort <= 0) return nullptr;
+
+	QString strError;
+	if (!m_streamServer.listen(static_cast<quint16>(nPort), QHostAddress(QHostAddress::LocalHost), &strError)) {
+		QMessageBox::warning(this, tr("Telemetry Stream"), tr("Telemetry won't be streamed.") + "\n" + strError);
+		return nullptr;
+	}
+	return &m_streamServer.queue();
+}
+
+void CMainWindow::en_clearTelemetryHistory()
+{
+	for (int nSport = 0; nSport < SPIDE_COUNT; ++nSport) {
+		m_arrTimeSeries[nSport].clear();
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+#ifdef LUA_SUPPORT
+void CMainWindow::en_runLuaScript(SPORT_ID_ENUM nSport)
+{
+	assert(!m_arrpSport[nSport].isNull());
+
+	// Each port can run one script session at a time, concurrently with
+	//	sessions on the other ports:
+	if (!m_arrpLuaScriptDlg[nSport].isNull()) {
+		m_arrpLuaScriptDlg[nSport]->raise();
+		m_arrpLuaScriptDlg[nSport]->activateWindow();
+		return;
+	}
 
-	if (!m_arrpSport[CPersistentSettings::instance()->getDataConfigSportPort()]->isOpen()) {
-		QMessageBox::critical(this, windowTitle(), tr("Sport #%1 is not open.  Check configuration!").arg(CPersistentSettings::instance()->getDataConfigSportPort()+1));
+	if (!m_arrpSport[nSport]->isOpen()) {
+		QMessageBox::critical(this, windowTitle(), tr("Sport #%1 is not open.  Check configuration!").arg(nSport+1));
 		return;
 	}
 
@@ -390,8 +588,37 @@ void CMainWindow::en_runLuaScript()
 	if (strFilePathName.isEmpty()) return;
 	CPersistentSettings::instance()->setLuaScriptLastPath(strFilePathName);
 
-	CLuaScriptDlg dlg(*m_arrpSport[CPersistentSettings::instance()->getDataConfigSportPort()], strFilePathName, this);
-	dlg.exec();
+	stopTelemetryMonitor(nSport);		// The script session records the telemetry instead
+	CLuaScriptDlg *pDlg = new CLuaScriptDlg(*m_arrpSport[nSport], strFilePathName, &m_arrTimeSeries[nSport], openShmPublisher(nSport), openStreamServer(), this);
+	pDlg->setWindowTitle(tr("Lua Script on Sport #%1 - %2").arg(nSport+1).arg(QFileInfo(strFilePathName).fileName()));
+	connect(pDlg, &QDialog::finished, pDlg, &QObject::deleteLater);
+	m_arrpLuaScriptDlg[nSport] = pDlg;
+	pDlg->show();
+}
+
+void CMainWindow::en_saveLuaProfile()
+{
+	CLuaProfiler profile = CLuaEngine::profile();
+	if (profile.sampleCount() == 0) {
+		QMessageBox::information(this, tr("Save Script Profile"),
+				tr("There are no profile samples to save.  Enable \"Profile Scripts\" on the Lua Script menu and run a script first."));
+		return;
+	}
+
+	QString strFilePathName = CSaveLoadFileDialog::getSaveFileName(
+				this,
+				tr("Save Script Profile", "FileFilters"),
+				QFileInfo(CPersistentSettings::instance()->getLuaScriptLastPath()).path(),
+				tr("Collapsed Stack Files (*.folded *.txt);;All Files (*.*)", "FileFilters"),
+				"folded",
+				nullptr,
+				QFileDialog::Options());
+	if (strFilePathName.isEmpty()) return;
+
+	QString strError;
+	if (!profile.writeCollapsedStacks(strFilePathName, &strError)) {
+		QMessageBox::warning(this, tr("Save Script Profile"), tr("Error: Couldn't write Profile File \"%1\": %2").arg(strFilePathName, strError));
+	}
 }
 #endif
 
@@ -25,6 +25,9 @@
 
 #include "PersistentSettings.h"
 #include "LogFile.h"
+#include "frsky_sport_timeseries.h"
+#include "frsky_sport_shm_publisher.h"
+#include "frsky_sport_stream_server.h"
 
 #include <QMainWindow>
 #include <QPointer>
@@ -33,6 +36,11 @@
 
 // Forward Declarations
 class CFrskySportIO;
+class CTelemetryMonitorThread;
+class CTelemetryPlotDock;
+#ifdef LUA_SUPPORT
+class CLuaScriptDlg;
+#endif
 
 // ============================================================================
 
@@ -60,14 +68,31 @@ protected slots:
 	void en_firmwareProgram();
 	void en_firmwareRead();
 	// ----
+	void en_monitorTelemetry(SPORT_ID_ENUM nSport, bool bMonitor);
+	void en_clearTelemetryHistory();
+	// ----
 #ifdef LUA_SUPPORT
-	void en_runLuaScript();
+	void en_runLuaScript(SPORT_ID_ENUM nSport);
+	void en_saveLuaProfile();
 #endif
 
 protected:
+	void stopTelemetryMonitor(SPORT_ID_ENUM nSport);		// Stop it before anything else uses the port
+	bool firmwarePortAvailable();							// Frees the firmware port for a firmware operation, false (reported) if it can't be
+	CSportShmPublisher *openShmPublisher(SPORT_ID_ENUM nSport);	// Shared memory for the port's telemetry, nullptr if not configured
+	CSportStreamQueue *openStreamServer();					// Stream server queue for the telemetry, nullptr if not configured
+
 	CLogFile m_logFile;
 
 	QPointer<CFrskySportIO> m_arrpSport[SPIDE_COUNT];
+	CSportTimeSeriesStore m_arrTimeSeries[SPIDE_COUNT];			// Telemetry history of each port, for the plots
+	CSportShmPublisher m_arrShmPublisher[SPIDE_COUNT];			// Telemetry of each port published for other programs
+	CSportStreamServer m_streamServer;							// Telemetry of all ports streamed to other programs (on its own thread)
+	QPointer<CTelemetryMonitorThread> m_arrpTelemetryMonitor[SPIDE_COUNT];	// Telemetry monitor on each port (each on its own thread)
+	QPointer<CTelemetryPlotDock> m_pTelemetryPlotDock;
+#ifdef LUA_SUPPORT
+	QPointer<CLuaScriptDlg> m_arrpLuaScriptDlg[SPIDE_COUNT];		// Running script session on each port (each on its own thread)
+#endif
 
 private:
 	QPointer<QAction> m_pConnectAction;
@@ -76,8 +101,9 @@ private:
 	QPointer<QAction> m_pFirmwareIDAction;
 	QPointer<QAction> m_pFirmwareProgramAction;
 	QPointer<QAction> m_pFirmwareReadAction;
+	QPointer<QAction> m_arrpMonitorTelemetryAction[SPIDE_COUNT];
 #ifdef LUA_SUPPORT
-	QPointer<QAction> m_pRunLuaScriptAction;
+	QPointer<QAction> m_arrpRunLuaScriptAction[SPIDE_COUNT];
 #endif
 
 	Ui::CMainWindow *ui;
@@ -37,12 +37,19 @@ namespace {
 	// ----
 	const QString constrLogFileSettingsGroup("LogFile");
 	const QString constrLogFileLastPathKey("LastPath");
+	const QString constrLogFileFlushIntervalKey("FlushInterval");
+	const QString constrLogFileRotateSizeKey("RotateSize");
+	const QString constrLogFileRotateMinutesKey("RotateMinutes");
+	const QString constrLogFileRotateKeepKey("RotateKeep");
+	const QString constrLogFileFilterKey("Filter");
 	// ----
 	const QString constrFirmwareCommGroup("FirmwareComm");
 	const QString constrDataConfigCommGroup("DataConfigComm");
 	// ----
 	const QString constrSportPortKey("SportPort");
 	const QString constrLogTxEchosKey("LogTxEchos");
+	const QString constrSharedMemoryKey("SharedMemory");
+	const QString constrStreamPortKey("StreamPort");
 	// ----
 	const QString constrFirmwareGroup("Firmware");
 	const QString constrLastReadPathKey("LastReadPath");
@@ -51,6 +58,9 @@ namespace {
 	const QString constrLuaScriptGroup("LuaScript");
 	const QString constrLuaScriptLastPathKey("LastPath");
 	const QString constrLuaScreenThemeKey("ScreenTheme");
+	const QString constrLuaWakeOnRxRateKey("WakeOnRxRate");
+	const QString constrLuaMemoryLimitKey("MemoryLimit");
+	const QString constrLuaInstructionsLimitKey("InstructionsLimit");
 	// ----
 
 	// ------------------------------------------------------------------------
@@ -82,11 +92,19 @@ namespace {
 
 CPersistentSettings::CPersistentSettings(QObject *parent)
 	:	QSettings(parent),
+		m_nLogFileFlushInterval(1000),			// Same as CLogFile::DEFAULT_FLUSH_INTERVAL
+		m_nLogFileRotateSize(0),
+		m_nLogFileRotateMinutes(0),
+		m_nLogFileRotateKeep(0),
 		m_nFirmwareSportPort(SPIDE_SPORT1),
 		m_bFirmwareLogTxEchos(false),
 		m_nDataConfigSportPort(SPIDE_SPORT2),
 		m_bDataConfigLogTxEchos(false),
-		m_nLuaScreenTheme(0)
+		m_nDataConfigStreamPort(0),
+		m_nLuaScreenTheme(0),
+		m_nLuaWakeOnRxRate(0),
+		m_nLuaMemoryLimit(0),
+		m_nLuaInstructionsLimit(1000000)		// Same as CLuaEngine::DEFAULT_INSTRUCTIONS_LIMIT
 {
 	for (int nSport = 0; nSport < SPIDE_COUNT; ++nSport) {
 		m_deviceSettings[nSport] = conarrDefaultDeviceSettings[nSport];
@@ -121,6 +139,11 @@ void CPersistentSettings::saveSettings()
 	// -----------------
 	beginGroup(constrLogFileSettingsGroup);
 	setValue(constrLogFileLastPathKey, m_strLogFileLastPath);
+	setValue(constrLogFileFlushIntervalKey, m_nLogFileFlushInterval);
+	setValue(constrLogFileRotateSizeKey, m_nLogFileRotateSize);
+	setValue(constrLogFileRotateMinutesKey, m_nLogFileRotateMinutes);
+	setValue(constrLogFileRotateKeepKey, m_nLogFileRotateKeep);
+	setValue(constrLogFileFilterKey, m_strLogFileFilter);
 	endGroup();
 
 	// Comm Settings:
@@ -133,6 +156,8 @@ void CPersistentSettings::saveSettings()
 	beginGroup(constrDataConfigCommGroup);
 	setValue(constrSportPortKey, m_nDataConfigSportPort);
 	setValue(constrLogTxEchosKey, m_bDataConfigLogTxEchos);
+	setValue(constrSharedMemoryKey, m_strDataConfigSharedMemory);
+	setValue(constrStreamPortKey, m_nDataConfigStreamPort);
 	endGroup();
 
 	// Firmware Settings:
@@ -147,6 +172,9 @@ void CPersistentSettings::saveSettings()
 	beginGroup(constrLuaScriptGroup);
 	setValue(constrLuaScriptLastPathKey, m_strLuaScriptLastPath);
 	setValue(constrLuaScreenThemeKey, m_nLuaScreenTheme);
+	setValue(constrLuaWakeOnRxRateKey, m_nLuaWakeOnRxRate);
+	setValue(constrLuaMemoryLimitKey, m_nLuaMemoryLimit);
+	setValue(constrLuaInstructionsLimitKey, m_nLuaInstructionsLimit);
 	endGroup();
 }
 
@@ -168,6 +196,11 @@ void CPersistentSettings::loadSettings()
 	// -----------------
 	beginGroup(constrLogFileSettingsGroup);
 	m_strLogFileLastPath = value(constrLogFileLastPathKey, m_strLogFileLastPath).toString();
+	m_nLogFileFlushInterval = value(constrLogFileFlushIntervalKey, m_nLogFileFlushInterval).toInt();
+	m_nLogFileRotateSize = value(constrLogFileRotateSizeKey, m_nLogFileRotateSize).toInt();
+	m_nLogFileRotateMinutes = value(constrLogFileRotateMinutesKey, m_nLogFileRotateMinutes).toInt();
+	m_nLogFileRotateKeep = value(constrLogFileRotateKeepKey, m_nLogFileRotateKeep).toInt();
+	m_strLogFileFilter = value(constrLogFileFilterKey, m_strLogFileFilter).toString();
 	endGroup();
 
 	// Comm Settings:
@@ -180,6 +213,8 @@ void CPersistentSettings::loadSettings()
 	beginGroup(constrDataConfigCommGroup);
 	m_nDataConfigSportPort = static_cast<SPORT_ID_ENUM>(value(constrSportPortKey, m_nDataConfigSportPort).toInt());
 	m_bDataConfigLogTxEchos = value(constrLogTxEchosKey, m_bDataConfigLogTxEchos).toBool();
+	m_strDataConfigSharedMemory = value(constrSharedMemoryKey, m_strDataConfigSharedMemory).toString();
+	m_nDataConfigStreamPort = value(constrStreamPortKey, m_nDataConfigStreamPort).toInt();
 	endGroup();
 
 	// Firmware Settings:
@@ -194,6 +229,9 @@ void CPersistentSettings::loadSettings()
 	beginGroup(constrLuaScriptGroup);
 	m_strLuaScriptLastPath = value(constrLuaScriptLastPathKey, m_strLuaScriptLastPath).toString();
 	m_nLuaScreenTheme = value(constrLuaScreenThemeKey, m_nLuaScreenTheme).toInt();
+	m_nLuaWakeOnRxRate = value(constrLuaWakeOnRxRateKey, m_nLuaWakeOnRxRate).toInt();
+	m_nLuaMemoryLimit = value(constrLuaMemoryLimitKey, m_nLuaMemoryLimit).toInt();
+	m_nLuaInstructionsLimit = value(constrLuaInstructionsLimitKey, m_nLuaInstructionsLimit).toInt();
 	endGroup();
 }
 
@@ -73,6 +73,11 @@ public:
 	// ----
 
 	QString getLogFileLastPath() const { return m_strLogFileLastPath; }
+	int getLogFileFlushInterval() const { return m_nLogFileFlushInterval; }
+	int getLogFileRotateSize() const { return m_nLogFileRotateSize; }
+	int getLogFileRotateMinutes() const { return m_nLogFileRotateMinutes; }
+	int getLogFileRotateKeep() const { return m_nLogFileRotateKeep; }
+	QString getLogFileFilter() const { return m_strLogFileFilter; }
 
 	// ----
 
@@ -81,6 +86,8 @@ public:
 	// ----
 	SPORT_ID_ENUM getDataConfigSportPort() const { return m_nDataConfigSportPort; }
 	bool getDataConfigLogTxEchos() const { return m_bDataConfigLogTxEchos; }
+	QString getDataConfigSharedMemory() const { return m_strDataConfigSharedMemory; }
+	int getDataConfigStreamPort() const { return m_nDataConfigStreamPort; }
 
 	// ----
 
@@ -91,6 +98,9 @@ public:
 
 	QString getLuaScriptLastPath() const { return m_strLuaScriptLastPath; }
 	int getLuaScreenTheme() const { return m_nLuaScreenTheme; }
+	int getLuaWakeOnRxRate() const { return m_nLuaWakeOnRxRate; }
+	int getLuaMemoryLimit() const { return m_nLuaMemoryLimit; }
+	int getLuaInstructionsLimit() const { return m_nLuaInstructionsLimit; }
 
 	// ----
 
@@ -106,6 +116,11 @@ public slots:
 	// ----
 
 	void setLogFileLastPath(const QString &strLastPath) { m_strLogFileLastPath = strLastPath; }
+	void setLogFileFlushInterval(int nMsecs) { m_nLogFileFlushInterval = nMsecs; }
+	void setLogFileRotateSize(int nMBytes) { m_nLogFileRotateSize = nMBytes; }
+	void setLogFileRotateMinutes(int nMinutes) { m_nLogFileRotateMinutes = nMinutes; }
+	void setLogFileRotateKeep(int nFiles) { m_nLogFileRotateKeep = nFiles; }
+	void setLogFileFilter(const QString &strFilter) { m_strLogFileFilter = strFilter; }
 
 	// ----
 
@@ -114,6 +129,8 @@ public slots:
 	// ----
 	void setDataConfigSportPort(SPORT_ID_ENUM nPort) { m_nDataConfigSportPort = nPort; }
 	void setDataConfigLogTxEchos(bool bLogEchos) { m_bDataConfigLogTxEchos = bLogEchos; }
+	void setDataConfigSharedMemory(const QString &strName) { m_strDataConfigSharedMemory = strName; }
+	void setDataConfigStreamPort(int nPort) { m_nDataConfigStreamPort = nPort; }
 
 	// ----
 
@@ -124,6 +141,9 @@ public slots:
 
 	void setLuaScriptLastPath(const QString &strLastPath) { m_strLuaScriptLastPath = strLastPath; }
 	void setLuaScreenTheme(int nTheme) { m_nLuaScreenTheme = nTheme; }
+	void setLuaWakeOnRxRate(int nMaxRunsPerMs) { m_nLuaWakeOnRxRate = nMaxRunsPerMs; }
+	void setLuaMemoryLimit(int nKBytes) { m_nLuaMemoryLimit = nKBytes; }
+	void setLuaInstructionsLimit(int nInstructions) { m_nLuaInstructionsLimit = nInstructions; }
 
 	// --------------------------------
 
@@ -138,6 +158,11 @@ protected:
 	// LogFile Settings:
 	// -----------------
 	QString m_strLogFileLastPath;
+	int m_nLogFileFlushInterval;		// Text log flush interval in msecs (0 = every line)
+	int m_nLogFileRotateSize;			// Rotate log files at this size in MBytes (0 = no limit)
+	int m_nLogFileRotateMinutes;		// Rotate log files at this age in minutes (0 = no limit)
+	int m_nLogFileRotateKeep;			// Rotated log files to keep (0 = all)
+	QString m_strLogFileFilter;			// CSportLogFilter spec of the frames to log (empty = all)
 	// ----
 
 	// Comm Settings:
@@ -147,6 +172,8 @@ protected:
 	// ----
 	SPORT_ID_ENUM m_nDataConfigSportPort;
 	bool m_bDataConfigLogTxEchos;
+	QString m_strDataConfigSharedMemory;	// Name of the shared memory to publish received telemetry in, see CSportShmPublisher (empty = none)
+	int m_nDataConfigStreamPort;			// Local TCP/UDP port to stream received telemetry on, see CSportStreamServer (0 = none)
 	// ----
 
 	// Firmware Settings:
@@ -159,6 +186,9 @@ protected:
 	// --------------------
 	QString m_strLuaScriptLastPath;
 	int m_nLuaScreenTheme;
+	int m_nLuaWakeOnRxRate;				// Max script runs per millisecond triggered by received packets (0 = refresh timer only)
+	int m_nLuaMemoryLimit;				// Lua script memory limit in KBytes (0 = unlimited)
+	int m_nLuaInstructionsLimit;		// Lua script instructions per run before it's killed (0 = unlimited)
 
 private:
 };
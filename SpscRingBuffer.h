@@ -0,0 +1,109 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+
+#ifndef SPSC_RING_BUFFER_H
+#define SPSC_RING_BUFFER_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+
+// Fixed capacity lock-free ring buffer for one producer and one consumer,
+//	which can be on different threads.  When full, push() rejects the new
+//	item (the producer can't safely discard the oldest item out from under
+//	the consumer) and counts it as dropped.
+//
+//	N must be a power of two.  One slot is never used, so N-1 items fit.
+template<typename T, size_t N>
+class CSpscRingBuffer
+{
+	static_assert((N >= 2) && ((N & (N-1)) == 0), "CSpscRingBuffer size must be a power of two");
+
+public:
+	static constexpr size_t capacity() { return N-1; }
+
+	// Producer side:
+	bool push(const T &item)
+	{
+		size_t nHead = m_nHead.load(std::memory_order_relaxed);
+		size_t nNext = (nHead + 1) & (N-1);
+		if (nNext == m_nTail.load(std::memory_order_acquire)) {
+			m_nDropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		m_arrItems[nHead] = item;
+		m_nHead.store(nNext, std::memory_order_release);
+		m_nPushed.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// Consumer side:
+	bool pop(T &item)
+	{
+		size_t nTail = m_nTail.load(std::memory_order_relaxed);
+		if (nTail == m_nHead.load(std::memory_order_acquire)) return false;
+		item = m_arrItems[nTail];
+		m_nTail.store((nTail + 1) & (N-1), std::memory_order_release);
+		return true;
+	}
+
+	bool isEmpty() const
+	{
+		return (m_nTail.load(std::memory_order_acquire) == m_nHead.load(std::memory_order_acquire));
+	}
+
+	size_t size() const
+	{
+		return (m_nHead.load(std::memory_order_acquire) - m_nTail.load(std::memory_order_acquire)) & (N-1);
+	}
+
+	// Statistics (either side):
+	uint32_t pushedCount() const { return m_nPushed.load(std::memory_order_relaxed); }		// Items accepted by push()
+	uint32_t droppedCount() const { return m_nDropped.load(std::memory_order_relaxed); }	// Items rejected by push() because the ring was full
+
+protected:
+	// The producer's and the consumer's indexes are kept on separate cache
+	//	lines, so they don't bounce a line between the two threads.  That's
+	//	done with explicit padding rather than alignas(), since these are
+	//	members of heap allocated objects and C++14's operator new doesn't
+	//	honor over-alignment.  A whole line of padding on each side keeps
+	//	them apart wherever the object lands:
+	static constexpr size_t CACHE_LINE_SIZE = 64;
+
+	T m_arrItems[N];
+	char m_arrPadItems[CACHE_LINE_SIZE];
+	// ---- Producer:
+	std::atomic<size_t> m_nHead{0};			// Next slot to write
+	std::atomic<uint32_t> m_nPushed{0};
+	std::atomic<uint32_t> m_nDropped{0};
+	char m_arrPadHead[CACHE_LINE_SIZE];
+	// ---- Consumer:
+	std::atomic<size_t> m_nTail{0};			// Next slot to read
+	char m_arrPadTail[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+};
+
+// ============================================================================
+
+#endif	// SPSC_RING_BUFFER_H
@@ -0,0 +1,68 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#include "TelemetryMonitorThread.h"
+
+#include "frsky_sport_io.h"
+#include "frsky_sport_telemetry.h"
+#include "frsky_sport_timeseries.h"
+
+// ============================================================================
+
+CTelemetryMonitorThread::CTelemetryMonitorThread(CFrskySportIO &frskySportIO, CSportTimeSeriesStore &timeSeriesStore, CSportShmPublisher *pShmPublisher, CSportStreamQueue *pStreamQueue, QObject *pParent)
+	:	QThread(pParent),
+		m_frskySportIO(frskySportIO),
+		m_timeSeriesStore(timeSeriesStore),
+		m_pShmPublisher(pShmPublisher),
+		m_pStreamQueue(pStreamQueue),
+		m_pOwnerThread(frskySportIO.port().thread())
+{
+}
+
+CTelemetryMonitorThread::~CTelemetryMonitorThread()
+{
+	quit();
+	wait();
+}
+
+// ----------------------------------------------------------------------------
+
+void CTelemetryMonitorThread::run()
+{
+	// The serial port is moved to this thread by the thread owner before
+	//	starting, since QObject::moveToThread must be called from the
+	//	object's current thread:
+	Q_ASSERT(m_frskySportIO.port().thread() == this);
+
+	{
+		CFrskySportDeviceTelemetry frskyTelemetry(m_frskySportIO);
+		frskyTelemetry.setTimeSeriesStore(&m_timeSeriesStore);
+		frskyTelemetry.setShmPublisher(m_pShmPublisher);
+		frskyTelemetry.setStreamQueue(m_pStreamQueue);
+
+		exec();
+	}
+
+	m_frskySportIO.port().moveToThread(m_pOwnerThread);
+}
+
+// ============================================================================
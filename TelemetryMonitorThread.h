@@ -0,0 +1,65 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#ifndef TELEMETRY_MONITOR_THREAD_H
+#define TELEMETRY_MONITOR_THREAD_H
+
+#include <QThread>
+
+// Forward Declarations
+class CFrskySportIO;
+class CSportTimeSeriesStore;
+class CSportShmPublisher;
+class CSportStreamQueue;
+
+// ============================================================================
+
+// Worker thread for passively monitoring the telemetry on a port, for
+//	the plots, when no script session is using it.  Like CLuaScriptThread,
+//	the telemetry handler lives on this thread along with the serial port,
+//	which is moved here for the life of the monitor and moved back to its
+//	owner thread when it ends, so the GUI can't hold up the receive path.
+//	The received sensor data is recorded in the time series store, which
+//	the GUI reads, and optionally published in shared memory and streamed
+//	to other processes.
+class CTelemetryMonitorThread : public QThread
+{
+	Q_OBJECT
+
+public:
+	CTelemetryMonitorThread(CFrskySportIO &frskySportIO, CSportTimeSeriesStore &timeSeriesStore, CSportShmPublisher *pShmPublisher = nullptr, CSportStreamQueue *pStreamQueue = nullptr, QObject *pParent = nullptr);
+	virtual ~CTelemetryMonitorThread();
+
+protected:
+	virtual void run() override;
+
+private:
+	CFrskySportIO &m_frskySportIO;
+	CSportTimeSeriesStore &m_timeSeriesStore;
+	CSportShmPublisher *m_pShmPublisher;		// Optional shared memory to publish the telemetry received in
+	CSportStreamQueue *m_pStreamQueue;			// Optional stream server queue to stream the telemetry received from
+	QThread *m_pOwnerThread;			// Thread to return the serial port to when the monitor ends
+};
+
+// ============================================================================
+
+#endif	// TELEMETRY_MONITOR_THREAD_H
@@ -0,0 +1,172 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#include "TelemetryPlotDock.h"
+#include "TelemetryPlotWidget.h"
+
+#include "frsky_sport_timeseries.h"
+
+#include <QComboBox>
+#include <QListWidget>
+#include <QLabel>
+#include <QSplitter>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QSet>
+
+// ============================================================================
+
+namespace {
+	struct TSpan {
+		const char *m_pszName;
+		int64_t m_nNsecs;
+	};
+	const TSpan conarrSpans[] =
+	{
+		{ QT_TRANSLATE_NOOP("CTelemetryPlotDock", "10 seconds"), 10000000000LL },
+		{ QT_TRANSLATE_NOOP("CTelemetryPlotDock", "1 minute"), 60000000000LL },
+		{ QT_TRANSLATE_NOOP("CTelemetryPlotDock", "10 minutes"), 600000000000LL },
+		{ QT_TRANSLATE_NOOP("CTelemetryPlotDock", "1 hour"), 3600000000000LL },
+		{ QT_TRANSLATE_NOOP("CTelemetryPlotDock", "6 hours"), 21600000000000LL },
+	};
+	constexpr int DEFAULT_SPAN_INDEX = 1;
+};
+
+// ============================================================================
+
+CTelemetryPlotDock::CTelemetryPlotDock(CSportTimeSeriesStore *arrStores, QWidget *pParent)
+	:	QDockWidget(tr("Telemetry Plot"), pParent),
+		m_arrStores(arrStores)
+{
+	setObjectName("TelemetryPlotDock");
+
+	QWidget *pContents = new QWidget(this);
+	QVBoxLayout *pLayout = new QVBoxLayout(pContents);
+	QHBoxLayout *pControlsLayout = new QHBoxLayout();
+	pLayout->addLayout(pControlsLayout);
+
+	pControlsLayout->addWidget(new QLabel(tr("Port:"), pContents));
+	m_pPortCombo = new QComboBox(pContents);
+	for (int nSport = 0; nSport < SPIDE_COUNT; ++nSport) {
+		m_pPortCombo->addItem(tr("Sport #%1").arg(nSport+1));
+	}
+	pControlsLayout->addWidget(m_pPortCombo);
+
+	pControlsLayout->addWidget(new QLabel(tr("Span:"), pContents));
+	m_pSpanCombo = new QComboBox(pContents);
+	for (auto const &span : conarrSpans) {
+		m_pSpanCombo->addItem(tr(span.m_pszName));
+	}
+	pControlsLayout->addWidget(m_pSpanCombo);
+
+	m_pStatusLabel = new QLabel(pContents);
+	pControlsLayout->addWidget(m_pStatusLabel, 1);
+
+	QSplitter *pSplitter = new QSplitter(Qt::Horizontal, pContents);
+	m_pSeriesList = new QListWidget(pSplitter);
+	m_pPlot = new CTelemetryPlotWidget(pSplitter);
+	pSplitter->addWidget(m_pSeriesList);
+	pSplitter->addWidget(m_pPlot);
+	pSplitter->setStretchFactor(1, 1);
+	pLayout->addWidget(pSplitter, 1);
+
+	setWidget(pContents);
+
+	m_pSpanCombo->setCurrentIndex(DEFAULT_SPAN_INDEX);
+	m_pPlot->setSpan(conarrSpans[DEFAULT_SPAN_INDEX].m_nNsecs);
+	m_pPlot->setStore(&m_arrStores[m_nSport]);
+
+	connect(m_pPortCombo, SIGNAL(currentIndexChanged(int)), this, SLOT(en_portChanged(int)));
+	connect(m_pSpanCombo, SIGNAL(currentIndexChanged(int)), this, SLOT(en_spanChanged(int)));
+	connect(m_pSeriesList, &QListWidget::itemChanged, this, &CTelemetryPlotDock::en_seriesChanged);
+	connect(&m_tmrStatus, &QTimer::timeout, this, &CTelemetryPlotDock::en_status);
+	m_tmrStatus.start(STATUS_MSECS);
+}
+
+// ----------------------------------------------------------------------------
+
+void CTelemetryPlotDock::en_portChanged(int nIndex)
+{
+	if ((nIndex < 0) || (nIndex >= SPIDE_COUNT)) return;
+	m_nSport = static_cast<SPORT_ID_ENUM>(nIndex);
+	m_pSeriesList->clear();
+	m_pPlot->setSeries(QList<uint32_t>());
+	m_pPlot->setStore(&m_arrStores[m_nSport]);
+	refreshSeriesList();
+}
+
+void CTelemetryPlotDock::en_spanChanged(int nIndex)
+{
+	if ((nIndex < 0) || (nIndex >= static_cast<int>(sizeof(conarrSpans)/sizeof(conarrSpans[0])))) return;
+	m_pPlot->setSpan(conarrSpans[nIndex].m_nNsecs);
+}
+
+void CTelemetryPlotDock::en_seriesChanged()
+{
+	QList<uint32_t> lstSeriesKeys;
+	m_pSeriesList->blockSignals(true);		// Changing the colors emits itemChanged too
+	for (int ndx = 0; ndx < m_pSeriesList->count(); ++ndx) {
+		QListWidgetItem *pItem = m_pSeriesList->item(ndx);
+		if (pItem->checkState() == Qt::Checked) {
+			pItem->setForeground(CTelemetryPlotWidget::seriesColor(lstSeriesKeys.size()));
+			lstSeriesKeys.append(pItem->data(Qt::UserRole).toUInt());
+		} else {
+			pItem->setForeground(palette().text());
+		}
+	}
+	m_pSeriesList->blockSignals(false);
+	m_pPlot->setSeries(lstSeriesKeys);
+}
+
+void CTelemetryPlotDock::en_status()
+{
+	if (!isVisible()) return;
+	refreshSeriesList();
+	m_pStatusLabel->setText(m_pPlot->renderStats() + "; " + m_arrStores[m_nSport].summary());
+}
+
+void CTelemetryPlotDock::refreshSeriesList()
+{
+	// Series are only added to the store until it's cleared, so the list
+	//	only needs rebuilding when the count changes:
+	QList<uint32_t> lstSeriesKeys = m_arrStores[m_nSport].seriesKeys();
+	if (lstSeriesKeys.size() == m_pSeriesList->count()) return;
+
+	QSet<uint32_t> setChecked;
+	for (int ndx = 0; ndx < m_pSeriesList->count(); ++ndx) {
+		QListWidgetItem *pItem = m_pSeriesList->item(ndx);
+		if (pItem->checkState() == Qt::Checked) setChecked.insert(pItem->data(Qt::UserRole).toUInt());
+	}
+
+	m_pSeriesList->blockSignals(true);
+	m_pSeriesList->clear();
+	for (uint32_t nKey : lstSeriesKeys) {
+		QListWidgetItem *pItem = new QListWidgetItem(CSportTimeSeriesStore::seriesName(nKey), m_pSeriesList);
+		pItem->setData(Qt::UserRole, nKey);
+		pItem->setFlags(pItem->flags() | Qt::ItemIsUserCheckable);
+		pItem->setCheckState(setChecked.contains(nKey) ? Qt::Checked : Qt::Unchecked);
+	}
+	m_pSeriesList->blockSignals(false);
+	en_seriesChanged();
+}
+
+// ============================================================================
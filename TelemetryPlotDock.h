@@ -0,0 +1,77 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#ifndef TELEMETRY_PLOT_DOCK_H
+#define TELEMETRY_PLOT_DOCK_H
+
+#include "PersistentSettings.h"
+
+#include <QDockWidget>
+#include <QPointer>
+#include <QTimer>
+
+// Forward Declarations
+class QComboBox;
+class QListWidget;
+class QLabel;
+class CSportTimeSeriesStore;
+class CTelemetryPlotWidget;
+
+// ============================================================================
+
+// Dock with a live plot of the telemetry history recorded for a port,
+//	with the list of sensors seen to choose from.  The stores are owned
+//	by the main window, one per port, and are fed by the telemetry
+//	monitor or script session running on each port.
+class CTelemetryPlotDock : public QDockWidget
+{
+	Q_OBJECT
+
+public:
+	static constexpr int STATUS_MSECS = 1000;		// Sensor list and status refresh interval
+
+	CTelemetryPlotDock(CSportTimeSeriesStore *arrStores, QWidget *pParent = nullptr);		// arrStores has SPIDE_COUNT entries
+
+protected slots:
+	void en_portChanged(int nIndex);
+	void en_spanChanged(int nIndex);
+	void en_seriesChanged();
+	void en_status();
+
+protected:
+	void refreshSeriesList();
+
+private:
+	CSportTimeSeriesStore *m_arrStores;
+	SPORT_ID_ENUM m_nSport = SPIDE_SPORT1;
+	// ----
+	QPointer<QComboBox> m_pPortCombo;
+	QPointer<QComboBox> m_pSpanCombo;
+	QPointer<QLabel> m_pStatusLabel;
+	QPointer<QListWidget> m_pSeriesList;
+	QPointer<CTelemetryPlotWidget> m_pPlot;
+	QTimer m_tmrStatus;
+};
+
+// ============================================================================
+
+#endif	// TELEMETRY_PLOT_DOCK_H
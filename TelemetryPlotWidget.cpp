@@ -0,0 +1,319 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#include "TelemetryPlotWidget.h"
+
+#include "frsky_sport_timeseries.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+#include <QResizeEvent>
+#include <QVector>
+
+#include <math.h>
+
+// ============================================================================
+
+namespace {
+	const QColor conarrSeriesColors[] =
+	{
+		QColor(31, 119, 180),
+		QColor(255, 127, 14),
+		QColor(44, 160, 44),
+		QColor(214, 39, 40),
+		QColor(148, 103, 189),
+		QColor(140, 86, 75),
+		QColor(227, 119, 194),
+		QColor(23, 190, 207),
+	};
+
+	// Samples in one pixel column:
+	struct TColumn {
+		bool m_bValid = false;
+		int32_t m_nMin = 0;
+		int32_t m_nMax = 0;
+		int32_t m_nFirst = 0;		// Value to connect from the previous column
+		int32_t m_nLast = 0;		// Value to connect to the next column
+	};
+
+	// Reduces the points to the min/max of each column, in a single pass.
+	//	Column 0 starts at nStartNsecs, and buckets that started before it
+	//	are counted in column 0:
+	void decimate(const QVector<CSportTimeSeries::TPoint> &arrPoints, int64_t nStartNsecs, int64_t nNsecsPerColumn, QVector<TColumn> &arrColumns)
+	{
+		for (auto const &pt : arrPoints) {
+			int nColumn = (pt.m_nTimestampNsecs > nStartNsecs) ? static_cast<int>((pt.m_nTimestampNsecs - nStartNsecs) / nNsecsPerColumn) : 0;
+			if (nColumn >= arrColumns.size()) nColumn = arrColumns.size()-1;
+			int32_t nValue = (pt.m_nCount == 1) ? pt.m_nMin : static_cast<int32_t>(lround(pt.avg()));
+			TColumn &column = arrColumns[nColumn];
+			if (!column.m_bValid) {
+				column.m_bValid = true;
+				column.m_nMin = pt.m_nMin;
+				column.m_nMax = pt.m_nMax;
+				column.m_nFirst = nValue;
+			} else {
+				if (pt.m_nMin < column.m_nMin) column.m_nMin = pt.m_nMin;
+				if (pt.m_nMax > column.m_nMax) column.m_nMax = pt.m_nMax;
+			}
+			column.m_nLast = nValue;
+		}
+	}
+};
+
+// ============================================================================
+
+CTelemetryPlotWidget::CTelemetryPlotWidget(QWidget *pParent)
+	:	QWidget(pParent)
+{
+	setAttribute(Qt::WA_OpaquePaintEvent);		// The cached plot covers everything
+	setMinimumSize(200, 100);
+
+	connect(&m_tmrRefresh, &QTimer::timeout, this, &CTelemetryPlotWidget::en_refresh);
+	m_tmrRefresh.start(REFRESH_MSECS);
+	m_tmrStats.start();
+}
+
+void CTelemetryPlotWidget::setStore(const CSportTimeSeriesStore *pStore)
+{
+	m_pStore = pStore;
+	m_nRightNsecs = -1;
+	update();
+}
+
+void CTelemetryPlotWidget::setSeries(const QList<uint32_t> &lstSeriesKeys)
+{
+	m_lstSeries.clear();
+	for (int ndx = 0; ndx < lstSeriesKeys.size(); ++ndx) {
+		TSeries series;
+		series.m_nKey = lstSeriesKeys.at(ndx);
+		series.m_color = seriesColor(ndx);
+		series.m_strName = CSportTimeSeriesStore::seriesName(series.m_nKey);
+		m_lstSeries.append(series);
+	}
+	m_nRightNsecs = -1;
+	update();
+}
+
+void CTelemetryPlotWidget::setSpan(int64_t nSpanNsecs)
+{
+	m_nSpanNsecs = qMax(nSpanNsecs, static_cast<int64_t>(1000000));
+	m_nRightNsecs = -1;
+	update();
+}
+
+QColor CTelemetryPlotWidget::seriesColor(int nIndex)
+{
+	return conarrSeriesColors[nIndex % (sizeof(conarrSeriesColors)/sizeof(conarrSeriesColors[0]))];
+}
+
+QString CTelemetryPlotWidget::renderStats()
+{
+	int64_t nElapsedNsecs = m_tmrStats.nsecsElapsed();
+	QString strStats = QString("Plot: %1 fps, render avg/max %2/%3 ms, %4 full redraws")
+				.arg(nElapsedNsecs ? (m_nFrames * 1.0e9 / nElapsedNsecs) : 0.0, 0, 'f', 1)
+				.arg(m_nFrames ? (m_nRenderNsecs / m_nFrames / 1000000.0) : 0.0, 0, 'f', 2)
+				.arg(m_nMaxRenderNsecs / 1000000.0, 0, 'f', 2)
+				.arg(m_nFullRedraws);
+	m_nFrames = 0;
+	m_nRenderNsecs = 0;
+	m_nMaxRenderNsecs = 0;
+	m_nFullRedraws = 0;
+	m_tmrStats.start();
+	return strStats;
+}
+
+// ----------------------------------------------------------------------------
+
+void CTelemetryPlotWidget::en_refresh()
+{
+	if ((m_pStore == nullptr) || !isVisible()) return;
+
+	// Only repaint if there's something new to draw:
+	uint64_t nInsertCount = m_pStore->insertCount();
+	if ((m_nRightNsecs >= 0) && (nInsertCount == m_nLastInsertCount)) return;
+	m_nLastInsertCount = nInsertCount;
+
+	QElapsedTimer tmrFrame;
+	tmrFrame.start();
+
+	int64_t nLatestNsecs = qMax(m_pStore->latestTimestamp(), static_cast<int64_t>(0));
+	int64_t nRightNsecs = ((nLatestNsecs / m_nNsecsPerColumn) + 1) * m_nNsecsPerColumn;
+	int nWidth = m_pixPlot.width();
+	if ((m_nRightNsecs < 0) || (m_pixPlot.size() != size()) || (nRightNsecs < m_nRightNsecs) ||
+		(((nRightNsecs - m_nRightNsecs) / m_nNsecsPerColumn) >= nWidth)) {
+		redraw(nLatestNsecs);
+	} else {
+		// Scroll by the elapsed columns and draw just the new ones, along
+		//	with the previous last column, which may have gotten more
+		//	samples since it was drawn:
+		int nShift = static_cast<int>((nRightNsecs - m_nRightNsecs) / m_nNsecsPerColumn);
+		if (nShift) m_pixPlot.scroll(-nShift, 0, m_pixPlot.rect());
+		m_nRightNsecs = nRightNsecs;
+		int nFirstColumn = qMax(nWidth - nShift - 1, 0);
+		{
+			QPainter painter(&m_pixPlot);
+			painter.fillRect(nFirstColumn, 0, nWidth - nFirstColumn, m_pixPlot.height(), palette().base());
+		}
+		if (!drawColumns(nFirstColumn, nWidth-1)) redraw(nLatestNsecs);
+	}
+
+	m_nFrameNsecs = tmrFrame.nsecsElapsed();
+	update();
+}
+
+void CTelemetryPlotWidget::redraw(int64_t nLatestNsecs)
+{
+	++m_nFullRedraws;
+	if (m_pixPlot.size() != size()) m_pixPlot = QPixmap(size());
+	if (m_pixPlot.isNull()) return;
+	m_pixPlot.fill(palette().base().color());
+
+	m_nNsecsPerColumn = qMax(m_nSpanNsecs / m_pixPlot.width(), static_cast<int64_t>(1));
+	m_nRightNsecs = ((nLatestNsecs / m_nNsecsPerColumn) + 1) * m_nNsecsPerColumn;
+	for (auto &series : m_lstSeries) series.m_bHaveScale = false;		// Rescale to what's visible
+	drawColumns(0, m_pixPlot.width()-1);
+}
+
+bool CTelemetryPlotWidget::drawColumns(int nFirstColumn, int nLastColumn)
+{
+	if ((m_pStore == nullptr) || (nLastColumn < nFirstColumn)) return true;
+
+	// Start a column early, to connect to what's already drawn:
+	int64_t nFromNsecs = m_nRightNsecs - (m_pixPlot.width() - nFirstColumn + 1) * m_nNsecsPerColumn;
+	int64_t nToNsecs = m_nRightNsecs - (m_pixPlot.width() - nLastColumn - 1) * m_nNsecsPerColumn - 1;
+	int nColumns = nLastColumn - nFirstColumn + 2;
+
+	// Decimate and check the scales of all series before drawing any:
+	QVector<QVector<TColumn> > arrSeriesColumns(m_lstSeries.size());
+	QVector<CSportTimeSeries::TPoint> arrPoints;
+	for (int ndx = 0; ndx < m_lstSeries.size(); ++ndx) {
+		TSeries &series = m_lstSeries[ndx];
+		CSportTimeSeries::TIER nTier = m_pStore->tierFor(series.m_nKey, nFromNsecs, nToNsecs, nColumns*4);
+		arrPoints.clear();
+		m_pStore->range(series.m_nKey, nTier, nFromNsecs, nToNsecs, arrPoints);
+		QVector<TColumn> &arrColumns = arrSeriesColumns[ndx];
+		arrColumns.resize(nColumns);
+		decimate(arrPoints, nFromNsecs, m_nNsecsPerColumn, arrColumns);
+
+		bool bHaveData = false;
+		int32_t nMin = 0;
+		int32_t nMax = 0;
+		for (auto const &column : arrColumns) {
+			if (!column.m_bValid) continue;
+			if (!bHaveData || (column.m_nMin < nMin)) nMin = column.m_nMin;
+			if (!bHaveData || (column.m_nMax > nMax)) nMax = column.m_nMax;
+			bHaveData = true;
+		}
+		if (!bHaveData) continue;
+		if (!series.m_bHaveScale) {
+			double dRange = static_cast<double>(nMax) - nMin;
+			if (dRange == 0) dRange = qMax(fabs(static_cast<double>(nMax)) / 10.0, 1.0);
+			series.m_dScaleMin = nMin - dRange/10.0;
+			series.m_dScaleMax = nMax + dRange/10.0;
+			series.m_bHaveScale = true;
+		} else if ((nMin < series.m_dScaleMin) || (nMax > series.m_dScaleMax)) {
+			return false;
+		}
+	}
+
+	QPainter painter(&m_pixPlot);
+	for (int ndx = 0; ndx < m_lstSeries.size(); ++ndx) {
+		TSeries &series = m_lstSeries[ndx];
+		const QVector<TColumn> &arrColumns = arrSeriesColumns.at(ndx);
+		painter.setPen(series.m_color);
+		bool bHavePrevious = arrColumns.at(0).m_bValid;
+		int nPreviousY = bHavePrevious ? valueToY(series, arrColumns.at(0).m_nLast) : 0;
+		for (int nColumn = 1; nColumn < nColumns; ++nColumn) {
+			const TColumn &column = arrColumns.at(nColumn);
+			if (!column.m_bValid) continue;
+			int nX = nFirstColumn + nColumn - 1;
+			if (bHavePrevious) painter.drawLine(nX-1, nPreviousY, nX, valueToY(series, column.m_nFirst));
+			painter.drawLine(nX, valueToY(series, column.m_nMax), nX, valueToY(series, column.m_nMin));
+			nPreviousY = valueToY(series, column.m_nLast);
+			bHavePrevious = true;
+			series.m_nLastValue = column.m_nLast;
+			series.m_bHaveLast = true;
+		}
+	}
+
+	return true;
+}
+
+int CTelemetryPlotWidget::valueToY(const TSeries &series, int32_t nValue) const
+{
+	int nHeight = m_pixPlot.height() - 4;		// Keep 2 pixels clear top and bottom
+	double dRange = series.m_dScaleMax - series.m_dScaleMin;
+	if (dRange <= 0) return m_pixPlot.height()/2;
+	return (m_pixPlot.height() - 2) - static_cast<int>((nValue - series.m_dScaleMin) / dRange * nHeight);
+}
+
+// ----------------------------------------------------------------------------
+
+void CTelemetryPlotWidget::paintEvent(QPaintEvent *pEvent)
+{
+	Q_UNUSED(pEvent);
+
+	QElapsedTimer tmrPaint;
+	tmrPaint.start();
+
+	QPainter painter(this);
+	if (m_pixPlot.isNull()) {
+		painter.fillRect(rect(), palette().base());
+	} else {
+		painter.drawPixmap(0, 0, m_pixPlot);
+	}
+
+	if (m_lstSeries.isEmpty()) {
+		painter.setPen(palette().text().color());
+		painter.drawText(rect(), Qt::AlignCenter, tr("Select the sensors to plot"));
+	} else {
+		// Legend, with each series' latest value and scale:
+		QFontMetrics fm = painter.fontMetrics();
+		int nY = 4;
+		for (auto const &series : m_lstSeries) {
+			QString strLegend = series.m_strName;
+			if (series.m_bHaveLast) {
+				strLegend += QString(" = %1  [%2 .. %3]").arg(series.m_nLastValue)
+								.arg(static_cast<qint64>(series.m_dScaleMin))
+								.arg(static_cast<qint64>(series.m_dScaleMax));
+			}
+			painter.fillRect(4, nY, fm.height(), fm.height(), series.m_color);
+			painter.setPen(palette().text().color());
+			painter.drawText(8 + fm.height(), nY + fm.ascent(), strLegend);
+			nY += fm.height() + 2;
+		}
+	}
+
+	int64_t nNsecs = m_nFrameNsecs + tmrPaint.nsecsElapsed();
+	m_nFrameNsecs = 0;
+	++m_nFrames;
+	m_nRenderNsecs += nNsecs;
+	if (nNsecs > m_nMaxRenderNsecs) m_nMaxRenderNsecs = nNsecs;
+}
+
+void CTelemetryPlotWidget::resizeEvent(QResizeEvent *pEvent)
+{
+	m_nRightNsecs = -1;			// Redraw at the next refresh
+	QWidget::resizeEvent(pEvent);
+}
+
+// ============================================================================
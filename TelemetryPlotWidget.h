@@ -0,0 +1,115 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#ifndef TELEMETRY_PLOT_WIDGET_H
+#define TELEMETRY_PLOT_WIDGET_H
+
+#include <QWidget>
+#include <QPixmap>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QList>
+#include <QColor>
+#include <QString>
+
+#include <stdint.h>
+
+// Forward Declarations
+class CSportTimeSeriesStore;
+
+// ============================================================================
+
+//
+// Live strip chart of telemetry series from a CSportTimeSeriesStore,
+//	with the newest data at the right edge.  Each pixel column is drawn
+//	as the min/max of the samples that fall in it (from whichever tier of
+//	the store has enough resolution), so the cost of drawing depends on
+//	the width of the plot rather than the bus rate.  The plot is cached in
+//	a pixmap, and as time advances it's scrolled and only the new columns
+//	are drawn, unless a series' values go outside its current scale.
+//
+// Repaints are throttled to a refresh timer and only happen when the
+//	store has new data.  Each series is scaled to its own min/max.
+//
+class CTelemetryPlotWidget : public QWidget
+{
+	Q_OBJECT
+
+public:
+	static constexpr int REFRESH_MSECS = 16;			// Refresh (and so repaint) interval, about 60 fps
+	static constexpr int64_t DEFAULT_SPAN_NSECS = 60000000000LL;	// Default time span across the plot
+
+	explicit CTelemetryPlotWidget(QWidget *pParent = nullptr);
+
+	void setStore(const CSportTimeSeriesStore *pStore);
+	void setSeries(const QList<uint32_t> &lstSeriesKeys);	// CSportTimeSeriesStore::seriesKey() of each series to plot
+	void setSpan(int64_t nSpanNsecs);
+	int64_t span() const { return m_nSpanNsecs; }
+
+	static QColor seriesColor(int nIndex);
+
+	QString renderStats();			// Frame rate and render times since the last call
+
+protected:
+	virtual void paintEvent(QPaintEvent *pEvent) override;
+	virtual void resizeEvent(QResizeEvent *pEvent) override;
+
+protected slots:
+	void en_refresh();
+
+private:
+	struct TSeries {
+		uint32_t m_nKey = 0;
+		QColor m_color;
+		QString m_strName;
+		bool m_bHaveScale = false;
+		double m_dScaleMin = 0;				// Value range mapped to the height of the plot
+		double m_dScaleMax = 0;
+		bool m_bHaveLast = false;
+		int32_t m_nLastValue = 0;			// Most recent value drawn, for the legend
+	};
+
+	void redraw(int64_t nRightNsecs);							// Full redraw with nRightNsecs at the right edge
+	bool drawColumns(int nFirstColumn, int nLastColumn);		// False if a series needs rescaling (and so a full redraw)
+	int valueToY(const TSeries &series, int32_t nValue) const;
+
+	const CSportTimeSeriesStore *m_pStore = nullptr;
+	QList<TSeries> m_lstSeries;
+	int64_t m_nSpanNsecs = DEFAULT_SPAN_NSECS;
+	// ----
+	QPixmap m_pixPlot;					// Cached plot, one column per pixel
+	int64_t m_nNsecsPerColumn = 1;
+	int64_t m_nRightNsecs = -1;			// Time at the (exclusive) right edge of m_pixPlot, -1 if it needs a full redraw
+	uint64_t m_nLastInsertCount = 0;	// Store's insertCount() when last drawn
+	QTimer m_tmrRefresh;
+	// ----
+	int m_nFrames = 0;					// Render statistics since the last renderStats()
+	int64_t m_nRenderNsecs = 0;
+	int64_t m_nMaxRenderNsecs = 0;
+	int m_nFullRedraws = 0;
+	QElapsedTimer m_tmrStats;			// Time since the last renderStats()
+	int64_t m_nFrameNsecs = 0;			// Time spent on the current frame so far
+};
+
+// ============================================================================
+
+#endif	// TELEMETRY_PLOT_WIDGET_H
@@ -55,6 +55,8 @@ apt-get update
 apt-get install -y cmake
 # Dependencies for Lua.  It also needs libdl, but that's part of the libc6 package:
 apt-get install -y libreadline-dev
+# Optional, for compressed log files:
+apt-get install -y zlib1g-dev
 
 
 # ----------------------
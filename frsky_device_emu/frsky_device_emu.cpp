@@ -63,6 +63,7 @@ int main(int argc, char *argv[])
 	QString strFirmwareIn;
 	QString strFirmwareOut;
 	QString strLogFile;
+	QString strLogFilter = CPersistentSettings::instance()->getLogFileFilter();
 	SPORT_ID_ENUM nSport = CPersistentSettings::instance()->getFirmwareSportPort();
 	QString strPort;
 	int nBaudRate = 57600;
@@ -132,6 +133,13 @@ int main(int argc, char *argv[])
 			} else {
 				strLogFile = strArg.mid(2);
 			}
+		} else if (strArg.startsWith("-F")) {
+			if ((strArg == "-F") && (argc > ndx+1)) {
+				strLogFilter = argv[ndx+1];
+				++ndx;
+			} else {
+				strLogFilter = strArg.mid(2);
+			}
 		} else if (strArg == "-m") {
 			bSportMonMode = true;
 		} else if (strArg == "-i") {
@@ -158,6 +166,10 @@ int main(int argc, char *argv[])
 		std::cerr << "    -s <port-settings> = where port-settings is a comma separated list of" << std::endl;
 		std::cerr << "                    \"DataBit,Parity,StopBit\", such as \"8,N,1\" (which is the default)" << std::endl;
 		std::cerr << "    -l <logfile>  = optional communications log file to generate" << std::endl;
+		std::cerr << "                    (written in the indexed binary format, for frsky_log_view," << std::endl;
+		std::cerr << "                    if the filename ends in \".slog\")" << std::endl;
+		std::cerr << "    -F <log-filter> = optional log filter, such as \"type=rx,tx;phys!=0x1B\"" << std::endl;
+		std::cerr << "                    (keys: port, type, phys, prim, data; errors are always logged)" << std::endl;
 		std::cerr << "    -f <firmware-in> = optional input firmware filename to use for comparison" << std::endl;
 		std::cerr << "                    (if omitted, will skip byte-wise checks for firmware content)" << std::endl;
 		std::cerr << "    -w <firware-out> = optional output firmware filename to write received data" << std::endl;
@@ -173,6 +185,11 @@ int main(int argc, char *argv[])
 	std::cerr << "frsky_device_emu version: " << strVersion.toUtf8().data() << std::endl;
 
 	CFrskySportIO sport(nSport);
+	QString strFilterError;
+	if (!sport.logFilter().parse(strLogFilter, &strFilterError)) {
+		std::cerr << "Invalid log filter: " << strFilterError.toUtf8().data() << std::endl;
+		return -1;
+	}
 	if (!sport.openPort(strPort, nBaudRate, nDataBits, chParity, nStopBits)) {
 		std::cerr << "Failed to open serial port" << std::endl;
 		std::cerr << sport.getLastError().toUtf8().data() << std::endl;
@@ -190,6 +207,7 @@ int main(int argc, char *argv[])
 	std::cerr << "Port Settings: " << lstPortSettings.join(',').toUtf8().data() << std::endl;
 	if (!strLogFile.isEmpty()) {
 		std::cerr << "Log File: " << strLogFile.toUtf8().data() << std::endl;
+		if (!sport.logFilter().acceptsAll()) std::cerr << "Log Filter: " << sport.logFilter().spec().toUtf8().data() << std::endl;
 	}
 	if (!strFirmwareIn.isEmpty()) {
 		std::cerr << "Input (comparison) Firmware File: " << strFirmwareIn.toUtf8().data() << std::endl;
@@ -247,11 +265,18 @@ int main(int argc, char *argv[])
 
 	CLogFile logFile;
 	if (!strLogFile.isEmpty()) {
+		logFile.setFlushInterval(CPersistentSettings::instance()->getLogFileFlushInterval());
+		logFile.setRotation(static_cast<qint64>(CPersistentSettings::instance()->getLogFileRotateSize())*1024*1024,
+							static_cast<qint64>(CPersistentSettings::instance()->getLogFileRotateMinutes())*60000,
+							CPersistentSettings::instance()->getLogFileRotateKeep());
 		if (!logFile.openLogFile(strLogFile, QIODevice::WriteOnly)) {
 			std::cerr << "Failed to open \"" << strLogFile.toUtf8().data() << "\" for writing" << std::endl;
 			std::cerr << logFile.getLastError().toUtf8().data() << std::endl;
 			return -5;
 		}
+		QObject::connect(&logFile, &CLogFile::logFileError, &logFile, [](const QString &strError)->void {
+			std::cerr << strError.toUtf8().data() << std::endl;
+		});
 		QObject::connect(&sport, &CFrskySportIO::writeLogString, &sport,
 							[&logFile](SPORT_ID_ENUM nSport, const QString &strMessage)->void {
 								Q_UNUSED(nSport);
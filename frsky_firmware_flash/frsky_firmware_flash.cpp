@@ -61,6 +61,7 @@ int main(int argc, char *argv[])
 
 	QString strFirmware;
 	QString strLogFile;
+	QString strLogFilter = CPersistentSettings::instance()->getLogFileFilter();
 	bool bLogEchos = false;
 	SPORT_ID_ENUM nSport = CPersistentSettings::instance()->getFirmwareSportPort();
 	QString strPort = CPersistentSettings::instance()->getDeviceSerialPort(nSport);
@@ -125,6 +126,13 @@ int main(int argc, char *argv[])
 			} else {
 				strLogFile = strArg.mid(2);
 			}
+		} else if (strArg.startsWith("-F")) {
+			if ((strArg == "-F") && (argc > ndx+1)) {
+				strLogFilter = argv[ndx+1];
+				++ndx;
+			} else {
+				strLogFilter = strArg.mid(2);
+			}
 		} else if (strArg == "-e") {
 			bLogEchos = true;
 		} else if (strArg == "-i") {
@@ -161,6 +169,10 @@ int main(int argc, char *argv[])
 		std::cerr << "                    \"DataBit,Parity,StopBit\", such as \"8,E,2\"" << std::endl;
 		std::cerr << "                    If omitted, will use current setting of \"" << lstDefaultPortSettings.join(',').toUtf8().data() << "\"" << std::endl;
 		std::cerr << "    -l <logfile>  = optional communications log file to generate" << std::endl;
+		std::cerr << "                    (written in the indexed binary format, for frsky_log_view," << std::endl;
+		std::cerr << "                    if the filename ends in \".slog\")" << std::endl;
+		std::cerr << "    -F <log-filter> = optional log filter, such as \"type=rx,tx;phys!=0x1B\"" << std::endl;
+		std::cerr << "                    (keys: port, type, phys, prim, data; errors are always logged)" << std::endl;
 		std::cerr << "    -e = Log transmit echo messages" << std::endl;
 		std::cerr << "    -i = interactive mode, enables prompts" << std::endl;
 		std::cerr << std::endl << std::endl;
@@ -173,6 +185,11 @@ int main(int argc, char *argv[])
 	CPersistentSettings::instance()->setFirmwareLogTxEchos(bLogEchos);
 
 	CFrskySportIO sport(nSport);
+	QString strFilterError;
+	if (!sport.logFilter().parse(strLogFilter, &strFilterError)) {
+		std::cerr << "Invalid log filter: " << strFilterError.toUtf8().data() << std::endl;
+		return -1;
+	}
 	if (!sport.openPort(strPort, nBaudRate, nDataBits, chParity, nStopBits)) {
 		std::cerr << "Failed to open serial port" << std::endl;
 		std::cerr << sport.getLastError().toUtf8().data() << std::endl;
@@ -191,6 +208,7 @@ int main(int argc, char *argv[])
 	if (!strLogFile.isEmpty()) {
 		std::cerr << "Log File: " << strLogFile.toUtf8().data() << std::endl;
 		std::cerr << "Logging Echos: " << (CPersistentSettings::instance()->getFirmwareLogTxEchos() ? "True" : "False") << std::endl;
+		if (!sport.logFilter().acceptsAll()) std::cerr << "Log Filter: " << sport.logFilter().spec().toUtf8().data() << std::endl;
 	}
 	std::cerr << "Firmware File: " << strFirmware.toUtf8().data() << std::endl;
 
@@ -218,6 +236,10 @@ int main(int argc, char *argv[])
 			}
 		}
 
+		logFile.setFlushInterval(CPersistentSettings::instance()->getLogFileFlushInterval());
+		logFile.setRotation(static_cast<qint64>(CPersistentSettings::instance()->getLogFileRotateSize())*1024*1024,
+							static_cast<qint64>(CPersistentSettings::instance()->getLogFileRotateMinutes())*60000,
+							CPersistentSettings::instance()->getLogFileRotateKeep());
 		if (!logFile.openLogFile(strLogFile, QIODevice::WriteOnly)) {
 			std::cerr << "Failed to open \"" << strLogFile.toUtf8().data() << "\" for writing" << std::endl;
 			std::cerr << logFile.getLastError().toUtf8().data() << std::endl;
@@ -0,0 +1,242 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#include <LogFileReader.h>
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+
+#include <iostream>
+#include <stdio.h>
+
+#include <version.h>
+
+// ============================================================================
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	QString strREV = GIT_REV;
+	QString strTAG = GIT_TAG;
+	QString strBRANCH = GIT_BRANCH;
+
+	QString strVersion;
+	if (!strTAG.isEmpty()) {
+		strVersion = strTAG;
+	} else {
+		strVersion = QString("%1/%2").arg(strBRANCH, strREV);
+	}
+
+	app.setApplicationVersion(strVersion);
+	app.setApplicationName("frsky_sport_tool");		// Note: use package name here instead of this app so we can use its common settings
+	app.setOrganizationName("Dewtronics");
+	app.setOrganizationDomain("dewtronics.com");
+
+	QString strLogFile;
+	QString strOutput;
+	double dblStartMsecs = -1;
+	qint64 nCrcError = 0;			// 1-based, 0 = not selected
+	qint64 nError = 0;				// 1-based, 0 = not selected
+	int nBefore = 0;
+	qint64 nCount = 0;				// 0 = all
+	bool bSummaryOnly = false;
+	bool bShowIndex = false;
+	bool bNeedUsage = false;
+	int nArgsFound = 0;
+
+	for (int ndx = 1; ndx < argc; ++ndx) {
+		QString strArg = argv[ndx];
+		if (!strArg.startsWith("-")) {
+			switch (nArgsFound) {
+				case 0:
+					strLogFile = strArg;
+					break;
+				default:
+					bNeedUsage = true;
+					break;
+			}
+			++nArgsFound;
+		} else if (strArg.startsWith("-o")) {
+			if ((strArg == "-o") && (argc > ndx+1)) {
+				strOutput = argv[ndx+1];
+				++ndx;
+			} else {
+				strOutput = strArg.mid(2);
+			}
+		} else if (strArg.startsWith("-t")) {
+			if ((strArg == "-t") && (argc > ndx+1)) {
+				dblStartMsecs = strtod(argv[ndx+1], nullptr);
+				++ndx;
+			} else {
+				dblStartMsecs = strtod(strArg.mid(2).toUtf8().data(), nullptr);
+			}
+		} else if (strArg.startsWith("-e")) {
+			if ((strArg == "-e") && (argc > ndx+1)) {
+				nCrcError = strtoull(argv[ndx+1], nullptr, 0);
+				++ndx;
+			} else {
+				nCrcError = strtoull(strArg.mid(2).toUtf8().data(), nullptr, 0);
+			}
+		} else if (strArg.startsWith("-E")) {
+			if ((strArg == "-E") && (argc > ndx+1)) {
+				nError = strtoull(argv[ndx+1], nullptr, 0);
+				++ndx;
+			} else {
+				nError = strtoull(strArg.mid(2).toUtf8().data(), nullptr, 0);
+			}
+		} else if (strArg.startsWith("-b")) {
+			if ((strArg == "-b") && (argc > ndx+1)) {
+				nBefore = strtoul(argv[ndx+1], nullptr, 0);
+				++ndx;
+			} else {
+				nBefore = strtoul(strArg.mid(2).toUtf8().data(), nullptr, 0);
+			}
+		} else if (strArg.startsWith("-n")) {
+			if ((strArg == "-n") && (argc > ndx+1)) {
+				nCount = strtoull(argv[ndx+1], nullptr, 0);
+				++ndx;
+			} else {
+				nCount = strtoull(strArg.mid(2).toUtf8().data(), nullptr, 0);
+			}
+		} else if (strArg == "-s") {
+			bSummaryOnly = true;
+		} else if (strArg == "-i") {
+			bShowIndex = true;
+		} else {
+			bNeedUsage = true;
+		}
+	}
+	if (strLogFile.isEmpty()) bNeedUsage = true;
+	if (((dblStartMsecs >= 0) + (nCrcError > 0) + (nError > 0)) > 1) bNeedUsage = true;
+
+	if (bNeedUsage) {
+		std::cerr << "Frsky Binary Log Viewer" << std::endl;
+		std::cerr << "Version: " << strVersion.toUtf8().data() << std::endl << std::endl;
+		std::cerr << "Usage: frsky_log_view [options] <logfile>" << std::endl;
+		std::cerr << std::endl;
+		std::cerr << "Where:" << std::endl;
+		std::cerr << "    <logfile> = Binary log file to read (required), as written by the" << std::endl;
+		std::cerr << "                    other tools when the log file has a \".slog\" suffix" << std::endl;
+		std::cerr << std::endl;
+		std::cerr << "Options:" << std::endl;
+		std::cerr << "    -o <text-file> = optional output file to write the messages to as a" << std::endl;
+		std::cerr << "                    text log (if omitted, will write to stdout)" << std::endl;
+		std::cerr << "    -t <msecs> = start at the first message at or after this log time" << std::endl;
+		std::cerr << "    -e <n> = start at the nth (1-based) CRC error" << std::endl;
+		std::cerr << "    -E <n> = start at the nth (1-based) message with any error (\"***\")" << std::endl;
+		std::cerr << "                    (only one of -t, -e or -E can be used)" << std::endl;
+		std::cerr << "    -b <count> = also output this many messages before the start" << std::endl;
+		std::cerr << "    -n <count> = number of messages to output (if omitted, outputs all" << std::endl;
+		std::cerr << "                    messages to the end of the log)" << std::endl;
+		std::cerr << "    -s = only print the log summary" << std::endl;
+		std::cerr << "    -i = print the block index with the summary" << std::endl;
+		std::cerr << std::endl << std::endl;
+
+		return -1;
+	}
+
+	CLogFileReader reader;
+	QString strError;
+	if (!reader.open(strLogFile, &strError)) {
+		std::cerr << "Failed to open \"" << strLogFile.toUtf8().data() << "\" for reading" << std::endl;
+		std::cerr << strError.toUtf8().data() << std::endl;
+		return -2;
+	}
+
+	std::cerr << "Log File: " << strLogFile.toUtf8().data() << std::endl;
+	std::cerr << reader.summary().toUtf8().data() << std::endl;
+	if (bShowIndex) {
+		for (int nBlock = 0; nBlock < reader.blockCount(); ++nBlock) {
+			const BinaryLog::TBlock &block = reader.block(nBlock);
+			QString strCounts;
+			for (int i = 0; i < BinaryLog::LOG_TYPE_COUNT; ++i) {
+				strCounts += QString(" %1").arg(block.m_arrLogTypeCounts[i], 6);
+			}
+			std::cerr << QString("Block %1: @%2, %3 ms to %4 ms, %5 messages, %6 errors, %7 CRC errors, by type:%8, other: %9")
+							.arg(nBlock, 5).arg(block.m_nFirstOffset)
+							.arg(static_cast<double>(block.m_nFirstNsecs)/1000000.0, 0, 'f', 4)
+							.arg(static_cast<double>(block.m_nLastNsecs)/1000000.0, 0, 'f', 4)
+							.arg(block.m_nMessages).arg(block.m_nErrors).arg(block.m_nCrcErrors)
+							.arg(strCounts).arg(block.m_nOtherCount).toUtf8().data() << std::endl;
+		}
+	}
+	if (bSummaryOnly) return 0;
+
+	qint64 nOffset = reader.firstMessage();
+	if (dblStartMsecs >= 0) {
+		nOffset = reader.findTime(static_cast<int64_t>(dblStartMsecs * 1000000.0));
+	} else if (nCrcError > 0) {
+		nOffset = reader.findError(nCrcError-1, true);
+		if (nOffset < 0) {
+			std::cerr << "Log has only " << reader.errorCount(true) << " CRC errors" << std::endl;
+			return -3;
+		}
+	} else if (nError > 0) {
+		nOffset = reader.findError(nError-1, false);
+		if (nOffset < 0) {
+			std::cerr << "Log has only " << reader.errorCount(false) << " errors" << std::endl;
+			return -3;
+		}
+	}
+	if ((nOffset >= 0) && (nBefore > 0)) {
+		qint64 nStart = reader.findPrevious(nOffset, nBefore);
+		if (nCount) {
+			// Count the context messages in with the ones requested:
+			for (qint64 nScan = nStart; (nScan >= 0) && (nScan != nOffset); nScan = reader.nextMessage(nScan)) ++nCount;
+		}
+		nOffset = nStart;
+	}
+
+	QFile fileOutput;
+	if (!strOutput.isEmpty()) {
+		fileOutput.setFileName(strOutput);
+		if (!fileOutput.open(QIODevice::WriteOnly)) {
+			std::cerr << "Failed to open output file \"" << strOutput.toUtf8().data() << "\" for writing" << std::endl;
+			std::cerr << fileOutput.errorString().toUtf8().data() << std::endl;
+			return -4;
+		}
+	} else {
+		if (!fileOutput.open(stdout, QIODevice::WriteOnly)) {
+			std::cerr << "Failed to open stdout for writing" << std::endl;
+			return -4;
+		}
+	}
+
+	// Note: the lines are written the same as CLogFile writes its text logs,
+	//	so the output can be read by anything that reads those:
+	QTextStream streamOutput(&fileOutput);
+	CLogFileReader::TMessage msg;
+	qint64 nWritten = 0;
+	for ( ; (nOffset >= 0) && (!nCount || (nWritten < nCount)); nOffset = reader.nextMessage(nOffset)) {
+		if (!reader.readMessage(nOffset, msg)) break;
+		streamOutput << msg.logLine() << "\n";
+		++nWritten;
+	}
+	streamOutput.flush();
+	fileOutput.close();
+
+	return 0;
+}
+
+// ============================================================================
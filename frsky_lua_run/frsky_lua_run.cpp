@@ -0,0 +1,808 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+
+#include <PersistentSettings.h>
+#include <LogFile.h>
+#include <frsky_sport_io.h>
+#include <frsky_sport_telemetry.h>
+#include <frsky_sport_shm_publisher.h>
+#include <LuaEvents.h>
+#include <LuaEngine.h>
+#include <LuaGeneral.h>
+#include <LuaLCD.h>
+#include <LuaBytecodeCache.h>
+
+#include <QGuiApplication>
+#include <QFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+#include <QTimer>
+#include <QTextStream>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QList>
+#include <QThread>
+#include <QElapsedTimer>
+
+#include <iostream>
+
+#include <version.h>
+
+// ============================================================================
+
+namespace {
+	// Scripted key input file entry.  Each line of the file is:
+	//		<delay-ms> <action> <key>
+	//	where <delay-ms> is the time to wait after the previous entry (or
+	//	after the script starts for the first entry), <action> is one of
+	//	"press", "release", "repeat", "long", or "tap", and <key> is a
+	//	Lua key name (PGUP, PGDN, ENTER, MODEL, UP, EXIT, DOWN, TELEM,
+	//	RIGHT, RADIO, LEFT).  Blank lines and lines starting with '#'
+	//	are ignored.
+	struct TKeyScriptEntry {
+		enum KEY_ACTION {
+			KA_PRESS,			// Key pressed (EVT_KEY_FIRST)
+			KA_RELEASE,			// Key released (EVT_KEY_BREAK)
+			KA_REPEAT,			// Key auto-repeat (EVT_KEY_LONG on first, EVT_KEY_REPT after)
+			KA_LONG,			// Press followed by auto-repeat (EVT_KEY_FIRST, EVT_KEY_LONG)
+			KA_TAP,				// Press followed by release (EVT_KEY_FIRST, EVT_KEY_BREAK)
+		};
+
+		int m_nDelay = 0;
+		KEY_ACTION m_nAction = KA_TAP;
+		event_t m_nKey = EVT_NONE;
+	};
+
+	bool readKeyScript(const QString &strFilename, QList<TKeyScriptEntry> &lstEntries, QString &strError)
+	{
+		QFile fileKeys(strFilename);
+		if (!fileKeys.open(QIODevice::ReadOnly | QIODevice::Text)) {
+			strError = fileKeys.errorString();
+			return false;
+		}
+
+		QTextStream tsKeys(&fileKeys);
+		int nLine = 0;
+		while (!tsKeys.atEnd()) {
+			QString strLine = tsKeys.readLine().trimmed();
+			++nLine;
+			if (strLine.isEmpty() || strLine.startsWith('#')) continue;
+
+			QStringList lstFields = strLine.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
+			TKeyScriptEntry entry;
+			bool bOK = (lstFields.size() == 3);
+			if (bOK) entry.m_nDelay = lstFields.at(0).toInt(&bOK);
+			if (bOK) {
+				QString strAction = lstFields.at(1).toLower();
+				if (strAction == "press") {
+					entry.m_nAction = TKeyScriptEntry::KA_PRESS;
+				} else if (strAction == "release") {
+					entry.m_nAction = TKeyScriptEntry::KA_RELEASE;
+				} else if (strAction == "repeat") {
+					entry.m_nAction = TKeyScriptEntry::KA_REPEAT;
+				} else if (strAction == "long") {
+					entry.m_nAction = TKeyScriptEntry::KA_LONG;
+				} else if (strAction == "tap") {
+					entry.m_nAction = TKeyScriptEntry::KA_TAP;
+				} else {
+					bOK = false;
+				}
+			}
+			if (bOK) {
+				entry.m_nKey = CLuaEvents::keyNameToKey(lstFields.at(2));
+				bOK = (entry.m_nKey != EVT_NONE);
+			}
+			if (!bOK || (entry.m_nDelay < 0)) {
+				strError = QString("Syntax error on line %1: \"%2\"").arg(nLine).arg(strLine);
+				return false;
+			}
+			lstEntries.append(entry);
+		}
+
+		return true;
+	}
+
+	// ------------------------------------------------------------------------
+
+	// Options shared by all of the script sessions:
+	struct TSessionOptions {
+		QString m_strScript;
+		QString m_strFrameDir;
+		QString m_strHistoryFile;
+		QString m_strShmName;
+		QList<TKeyScriptEntry> m_lstKeyScript;
+		int m_nStartDelay = 1000;
+		int m_nTimeout = 0;
+		int m_nWakeRate = 0;
+		int m_nMemoryLimit = 0;
+		int m_nInstructionsLimit = 0;
+		bool m_bSystemAllocator = false;
+		bool m_bMultiSession = false;		// True if there's more than one session, to label the output and frames
+	};
+
+	// One script session, running the script on one port.  Each session
+	//	runs on its own thread with its own Lua state, telemetry handler
+	//	and LCD, so sessions on different ports run concurrently:
+	class CScriptSession : public QThread
+	{
+	public:
+		CScriptSession(int nSession, SPORT_ID_ENUM nSport, const TSessionOptions &options)
+			:	m_nSession(nSession),
+				m_options(options),
+				m_sport(nSport)
+		{
+		}
+
+		CFrskySportIO &sport() { return m_sport; }
+		CSportShmPublisher &shmPublisher() { return m_shmPublisher; }
+		QString label() const { return m_options.m_bMultiSession ? QString("Session %1: ").arg(m_nSession+1) : QString(); }
+
+		// Moves the (opened) port to the session thread and starts it:
+		void startSession()
+		{
+			m_pOwnerThread = m_sport.thread();
+			m_sport.moveToThread(this);
+			m_sport.port().moveToThread(this);
+			start();
+		}
+
+		int result() const { return m_nResult; }
+		qint64 scriptNsecs() const { return m_nScriptNsecs; }		// Wall time from script start to finish
+		const QStringList &report() const { return m_lstReport; }	// End of session statistics
+
+	protected:
+		virtual void run() override;
+		void writeMessage(const QString &strMessage) const
+		{
+			std::cerr << (label() + strMessage).toUtf8().data() << std::endl;
+		}
+
+	private:
+		int m_nSession;
+		const TSessionOptions &m_options;
+		CFrskySportIO m_sport;
+		CSportTimeSeriesStore m_timeSeries;		// Sensor history, when writing it
+		CSportShmPublisher m_shmPublisher;		// Shared memory to publish the telemetry in, when opened
+		QThread *m_pOwnerThread = nullptr;
+		// ----
+		int m_nResult = 0;
+		qint64 m_nScriptNsecs = 0;
+		QStringList m_lstReport;
+	};
+
+	void CScriptSession::run()
+	{
+		{
+			CFrskySportDeviceTelemetry telemetry(m_sport);
+			if (!m_options.m_strHistoryFile.isEmpty()) telemetry.setTimeSeriesStore(&m_timeSeries);
+			if (m_shmPublisher.isOpen()) telemetry.setShmPublisher(&m_shmPublisher);
+			CLuaEvents luaEvents;
+			CLuaEngine luaEngine;
+			CLuaGeneral luaGeneral(&telemetry);
+			CLuaLCD luaLCD;
+			QElapsedTimer tmrScript;
+
+			QObject::connect(&luaEngine, SIGNAL(killKeyEvent(event_t)), &luaEvents, SLOT(killKeyEvent(event_t)));
+			QObject::connect(&luaGeneral, SIGNAL(killKeyEvent(event_t)), &luaEvents, SLOT(killKeyEvent(event_t)));
+			QObject::connect(&luaEvents, SIGNAL(luaEvent(event_t)), &luaEngine, SLOT(runLuaScript(event_t)));
+			QObject::connect(&luaGeneral, SIGNAL(rxSportPacketAvailable()), &luaEvents, SLOT(wakeEvent()));
+			QObject::connect(&luaGeneral, SIGNAL(sportRequestsFinished()), &luaEngine, SLOT(resumeLuaScript()));
+			// Note: These are all per thread, so must be set on the session thread:
+			luaEvents.setWakeRate(m_options.m_nWakeRate);
+			luaEngine.setMemoryLimit(m_options.m_nMemoryLimit * 1024);
+			luaEngine.setUsePoolAllocator(!m_options.m_bSystemAllocator);
+			luaEngine.setInstructionsLimit(m_options.m_nInstructionsLimit);
+
+			QObject::connect(&luaEngine, &CLuaEngine::scriptError, &luaEngine,
+								[this](const QString &strTitle, const QString &strMessage, bool bAcknowledge)->void {
+									Q_UNUSED(bAcknowledge);
+									writeMessage(strTitle + ": " + strMessage);
+								});
+			QObject::connect(&luaEngine, &CLuaEngine::scriptFinished, &luaEngine,
+								[this, &tmrScript](int nStatus)->void {
+									m_nScriptNsecs = tmrScript.nsecsElapsed();
+									// Running to completion reports SCRIPT_NOFILE:
+									exit((nStatus == CLuaEngine::SCRIPT_NOFILE) ? 0 : (-10 - nStatus));
+								});
+
+			int nFrame = 0;
+			if (!m_options.m_strFrameDir.isEmpty()) {
+				QString strFramePrefix = m_options.m_bMultiSession ? QString("session%1_frame").arg(m_nSession+1) : QString("frame");
+				QObject::connect(&luaLCD, &CLuaLCD::frameReady, &luaLCD,
+									[this, &nFrame, strFramePrefix](const QImage &image)->void {
+										QString strFrameFile = QString("%1/%2_%3.png").arg(m_options.m_strFrameDir, strFramePrefix).arg(nFrame++, 6, 10, QChar('0'));
+										if (!image.save(strFrameFile, "PNG")) {
+											writeMessage("*** Warning: Failed to write \"" + strFrameFile + "\"");
+										}
+									});
+			}
+
+			// Feed scripted keys, each one timed relative to the previous one:
+			const QList<TKeyScriptEntry> &lstKeyScript = m_options.m_lstKeyScript;
+			QTimer tmrKeys;
+			tmrKeys.setSingleShot(true);
+			int ndxKey = 0;
+			QObject::connect(&tmrKeys, &QTimer::timeout, &luaEvents,
+								[&tmrKeys, &ndxKey, &lstKeyScript, &luaEvents]()->void {
+									if (ndxKey >= lstKeyScript.size()) return;
+									const TKeyScriptEntry &entry = lstKeyScript.at(ndxKey++);
+									switch (entry.m_nAction) {
+										case TKeyScriptEntry::KA_PRESS:
+											luaEvents.keyPress(entry.m_nKey);
+											break;
+										case TKeyScriptEntry::KA_RELEASE:
+											luaEvents.keyRelease(entry.m_nKey);
+											break;
+										case TKeyScriptEntry::KA_REPEAT:
+											luaEvents.keyPress(entry.m_nKey, true);
+											break;
+										case TKeyScriptEntry::KA_LONG:
+											luaEvents.keyPress(entry.m_nKey);
+											luaEvents.keyPress(entry.m_nKey, true);
+											break;
+										case TKeyScriptEntry::KA_TAP:
+											luaEvents.keyPress(entry.m_nKey);
+											luaEvents.keyRelease(entry.m_nKey);
+											break;
+									}
+									if (ndxKey < lstKeyScript.size()) tmrKeys.start(lstKeyScript.at(ndxKey).m_nDelay);
+								});
+
+			// Delay before opening the script and executing it to give
+			//	time for communications to run, specifically the telemetry polling,
+			//	before running a script that sends messages, particularly via poll push:
+			QTimer::singleShot(m_options.m_nStartDelay, &luaEngine, [&]()->void {
+				int nCacheHits = CLuaBytecodeCache::hits();
+				tmrScript.start();
+				luaEngine.execLuaScript(m_options.m_strScript);
+				writeMessage(QString("Script startup: Lua init %1 ms, script load %2 ms (bytecode cache %3)")
+								.arg(luaEngine.lastInitNsecs()/1000000.0, 0, 'f', 3)
+								.arg(luaEngine.lastLoadNsecs()/1000000.0, 0, 'f', 3)
+								.arg(!CLuaBytecodeCache::isEnabled() ? QString("disabled") :
+										((CLuaBytecodeCache::hits() != nCacheHits) ? QString("hit") : QString("miss"))));
+				if (!lstKeyScript.isEmpty()) tmrKeys.start(lstKeyScript.at(0).m_nDelay);
+			});
+
+			if (m_options.m_nTimeout) {
+				QTimer::singleShot(m_options.m_nTimeout*1000, &luaEngine, [this]()->void {
+					writeMessage("Timeout waiting for script to finish");
+					exit(-7);
+				});
+			}
+
+			m_nResult = exec();
+
+			// Gather the statistics here, since the Lua memory statistics are per thread:
+			const CLuaGeneral::TRequestTimingStats &stats = luaGeneral.requestTimingStats();
+			if (stats.m_nCount) {
+				m_lstReport.append(QString("Parameter Requests: %1, Round-Trip avg/min/max: %2/%3/%4 ms")
+								.arg(stats.m_nCount)
+								.arg(stats.m_nTotalNsecs/stats.m_nCount/1000000.0, 0, 'f', 2)
+								.arg(stats.m_nMinNsecs/1000000.0, 0, 'f', 2)
+								.arg(stats.m_nMaxNsecs/1000000.0, 0, 'f', 2));
+			}
+
+			m_lstReport.append("Script " + luaEngine.runStats().summary());
+
+			const CLuaAllocator::TStats &memStats = CLuaEngine::memoryStats();
+			m_lstReport.append(QString("Lua Memory (%1): live %2 KB, peak %3 KB, reserved %4 KB, allocated %5 KB at %6 KB/s in %7 allocs, %8 failed")
+							.arg(m_options.m_bSystemAllocator ? "system allocator" : "pool allocator")
+							.arg(memStats.m_nLiveBytes/1024.0, 0, 'f', 1)
+							.arg(memStats.m_nPeakBytes/1024.0, 0, 'f', 1)
+							.arg(memStats.m_nReservedBytes/1024.0, 0, 'f', 1)
+							.arg(memStats.m_nTotalAllocBytes/1024.0, 0, 'f', 1)
+							.arg(CLuaEngine::allocationRate()/1024.0, 0, 'f', 1)
+							.arg(memStats.m_nAllocCount)
+							.arg(memStats.m_nFailedCount));
+			if (memStats.m_nGcSteps || memStats.m_nGcFull) {
+				m_lstReport.append(QString("Lua GC: %1 steps, %2 full, pause avg/max: %3/%4 us")
+								.arg(memStats.m_nGcSteps)
+								.arg(memStats.m_nGcFull)
+								.arg(memStats.m_nGcTotalNsecs/(memStats.m_nGcSteps + memStats.m_nGcFull)/1000.0, 0, 'f', 1)
+								.arg(memStats.m_nGcMaxNsecs/1000.0, 0, 'f', 1));
+			}
+
+			CFrskySportDeviceTelemetry::TPushQueueStats pushStats = telemetry.pushQueueStats();
+			if (pushStats.m_nPushed || pushStats.m_nRejected) {
+				m_lstReport.append(QString("Push Queue: %1 queued, %2 sent, %3 rejected (full), max occupancy %4, wait avg/max: %5/%6 ms")
+								.arg(pushStats.m_nPushed)
+								.arg(pushStats.m_nSent)
+								.arg(pushStats.m_nRejected)
+								.arg(pushStats.m_nMaxOccupancy)
+								.arg(pushStats.m_nSent ? (pushStats.m_nTotalWaitNsecs/pushStats.m_nSent/1000000.0) : 0.0, 0, 'f', 2)
+								.arg(pushStats.m_nMaxWaitNsecs/1000000.0, 0, 'f', 2));
+			}
+			m_lstReport.append(telemetry.busStatsSummary());
+			if (telemetry.sensorStore().sensorCount() || telemetry.sensorStore().droppedCount()) {
+				m_lstReport.append(QString("Sensors Seen: %1, Updates Dropped (no free slot): %2")
+								.arg(telemetry.sensorStore().sensorCount())
+								.arg(telemetry.sensorStore().droppedCount()));
+			}
+			if (telemetry.unpolledTxCount() || telemetry.crcErrorCount()) {
+				m_lstReport.append(QString("Un-polled Transmits While Polling: %1, Received CRC Errors: %2")
+								.arg(telemetry.unpolledTxCount())
+								.arg(telemetry.crcErrorCount()));
+			}
+
+			if (luaGeneral.rxSportPacketsQueued() || luaGeneral.rxSportPacketsDropped()) {
+				m_lstReport.append(QString("Telemetry Packets Queued: %1, Dropped: %2")
+								.arg(luaGeneral.rxSportPacketsQueued())
+								.arg(luaGeneral.rxSportPacketsDropped()));
+			}
+
+			if (m_shmPublisher.isOpen()) {
+				m_lstReport.append(QString("Shared Memory Frames Published: %1, Dropped: %2, Sensor Updates Dropped: %3")
+								.arg(m_shmPublisher.framesPublished())
+								.arg(m_shmPublisher.framesDropped())
+								.arg(m_shmPublisher.sensorsDropped()));
+			}
+
+			if (!m_options.m_strHistoryFile.isEmpty()) {
+				QString strHistoryFile = m_options.m_strHistoryFile;
+				if (m_options.m_bMultiSession) {
+					QFileInfo fiHistory(strHistoryFile);
+					strHistoryFile = fiHistory.dir().filePath(QString("session%1_%2").arg(m_nSession+1).arg(fiHistory.fileName()));
+				}
+				QString strError;
+				m_lstReport.append(m_timeSeries.summary());
+				if (m_timeSeries.writeCsv(strHistoryFile, CSportTimeSeries::TIER_1S, &strError)) {
+					m_lstReport.append("Sensor History written to \"" + strHistoryFile + "\"");
+				} else {
+					m_lstReport.append("*** Failed to write Sensor History \"" + strHistoryFile + "\": " + strError);
+				}
+			}
+		}
+
+		// Return the port to the main thread:
+		m_sport.port().moveToThread(m_pOwnerThread);
+		m_sport.moveToThread(m_pOwnerThread);
+	}
+};
+
+// ============================================================================
+
+int main(int argc, char *argv[])
+{
+	// Render the LCD off-screen.  A QGuiApplication (rather than just a
+	//	QCoreApplication) is still needed for the font database used
+	//	by the LCD text drawing, but it doesn't need a display:
+	if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+
+	QGuiApplication app(argc, argv);
+
+	QString strREV = GIT_REV;
+	QString strTAG = GIT_TAG;
+	QString strBRANCH = GIT_BRANCH;
+
+	QString strVersion;
+	if (!strTAG.isEmpty()) {
+		strVersion = strTAG;
+	} else {
+		strVersion = QString("%1/%2").arg(strBRANCH, strREV);
+	}
+
+	app.setApplicationVersion(strVersion);
+	app.setApplicationName("frsky_sport_tool");		// Note: use package name here instead of this app so we can use its common settings
+	app.setOrganizationName("Dewtronics");
+	app.setOrganizationDomain("dewtronics.com");
+
+	CPersistentSettings::instance()->loadSettings();
+
+	QString strScript;
+	QString strLogFile;
+	QString strLogFilter = CPersistentSettings::instance()->getLogFileFilter();
+	QString strKeyFile;
+	QString strFrameDir;
+	SPORT_ID_ENUM nSport = CPersistentSettings::instance()->getDataConfigSportPort();
+	QString strPort;
+	int nBaudRate = 57600;
+	int nDataBits = 8;
+	char chParity = 'N';
+	int nStopBits = 1;
+	int nStartDelay = 1000;
+	int nTimeout = 0;
+	int nWakeRate = CPersistentSettings::instance()->getLuaWakeOnRxRate();
+	int nMemoryLimit = CPersistentSettings::instance()->getLuaMemoryLimit();
+	bool bSystemAllocator = false;
+	int nInstructionsLimit = CPersistentSettings::instance()->getLuaInstructionsLimit();
+	bool bNoBytecodeCache = false;
+	QString strProfileFile;
+	QString strHistoryFile;
+	QString strShmName;
+	bool bNeedUsage = false;
+	int nArgsFound = 0;
+
+	for (int ndx = 1; ndx < argc; ++ndx) {
+		QString strArg = argv[ndx];
+		if (!strArg.startsWith("-")) {
+			switch (nArgsFound) {
+				case 0:
+					strPort = strArg;
+					break;
+				case 1:
+					strScript = strArg;
+					break;
+				default:
+					bNeedUsage = true;
+					break;
+			}
+			++nArgsFound;
+		} else if (strArg.startsWith("-b")) {
+			if ((strArg == "-b") && (argc > ndx+1)) {
+				nBaudRate = strtoul(argv[ndx+1], nullptr, 0);
+				++ndx;
+			} else {
+				nBaudRate = strtoul(strArg.mid(2).toUtf8().data(), nullptr, 0);
+			}
+		} else if (strArg.startsWith("-s")) {
+			QString strPortSettings;
+			if ((strArg == "-s") && (argc > ndx+1)) {
+				strPortSettings = argv[ndx+1];
+				++ndx;
+			} else {
+				strPortSettings = strArg.mid(2);
+			}
+			QStringList lstPortSettings = strPortSettings.split(",", Qt::KeepEmptyParts);
+			if (lstPortSettings.size() >= 1) {
+				nDataBits = strtoul(lstPortSettings.at(0).toUtf8().data(), nullptr, 0);
+			}
+			if (lstPortSettings.size() >= 2) {
+				if (lstPortSettings.at(1).size() > 0) chParity = lstPortSettings.at(1).toUpper().at(0).toLatin1();
+			}
+			if (lstPortSettings.size() >= 3) {
+				nStopBits = strtoul(lstPortSettings.at(2).toUtf8().data(), nullptr, 0);
+			}
+		} else if (strArg.startsWith("-l")) {
+			if ((strArg == "-l") && (argc > ndx+1)) {
+				strLogFile = argv[ndx+1];
+				++ndx;
+			} else {
+				strLogFile = strArg.mid(2);
+			}
+		} else if (strArg.startsWith("-F")) {
+			if ((strArg == "-F") && (argc > ndx+1)) {
+				strLogFilter = argv[ndx+1];
+				++ndx;
+			} else {
+				strLogFilter = strArg.mid(2);
+			}
+		} else if (strArg.startsWith("-k")) {
+			if ((strArg == "-k") && (argc > ndx+1)) {
+				strKeyFile = argv[ndx+1];
+				++ndx;
+			} else {
+				strKeyFile = strArg.mid(2);
+			}
+		} else if (strArg.startsWith("-p")) {
+			if ((strArg == "-p") && (argc > ndx+1)) {
+				strFrameDir = argv[ndx+1];
+				++ndx;
+			} else {
+				strFrameDir = strArg.mid(2);
+			}
+		} else if (strArg.startsWith("-d")) {
+			if ((strArg == "-d") && (argc > ndx+1)) {
+				nStartDelay = strtoul(argv[ndx+1], nullptr, 0);
+				++ndx;
+			} else {
+				nStartDelay = strtoul(strArg.mid(2).toUtf8().data(), nullptr, 0);
+			}
+		} else if (strArg.startsWith("-w")) {
+			if ((strArg == "-w") && (argc > ndx+1)) {
+				nWakeRate = strtoul(argv[ndx+1], nullptr, 0);
+				++ndx;
+			} else {
+				nWakeRate = strtoul(strArg.mid(2).toUtf8().data(), nullptr, 0);
+			}
+		} else if (strArg.startsWith("-m")) {
+			if ((strArg == "-m") && (argc > ndx+1)) {
+				nMemoryLimit = strtoul(argv[ndx+1], nullptr, 0);
+				++ndx;
+			} else {
+				nMemoryLimit = strtoul(strArg.mid(2).toUtf8().data(), nullptr, 0);
+			}
+		} else if (strArg.startsWith("-i")) {
+			if ((strArg == "-i") && (argc > ndx+1)) {
+				nInstructionsLimit = strtoul(argv[ndx+1], nullptr, 0);
+				++ndx;
+			} else {
+				nInstructionsLimit = strtoul(strArg.mid(2).toUtf8().data(), nullptr, 0);
+			}
+		} else if (strArg.startsWith("-P")) {
+			if ((strArg == "-P") && (argc > ndx+1)) {
+				strProfileFile = argv[ndx+1];
+				++ndx;
+			} else {
+				strProfileFile = strArg.mid(2);
+			}
+		} else if (strArg.startsWith("-H")) {
+			if ((strArg == "-H") && (argc > ndx+1)) {
+				strHistoryFile = argv[ndx+1];
+				++ndx;
+			} else {
+				strHistoryFile = strArg.mid(2);
+			}
+		} else if (strArg.startsWith("-M")) {
+			if ((strArg == "-M") && (argc > ndx+1)) {
+				strShmName = argv[ndx+1];
+				++ndx;
+			} else {
+				strShmName = strArg.mid(2);
+			}
+		} else if (strArg == "-a") {
+			bSystemAllocator = true;
+		} else if (strArg == "-n") {
+			bNoBytecodeCache = true;
+		} else if (strArg.startsWith("-t")) {
+			if ((strArg == "-t") && (argc > ndx+1)) {
+				nTimeout = strtoul(argv[ndx+1], nullptr, 0);
+				++ndx;
+			} else {
+				nTimeout = strtoul(strArg.mid(2).toUtf8().data(), nullptr, 0);
+			}
+		} else {
+			bNeedUsage = true;
+		}
+	}
+	// Each comma separated port gets its own concurrent script session,
+	//	each with its own SPORT_ID_ENUM, for the log filter and settings:
+	QStringList lstPorts = strPort.split(",", Qt::SkipEmptyParts);
+	if (lstPorts.isEmpty() || (lstPorts.size() > SPIDE_COUNT) || strScript.isEmpty()) bNeedUsage = true;
+
+	if (bNeedUsage) {
+		std::cerr << "Frsky Headless Lua Script Runner" << std::endl;
+		std::cerr << "Version: " << strVersion.toUtf8().data() << std::endl << std::endl;
+		std::cerr << "Usage: frsky_lua_run [options] <port> <script>" << std::endl;
+		std::cerr << std::endl;
+		std::cerr << "Where:" << std::endl;
+		std::cerr << "    <port> = Serial Port to use (required), or a comma separated list of" << std::endl;
+		std::cerr << "                    ports to run the script on each of them concurrently," << std::endl;
+		std::cerr << "                    each in its own session thread (up to " << SPIDE_COUNT << " ports)" << std::endl;
+		std::cerr << "    <script> = Lua Script to run (required)" << std::endl;
+		std::cerr << std::endl;
+		std::cerr << "Options:" << std::endl;
+		std::cerr << "    -b <baudrate> = optional baud-rate specifier" << std::endl;
+		std::cerr << "                    (if omitted, will use the default of 57600)" << std::endl;
+		std::cerr << "    -s <port-settings> = where port-settings is a comma separated list of" << std::endl;
+		std::cerr << "                    \"DataBit,Parity,StopBit\", such as \"8,N,1\" (which is the default)" << std::endl;
+		std::cerr << "    -l <logfile>  = optional communications log file to generate" << std::endl;
+		std::cerr << "                    (written in the indexed binary format, for frsky_log_view," << std::endl;
+		std::cerr << "                    if the filename ends in \".slog\")" << std::endl;
+		std::cerr << "    -F <log-filter> = optional log filter, such as \"type=rx,tx;phys!=0x1B\"" << std::endl;
+		std::cerr << "                    (keys: port, type, phys, prim, data; errors are always logged)" << std::endl;
+		std::cerr << "    -k <keyfile>  = optional scripted key input file, with lines of:" << std::endl;
+		std::cerr << "                    \"<delay-ms> <press|release|repeat|long|tap> <key>\"" << std::endl;
+		std::cerr << "                    (key is PGUP, PGDN, ENTER, MODEL, UP, EXIT, DOWN, TELEM," << std::endl;
+		std::cerr << "                    RIGHT, RADIO, or LEFT)" << std::endl;
+		std::cerr << "    -p <png-dir>  = optional folder to dump LCD frames to as PNG files" << std::endl;
+		std::cerr << "    -d <delay-ms> = delay before starting the script (default 1000)" << std::endl;
+		std::cerr << "                    (gives the telemetry polling time to start)" << std::endl;
+		std::cerr << "    -w <runs-per-ms> = wake the script on received packets, running it at most" << std::endl;
+		std::cerr << "                    this many times per millisecond (0 = use 50ms refresh only)" << std::endl;
+		std::cerr << "                    (if omitted, will use the GUI's setting)" << std::endl;
+		std::cerr << "    -t <timeout-secs> = abort if the script hasn't finished in this time" << std::endl;
+		std::cerr << "                    (default 0 = run until the script finishes)" << std::endl;
+		std::cerr << "    -n            = don't use the compiled script bytecode cache" << std::endl;
+		std::cerr << "    -m <kbytes>   = Lua memory limit, like the radio's RAM (0 = unlimited)" << std::endl;
+		std::cerr << "                    (if omitted, will use the GUI's setting)" << std::endl;
+		std::cerr << "    -i <instructions> = Lua instructions allowed per script run before the" << std::endl;
+		std::cerr << "                    script is killed (0 = unlimited)" << std::endl;
+		std::cerr << "                    (if omitted, will use the GUI's setting)" << std::endl;
+		std::cerr << "    -P <profile-file> = profile the script, writing the sampled Lua call stacks" << std::endl;
+		std::cerr << "                    to this file in flamegraph collapsed-stack format" << std::endl;
+		std::cerr << "    -H <csv-file> = write the history of the telemetry sensors received to this" << std::endl;
+		std::cerr << "                    file as 1 second min/max/avg points (with multiple ports," << std::endl;
+		std::cerr << "                    each session's file is prefixed with \"sessionN_\")" << std::endl;
+		std::cerr << "    -M <shm-name> = publish the telemetry received in POSIX shared memory of this" << std::endl;
+		std::cerr << "                    name, for other programs to read (see frsky_sport_shm.h)" << std::endl;
+		std::cerr << "                    (with multiple ports, each session's name is suffixed" << std::endl;
+		std::cerr << "                    with its session number)" << std::endl;
+		std::cerr << "    -a            = use the system allocator instead of the Lua memory pools" << std::endl;
+		std::cerr << "                    (for comparing allocator performance)" << std::endl;
+		std::cerr << std::endl << std::endl;
+
+		return -1;
+	}
+
+	std::cerr << "frsky_lua_run version: " << strVersion.toUtf8().data() << std::endl;
+
+	// Note: a missing script file would otherwise be indistinguishable
+	//	from a script that ran to completion (both are SCRIPT_NOFILE):
+	if (!QFile::exists(strScript)) {
+		std::cerr << "Lua Script \"" << strScript.toUtf8().data() << "\" not found" << std::endl;
+		return -3;
+	}
+
+	CSportLogFilter logFilter;
+	QString strFilterError;
+	if (!logFilter.parse(strLogFilter, &strFilterError)) {
+		std::cerr << "Invalid log filter: " << strFilterError.toUtf8().data() << std::endl;
+		return -1;
+	}
+
+	QList<TKeyScriptEntry> lstKeyScript;
+	if (!strKeyFile.isEmpty()) {
+		QString strError;
+		if (!readKeyScript(strKeyFile, lstKeyScript, strError)) {
+			std::cerr << "Failed to read key input file \"" << strKeyFile.toUtf8().data() << "\"" << std::endl;
+			std::cerr << strError.toUtf8().data() << std::endl;
+			return -4;
+		}
+	}
+
+	if (!strFrameDir.isEmpty() && !QDir().mkpath(strFrameDir)) {
+		std::cerr << "Failed to create PNG frame folder \"" << strFrameDir.toUtf8().data() << "\"" << std::endl;
+		return -5;
+	}
+
+	TSessionOptions options;
+	options.m_strScript = strScript;
+	options.m_strFrameDir = strFrameDir;
+	options.m_strHistoryFile = strHistoryFile;
+	options.m_strShmName = strShmName;
+	options.m_lstKeyScript = lstKeyScript;
+	options.m_nStartDelay = nStartDelay;
+	options.m_nTimeout = nTimeout;
+	options.m_nWakeRate = nWakeRate;
+	options.m_nMemoryLimit = nMemoryLimit;
+	options.m_nInstructionsLimit = nInstructionsLimit;
+	options.m_bSystemAllocator = bSystemAllocator;
+	options.m_bMultiSession = (lstPorts.size() > 1);
+
+	QList<CScriptSession *> lstSessions;
+	for (int nSession = 0; nSession < lstPorts.size(); ++nSession) {
+		CScriptSession *pSession = new CScriptSession(nSession, static_cast<SPORT_ID_ENUM>((nSport + nSession) % SPIDE_COUNT), options);
+		lstSessions.append(pSession);
+		CFrskySportIO &sport = pSession->sport();
+		sport.logFilter() = logFilter;
+		if (!sport.openPort(lstPorts.at(nSession), nBaudRate, nDataBits, chParity, nStopBits)) {
+			std::cerr << "Failed to open serial port " << lstPorts.at(nSession).toUtf8().data() << std::endl;
+			std::cerr << sport.getLastError().toUtf8().data() << std::endl;
+			qDeleteAll(lstSessions);
+			return -2;
+		}
+
+		QStringList lstPortSettings;
+		lstPortSettings.append(QString("%1").arg(sport.dataBits()));
+		lstPortSettings.append(QString("%1").arg(QChar(sport.parity())));
+		lstPortSettings.append(QString("%1").arg(sport.stopBits()));
+
+		std::cerr << pSession->label().toUtf8().data() << "Serial Port: " << lstPorts.at(nSession).toUtf8().data() << std::endl;
+		std::cerr << pSession->label().toUtf8().data() << "Baud Rate: " << sport.baudRate() << std::endl;
+		std::cerr << pSession->label().toUtf8().data() << "Port Settings: " << lstPortSettings.join(',').toUtf8().data() << std::endl;
+
+		if (!strShmName.isEmpty()) {
+			QString strName = options.m_bMultiSession ? QString("%1%2").arg(strShmName).arg(nSession+1) : strShmName;
+			QString strError;
+			if (!pSession->shmPublisher().open(strName, CSportShmPublisher::DEFAULT_RING_SIZE, &strError)) {
+				std::cerr << strError.toUtf8().data() << std::endl;
+				qDeleteAll(lstSessions);
+				return -7;
+			}
+			std::cerr << pSession->label().toUtf8().data() << "Shared Memory: " << pSession->shmPublisher().name().toUtf8().data() << std::endl;
+		}
+	}
+	std::cerr << "Lua Script: " << strScript.toUtf8().data() << std::endl;
+	if (!strLogFile.isEmpty()) {
+		std::cerr << "Log File: " << strLogFile.toUtf8().data() << std::endl;
+		if (!logFilter.acceptsAll()) std::cerr << "Log Filter: " << logFilter.spec().toUtf8().data() << std::endl;
+	}
+	if (!strKeyFile.isEmpty()) {
+		std::cerr << "Key Input File: " << strKeyFile.toUtf8().data() << std::endl;
+	}
+	if (!strFrameDir.isEmpty()) {
+		std::cerr << "PNG Frame Folder: " << strFrameDir.toUtf8().data() << std::endl;
+	}
+	if (!strHistoryFile.isEmpty()) {
+		std::cerr << "Sensor History File: " << strHistoryFile.toUtf8().data() << std::endl;
+	}
+	if (nWakeRate) {
+		std::cerr << "Wake on Received Packets: " << nWakeRate << " runs/ms max" << std::endl;
+	} else {
+		std::cerr << "Wake on Received Packets: disabled" << std::endl;
+	}
+
+	CLogFile logFile;
+	if (!strLogFile.isEmpty()) {
+		logFile.setFlushInterval(CPersistentSettings::instance()->getLogFileFlushInterval());
+		logFile.setRotation(static_cast<qint64>(CPersistentSettings::instance()->getLogFileRotateSize())*1024*1024,
+							static_cast<qint64>(CPersistentSettings::instance()->getLogFileRotateMinutes())*60000,
+							CPersistentSettings::instance()->getLogFileRotateKeep());
+		if (!logFile.openLogFile(strLogFile, QIODevice::WriteOnly)) {
+			std::cerr << "Failed to open \"" << strLogFile.toUtf8().data() << "\" for writing" << std::endl;
+			std::cerr << logFile.getLastError().toUtf8().data() << std::endl;
+			qDeleteAll(lstSessions);
+			return -6;
+		}
+		QObject::connect(&logFile, &CLogFile::logFileError, &app, [](const QString &strError)->void {
+			std::cerr << strError.toUtf8().data() << std::endl;
+		});
+		// Note: The log messages are queued to this (main) thread from the
+		//	session threads, so only this thread writes the log file:
+		qRegisterMetaType<SPORT_ID_ENUM>("SPORT_ID_ENUM");
+		for (CScriptSession *pSession : lstSessions) {
+			QString strPrefix = options.m_bMultiSession ? pSession->label() : QString();
+			QObject::connect(&pSession->sport(), &CFrskySportIO::writeLogString, &app,
+								[&logFile, strPrefix](SPORT_ID_ENUM nSport, const QString &strMessage)->void {
+									Q_UNUSED(nSport);
+									logFile.writeLogString(strPrefix + strMessage);
+								});
+		}
+	}
+
+	// These apply to all threads:
+	CLuaBytecodeCache::setEnabled(!bNoBytecodeCache);
+	CLuaEngine::setProfilingEnabled(!strProfileFile.isEmpty());
+
+	QElapsedTimer tmrSessions;
+	tmrSessions.start();
+	int nSessionsRunning = lstSessions.size();
+	for (CScriptSession *pSession : lstSessions) {
+		QObject::connect(pSession, &QThread::finished, &app, [&nSessionsRunning]()->void {
+			if (--nSessionsRunning == 0) QCoreApplication::quit();
+		});
+		pSession->startSession();
+	}
+
+	app.exec();
+	qint64 nSessionsNsecs = tmrSessions.nsecsElapsed();
+
+	int nResult = 0;
+	QStringList lstScriptTimes;
+	for (CScriptSession *pSession : lstSessions) {
+		pSession->wait();
+		for (const QString &strLine : pSession->report()) {
+			std::cerr << (pSession->label() + strLine).toUtf8().data() << std::endl;
+		}
+		lstScriptTimes.append(QString("%1").arg(pSession->scriptNsecs()/1000000.0, 0, 'f', 1));
+		if ((nResult == 0) && (pSession->result() != 0)) nResult = pSession->result();
+	}
+	std::cerr << QString("Sessions: %1, script wall time %2 ms, total %3 ms")
+					.arg(lstSessions.size())
+					.arg(lstScriptTimes.join('/'))
+					.arg(nSessionsNsecs/1000000.0, 0, 'f', 1).toUtf8().data() << std::endl;
+	qDeleteAll(lstSessions);
+
+	if (!strProfileFile.isEmpty()) {
+		QString strError;
+		CLuaProfiler profile = CLuaEngine::profile();
+		if (profile.writeCollapsedStacks(strProfileFile, &strError)) {
+			std::cerr << QString("Profile: %1 samples of %2 unique stacks written to \"%3\"")
+							.arg(profile.sampleCount())
+							.arg(profile.stackCount())
+							.arg(strProfileFile).toUtf8().data() << std::endl;
+		} else {
+			std::cerr << "Failed to write profile file \"" << strProfileFile.toUtf8().data() << "\": "
+						<< strError.toUtf8().data() << std::endl;
+		}
+	}
+
+	if (nResult == 0) {
+		std::cerr << "Script completed successfully" << std::endl;
+	}
+
+	// Don't save persistent settings here, since we aren't changing anything
+
+	return nResult;
+}
@@ -0,0 +1,179 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+
+#include "frsky_sport_bus_stats.h"
+
+#include <QStringList>
+
+// ============================================================================
+
+int64_t CSportBusStats::TIdStats::latencyPercentileNsecs(int nPercentile) const
+{
+	if (m_nResponses == 0) return 0;
+
+	uint32_t nTarget = (static_cast<uint64_t>(m_nResponses) * nPercentile + 99) / 100;
+	if (nTarget < 1) nTarget = 1;
+	uint32_t nCount = 0;
+	for (int nBucket = 0; nBucket < LATENCY_BUCKETS-1; ++nBucket) {
+		nCount += m_arrLatencyHistogram[nBucket];
+		if (nCount >= nTarget) return (nBucket+1) * LATENCY_BUCKET_NSECS;
+	}
+	return m_nMaxLatencyNsecs;		// In the overflow bucket
+}
+
+// ----------------------------------------------------------------------------
+
+CSportBusStats::CSportBusStats()
+{
+	reset(0);
+}
+
+void CSportBusStats::reset(int64_t nNowNsecs)
+{
+	m_nStartNsecs = nNowNsecs;
+	for (int i = 0; i < TELEMETRY_PHYS_ID_COUNT; ++i) {
+		m_arrIdStats[i] = TIdStats();
+	}
+	m_nRxBytes = 0;
+	m_nLastRxNsecs = -1;
+	m_nIdleGaps = 0;
+	m_nTotalIdleGapNsecs = 0;
+	m_nMaxIdleGapNsecs = 0;
+}
+
+void CSportBusStats::notePoll(int nPhysicalId)
+{
+	if ((nPhysicalId < 0) || (nPhysicalId >= TELEMETRY_PHYS_ID_COUNT)) return;
+	++m_arrIdStats[nPhysicalId].m_nPolls;
+}
+
+void CSportBusStats::noteResponse(int nPhysicalId, int64_t nLatencyNsecs)
+{
+	if ((nPhysicalId < 0) || (nPhysicalId >= TELEMETRY_PHYS_ID_COUNT)) return;
+	if (nLatencyNsecs < 0) nLatencyNsecs = 0;
+
+	TIdStats &stats = m_arrIdStats[nPhysicalId];
+	++stats.m_nResponses;
+	if (nLatencyNsecs > m_nLateNsecs) ++stats.m_nLate;
+	stats.m_nTotalLatencyNsecs += nLatencyNsecs;
+	if (nLatencyNsecs > stats.m_nMaxLatencyNsecs) stats.m_nMaxLatencyNsecs = nLatencyNsecs;
+	int64_t nBucket = nLatencyNsecs / LATENCY_BUCKET_NSECS;
+	++stats.m_arrLatencyHistogram[(nBucket < LATENCY_BUCKETS-1) ? nBucket : LATENCY_BUCKETS-1];
+}
+
+void CSportBusStats::noteRxBytes(int nBytes, int64_t nNowNsecs)
+{
+	if (nBytes <= 0) return;
+
+	if (m_nLastRxNsecs >= 0) {
+		int64_t nGap = nNowNsecs - m_nLastRxNsecs;
+		if (nGap >= IDLE_GAP_NSECS) {
+			++m_nIdleGaps;
+			m_nTotalIdleGapNsecs += nGap;
+			if (nGap > m_nMaxIdleGapNsecs) m_nMaxIdleGapNsecs = nGap;
+		}
+	}
+	m_nLastRxNsecs = nNowNsecs;
+	m_nRxBytes += nBytes;
+}
+
+// ----------------------------------------------------------------------------
+
+CSportBusStats::TIdStats CSportBusStats::totalStats() const
+{
+	TIdStats total;
+	for (int i = 0; i < TELEMETRY_PHYS_ID_COUNT; ++i) {
+		const TIdStats &stats = m_arrIdStats[i];
+		total.m_nPolls += stats.m_nPolls;
+		total.m_nResponses += stats.m_nResponses;
+		total.m_nLate += stats.m_nLate;
+		total.m_nTotalLatencyNsecs += stats.m_nTotalLatencyNsecs;
+		if (stats.m_nMaxLatencyNsecs > total.m_nMaxLatencyNsecs) total.m_nMaxLatencyNsecs = stats.m_nMaxLatencyNsecs;
+		for (int nBucket = 0; nBucket < LATENCY_BUCKETS; ++nBucket) {
+			total.m_arrLatencyHistogram[nBucket] += stats.m_arrLatencyHistogram[nBucket];
+		}
+	}
+	return total;
+}
+
+double CSportBusStats::pollRate(int nPhysicalId, int64_t nNowNsecs) const
+{
+	int64_t nElapsed = nNowNsecs - m_nStartNsecs;
+	if ((nElapsed <= 0) || (nPhysicalId < 0) || (nPhysicalId >= TELEMETRY_PHYS_ID_COUNT)) return 0.0;
+	return m_arrIdStats[nPhysicalId].m_nPolls * 1.0e9 / nElapsed;
+}
+
+double CSportBusStats::bytesPerSecond(int64_t nNowNsecs) const
+{
+	int64_t nElapsed = nNowNsecs - m_nStartNsecs;
+	if (nElapsed <= 0) return 0.0;
+	return m_nRxBytes * 1.0e9 / nElapsed;
+}
+
+double CSportBusStats::utilisation(int64_t nNowNsecs, int nBaudRate) const
+{
+	if (nBaudRate <= 0) return 0.0;
+	return bytesPerSecond(nNowNsecs) * 10.0 / nBaudRate;
+}
+
+QString CSportBusStats::summary(int64_t nNowNsecs, int nBaudRate) const
+{
+	TIdStats total = totalStats();
+
+	QString strSummary = QString("Bus: %1 B/s, %2% used, idle gaps %3 avg/max: %4/%5 ms, polls %6/s")
+			.arg(bytesPerSecond(nNowNsecs), 0, 'f', 0)
+			.arg(utilisation(nNowNsecs, nBaudRate) * 100.0, 0, 'f', 1)
+			.arg(m_nIdleGaps)
+			.arg(avgIdleGapNsecs()/1000000.0, 0, 'f', 2)
+			.arg(m_nMaxIdleGapNsecs/1000000.0, 0, 'f', 2)
+			.arg((nNowNsecs > m_nStartNsecs) ? (total.m_nPolls * 1.0e9 / (nNowNsecs - m_nStartNsecs)) : 0.0, 0, 'f', 1);
+	if (total.m_nResponses) {
+		strSummary += QString(", responses %1 (%2 late > %3 ms), latency avg/p50/p99/max: %4/%5/%6/%7 ms")
+				.arg(total.m_nResponses)
+				.arg(total.m_nLate)
+				.arg(m_nLateNsecs/1000000.0, 0, 'f', 2)
+				.arg(total.m_nTotalLatencyNsecs/total.m_nResponses/1000000.0, 0, 'f', 2)
+				.arg(total.latencyPercentileNsecs(50)/1000000.0, 0, 'f', 2)
+				.arg(total.latencyPercentileNsecs(99)/1000000.0, 0, 'f', 2)
+				.arg(total.m_nMaxLatencyNsecs/1000000.0, 0, 'f', 2);
+	}
+
+	QStringList lstIds;
+	for (int i = 0; i < TELEMETRY_PHYS_ID_COUNT; ++i) {
+		const TIdStats &stats = m_arrIdStats[i];
+		if (stats.m_nPolls == 0) continue;
+		QString strId = QString("%1: %2/s").arg(i).arg(pollRate(i, nNowNsecs), 0, 'f', 1);
+		if (stats.m_nResponses) {
+			strId += QString(" %1 resp %2 late p99 %3 ms")
+					.arg(stats.m_nResponses)
+					.arg(stats.m_nLate)
+					.arg(stats.latencyPercentileNsecs(99)/1000000.0, 0, 'f', 2);
+		}
+		lstIds.append(strId);
+	}
+	if (!lstIds.isEmpty()) strSummary += "; IDs " + lstIds.join(", ");
+
+	return strSummary;
+}
+
+// ============================================================================
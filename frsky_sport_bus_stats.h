@@ -0,0 +1,101 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+
+#ifndef FRSKY_SPORT_BUS_STATS_H
+#define FRSKY_SPORT_BUS_STATS_H
+
+#include <QString>
+
+#include <stdint.h>
+
+#include "frsky_sport_io.h"
+
+// ============================================================================
+
+//
+// Telemetry poll response latency and bus utilisation statistics, for the
+//	telemetry handler.  Latency is measured from when the poll is read to
+//	when the write of our push response to the port completes, and is kept
+//	as a histogram for each physical ID, with responses slower than the
+//	late threshold counted as late (receivers drop responses that start
+//	too long after the poll).  Bus utilisation is computed from the bytes
+//	received, which on the half-duplex bus includes the echoes of what we
+//	send, and the gaps between them.  All times are in nanoseconds on the
+//	caller's time base and all statistics are since reset().
+//
+class CSportBusStats
+{
+public:
+	static constexpr int LATENCY_BUCKETS = 32;				// Latency histogram buckets, the last one counts everything above it
+	static constexpr int64_t LATENCY_BUCKET_NSECS = 250000;	// Width of each latency histogram bucket
+	static constexpr int64_t DEFAULT_LATE_NSECS = 4000000;	// Default late response threshold
+	static constexpr int64_t IDLE_GAP_NSECS = 1000000;		// Minimum quiet time between received bytes to count as an idle gap
+
+	struct TIdStats {
+		uint32_t m_nPolls = 0;					// Polls received for this ID
+		uint32_t m_nResponses = 0;				// Push responses sent to polls
+		uint32_t m_nLate = 0;					// Responses later than the late threshold
+		int64_t m_nTotalLatencyNsecs = 0;
+		int64_t m_nMaxLatencyNsecs = 0;
+		uint32_t m_arrLatencyHistogram[LATENCY_BUCKETS] = {};
+
+		// Upper bound of the latency histogram bucket containing the
+		//	given percentile (0-100) of the responses:
+		int64_t latencyPercentileNsecs(int nPercentile) const;
+	};
+
+	CSportBusStats();
+
+	void reset(int64_t nNowNsecs);
+	void setLateThreshold(int64_t nNsecs) { m_nLateNsecs = nNsecs; }
+	int64_t lateThreshold() const { return m_nLateNsecs; }
+
+	void notePoll(int nPhysicalId);
+	void noteResponse(int nPhysicalId, int64_t nLatencyNsecs);
+	void noteRxBytes(int nBytes, int64_t nNowNsecs);
+
+	const TIdStats &idStats(int nPhysicalId) const { return m_arrIdStats[nPhysicalId]; }
+	TIdStats totalStats() const;							// Combined statistics of all IDs
+	double pollRate(int nPhysicalId, int64_t nNowNsecs) const;	// Polls per second of nPhysicalId
+	double bytesPerSecond(int64_t nNowNsecs) const;
+	double utilisation(int64_t nNowNsecs, int nBaudRate) const;	// Fraction of the bus time in use (8N1, so 10 bits per byte)
+	uint32_t idleGaps() const { return m_nIdleGaps; }
+	int64_t maxIdleGapNsecs() const { return m_nMaxIdleGapNsecs; }
+	int64_t avgIdleGapNsecs() const { return m_nIdleGaps ? (m_nTotalIdleGapNsecs / m_nIdleGaps) : 0; }
+
+	QString summary(int64_t nNowNsecs, int nBaudRate) const;	// Single line summary for logging and display
+
+private:
+	int64_t m_nLateNsecs = DEFAULT_LATE_NSECS;
+	int64_t m_nStartNsecs = 0;				// Time of reset()
+	TIdStats m_arrIdStats[TELEMETRY_PHYS_ID_COUNT];
+	uint64_t m_nRxBytes = 0;
+	int64_t m_nLastRxNsecs = -1;			// Time of the last received bytes, -1 if none
+	uint32_t m_nIdleGaps = 0;
+	int64_t m_nTotalIdleGapNsecs = 0;
+	int64_t m_nMaxIdleGapNsecs = 0;
+};
+
+// ============================================================================
+
+#endif	// FRSKY_SPORT_BUS_STATS_H
@@ -0,0 +1,213 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#include <frsky_sport_decoder.h>
+
+#include <QCoreApplication>
+#include <QFile>
+
+#include <iostream>
+#include <stdio.h>
+
+#include <version.h>
+
+// ============================================================================
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	QString strREV = GIT_REV;
+	QString strTAG = GIT_TAG;
+	QString strBRANCH = GIT_BRANCH;
+
+	QString strVersion;
+	if (!strTAG.isEmpty()) {
+		strVersion = strTAG;
+	} else {
+		strVersion = QString("%1/%2").arg(strBRANCH, strREV);
+	}
+
+	app.setApplicationVersion(strVersion);
+	app.setApplicationName("frsky_sport_tool");		// Note: use package name here instead of this app so we can use its common settings
+	app.setOrganizationName("Dewtronics");
+	app.setOrganizationDomain("dewtronics.com");
+
+	QString strInput;
+	QString strOutput;
+	CSportCaptureDecoder::INPUT_FORMAT nInputFormat = CSportCaptureDecoder::IF_AUTO;
+	CSportCaptureDecoder::OUTPUT_FORMAT nOutputFormat = CSportCaptureDecoder::OF_CSV;
+	int nThreads = 0;
+	qint64 nChunkSize = CSportCaptureDecoder::DEFAULT_CHUNK_SIZE;
+	bool bIncludeDetails = false;
+	bool bNeedUsage = false;
+	int nArgsFound = 0;
+
+	for (int ndx = 1; ndx < argc; ++ndx) {
+		QString strArg = argv[ndx];
+		if (!strArg.startsWith("-")) {
+			switch (nArgsFound) {
+				case 0:
+					strInput = strArg;
+					break;
+				default:
+					bNeedUsage = true;
+					break;
+			}
+			++nArgsFound;
+		} else if (strArg.startsWith("-o")) {
+			if ((strArg == "-o") && (argc > ndx+1)) {
+				strOutput = argv[ndx+1];
+				++ndx;
+			} else {
+				strOutput = strArg.mid(2);
+			}
+		} else if (strArg.startsWith("-f")) {
+			QString strFormat;
+			if ((strArg == "-f") && (argc > ndx+1)) {
+				strFormat = argv[ndx+1];
+				++ndx;
+			} else {
+				strFormat = strArg.mid(2);
+			}
+			if (strFormat.compare("csv", Qt::CaseInsensitive) == 0) {
+				nOutputFormat = CSportCaptureDecoder::OF_CSV;
+			} else if (strFormat.compare("json", Qt::CaseInsensitive) == 0) {
+				nOutputFormat = CSportCaptureDecoder::OF_JSON;
+			} else {
+				bNeedUsage = true;
+			}
+		} else if (strArg.startsWith("-t")) {
+			QString strType;
+			if ((strArg == "-t") && (argc > ndx+1)) {
+				strType = argv[ndx+1];
+				++ndx;
+			} else {
+				strType = strArg.mid(2);
+			}
+			if (strType.compare("auto", Qt::CaseInsensitive) == 0) {
+				nInputFormat = CSportCaptureDecoder::IF_AUTO;
+			} else if (strType.compare("raw", Qt::CaseInsensitive) == 0) {
+				nInputFormat = CSportCaptureDecoder::IF_RAW;
+			} else if (strType.compare("pcapng", Qt::CaseInsensitive) == 0) {
+				nInputFormat = CSportCaptureDecoder::IF_PCAPNG;
+			} else if (strType.compare("log", Qt::CaseInsensitive) == 0) {
+				nInputFormat = CSportCaptureDecoder::IF_TEXTLOG;
+			} else {
+				bNeedUsage = true;
+			}
+		} else if (strArg.startsWith("-j")) {
+			if ((strArg == "-j") && (argc > ndx+1)) {
+				nThreads = strtoul(argv[ndx+1], nullptr, 0);
+				++ndx;
+			} else {
+				nThreads = strtoul(strArg.mid(2).toUtf8().data(), nullptr, 0);
+			}
+		} else if (strArg.startsWith("-c")) {
+			if ((strArg == "-c") && (argc > ndx+1)) {
+				nChunkSize = static_cast<qint64>(strtoul(argv[ndx+1], nullptr, 0)) * 1024;
+				++ndx;
+			} else {
+				nChunkSize = static_cast<qint64>(strtoul(strArg.mid(2).toUtf8().data(), nullptr, 0)) * 1024;
+			}
+		} else if (strArg == "-d") {
+			bIncludeDetails = true;
+		} else {
+			bNeedUsage = true;
+		}
+	}
+	if (strInput.isEmpty()) bNeedUsage = true;
+
+	if (bNeedUsage) {
+		std::cerr << "Frsky Sport Capture Decoder" << std::endl;
+		std::cerr << "Version: " << strVersion.toUtf8().data() << std::endl << std::endl;
+		std::cerr << "Usage: frsky_sport_decode [options] <input-file>" << std::endl;
+		std::cerr << std::endl;
+		std::cerr << "Where:" << std::endl;
+		std::cerr << "    <input-file> = Capture to decode (required), which can be a raw byte dump" << std::endl;
+		std::cerr << "                    of the Sport bus, a pcapng capture of the serial data, or" << std::endl;
+		std::cerr << "                    a communications log file from the other tools" << std::endl;
+		std::cerr << std::endl;
+		std::cerr << "Options:" << std::endl;
+		std::cerr << "    -o <output-file> = optional output file to write" << std::endl;
+		std::cerr << "                    (if omitted, will write to stdout)" << std::endl;
+		std::cerr << "    -f <format> = output format, \"csv\" (the default) or \"json\"" << std::endl;
+		std::cerr << "    -t <type> = input type, \"auto\" (the default), \"raw\", \"pcapng\" or \"log\"" << std::endl;
+		std::cerr << "    -j <threads> = optional number of decode threads" << std::endl;
+		std::cerr << "                    (if omitted, will use all cores)" << std::endl;
+		std::cerr << "    -c <chunk-KB> = optional size of the chunks the input is split into" << std::endl;
+		std::cerr << "                    for decoding, in KB (if omitted, will use "
+					<< (CSportCaptureDecoder::DEFAULT_CHUNK_SIZE/1024) << ")" << std::endl;
+		std::cerr << "    -d = include the decoded packet details text (slower)" << std::endl;
+		std::cerr << std::endl << std::endl;
+
+		return -1;
+	}
+
+	std::cerr << "frsky_sport_decode version: " << strVersion.toUtf8().data() << std::endl;
+	std::cerr << "Input File: " << strInput.toUtf8().data() << std::endl;
+	if (!strOutput.isEmpty()) {
+		std::cerr << "Output File: " << strOutput.toUtf8().data() << std::endl;
+	}
+
+	QFile fileOutput;
+	if (!strOutput.isEmpty()) {
+		fileOutput.setFileName(strOutput);
+		if (!fileOutput.open(QIODevice::WriteOnly)) {
+			std::cerr << "Failed to open output file \"" << strOutput.toUtf8().data() << "\" for writing" << std::endl;
+			std::cerr << fileOutput.errorString().toUtf8().data() << std::endl;
+			return -2;
+		}
+	} else {
+		if (!fileOutput.open(stdout, QIODevice::WriteOnly)) {
+			std::cerr << "Failed to open stdout for writing" << std::endl;
+			return -2;
+		}
+	}
+
+	CSportCaptureDecoder decoder;
+	decoder.setThreadCount(nThreads);
+	decoder.setChunkSize(nChunkSize);
+	decoder.setOutputFormat(nOutputFormat);
+	decoder.setIncludeDetails(bIncludeDetails);
+
+	QString strError;
+	bool bSuccess = decoder.decodeFile(strInput, nInputFormat, fileOutput, &strError);
+	fileOutput.close();
+
+	if (!bSuccess) {
+		std::cerr << "Failed to decode \"" << strInput.toUtf8().data() << "\"" << std::endl;
+		std::cerr << strError.toUtf8().data() << std::endl;
+		return -3;
+	}
+
+	std::cerr << decoder.summary().toUtf8().data() << std::endl;
+	if (decoder.inputFormat() == CSportCaptureDecoder::IF_TEXTLOG) {
+		const CSportCaptureDecoder::TDecodeStats &stats = decoder.stats();
+		std::cerr << "Log Lines: " << stats.m_nLines << ", Stat Lines: " << stats.m_nStatLines
+					<< ", Unrecognized Lines: " << stats.m_nSkippedLines << std::endl;
+	}
+
+	return 0;
+}
+
+// ============================================================================
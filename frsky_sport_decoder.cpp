@@ -0,0 +1,969 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#include "frsky_sport_decoder.h"
+#include "frsky_sport_io.h"
+
+#include <QThread>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QtEndian>
+
+#include <algorithm>
+#include <string.h>
+
+// ============================================================================
+
+namespace {
+	constexpr uint32_t PCAPNG_BLOCK_SHB = 0x0A0D0D0A;		// Section Header Block
+	constexpr uint32_t PCAPNG_BLOCK_IDB = 0x00000001;		// Interface Description Block
+	constexpr uint32_t PCAPNG_BLOCK_OPB = 0x00000002;		// Obsolete Packet Block
+	constexpr uint32_t PCAPNG_BLOCK_SPB = 0x00000003;		// Simple Packet Block
+	constexpr uint32_t PCAPNG_BLOCK_EPB = 0x00000006;		// Enhanced Packet Block
+	constexpr uint32_t PCAPNG_BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+	constexpr uint16_t PCAPNG_OPT_END = 0;
+	constexpr uint16_t PCAPNG_OPT_IF_TSRESOL = 9;
+	constexpr uint16_t LINKTYPE_RTAC_SERIAL = 250;
+	constexpr int RTAC_SERIAL_HEADER_SIZE = 12;				// LINKTYPE_RTAC_SERIAL header preceding the serial bytes
+	constexpr int TEXT_DETECT_SIZE = 4096;					// Bytes checked by detectFormat() for a text log
+
+	const char *conarrFrameKindNames[CSportCaptureDecoder::FK_COUNT] = {
+		"poll",
+		"telemetry",
+		"firmware",
+		"unknown",
+		"partial",
+		"extraneous",
+	};
+
+	// Log type names as written by CFrskySportIO::logMessage(), in LOG_TYPE order:
+	const char *conarrLogTypeNames[] = {
+		"Recv",
+		"Send",
+		"Echo",
+		"Push",
+		"Poll",
+		"Stat",
+	};
+
+	const char conarrHexDigits[] = "0123456789ABCDEF";
+
+	const char conCsvHeader[] = "offset,time_ms,port,type,kind,phys_id,prim,data_id,cmd,value,crc_ok,bytes";
+
+	// ------------------------------------------------------------------------
+
+	struct TPcapInterface {
+		uint16_t m_nLinkType = 0;
+		bool m_bBinaryResolution = false;		// Timestamp units are 2^-m_nResolution seconds instead of 10^-m_nResolution
+		int m_nResolution = 6;
+	};
+
+	class CPcapReader
+	{
+	public:
+		CPcapReader(const uchar *pData, bool bSwapped)
+			:	m_pData(pData),
+				m_bSwapped(bSwapped)
+		{ }
+
+		uint16_t u16(qint64 nPos) const
+		{
+			uint16_t nValue;
+			memcpy(&nValue, m_pData + nPos, sizeof(nValue));
+			return m_bSwapped ? qbswap(nValue) : nValue;
+		}
+
+		uint32_t u32(qint64 nPos) const
+		{
+			uint32_t nValue;
+			memcpy(&nValue, m_pData + nPos, sizeof(nValue));
+			return m_bSwapped ? qbswap(nValue) : nValue;
+		}
+
+	private:
+		const uchar *m_pData;
+		bool m_bSwapped;
+	};
+
+	int64_t pcapTimestampNsecs(uint64_t nTimestamp, const TPcapInterface &interface)
+	{
+		if (interface.m_bBinaryResolution) {
+			if (interface.m_nResolution >= 64) return 0;
+			uint64_t nUnitsPerSec = (1ull << interface.m_nResolution);
+			return static_cast<int64_t>((nTimestamp / nUnitsPerSec) * 1000000000ull +
+					static_cast<uint64_t>((static_cast<double>(nTimestamp % nUnitsPerSec) * 1e9) / nUnitsPerSec));
+		}
+
+		int64_t nValue = static_cast<int64_t>(nTimestamp);
+		for (int i = interface.m_nResolution; i < 9; ++i) nValue *= 10;
+		for (int i = 9; i < interface.m_nResolution; ++i) nValue /= 10;
+		return nValue;
+	}
+
+	// ------------------------------------------------------------------------
+
+	// A single output record and its formatting.  Formatting is done by
+	//	hand into the chunk's output buffer, as QString formatting of every
+	//	field would dominate the decode time.
+	struct TRecord {
+		qint64 m_nOffset = 0;					// Offset in the input file
+		int64_t m_nTimestampNsecs = -1;			// Binary timestamp, -1 if none
+		const char *m_pTimeText = nullptr;		// Timestamp text (msecs) copied verbatim from a text log
+		int m_nTimeTextLen = 0;
+		int m_nPort = -1;						// Port number from a text log, -1 if none
+		const char *m_pType = "Recv";
+		CSportCaptureDecoder::FRAME_KIND m_nKind = CSportCaptureDecoder::FK_PARTIAL;
+		const CSportRxBuffer *m_pRxBuffer = nullptr;	// Decoded frame, null for extraneous bytes
+		const uchar *m_pBytes = nullptr;		// Frame bytes as on the bus, including the 0x7E
+		int m_nBytes = 0;
+	};
+
+	// Record text is built in a local buffer and appended to the chunk's
+	//	output in blocks, as per-character QByteArray appends would dominate
+	//	the decode time:
+	class CRecordBuffer
+	{
+	public:
+		CRecordBuffer(QByteArray &baOutput)
+			:	m_baOutput(baOutput)
+		{ }
+		~CRecordBuffer()
+		{
+			flush();
+		}
+
+		void flush()
+		{
+			m_baOutput.append(m_buf, m_nLen);
+			m_nLen = 0;
+		}
+
+		void put(char ch)
+		{
+			if (m_nLen == BUFFER_SIZE) flush();
+			m_buf[m_nLen++] = ch;
+		}
+
+		void put(const char *pszText)
+		{
+			while (*pszText) put(*pszText++);
+		}
+
+		void put(const char *pText, int nLen)
+		{
+			for (int i = 0; i < nLen; ++i) put(pText[i]);
+		}
+
+		void putDec(uint64_t nValue)
+		{
+			char buf[24];
+			int nPos = sizeof(buf);
+			do {
+				buf[--nPos] = '0' + (nValue % 10);
+				nValue /= 10;
+			} while (nValue);
+			put(buf + nPos, sizeof(buf) - nPos);
+		}
+
+		void putHex(uint32_t nValue, int nDigits)
+		{
+			put('0');
+			put('x');
+			for (int i = nDigits-1; i >= 0; --i) put(conarrHexDigits[(nValue >> (i*4)) & 0x0F]);
+		}
+
+		void putHexBytes(const uchar *pBytes, int nBytes)
+		{
+			for (int i = 0; i < nBytes; ++i) {
+				if (i) put('.');
+				put(conarrHexDigits[pBytes[i] >> 4]);
+				put(conarrHexDigits[pBytes[i] & 0x0F]);
+			}
+		}
+
+		void putEscaped(const QByteArray &baText, CSportCaptureDecoder::OUTPUT_FORMAT nFormat)
+		{
+			put('"');
+			for (char ch : baText) {
+				if (ch == '"') {
+					put((nFormat == CSportCaptureDecoder::OF_CSV) ? "\"\"" : "\\\"");
+				} else if ((nFormat == CSportCaptureDecoder::OF_JSON) && (ch == '\\')) {
+					put("\\\\");
+				} else if ((nFormat == CSportCaptureDecoder::OF_JSON) && (static_cast<uchar>(ch) < 0x20)) {
+					put(' ');
+				} else {
+					put(ch);
+				}
+			}
+			put('"');
+		}
+
+	private:
+		static constexpr int BUFFER_SIZE = 256;
+		QByteArray &m_baOutput;
+		char m_buf[BUFFER_SIZE];
+		int m_nLen = 0;
+	};
+
+	void putTime(CRecordBuffer &buf, const TRecord &rec)
+	{
+		if (rec.m_pTimeText) {
+			buf.put(rec.m_pTimeText, rec.m_nTimeTextLen);
+		} else if (rec.m_nTimestampNsecs >= 0) {
+			// msecs with 4 decimals, same as CLogFile:
+			buf.putDec(rec.m_nTimestampNsecs / 1000000);
+			buf.put('.');
+			int64_t nFraction = (rec.m_nTimestampNsecs % 1000000) / 100;
+			for (int64_t nDiv = 1000; nDiv; nDiv /= 10) buf.put('0' + static_cast<char>((nFraction / nDiv) % 10));
+		}
+	}
+
+	void formatRecord(QByteArray &baOutput, CSportCaptureDecoder::TDecodeStats &stats, const TRecord &rec,
+						CSportCaptureDecoder::OUTPUT_FORMAT nFormat, bool bIncludeDetails)
+	{
+		bool bJson = (nFormat == CSportCaptureDecoder::OF_JSON);
+
+		// Decoded fields, by frame kind:
+		int nPhysicalId = -1;
+		int nPrim = -1;
+		int nDataId = -1;
+		int nCmd = -1;
+		int64_t nValue = -1;
+		int nCrcOk = -1;
+		if (rec.m_pRxBuffer) {
+			const CSportRxBuffer &rx = *rec.m_pRxBuffer;
+			switch (rec.m_nKind) {
+				case CSportCaptureDecoder::FK_POLL:
+					nPhysicalId = rx.telemetryPollPacket().getPhysicalId();
+					break;
+				case CSportCaptureDecoder::FK_TELEMETRY:
+					nPhysicalId = rx.telemetryPacket().getPhysicalId();
+					nPrim = rx.telemetryPacket().getPrimId();
+					nDataId = rx.telemetryPacket().getDataId();
+					nValue = rx.telemetryPacket().getValue();
+					nCrcOk = (rx.telemetryPacket().crc() == rx.crc());
+					break;
+				case CSportCaptureDecoder::FK_FIRMWARE:
+					nPhysicalId = (rx.firmwarePacket().m_physicalId & 0x1F);
+					nPrim = rx.firmwarePacket().m_primId;
+					nCmd = rx.firmwarePacket().m_cmd;
+					nValue = rx.firmwarePacket().dataValue();
+					nCrcOk = (rx.firmwarePacket().crc() == rx.crc());
+					break;
+				case CSportCaptureDecoder::FK_UNKNOWN:
+					nPhysicalId = rx.telemetryPacket().getPhysicalId();
+					nPrim = rx.telemetryPacket().getPrimId();
+					break;
+				default:
+					break;
+			}
+		}
+		++stats.m_nFrames[rec.m_nKind];
+		if (nCrcOk == 0) ++stats.m_nCrcErrors;
+
+		CRecordBuffer buf(baOutput);
+		if (bJson) {
+			// Note: records are written with a leading separator, which the
+			//	writer drops from the first one
+			buf.put(",\n  {\"offset\":");
+			buf.putDec(rec.m_nOffset);
+			if (rec.m_pTimeText || (rec.m_nTimestampNsecs >= 0)) {
+				buf.put(",\"time_ms\":");
+				putTime(buf, rec);
+			}
+			if (rec.m_nPort >= 0) {
+				buf.put(",\"port\":");
+				buf.putDec(rec.m_nPort);
+			}
+			buf.put(",\"type\":\"");
+			buf.put(rec.m_pType);
+			buf.put("\",\"kind\":\"");
+			buf.put(conarrFrameKindNames[rec.m_nKind]);
+			buf.put('"');
+			if (nPhysicalId >= 0) {
+				buf.put(",\"phys_id\":");
+				buf.putDec(nPhysicalId);
+			}
+			if (nPrim >= 0) {
+				buf.put(",\"prim\":");
+				buf.putDec(nPrim);
+			}
+			if (nDataId >= 0) {
+				buf.put(",\"data_id\":");
+				buf.putDec(nDataId);
+			}
+			if (nCmd >= 0) {
+				buf.put(",\"cmd\":");
+				buf.putDec(nCmd);
+			}
+			if (nValue >= 0) {
+				buf.put(",\"value\":");
+				buf.putDec(nValue);
+			}
+			if (nCrcOk >= 0) {
+				buf.put(nCrcOk ? ",\"crc_ok\":true" : ",\"crc_ok\":false");
+			}
+			buf.put(",\"bytes\":\"");
+			buf.putHexBytes(rec.m_pBytes, rec.m_nBytes);
+			buf.put('"');
+			if (bIncludeDetails && rec.m_pRxBuffer) {
+				buf.put(",\"detail\":");
+				buf.putEscaped(rec.m_pRxBuffer->logDetails().toUtf8(), nFormat);
+			}
+			buf.put('}');
+		} else {
+			buf.putDec(rec.m_nOffset);
+			buf.put(',');
+			putTime(buf, rec);
+			buf.put(',');
+			if (rec.m_nPort >= 0) buf.putDec(rec.m_nPort);
+			buf.put(',');
+			buf.put(rec.m_pType);
+			buf.put(',');
+			buf.put(conarrFrameKindNames[rec.m_nKind]);
+			buf.put(',');
+			if (nPhysicalId >= 0) buf.putDec(nPhysicalId);
+			buf.put(',');
+			if (nPrim >= 0) buf.putHex(nPrim, 2);
+			buf.put(',');
+			if (nDataId >= 0) buf.putHex(nDataId, 4);
+			buf.put(',');
+			if (nCmd >= 0) buf.putHex(nCmd, 2);
+			buf.put(',');
+			if (nValue >= 0) buf.putDec(nValue);
+			buf.put(',');
+			if (nCrcOk >= 0) buf.put(nCrcOk ? '1' : '0');
+			buf.put(',');
+			buf.putHexBytes(rec.m_pBytes, rec.m_nBytes);
+			if (bIncludeDetails) {
+				buf.put(',');
+				if (rec.m_pRxBuffer) buf.putEscaped(rec.m_pRxBuffer->logDetails().toUtf8(), nFormat);
+			}
+			buf.put('\n');
+		}
+	}
+
+	CSportCaptureDecoder::FRAME_KIND frameKind(const CSportRxBuffer &rx)
+	{
+		if (rx.haveCompletePacket()) {
+			if (rx.isFirmwarePacket()) return CSportCaptureDecoder::FK_FIRMWARE;
+			if (rx.isTelemetryPacket()) return CSportCaptureDecoder::FK_TELEMETRY;
+			return CSportCaptureDecoder::FK_UNKNOWN;
+		}
+		if (rx.haveTelemetryPoll()) return CSportCaptureDecoder::FK_POLL;
+		return CSportCaptureDecoder::FK_PARTIAL;
+	}
+
+	inline int hexValue(char ch)
+	{
+		if ((ch >= '0') && (ch <= '9')) return ch - '0';
+		if ((ch >= 'A') && (ch <= 'F')) return ch - 'A' + 10;
+		if ((ch >= 'a') && (ch <= 'f')) return ch - 'a' + 10;
+		return -1;
+	}
+};
+
+// ============================================================================
+
+class CSportDecodeWorker : public QThread
+{
+public:
+	CSportDecodeWorker(CSportCaptureDecoder &decoder)
+		:	m_decoder(decoder)
+	{ }
+
+protected:
+	virtual void run() override
+	{
+		m_decoder.workerLoop();
+	}
+
+private:
+	CSportCaptureDecoder &m_decoder;
+};
+
+// ============================================================================
+
+qint64 CSportCaptureDecoder::TDecodeStats::totalFrames() const
+{
+	qint64 nTotal = 0;
+	for (int i = 0; i < FK_COUNT; ++i) nTotal += m_nFrames[i];
+	return nTotal;
+}
+
+void CSportCaptureDecoder::TDecodeStats::add(const TDecodeStats &stats)
+{
+	for (int i = 0; i < FK_COUNT; ++i) m_nFrames[i] += stats.m_nFrames[i];
+	m_nCrcErrors += stats.m_nCrcErrors;
+	m_nLines += stats.m_nLines;
+	m_nStatLines += stats.m_nStatLines;
+	m_nSkippedLines += stats.m_nSkippedLines;
+}
+
+// ============================================================================
+
+CSportCaptureDecoder::CSportCaptureDecoder()
+{
+}
+
+CSportCaptureDecoder::~CSportCaptureDecoder()
+{
+}
+
+CSportCaptureDecoder::INPUT_FORMAT CSportCaptureDecoder::detectFormat(const uchar *pData, qint64 nSize)
+{
+	if ((nSize >= 4) && (CPcapReader(pData, false).u32(0) == PCAPNG_BLOCK_SHB)) return IF_PCAPNG;	// Same in both byte orders
+
+	// Text logs are all printable ASCII, which a raw bus capture
+	//	with its binary physical IDs and values won't be for long:
+	qint64 nCheck = std::min<qint64>(nSize, TEXT_DETECT_SIZE);
+	if (nCheck == 0) return IF_RAW;
+	for (qint64 i = 0; i < nCheck; ++i) {
+		uchar ch = pData[i];
+		if (((ch < 0x20) && (ch != '\n') && (ch != '\r') && (ch != '\t')) || (ch >= 0x7F)) return IF_RAW;
+	}
+	return IF_TEXTLOG;
+}
+
+QString CSportCaptureDecoder::inputFormatName(INPUT_FORMAT nFormat)
+{
+	switch (nFormat) {
+		case IF_AUTO:
+			return "auto";
+		case IF_RAW:
+			return "raw";
+		case IF_PCAPNG:
+			return "pcapng";
+		case IF_TEXTLOG:
+			return "text log";
+	}
+	return QString();
+}
+
+const char *CSportCaptureDecoder::frameKindName(FRAME_KIND nKind)
+{
+	if ((nKind < 0) || (nKind >= FK_COUNT)) return "";
+	return conarrFrameKindNames[nKind];
+}
+
+QString CSportCaptureDecoder::summary() const
+{
+	double dblSecs = static_cast<double>(m_stats.m_nElapsedNsecs) / 1e9;
+	double dblMBytes = static_cast<double>(m_stats.m_nInputBytes) / (1024.0*1024.0);
+	return QString("Decoded %1 records (%2 telemetry, %3 polls, %4 firmware, %5 unknown, %6 partial, %7 extraneous), %8 CRC errors")
+			.arg(m_stats.totalFrames()).arg(m_stats.m_nFrames[FK_TELEMETRY]).arg(m_stats.m_nFrames[FK_POLL])
+			.arg(m_stats.m_nFrames[FK_FIRMWARE]).arg(m_stats.m_nFrames[FK_UNKNOWN]).arg(m_stats.m_nFrames[FK_PARTIAL])
+			.arg(m_stats.m_nFrames[FK_EXTRANEOUS]).arg(m_stats.m_nCrcErrors) +
+			QString(" from %1 MB of %2 in %3 s (%4 MB/s, %5 chunks, %6 threads)")
+			.arg(dblMBytes, 0, 'f', 1).arg(inputFormatName(m_nInputFormat)).arg(dblSecs, 0, 'f', 3)
+			.arg((dblSecs > 0) ? (dblMBytes / dblSecs) : 0.0, 0, 'f', 1).arg(m_stats.m_nChunks).arg(m_stats.m_nThreads);
+}
+
+// ----------------------------------------------------------------------------
+
+bool CSportCaptureDecoder::decodeFile(const QString &strFilename, INPUT_FORMAT nFormat, QIODevice &devOutput, QString *pstrError)
+{
+	QElapsedTimer tmrElapsed;
+	tmrElapsed.start();
+
+	m_stats = TDecodeStats();
+	m_vecStream.clear();
+	m_arrSegments.clear();
+	m_pData = nullptr;
+	m_nSize = 0;
+
+	m_fileInput.setFileName(strFilename);
+	if (!m_fileInput.open(QIODevice::ReadOnly)) {
+		if (pstrError) *pstrError = m_fileInput.errorString();
+		return false;
+	}
+
+	qint64 nFileSize = m_fileInput.size();
+	const uchar *pFileData = nullptr;
+	if (nFileSize > 0) {
+		pFileData = m_fileInput.map(0, nFileSize);
+		if (pFileData == nullptr) {
+			if (pstrError) *pstrError = m_fileInput.errorString();
+			m_fileInput.close();
+			return false;
+		}
+	}
+	m_stats.m_nInputBytes = nFileSize;
+
+	m_nInputFormat = (nFormat == IF_AUTO) ? detectFormat(pFileData, nFileSize) : nFormat;
+	m_pData = pFileData;
+	m_nSize = nFileSize;
+	if (m_nInputFormat == IF_PCAPNG) {
+		if (!readPcapng(m_pData, m_nSize, m_vecStream, m_arrSegments, pstrError)) {
+			m_fileInput.close();
+			return false;
+		}
+		m_pData = m_vecStream.data();
+		m_nSize = static_cast<qint64>(m_vecStream.size());
+	}
+
+	// Split and decode:
+	if (m_nChunkSize < 1024) m_nChunkSize = 1024;
+	m_nChunks = static_cast<int>((m_nSize + m_nChunkSize - 1) / m_nChunkSize);
+	int nThreads = (m_nThreads > 0) ? m_nThreads : QThread::idealThreadCount();
+	if (nThreads < 1) nThreads = 1;
+	if (nThreads > m_nChunks) nThreads = std::max(m_nChunks, 1);
+	m_stats.m_nChunks = m_nChunks;
+	m_stats.m_nThreads = nThreads;
+
+	m_nWindow = nThreads * CHUNKS_AHEAD_PER_THREAD;
+	m_arrResults.clear();
+	m_arrResults.resize(m_nWindow);
+	m_nNextChunk = 0;
+	m_nWrittenChunks = 0;
+	m_bAbort = false;
+
+	QVector<CSportDecodeWorker *> arrWorkers;
+	for (int i = 0; i < nThreads; ++i) {
+		arrWorkers.append(new CSportDecodeWorker(*this));
+		arrWorkers.last()->start();
+	}
+
+	bool bSuccess = true;
+	bool bAnyRecord = false;
+	QByteArray baHeader = (m_nOutputFormat == OF_JSON) ? QByteArray("[") : QByteArray(conCsvHeader);
+	if ((m_nOutputFormat == OF_CSV) && m_bIncludeDetails) baHeader.append(",detail");
+	if (m_nOutputFormat == OF_CSV) baHeader.append('\n');
+	if (devOutput.write(baHeader) != baHeader.size()) bSuccess = false;
+	m_stats.m_nOutputBytes += baHeader.size();
+
+	// Write the chunks out in order as they complete:
+	for (int nChunk = 0; bSuccess && (nChunk < m_nChunks); ++nChunk) {
+		QByteArray baOutput;
+		{
+			QMutexLocker locker(&m_mutex);
+			TChunkResult &result = m_arrResults[nChunk % m_nWindow];
+			while (!result.m_bDone) m_cndChunkDone.wait(&m_mutex);
+			baOutput.swap(result.m_baOutput);
+			m_stats.add(result.m_stats);
+			result = TChunkResult();
+			++m_nWrittenChunks;
+			m_cndWindow.wakeAll();
+		}
+
+		int nSkip = 0;
+		if ((m_nOutputFormat == OF_JSON) && !bAnyRecord && !baOutput.isEmpty()) {
+			nSkip = 1;				// Drop the leading separator of the first record
+			bAnyRecord = true;
+		}
+		qint64 nWrite = baOutput.size() - nSkip;
+		if ((nWrite > 0) && (devOutput.write(baOutput.constData() + nSkip, nWrite) != nWrite)) bSuccess = false;
+		m_stats.m_nOutputBytes += nWrite;
+	}
+
+	if (!bSuccess) {
+		QMutexLocker locker(&m_mutex);
+		m_bAbort = true;
+		m_cndWindow.wakeAll();
+	}
+	for (auto &pWorker : arrWorkers) {
+		pWorker->wait();
+		delete pWorker;
+	}
+	m_arrResults.clear();
+
+	if (bSuccess && (m_nOutputFormat == OF_JSON)) {
+		QByteArray baTrailer("\n]\n");
+		if (devOutput.write(baTrailer) != baTrailer.size()) bSuccess = false;
+		m_stats.m_nOutputBytes += baTrailer.size();
+	}
+	if (!bSuccess && pstrError) *pstrError = devOutput.errorString();
+
+	if (pFileData) m_fileInput.unmap(const_cast<uchar *>(pFileData));
+	m_fileInput.close();
+	m_vecStream.clear();
+	m_vecStream.shrink_to_fit();
+	m_pData = nullptr;
+
+	m_stats.m_nElapsedNsecs = tmrElapsed.nsecsElapsed();
+	return bSuccess;
+}
+
+// ----------------------------------------------------------------------------
+
+bool CSportCaptureDecoder::readPcapng(const uchar *pData, qint64 nSize, std::vector<uchar> &vecStream,
+										QVector<TPcapSegment> &arrSegments, QString *pstrError)
+{
+	qint64 nPos = 0;
+	bool bHaveSection = false;
+	bool bSwapped = false;
+	QVector<TPcapInterface> arrInterfaces;
+
+	vecStream.reserve(static_cast<size_t>(nSize));
+
+	while (nPos + 12 <= nSize) {
+		CPcapReader rd(pData, bSwapped);
+		uint32_t nBlockType = rd.u32(nPos);
+		if (nBlockType == PCAPNG_BLOCK_SHB) {
+			// Each section sets its own byte order and interfaces:
+			uint32_t nMagic = CPcapReader(pData, false).u32(nPos+8);
+			if (nMagic == PCAPNG_BYTE_ORDER_MAGIC) {
+				bSwapped = false;
+			} else if (nMagic == qbswap(PCAPNG_BYTE_ORDER_MAGIC)) {
+				bSwapped = true;
+			} else {
+				if (pstrError) *pstrError = QString("Invalid pcapng byte-order magic at offset %1").arg(nPos);
+				return false;
+			}
+			rd = CPcapReader(pData, bSwapped);
+			bHaveSection = true;
+			arrInterfaces.clear();
+		} else if (!bHaveSection) {
+			if (pstrError) *pstrError = "Not a pcapng file, no Section Header Block";
+			return false;
+		}
+
+		uint32_t nBlockLen = rd.u32(nPos+4);
+		if ((nBlockLen < 12) || (nBlockLen % 4) || (nPos + nBlockLen > nSize)) break;		// Truncated capture, keep what we have
+
+		qint64 nDataPos = -1;
+		qint64 nDataLen = 0;
+		int64_t nTimestampNsecs = -1;
+		int nInterface = 0;
+		switch (nBlockType) {
+			case PCAPNG_BLOCK_IDB:
+				if (nBlockLen >= 20) {
+					TPcapInterface interface;
+					interface.m_nLinkType = rd.u16(nPos+8);
+					qint64 nOptPos = nPos + 16;
+					while (nOptPos + 4 <= nPos + nBlockLen - 4) {
+						uint16_t nOptCode = rd.u16(nOptPos);
+						uint16_t nOptLen = rd.u16(nOptPos+2);
+						if (nOptCode == PCAPNG_OPT_END) break;
+						if ((nOptCode == PCAPNG_OPT_IF_TSRESOL) && (nOptLen >= 1)) {
+							uint8_t nResolution = pData[nOptPos+4];
+							interface.m_bBinaryResolution = ((nResolution & 0x80) != 0);
+							interface.m_nResolution = (nResolution & 0x7F);
+						}
+						nOptPos += 4 + ((nOptLen + 3) & ~3);
+					}
+					arrInterfaces.append(interface);
+				}
+				break;
+
+			case PCAPNG_BLOCK_EPB:
+				if (nBlockLen >= 32) {
+					nInterface = static_cast<int>(rd.u32(nPos+8));
+					uint64_t nTimestamp = (static_cast<uint64_t>(rd.u32(nPos+12)) << 32) | rd.u32(nPos+16);
+					if (nInterface < arrInterfaces.size()) {
+						nTimestampNsecs = pcapTimestampNsecs(nTimestamp, arrInterfaces.at(nInterface));
+					}
+					nDataPos = nPos + 28;
+					nDataLen = std::min<qint64>(rd.u32(nPos+20), nBlockLen - 32);
+				}
+				break;
+
+			case PCAPNG_BLOCK_OPB:
+				if (nBlockLen >= 32) {
+					nInterface = rd.u16(nPos+8);
+					uint64_t nTimestamp = (static_cast<uint64_t>(rd.u32(nPos+12)) << 32) | rd.u32(nPos+16);
+					if (nInterface < arrInterfaces.size()) {
+						nTimestampNsecs = pcapTimestampNsecs(nTimestamp, arrInterfaces.at(nInterface));
+					}
+					nDataPos = nPos + 28;
+					nDataLen = std::min<qint64>(rd.u32(nPos+20), nBlockLen - 32);
+				}
+				break;
+
+			case PCAPNG_BLOCK_SPB:
+				if (nBlockLen >= 16) {
+					nDataPos = nPos + 12;
+					nDataLen = std::min<qint64>(rd.u32(nPos+8), nBlockLen - 16);
+				}
+				break;
+
+			default:
+				break;		// Other blocks (name resolution, statistics, etc) don't carry bus data
+		}
+
+		if ((nDataPos >= 0) && (nInterface < arrInterfaces.size())) {
+			if (arrInterfaces.at(nInterface).m_nLinkType == LINKTYPE_RTAC_SERIAL) {
+				nDataPos += RTAC_SERIAL_HEADER_SIZE;
+				nDataLen -= RTAC_SERIAL_HEADER_SIZE;
+			}
+			if (nDataLen > 0) {
+				TPcapSegment segment;
+				segment.m_nStreamOffset = static_cast<qint64>(vecStream.size());
+				segment.m_nFileOffset = nDataPos;
+				segment.m_nTimestampNsecs = nTimestampNsecs;
+				arrSegments.append(segment);
+				vecStream.insert(vecStream.end(), pData + nDataPos, pData + nDataPos + nDataLen);
+			}
+		}
+
+		nPos += nBlockLen;
+	}
+
+	if (!bHaveSection) {
+		if (pstrError) *pstrError = "Not a pcapng file, no Section Header Block";
+		return false;
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+void CSportCaptureDecoder::workerLoop()
+{
+	for (;;) {
+		int nChunk;
+		{
+			QMutexLocker locker(&m_mutex);
+			while (!m_bAbort && (m_nNextChunk < m_nChunks) && (m_nNextChunk >= (m_nWrittenChunks + m_nWindow))) {
+				m_cndWindow.wait(&m_mutex);
+			}
+			if (m_bAbort || (m_nNextChunk >= m_nChunks)) return;
+			nChunk = m_nNextChunk++;
+		}
+
+		TChunkResult result;
+		decodeChunk(nChunk, result);
+
+		{
+			QMutexLocker locker(&m_mutex);
+			TChunkResult &slot = m_arrResults[nChunk % m_nWindow];
+			slot.m_baOutput.swap(result.m_baOutput);
+			slot.m_stats = result.m_stats;
+			slot.m_bDone = true;
+			m_cndChunkDone.wakeAll();
+		}
+	}
+}
+
+qint64 CSportCaptureDecoder::chunkStart(int nChunk) const
+{
+	if (nChunk <= 0) return 0;
+	if (nChunk >= m_nChunks) return m_nSize;
+
+	// Byte streams split at a frame start and text logs after a line end,
+	//	so each chunk boundary is found the same way by both chunks sharing it:
+	qint64 nNominal = static_cast<qint64>(nChunk) * m_nChunkSize;
+	if (m_nInputFormat == IF_TEXTLOG) {
+		const void *pFound = memchr(m_pData + nNominal, '\n', m_nSize - nNominal);
+		return pFound ? (static_cast<const uchar *>(pFound) - m_pData + 1) : m_nSize;
+	}
+	const void *pFound = memchr(m_pData + nNominal, 0x7E, m_nSize - nNominal);
+	return pFound ? (static_cast<const uchar *>(pFound) - m_pData) : m_nSize;
+}
+
+void CSportCaptureDecoder::decodeChunk(int nChunk, TChunkResult &result) const
+{
+	qint64 nStart = chunkStart(nChunk);
+	qint64 nEnd = chunkStart(nChunk+1);
+	if (nStart >= nEnd) return;
+
+	result.m_baOutput.reserve(static_cast<int>(std::min<qint64>((nEnd - nStart) * 8, 0x40000000)));
+	if (m_nInputFormat == IF_TEXTLOG) {
+		decodeTextChunk(nStart, nEnd, result);
+	} else {
+		decodeStreamChunk(nStart, nEnd, result);
+	}
+}
+
+void CSportCaptureDecoder::decodeStreamChunk(qint64 nStart, qint64 nEnd, TChunkResult &result) const
+{
+	CSportRxBuffer rxBuffer;
+	qint64 nFrameStart = -1;		// Offset of the current frame's 0x7E, -1 if none
+	bool bFrameDone = false;		// Current frame has been output
+	QByteArray baFrame;
+
+	// Segment of a pcapng capture containing the current position:
+	int nSegment = 0;
+	if (!m_arrSegments.isEmpty()) {
+		auto itr = std::upper_bound(m_arrSegments.cbegin(), m_arrSegments.cend(), nStart,
+					[](qint64 nOffset, const TPcapSegment &segment)->bool { return nOffset < segment.m_nStreamOffset; });
+		nSegment = static_cast<int>(itr - m_arrSegments.cbegin()) - 1;
+	}
+
+	auto fnSetOffset = [this, &nSegment](TRecord &rec, qint64 nStreamOffset)->void {
+		if (m_arrSegments.isEmpty()) {
+			rec.m_nOffset = nStreamOffset;
+			return;
+		}
+		while ((nSegment+1 < m_arrSegments.size()) && (m_arrSegments.at(nSegment+1).m_nStreamOffset <= nStreamOffset)) ++nSegment;
+		const TPcapSegment &segment = m_arrSegments.at(nSegment);
+		rec.m_nOffset = segment.m_nFileOffset + (nStreamOffset - segment.m_nStreamOffset);
+		rec.m_nTimestampNsecs = segment.m_nTimestampNsecs;
+	};
+
+	auto fnOutputFrame = [&]()->void {
+		TRecord rec;
+		fnSetOffset(rec, nFrameStart);
+		rec.m_nKind = frameKind(rxBuffer);
+		rec.m_pType = conarrLogTypeNames[(rec.m_nKind == FK_POLL) ? CFrskySportIO::LT_TELEPOLL : CFrskySportIO::LT_RX];
+		rec.m_pRxBuffer = &rxBuffer;
+		baFrame.resize(1);
+		baFrame[0] = 0x7E;		// Add the 0x7E since it's eaten by the RxBuffer
+		baFrame.append(rxBuffer.rawData());
+		rec.m_pBytes = reinterpret_cast<const uchar *>(baFrame.constData());
+		rec.m_nBytes = baFrame.size();
+		formatRecord(result.m_baOutput, result.m_stats, rec, m_nOutputFormat, m_bIncludeDetails);
+		bFrameDone = true;
+	};
+
+	auto fnOutputExtraneous = [&](const QByteArray &baExtraneous, qint64 nEndOffset)->void {
+		TRecord rec;
+		fnSetOffset(rec, nEndOffset - baExtraneous.size());
+		rec.m_nKind = FK_EXTRANEOUS;
+		rec.m_pBytes = reinterpret_cast<const uchar *>(baExtraneous.constData());
+		rec.m_nBytes = baExtraneous.size();
+		formatRecord(result.m_baOutput, result.m_stats, rec, m_nOutputFormat, m_bIncludeDetails);
+	};
+
+	for (qint64 nPos = nStart; nPos < nEnd; ++nPos) {
+		uint8_t nByte = m_pData[nPos];
+		if (nByte == 0x7E) {
+			// A poll without response or a partial frame ends at the next frame start:
+			if ((nFrameStart >= 0) && !bFrameDone) fnOutputFrame();
+			QByteArray baExtraneous = rxBuffer.pushByte(nByte);
+			if (!baExtraneous.isEmpty()) fnOutputExtraneous(baExtraneous, nPos);
+			nFrameStart = nPos;
+			bFrameDone = false;
+		} else {
+			rxBuffer.pushByte(nByte);
+			if (!bFrameDone && (nFrameStart >= 0) && rxBuffer.haveCompletePacket()) fnOutputFrame();
+		}
+	}
+
+	// The chunk ends where the next frame starts (or at the end of the input):
+	if ((nFrameStart >= 0) && !bFrameDone) fnOutputFrame();
+	QByteArray baExtraneous = rxBuffer.pushByte(0x7E);
+	if (!baExtraneous.isEmpty()) fnOutputExtraneous(baExtraneous, nEnd);
+}
+
+void CSportCaptureDecoder::decodeTextChunk(qint64 nStart, qint64 nEnd, TChunkResult &result) const
+{
+	const char *pChunk = reinterpret_cast<const char *>(m_pData);
+
+	qint64 nLineStart = nStart;
+	while (nLineStart < nEnd) {
+		const void *pFound = memchr(pChunk + nLineStart, '\n', nEnd - nLineStart);
+		qint64 nLineEnd = pFound ? (static_cast<const char *>(pFound) - pChunk) : nEnd;
+		const char *p = pChunk + nLineStart;
+		const char *pEnd = pChunk + nLineEnd;
+		qint64 nOffset = nLineStart;
+		nLineStart = nLineEnd + 1;
+		if ((pEnd > p) && (*(pEnd-1) == '\r')) --pEnd;
+		++result.m_stats.m_nLines;
+
+		// "<msecs>: [<port>: |Session <n>: ]<type>: <bytes>[  <details>]"
+		while ((p < pEnd) && (*p == ' ')) ++p;
+		const char *pTime = p;
+		while ((p < pEnd) && (((*p >= '0') && (*p <= '9')) || (*p == '.'))) ++p;
+		int nTimeLen = static_cast<int>(p - pTime);
+		if ((nTimeLen == 0) || (pEnd - p < 2) || (p[0] != ':') || (p[1] != ' ')) {
+			++result.m_stats.m_nSkippedLines;
+			continue;
+		}
+		p += 2;
+
+		TLogMessage msg;
+		if (!parseLogMessage(p, pEnd, msg)) {
+			++result.m_stats.m_nSkippedLines;
+			continue;
+		}
+		if (msg.m_nLogType == CFrskySportIO::LT_STATS) {
+			++result.m_stats.m_nStatLines;
+			continue;
+		}
+		if (msg.m_nBytes == 0) {
+			++result.m_stats.m_nSkippedLines;
+			continue;
+		}
+
+		TRecord rec;
+		rec.m_nOffset = nOffset;
+		rec.m_pTimeText = pTime;
+		rec.m_nTimeTextLen = nTimeLen;
+		rec.m_nPort = msg.m_nPort;
+		rec.m_pType = conarrLogTypeNames[msg.m_nLogType];
+		rec.m_pBytes = msg.m_arrBytes;
+		rec.m_nBytes = msg.m_nBytes;
+
+		CSportRxBuffer rxBuffer;
+		if (msg.m_arrBytes[0] == 0x7E) {
+			for (int i = 0; i < msg.m_nBytes; ++i) rxBuffer.pushByte(msg.m_arrBytes[i]);
+			rec.m_nKind = frameKind(rxBuffer);
+			rec.m_pRxBuffer = &rxBuffer;
+		} else {
+			rec.m_nKind = FK_EXTRANEOUS;		// "*** Extraneous Bytes" messages
+		}
+		formatRecord(result.m_baOutput, result.m_stats, rec, m_nOutputFormat, m_bIncludeDetails);
+	}
+}
+
+// ============================================================================
+
+bool CSportCaptureDecoder::parseLogMessage(const char *p, const char *pEnd, TLogMessage &msg)
+{
+	msg.m_nPort = -1;
+	msg.m_nLogType = -1;
+	msg.m_nBytes = 0;
+
+	if ((pEnd - p >= 8) && (memcmp(p, "Session ", 8) == 0)) p += 8;
+	const char *pPort = p;
+	int nPortValue = 0;
+	while ((p < pEnd) && (*p >= '0') && (*p <= '9')) nPortValue = nPortValue*10 + (*p++ - '0');
+	if ((p > pPort) && (pEnd - p >= 2) && (p[0] == ':') && (p[1] == ' ')) {
+		msg.m_nPort = nPortValue;
+		p += 2;
+	} else {
+		p = pPort;
+	}
+
+	if ((pEnd - p >= 6) && (p[4] == ':') && (p[5] == ' ')) {
+		for (int i = 0; i < static_cast<int>(_countof(conarrLogTypeNames)); ++i) {
+			if (memcmp(p, conarrLogTypeNames[i], 4) == 0) {
+				msg.m_nLogType = i;
+				break;
+			}
+		}
+	}
+	if (msg.m_nLogType < 0) return false;
+	if (msg.m_nLogType == CFrskySportIO::LT_STATS) return true;
+	p += 6;
+
+	// Message bytes, separated by '.' (or '|' after the physical ID of a push):
+	while ((pEnd - p >= 2) && (msg.m_nBytes < static_cast<int>(_countof(msg.m_arrBytes)))) {
+		int nHigh = hexValue(p[0]);
+		int nLow = hexValue(p[1]);
+		if ((nHigh < 0) || (nLow < 0)) break;
+		msg.m_arrBytes[msg.m_nBytes++] = static_cast<uchar>((nHigh << 4) | nLow);
+		p += 2;
+		if ((p < pEnd) && ((*p == '.') || (*p == '|'))) {
+			++p;
+		} else {
+			break;
+		}
+	}
+
+	return true;
+}
+
+// ============================================================================
@@ -0,0 +1,176 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#ifndef FRSKY_SPORT_DECODER_H
+#define FRSKY_SPORT_DECODER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QFile>
+#include <QIODevice>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <stdint.h>
+#include <vector>
+
+// ============================================================================
+
+//
+// Offline decoder for captured Sport traffic.  Input can be a raw byte dump
+//	of the bus, a pcapng capture whose packet data is the serial byte
+//	stream, or a text log written by CLogFile (the "Recv:/Send:/Echo:/
+//	Push:/Poll:" lines from CFrskySportIO::logMessage).  The input is mapped
+//	into memory and split into chunks, which for byte streams start at a
+//	0x7E frame start and for text logs start at a line start, so that every
+//	frame lies entirely within one chunk.  The chunks are decoded in
+//	parallel with a CSportRxBuffer each, formatted to CSV or JSON by the
+//	worker threads and written out in input order by the calling thread.
+//	Only a window of chunks ahead of the writer is held in memory.
+//
+class CSportCaptureDecoder
+{
+public:
+	enum INPUT_FORMAT {
+		IF_AUTO = 0,		// Detect from file content
+		IF_RAW = 1,			// Raw byte dump of the bus
+		IF_PCAPNG = 2,		// pcapng capture of the serial byte stream
+		IF_TEXTLOG = 3,		// CLogFile text log
+	};
+
+	enum OUTPUT_FORMAT {
+		OF_CSV = 0,
+		OF_JSON = 1,
+	};
+
+	enum FRAME_KIND {
+		FK_POLL = 0,			// Telemetry poll with no response
+		FK_TELEMETRY = 1,		// Telemetry packet
+		FK_FIRMWARE = 2,		// Firmware packet
+		FK_UNKNOWN = 3,			// Complete packet of unknown primitive
+		FK_PARTIAL = 4,			// Frame start without a complete packet
+		FK_EXTRANEOUS = 5,		// Bytes outside of a frame
+		FK_COUNT
+	};
+
+	static constexpr qint64 DEFAULT_CHUNK_SIZE = 4*1024*1024;		// Nominal chunk size in bytes of input
+	static constexpr int CHUNKS_AHEAD_PER_THREAD = 4;				// Decoded chunks held ahead of the writer per thread
+
+	struct TDecodeStats {
+		qint64 m_nInputBytes = 0;
+		qint64 m_nFrames[FK_COUNT] = {};		// Records output by kind
+		qint64 m_nCrcErrors = 0;				// Telemetry and firmware packets failing CRC
+		qint64 m_nLines = 0;					// Text log lines read
+		qint64 m_nStatLines = 0;				// Text log "Stat:" lines (skipped)
+		qint64 m_nSkippedLines = 0;				// Text log lines not recognized as log messages
+		qint64 m_nOutputBytes = 0;
+		int m_nChunks = 0;
+		int m_nThreads = 0;
+		qint64 m_nElapsedNsecs = 0;
+
+		qint64 totalFrames() const;
+		void add(const TDecodeStats &stats);
+	};
+
+	CSportCaptureDecoder();
+	~CSportCaptureDecoder();
+
+	void setThreadCount(int nThreads) { m_nThreads = nThreads; }	// 0 = all cores
+	void setChunkSize(qint64 nBytes) { m_nChunkSize = nBytes; }
+	void setOutputFormat(OUTPUT_FORMAT nFormat) { m_nOutputFormat = nFormat; }
+	void setIncludeDetails(bool bDetails) { m_bIncludeDetails = bDetails; }	// Add logDetails() text of each packet (much slower)
+
+	bool decodeFile(const QString &strFilename, INPUT_FORMAT nFormat, QIODevice &devOutput, QString *pstrError = nullptr);
+
+	INPUT_FORMAT inputFormat() const { return m_nInputFormat; }		// Format of the last decodeFile()
+	const TDecodeStats &stats() const { return m_stats; }
+	QString summary() const;				// Single line summary for display
+
+	static INPUT_FORMAT detectFormat(const uchar *pData, qint64 nSize);
+	static QString inputFormatName(INPUT_FORMAT nFormat);
+	static const char *frameKindName(FRAME_KIND nKind);
+
+	// Capture parsing, also used by CSportReplayer:
+	struct TPcapSegment {
+		qint64 m_nStreamOffset;		// Offset of the packet data in the stream
+		qint64 m_nFileOffset;		// Offset of the packet data in the file
+		int64_t m_nTimestampNsecs;	// Packet timestamp, -1 if none
+	};
+	static bool readPcapng(const uchar *pData, qint64 nSize, std::vector<uchar> &vecStream,
+							QVector<TPcapSegment> &arrSegments, QString *pstrError = nullptr);		// Extracts the serial byte stream
+
+	struct TLogMessage {
+		int m_nPort = -1;				// Port (or session) number, -1 if none
+		int m_nLogType = -1;			// CFrskySportIO::LOG_TYPE
+		int m_nBytes = 0;				// Message bytes, none on LT_STATS messages
+		uchar m_arrBytes[64];
+	};
+	// Parses a log message, "[<port>: |Session <n>: ]<type>: <bytes>[  <details>]",
+	//	which is a text log line after its "<msecs>: " timestamp, or the text
+	//	of a binary log message.  Returns false if it isn't one:
+	static bool parseLogMessage(const char *p, const char *pEnd, TLogMessage &msg);
+
+private:
+	struct TChunkResult {
+		QByteArray m_baOutput;
+		TDecodeStats m_stats;
+		bool m_bDone = false;
+	};
+
+	friend class CSportDecodeWorker;
+
+	void workerLoop();
+	qint64 chunkStart(int nChunk) const;
+	void decodeChunk(int nChunk, TChunkResult &result) const;
+	void decodeStreamChunk(qint64 nStart, qint64 nEnd, TChunkResult &result) const;
+	void decodeTextChunk(qint64 nStart, qint64 nEnd, TChunkResult &result) const;
+
+	int m_nThreads = 0;
+	qint64 m_nChunkSize = DEFAULT_CHUNK_SIZE;
+	OUTPUT_FORMAT m_nOutputFormat = OF_CSV;
+	bool m_bIncludeDetails = false;
+	INPUT_FORMAT m_nInputFormat = IF_AUTO;
+	TDecodeStats m_stats;
+
+	// Input being decoded:
+	QFile m_fileInput;
+	const uchar *m_pData = nullptr;			// Bytes being chunked, the mapped file or m_vecStream
+	qint64 m_nSize = 0;
+	std::vector<uchar> m_vecStream;			// Serial byte stream extracted from a pcapng file
+	QVector<TPcapSegment> m_arrSegments;	// Packets making up m_vecStream
+	int m_nChunks = 0;
+
+	// Work distribution, guarded by m_mutex:
+	QMutex m_mutex;
+	QWaitCondition m_cndChunkDone;			// Signaled when a chunk finishes decoding
+	QWaitCondition m_cndWindow;				// Signaled when the writer frees a chunk
+	QVector<TChunkResult> m_arrResults;
+	int m_nNextChunk = 0;					// Next chunk to hand to a worker
+	int m_nWrittenChunks = 0;				// Chunks written out by the caller
+	int m_nWindow = 0;						// Maximum chunks decoded ahead of the writer
+	bool m_bAbort = false;
+};
+
+// ============================================================================
+
+#endif	// FRSKY_SPORT_DECODER_H
@@ -219,23 +219,23 @@ void CFrskySportDeviceEmu::nextState()
 	}
 }
 
-CFrskySportDeviceEmu::FrameProcessResult CFrskySportDeviceEmu::processFrame()
+CFrskySportDeviceEmu::FrameProcessResult CFrskySportDeviceEmu::processFrame(const CSportRxBuffer &rxBuffer)
 {
 	FrameProcessResult results;
 	results.m_bAdvanceState = false;
 
 	if (m_state == SPORT_MONITOR_ONLY_MODE) {
-		results.m_strLogDetail = m_rxBuffer.logDetails();
+		results.m_strLogDetail = rxBuffer.logDetails();
 		return results;
 	}
 
 	if (!emulatorRunning()) return results;		// Don't run state-machine logic if the emulator isn't even running
 
-	if (m_rxBuffer.isFirmwarePacket()) {
-		if ((m_rxBuffer.firmwarePacket().m_physicalId == PHYS_ID_FIRMCMD) &&
-			(m_rxBuffer.firmwarePacket().m_primId == PRIM_ID_FIRMWARE_FRAME) &&
+	if (rxBuffer.isFirmwarePacket()) {
+		if ((rxBuffer.firmwarePacket().m_physicalId == PHYS_ID_FIRMCMD) &&
+			(rxBuffer.firmwarePacket().m_primId == PRIM_ID_FIRMWARE_FRAME) &&
 			(!getReceiverPolling())) {
-			switch (m_rxBuffer.firmwarePacket().m_cmd) {
+			switch (rxBuffer.firmwarePacket().m_cmd) {
 				case PRIM_REQ_FLASHMODE:			// Request to start flash mode
 					results.m_strLogDetail = tr("Request Flash Mode");
 					if (m_state == SPORT_FLASHMODE_REQ) {	// Can only be requested immediately at startup
@@ -268,7 +268,7 @@ CFrskySportDeviceEmu::FrameProcessResult CFrskySportDeviceEmu::processFrame()
 					if ((m_state == SPORT_VERSION_REQ) ||		// Can this be requested after FlashMode only? without VersionInfo Req?
 						(m_state == SPORT_VERSION_ACK) ||
 						((m_state == SPORT_DATA_TRANSFER) && (!m_bFirmwareRxMode))) {	// TODO : Determine if PRIM_CMD_UPLOAD is used for Reading or if PRIM_DATA_ADDR is used
-						m_nReqAddress = m_rxBuffer.firmwarePacket().dataValue();		// Is this really the address?
+						m_nReqAddress = rxBuffer.firmwarePacket().dataValue();		// Is this really the address?
 						m_bFirmwareRxMode = false;				// Upload/Reading mode
 						results.m_strLogDetail += QString(": Addr: 0x%1 ?").arg(m_nReqAddress, 8, 16, QChar('0'));
 						if (m_pFirmware.isNull()) {
@@ -301,10 +301,10 @@ CFrskySportDeviceEmu::FrameProcessResult CFrskySportDeviceEmu::processFrame()
 					results.m_strLogDetail = tr("Data Xfer");
 					if (m_state == SPORT_DATA_TRANSFER) {		// Data Transfer can only happen after Cmd Upload or Cmd Download has completed
 						if (m_bFirmwareRxMode) {
-							m_arrDataRead[0] = m_rxBuffer.firmwarePacket().m_data[0];
-							m_arrDataRead[1] = m_rxBuffer.firmwarePacket().m_data[1];
-							m_arrDataRead[2] = m_rxBuffer.firmwarePacket().m_data[2];
-							m_arrDataRead[3] = m_rxBuffer.firmwarePacket().m_data[3];
+							m_arrDataRead[0] = rxBuffer.firmwarePacket().m_data[0];
+							m_arrDataRead[1] = rxBuffer.firmwarePacket().m_data[1];
+							m_arrDataRead[2] = rxBuffer.firmwarePacket().m_data[2];
+							m_arrDataRead[3] = rxBuffer.firmwarePacket().m_data[3];
 							results.m_strLogDetail += QString(": %1.%2.%3.%4")
 									.arg(m_arrDataRead[0], 2, 16, QChar('0'))
 									.arg(m_arrDataRead[1], 2, 16, QChar('0'))
@@ -312,7 +312,7 @@ CFrskySportDeviceEmu::FrameProcessResult CFrskySportDeviceEmu::processFrame()
 									.arg(m_arrDataRead[3], 2, 16, QChar('0'));
 							m_state = SPORT_DATA_REQ;
 						} else {
-							m_nReqAddress = m_rxBuffer.firmwarePacket().dataValue();
+							m_nReqAddress = rxBuffer.firmwarePacket().dataValue();
 							results.m_strLogDetail += QString(": Addr: 0x%1 ?").arg(m_nReqAddress, 8, 16, QChar('0'));
 							m_state = SPORT_DATA_AVAIL;
 						}
@@ -346,15 +346,15 @@ CFrskySportDeviceEmu::FrameProcessResult CFrskySportDeviceEmu::processFrame()
 			}
 		} else {
 			if (deviceIsReceiver(m_nDevices) && getReceiverPolling() &&
-				(m_rxBuffer.firmwarePacket().m_physicalId == PHYS_ID_FIRMCMD)) {
+				(rxBuffer.firmwarePacket().m_physicalId == PHYS_ID_FIRMCMD)) {
 				emuError(tr("Firmware packet received when Rx in polling mode"));
 				results.m_strLogDetail = tr("Firmware packet received in polling mode, Ignoring");
 			}
 			// Ignore others, as they are probably just our echos
 		}
-	} else if (m_rxBuffer.isTelemetryPacket()) {
+	} else if (rxBuffer.isTelemetryPacket()) {
 		// TODO : Handle Telemetry Packet I/O emulation
-	} else if (m_rxBuffer.haveTelemetryPoll()) {
+	} else if (rxBuffer.haveTelemetryPoll()) {
 		// TODO : Handle Polling emulation logic
 	} else {
 		results.m_strLogDetail = tr("*** Unexpected/Unknown Packet");
@@ -366,14 +366,15 @@ CFrskySportDeviceEmu::FrameProcessResult CFrskySportDeviceEmu::processFrame()
 template<typename Tpacket>
 void CFrskySportDeviceEmu::sendFrame(const Tpacket &packet, const QString &strLogDetail)
 {
-	m_txBufferLast.reset();
-	m_txBufferLast.pushPacketWithByteStuffing(packet);
-
-	QByteArray arrBytes(1, 0x7E);	// Start of Frame
-	arrBytes.append(m_txBufferLast.data());
-	m_frskySportIO.logMessage(CFrskySportIO::LT_TX, arrBytes, strLogDetail);
-	m_frskySportIO.port().write(arrBytes);
-	m_frskySportIO.port().flush();
+	CSportTxBuffer txBuffer;
+	txBuffer.pushPacketWithByteStuffing(packet);
+
+	if (m_frskySportIO.logWanted(CFrskySportIO::LT_TX, packet.m_raw, sizeof(packet.m_raw))) {
+		QByteArray arrBytes(1, 0x7E);	// Start of Frame
+		arrBytes.append(txBuffer.data());
+		m_frskySportIO.logMessage(CFrskySportIO::LT_TX, arrBytes, strLogDetail);
+	}
+	m_frskySportIO.writeFrame(txBuffer);
 }
 
 bool CFrskySportDeviceEmu::compareFirmware() const
@@ -435,81 +436,32 @@ void CFrskySportDeviceEmu::endEmulation()
 
 // ----------------------------------------------------------------------------
 
-// This function gets triggered whenever the serial port
-//	has data.  Here, we emit a queued connection function
-//	that handles the read.  We do that rather than read
-//	the data here to avoid a race condition between reading
-//	the data and getting another event from the serial device.
-void CFrskySportDeviceEmu::en_readyRead()
+// Receive dispatch from m_frskySportIO.  Polls are logged before they
+//	get here, so they are logged before any response.  Frames are logged
+//	after, with their detail, and the state machine is advanced after
+//	that, so that they are logged before anything transmitted in response:
+void CFrskySportDeviceEmu::rxFrame(const TSportRxFrame &frame, QString *pstrLogDetail)
 {
-	emit dataAvailable();
+	FrameProcessResult procResults = processFrame(frame.m_rxBuffer);
+	if (frame.m_nKind == SRFK_TELEMETRY_POLL) return;
+	m_bAdvanceState = procResults.m_bAdvanceState;
+	if (pstrLogDetail) *pstrLogDetail = procResults.m_strLogDetail;
 }
 
-// This function gets triggered by the readyRead queued
-//	connection with dataAvailable.  Here, we check to see if we
-//	have incoming bytes from the serial connection, which might
-//	be bytes from the device or bytes we are sending being
-//	echoed since it's a half-duplex, single-wire connection,
-//	and then if it's a message from the device, we post an
-//	event to process them:
-void CFrskySportDeviceEmu::en_receive()
+void CFrskySportDeviceEmu::rxFrameDone(const TSportRxFrame &frame)
 {
-	QByteArray arrBytes = m_frskySportIO.port().readAll();
-	if (!arrBytes.isEmpty()) {
-		for (int ndx = 0; ndx < arrBytes.size(); ++ndx) {
-			QByteArray baExtraneous = m_rxBuffer.pushByte(arrBytes.at(ndx));
-			if (!baExtraneous.isEmpty()) {
-				m_frskySportIO.logMessage(CFrskySportIO::LT_RX, baExtraneous, "*** Extraneous Bytes");
-			}
-			if ((ndx == arrBytes.size()-1) && m_rxBuffer.haveTelemetryPoll()) {
-				bool bIsEcho = (QByteArray((char*)m_rxBuffer.data(), m_rxBuffer.size()) == m_txBufferLast.data());
-				QByteArray baMessage(1, 0x7E);		// Add the 0x7E since it's eaten by the RxBuffer
-				baMessage.append(m_rxBuffer.rawData());
-				m_frskySportIO.logMessage(bIsEcho ? CFrskySportIO::LT_TXECHO : CFrskySportIO::LT_TELEPOLL, baMessage,
-									m_rxBuffer.logDetails());
-				// Do the log above BEFORE calling processFrame so that things like the poll message
-				//	get logged before logging the transmitted response:
-				processFrame();
-			} else if (m_rxBuffer.haveCompletePacket()) {
-				if (!m_rxBuffer.isFirmwarePacket() && !m_rxBuffer.isTelemetryPacket()) {
-					QByteArray baUnexpected(1, 0x7E);		// Add the 0x7E since it's eaten by the RxBuffer
-					baUnexpected.append(m_rxBuffer.rawData());
-					m_frskySportIO.logMessage(CFrskySportIO::LT_RX, baUnexpected, "*** Unexpected/Unknown packet");
-				} else {
-					uint8_t nExpectedCRC = m_rxBuffer.isFirmwarePacket() ? m_rxBuffer.firmwarePacket().crc() :
-															m_rxBuffer.telemetryPacket().crc();
-					//bool bIsEcho = m_rxBuffer.isFirmwarePacket() && (m_rxBuffer.firmwarePacket().m_physicalId == PHYS_ID_FIRMRSP);
-					bool bIsEcho = (QByteArray((char*)m_rxBuffer.data(), m_rxBuffer.size()) == m_txBufferLast.data());
-
-					FrameProcessResult procResults = processFrame();		// Process all packets
-
-					if (CPersistentSettings::instance()->getFirmwareLogTxEchos() ||
-						(!CPersistentSettings::instance()->getFirmwareLogTxEchos() && !bIsEcho) ||
-						(nExpectedCRC != m_rxBuffer.crc()) ||
-						!procResults.m_strLogDetail.isEmpty() ||
-						inMonitorMode()) {
-						QByteArray baMessage(1, 0x7E);		// Add the 0x7E since it's eaten by the RxBuffer
-						baMessage.append(m_rxBuffer.rawData());
-						QString strExtraMessage = procResults.m_strLogDetail;
-						if (nExpectedCRC != m_rxBuffer.crc()) {
-							QString strCRCError = QString("*** Expected CRC of 0x%1, Received CRC of 0x%2")
-										.arg(QString("%1").arg(nExpectedCRC, 2, 16, QChar('0')).toUpper(),
-											QString("%1").arg(m_rxBuffer.crc(), 2, 16, QChar('0')).toUpper());
-							if (!strExtraMessage.isEmpty()) strExtraMessage += "  ";
-							strExtraMessage += strCRCError;
-						}
-						m_frskySportIO.logMessage(bIsEcho ? CFrskySportIO::LT_TXECHO : CFrskySportIO::LT_RX, baMessage, strExtraMessage);
-					}
-
-					if (procResults.m_bAdvanceState) nextState();
-				}
-
-				m_rxBuffer.reset();
-			}
-		}
+	Q_UNUSED(frame);
+	if (m_bAdvanceState) {
+		m_bAdvanceState = false;
+		nextState();
 	}
 }
 
+bool CFrskySportDeviceEmu::logTxEchos() const
+{
+	return (CPersistentSettings::instance()->getFirmwareLogTxEchos() || inMonitorMode());
+}
+
 void CFrskySportDeviceEmu::en_pollEvent()
 {
 	if (!emulatorRunning()) return;
@@ -549,8 +501,7 @@ CFrskySportDeviceEmu::CFrskySportDeviceEmu(CFrskySportIO &frskySportIO, CUICallb
 		m_frskySportIO(frskySportIO),
 		m_pUICallback(pUICallback)
 {
-	connect(&m_frskySportIO.port(), SIGNAL(readyRead()), this, SLOT(en_readyRead()));
-	connect(this, SIGNAL(dataAvailable()), this, SLOT(en_receive()), Qt::QueuedConnection);
+	m_frskySportIO.addRxHandler(this, SRFK_MASK_ALL);
 
 	connect(&m_tmrPollEvent, SIGNAL(timeout()), this, SLOT(en_pollEvent()));
 	if (pUICallback) {
@@ -562,6 +513,7 @@ CFrskySportDeviceEmu::CFrskySportDeviceEmu(CFrskySportIO &frskySportIO, CUICallb
 
 CFrskySportDeviceEmu::~CFrskySportDeviceEmu()
 {
+	m_frskySportIO.removeRxHandler(this);
 }
 
 // ----------------------------------------------------------------------------
@@ -38,7 +38,7 @@ class CUICallback;
 
 // ============================================================================
 
-class CFrskySportDeviceEmu : public QObject
+class CFrskySportDeviceEmu : public QObject, public CSportRxHandler
 {
 	Q_OBJECT
 
@@ -138,16 +138,10 @@ signals:
 	void deviceEmulationComplete(bool bSuccess);		// bSuccess True if completed successfully, else getLastError will have error message
 	void emulationErrorEncountered(const QString &strErrorMessage);		// Used for logging/reporting emulation issues (such as requesting device sending wrong data or bad message)
 
-	// Private:
-	void dataAvailable();
-
 public slots:
 	void endEmulation();
 
 protected slots:
-	void en_readyRead();
-	void en_receive();
-	// ----
 	void en_pollEvent();
 	// ----
 	void en_userCancel();
@@ -161,9 +155,15 @@ protected:
 		bool m_bAdvanceState = false;		// If true, then call nextState to advance state-machine
 		QString m_strLogDetail;				// Additional log file detail to add to message being processed
 	};
-	FrameProcessResult processFrame();		// Process the current frame in m_rxBuffer
+	FrameProcessResult processFrame(const CSportRxBuffer &rxBuffer);		// Process a received frame
 	template<typename Tpacket>
 	void sendFrame(const Tpacket &packet, const QString &strLogDetail = QString());		// Transmit frame with specified packet on bus
+
+	// CSportRxHandler:
+	virtual void rxFrame(const TSportRxFrame &frame, QString *pstrLogDetail) override;
+	virtual void rxFrameDone(const TSportRxFrame &frame) override;
+	virtual bool logTxEchos() const override;
+
 	bool compareFirmware() const;			// Compare received firmware against original firmware file expected
 
 	void resetPollList();
@@ -192,8 +192,7 @@ protected:
 	bool m_bFirmwareRxMode = true;			// True if receiving firmware (flashing), False if sending firmware (reading)
 	QByteArray m_baRxFirmware;				// Firmware received from bus
 	bool m_bRxFirmwareError = false;		// Set to 'True' if there was a CRC error or size error in receiving the firmware -- used for final reponse to tool (complete or fail)
-	CSportRxBuffer m_rxBuffer;				// Receive Sport Packet buffer from serial en_receive events
-	CSportTxBuffer m_txBufferLast;			// Last Transmit Sport Packet buffer -- used to detect echos
+	bool m_bAdvanceState = false;			// Set by rxFrame() to call nextState from rxFrameDone()
 	QTimer m_tmrPollEvent;					// Receiver poll event timer
 
 	QString m_strLastError;					// Last error to report
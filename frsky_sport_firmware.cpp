@@ -536,15 +536,15 @@ void CFrskyDeviceFirmwareUpdate::nextState()
 	}
 }
 
-CFrskyDeviceFirmwareUpdate::FrameProcessResult CFrskyDeviceFirmwareUpdate::processFrame()
+CFrskyDeviceFirmwareUpdate::FrameProcessResult CFrskyDeviceFirmwareUpdate::processFrame(const CSportRxBuffer &rxBuffer)
 {
-	assert(m_rxBuffer.haveCompletePacket() && m_rxBuffer.isFirmwarePacket());
+	assert(rxBuffer.haveCompletePacket() && rxBuffer.isFirmwarePacket());
 	FrameProcessResult results;
 	results.m_bAdvanceState = false;
 
-	if ((m_rxBuffer.firmwarePacket().m_physicalId == PHYS_ID_FIRMRSP) &&
-		(m_rxBuffer.firmwarePacket().m_primId == PRIM_ID_FIRMWARE_FRAME)) {
-		switch (m_rxBuffer.firmwarePacket().m_cmd) {
+	if ((rxBuffer.firmwarePacket().m_physicalId == PHYS_ID_FIRMRSP) &&
+		(rxBuffer.firmwarePacket().m_primId == PRIM_ID_FIRMWARE_FRAME)) {
+		switch (rxBuffer.firmwarePacket().m_cmd) {
 			case PRIM_ACK_FLASHMODE:		// Device ACK Flash Mode and is present
 				results.m_strLogDetail = tr("Flash Mode ACK");
 				if (m_state == SPORT_FLASHMODE_REQ) {
@@ -556,7 +556,7 @@ CFrskyDeviceFirmwareUpdate::FrameProcessResult CFrskyDeviceFirmwareUpdate::proce
 			case PRIM_ACK_VERSION:			// Device ACK Version Request
 				results.m_strLogDetail = tr("Version ACK");
 				if (m_state == SPORT_VERSION_REQ) {
-					m_nVersionInfo = m_rxBuffer.firmwarePacket().dataValue();
+					m_nVersionInfo = rxBuffer.firmwarePacket().dataValue();
 					m_state = SPORT_VERSION_ACK;
 					results.m_strLogDetail += tr(" : Version=0x%1").arg(m_nVersionInfo, 8, 16, QChar('0'));
 					results.m_bAdvanceState = true;
@@ -570,15 +570,15 @@ CFrskyDeviceFirmwareUpdate::FrameProcessResult CFrskyDeviceFirmwareUpdate::proce
 					(m_state == SPORT_DATA_TRANSFER)) {			//	or ongoing data transfer
 					switch (m_runmode) {
 						case FSM_RM_FLASH_PROGRAM:
-							m_nReqAddress = m_rxBuffer.firmwarePacket().dataValue();
+							m_nReqAddress = rxBuffer.firmwarePacket().dataValue();
 							results.m_strLogDetail += tr(", Addr=0x%1").arg(m_nReqAddress, 8, 16, QChar('0'));
 							m_state = SPORT_DATA_REQ;
 							break;
 						case FSM_RM_FLASH_READ:
-							m_arrDataRead[0] = m_rxBuffer.firmwarePacket().m_data[0];
-							m_arrDataRead[1] = m_rxBuffer.firmwarePacket().m_data[1];
-							m_arrDataRead[2] = m_rxBuffer.firmwarePacket().m_data[2];
-							m_arrDataRead[3] = m_rxBuffer.firmwarePacket().m_data[3];
+							m_arrDataRead[0] = rxBuffer.firmwarePacket().m_data[0];
+							m_arrDataRead[1] = rxBuffer.firmwarePacket().m_data[1];
+							m_arrDataRead[2] = rxBuffer.firmwarePacket().m_data[2];
+							m_arrDataRead[3] = rxBuffer.firmwarePacket().m_data[3];
 							results.m_strLogDetail += tr(", Data Xfer: %1.%2.%3.%4")
 									.arg(m_arrDataRead[0], 2, 16, QChar('0'))
 									.arg(m_arrDataRead[1], 2, 16, QChar('0'))
@@ -635,11 +635,12 @@ void CFrskyDeviceFirmwareUpdate::sendFrame(const CSportFirmwarePacket &packet, c
 	CSportTxBuffer frameFirmware;
 	frameFirmware.pushPacketWithByteStuffing(packet);
 
-	QByteArray arrBytes(1, 0x7E);	// Start of Frame
-	arrBytes.append(frameFirmware.data());
-	m_frskySportIO.logMessage(CFrskySportIO::LT_TX, arrBytes, strLogDetail);
-	m_frskySportIO.port().write(arrBytes);
-	m_frskySportIO.port().flush();
+	if (m_frskySportIO.logWanted(CFrskySportIO::LT_TX, packet.m_raw, sizeof(packet.m_raw))) {
+		QByteArray arrBytes(1, 0x7E);	// Start of Frame
+		arrBytes.append(frameFirmware.data());
+		m_frskySportIO.logMessage(CFrskySportIO::LT_TX, arrBytes, strLogDetail);
+	}
+	m_frskySportIO.writeFrame(frameFirmware);
 }
 
 void CFrskyDeviceFirmwareUpdate::en_timeout()
@@ -661,71 +662,31 @@ void CFrskyDeviceFirmwareUpdate::en_userCancel()
 
 // ----------------------------------------------------------------------------
 
-// This function gets triggered whenever the serial port
-//	has data.  Here, we emit a queued connection function
-//	that handles the read.  We do that rather than read
-//	the data here to avoid a race condition between reading
-//	the data and getting another event from the serial device.
-void CFrskyDeviceFirmwareUpdate::en_readyRead()
+// Receive dispatch from m_frskySportIO.  Only firmware frames are
+//	processed, as the others are logged by m_frskySportIO.  The state
+//	machine is advanced after the frame is logged, so that it's logged
+//	before anything transmitted in response:
+void CFrskyDeviceFirmwareUpdate::rxFrame(const TSportRxFrame &frame, QString *pstrLogDetail)
 {
-	emit dataAvailable();
+	FrameProcessResult procResults = processFrame(frame.m_rxBuffer);
+	m_bAdvanceState = procResults.m_bAdvanceState;
+	if (pstrLogDetail) *pstrLogDetail = procResults.m_strLogDetail;
 }
 
-// This function gets triggered by the readyRead queued
-//	connection with dataAvailable.  Here, we check to see if we
-//	have incoming bytes from the serial connection, which might
-//	be bytes from the device or bytes we are sending being
-//	echoed since it's a half-duplex, single-wire connection,
-//	and then if it's a message from the device, we post an
-//	event to process them:
-void CFrskyDeviceFirmwareUpdate::en_receive()
+void CFrskyDeviceFirmwareUpdate::rxFrameDone(const TSportRxFrame &frame)
 {
-	QByteArray arrBytes = m_frskySportIO.port().readAll();
-	if (!arrBytes.isEmpty()) {
-		for (int ndx = 0; ndx < arrBytes.size(); ++ndx) {
-			QByteArray baExtraneous = m_rxBuffer.pushByte(arrBytes.at(ndx));
-			if (!baExtraneous.isEmpty()) {
-				m_frskySportIO.logMessage(CFrskySportIO::LT_RX, baExtraneous, "*** Extraneous Bytes");
-			}
-			if (m_rxBuffer.haveCompletePacket()) {
-				if (!m_rxBuffer.isFirmwarePacket() && !m_rxBuffer.isTelemetryPacket()) {
-					QByteArray baUnexpected(1, 0x7E);		// Add the 0x7E since it's eaten by the RxBuffer
-					baUnexpected.append(m_rxBuffer.rawData());
-					m_frskySportIO.logMessage(CFrskySportIO::LT_RX, baUnexpected, "*** Unexpected/Unknown packet");
-				} else {
-					uint8_t nExpectedCRC = m_rxBuffer.isFirmwarePacket() ? m_rxBuffer.firmwarePacket().crc() :
-															m_rxBuffer.telemetryPacket().crc();
-					bool bIsEcho = m_rxBuffer.isFirmwarePacket() && (m_rxBuffer.firmwarePacket().m_physicalId == PHYS_ID_FIRMCMD);
-
-					FrameProcessResult procResults;
-					if (m_rxBuffer.isFirmwarePacket()) procResults = processFrame();		// Process only firmware packets
-
-					if (CPersistentSettings::instance()->getFirmwareLogTxEchos() ||
-						(!CPersistentSettings::instance()->getFirmwareLogTxEchos() && !bIsEcho) ||
-						(nExpectedCRC != m_rxBuffer.crc()) ||
-						!procResults.m_strLogDetail.isEmpty()) {
-						QByteArray baMessage(1, 0x7E);		// Add the 0x7E since it's eaten by the RxBuffer
-						baMessage.append(m_rxBuffer.rawData());
-						QString strExtraMessage = procResults.m_strLogDetail;
-						if (nExpectedCRC != m_rxBuffer.crc()) {
-							QString strCRCError = QString("*** Expected CRC of 0x%1, Received CRC of 0x%2")
-										.arg(QString("%1").arg(nExpectedCRC, 2, 16, QChar('0')).toUpper(),
-											QString("%1").arg(m_rxBuffer.crc(), 2, 16, QChar('0')).toUpper());
-							if (!strExtraMessage.isEmpty()) strExtraMessage += "  ";
-							strExtraMessage += strCRCError;
-						}
-						m_frskySportIO.logMessage(bIsEcho ? CFrskySportIO::LT_TXECHO : CFrskySportIO::LT_RX, baMessage, strExtraMessage);
-					}
-
-					if (procResults.m_bAdvanceState) nextState();
-				}
-
-				m_rxBuffer.reset();
-			}
-		}
+	Q_UNUSED(frame);
+	if (m_bAdvanceState) {
+		m_bAdvanceState = false;
+		nextState();
 	}
 }
 
+bool CFrskyDeviceFirmwareUpdate::logTxEchos() const
+{
+	return CPersistentSettings::instance()->getFirmwareLogTxEchos();
+}
+
 
 // ============================================================================
 
@@ -735,8 +696,7 @@ CFrskyDeviceFirmwareUpdate::CFrskyDeviceFirmwareUpdate(CFrskySportIO &frskySport
 		m_frskySportIO(frskySportIO),
 		m_pUICallback(pUICallback)
 {
-	connect(&m_frskySportIO.port(), SIGNAL(readyRead()), this, SLOT(en_readyRead()));
-	connect(this, SIGNAL(dataAvailable()), this, SLOT(en_receive()), Qt::QueuedConnection);
+	m_frskySportIO.addRxHandler(this, (1 << SRFK_FIRMWARE));
 
 	connect(&m_tmrEventTimeout, SIGNAL(timeout()), this, SLOT(en_timeout()), Qt::DirectConnection);
 	if (pUICallback) {
@@ -746,7 +706,7 @@ CFrskyDeviceFirmwareUpdate::CFrskyDeviceFirmwareUpdate(CFrskySportIO &frskySport
 
 CFrskyDeviceFirmwareUpdate::~CFrskyDeviceFirmwareUpdate()
 {
-
+	m_frskySportIO.removeRxHandler(this);
 }
 
 // ----------------------------------------------------------------------------
@@ -37,7 +37,7 @@ class CUICallback;
 
 // ============================================================================
 
-class CFrskyDeviceFirmwareUpdate : public QObject
+class CFrskyDeviceFirmwareUpdate : public QObject, public CSportRxHandler
 {
 	Q_OBJECT
 
@@ -137,13 +137,8 @@ public:
 signals:
 	void flashComplete(bool bSuccess);		// bSuccess True if completed successfully, else getLastError will have error message
 
-	// Private:
-	void dataAvailable();
-
 protected slots:
 	void en_timeout();
-	void en_readyRead();
-	void en_receive();
 	// ----
 	void en_userCancel();
 
@@ -156,10 +151,15 @@ protected:
 		bool m_bAdvanceState = false;		// If true, then call nextState to advance state-machine
 		QString m_strLogDetail;				// Additional log file detail to add to message being processed
 	};
-	FrameProcessResult processFrame();		// Process the current frame in m_rxBuffer
+	FrameProcessResult processFrame(const CSportRxBuffer &rxBuffer);		// Process a received frame
 	void waitState(State nNextState, uint32_t nTimeout, int nRetries);	// wait for specified state for nRetries, with nTimeout time between tries
 	void sendFrame(const CSportFirmwarePacket &packet, const QString &strLogDetail = QString());	// Transmit frame with specified packet on bus
 
+	// CSportRxHandler:
+	virtual void rxFrame(const TSportRxFrame &frame, QString *pstrLogDetail) override;
+	virtual void rxFrameDone(const TSportRxFrame &frame) override;
+	virtual bool logTxEchos() const override;
+
 protected:
 	RunMode m_runmode = FSM_RM_DEVICE_ID;	// FSM RunMode to execute
 	// -----
@@ -172,7 +172,7 @@ protected:
 	uint32_t m_nVersionInfo = 0;			// Version information read from device
 	QPointer<QIODevice> m_pFirmware;		// Current firmware file
 	qint64 m_nFirmwareSize = 0;				// Size of firmware, used for size checking and for progress callbacks, will be 0 for sequential streams that have no frsky header or will be the real size on random streams or where we have a header
-	CSportRxBuffer m_rxBuffer;				// Receive Sport Packet buffer from serial en_receive events
+	bool m_bAdvanceState = false;			// Set by rxFrame() to call nextState from rxFrameDone()
 	QTimer m_tmrEventTimeout;				// Current Event Timeout Timer, triggers for doing retries and state machine driving
 
 	QString m_strLastError;					// Last error to report
@@ -0,0 +1,235 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#include "frsky_sport_hub.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+
+// ============================================================================
+
+CFrskySportHub::CFrskySportHub(CFrskySportIO &frskySportIO, QObject *pParent)
+	:	QObject(pParent),
+		m_frskySportIO(frskySportIO),
+		m_pServer(new QLocalServer(this))
+{
+	connect(&m_frskySportIO.port(), SIGNAL(readyRead()), this, SLOT(en_readyRead()));
+	connect(this, SIGNAL(dataAvailable()), this, SLOT(en_receive()), Qt::QueuedConnection);
+	connect(m_pServer, SIGNAL(newConnection()), this, SLOT(en_newConnection()));
+}
+
+CFrskySportHub::~CFrskySportHub()
+{
+	while (!m_lstClients.isEmpty()) {
+		removeClient(m_lstClients.first());
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+bool CFrskySportHub::listen(const QString &strSocketName, QString *pstrError)
+{
+	QLocalServer::removeServer(strSocketName);
+	if (!m_pServer->listen(strSocketName)) {
+		if (pstrError) *pstrError = QString("Failed to listen on \"%1\": %2").arg(strSocketName, m_pServer->errorString());
+		return false;
+	}
+	return true;
+}
+
+QString CFrskySportHub::serverName() const
+{
+	return m_pServer->fullServerName();
+}
+
+// ============================================================================
+
+// This function gets triggered by the readyRead signal
+//	from the serial port when the port has data.  Like the
+//	device handlers, we emit a queued connection function
+//	to do the read rather than reading here.
+void CFrskySportHub::en_readyRead()
+{
+	emit dataAvailable();
+}
+
+// This function gets triggered by the readyRead queued
+//	connection with dataAvailable.  It passes what's been
+//	received on to the clients, up to the end of the last
+//	complete frame.  The start of a frame that's still coming
+//	is kept until the rest of it arrives:
+void CFrskySportHub::en_receive()
+{
+	QByteArray arrBytes = m_frskySportIO.port().readAll();
+	if (arrBytes.isEmpty()) return;
+	m_nRxBytes += arrBytes.size();
+	m_bPollWaiting = false;			// Anything received ends the slot for answering a poll
+
+	// Note: with nothing kept from the last read, as is usual, this
+	//	append doesn't copy arrBytes:
+	int nStart = m_baRxPending.size();
+	m_baRxPending.append(arrBytes);
+
+	int nSend = 0;					// Bytes that are whole frames (or frames cut off by the next one)
+	for (int ndx = nStart; ndx < m_baRxPending.size(); ++ndx) {
+		uint8_t nByte = m_baRxPending.at(ndx);
+		if (nByte == 0x7E) nSend = ndx;
+		m_rxBuffer.pushByte(nByte);
+		if (m_rxBuffer.haveCompletePacket()) {
+			nSend = ndx + 1;
+			m_rxBuffer.reset();
+		}
+	}
+	// A poll at the end of what's been received is passed on now, so the
+	//	clients can answer it:
+	if (m_rxBuffer.haveTelemetryPoll()) {
+		nSend = m_baRxPending.size();
+		m_bPollWaiting = true;
+	}
+
+	if (nSend == 0) return;
+	fanOut(m_baRxPending, nSend);
+	if (nSend == m_baRxPending.size()) {
+		m_baRxPending.clear();
+	} else {
+		m_baRxPending.remove(0, nSend);
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+void CFrskySportHub::fanOut(const QByteArray &baData, int nSize)
+{
+	for (TClient *pClient : m_lstClients) {
+		if (pClient->m_pSocket->state() != QLocalSocket::ConnectedState) continue;
+		if (pClient->m_pSocket->bytesToWrite() > m_nMaxBacklog) {
+			pClient->m_stats.m_nBytesDropped += nSize;
+			continue;
+		}
+		pClient->m_pSocket->write(baData.constData(), nSize);
+		pClient->m_stats.m_nBytesSent += nSize;
+	}
+}
+
+// ============================================================================
+
+void CFrskySportHub::en_newConnection()
+{
+	while (m_pServer->hasPendingConnections()) {
+		TClient *pClient = new TClient;
+		pClient->m_strName = QString("Client %1").arg(m_nNextClient++);
+		pClient->m_pSocket = m_pServer->nextPendingConnection();
+		connect(pClient->m_pSocket, &QLocalSocket::readyRead, this, [this, pClient]()->void {
+			clientReceive(pClient);
+		});
+		// Note: queued, since the socket can disconnect in the middle of
+		//	a fanOut() write, while m_lstClients is being iterated:
+		connect(pClient->m_pSocket, &QLocalSocket::disconnected, this, [this, pClient]()->void {
+			removeClient(pClient);
+		}, Qt::QueuedConnection);
+		m_lstClients.append(pClient);
+		emit clientConnected(pClient->m_strName);
+	}
+}
+
+void CFrskySportHub::removeClient(TClient *pClient)
+{
+	if (!m_lstClients.removeOne(pClient)) return;
+	pClient->m_pSocket->disconnect(this);
+	pClient->m_pSocket->deleteLater();
+	emit clientDisconnected(pClient->m_strName, clientSummary(pClient));
+	delete pClient;
+}
+
+QString CFrskySportHub::clientSummary(const TClient *pClient)
+{
+	const TClientStats &stats = pClient->m_stats;
+	return QString("%1 bytes sent, %2 dropped, %3 frames and %4 responses transmitted, %5 responses rejected, %6 bytes discarded")
+			.arg(stats.m_nBytesSent)
+			.arg(stats.m_nBytesDropped)
+			.arg(stats.m_nTxFrames)
+			.arg(stats.m_nTxResponses)
+			.arg(stats.m_nTxRejected)
+			.arg(stats.m_nTxDiscarded);
+}
+
+// ----------------------------------------------------------------------------
+
+// Splits what the client writes into frames to transmit.  A frame
+//	starts with 0x7E, except for a poll response, which is the rest
+//	of the frame after the poll's 0x7E and physical ID:
+void CFrskySportHub::clientReceive(TClient *pClient)
+{
+	QByteArray arrBytes = pClient->m_pSocket->readAll();
+	for (int ndx = 0; ndx < arrBytes.size(); ++ndx) {
+		uint8_t nByte = arrBytes.at(ndx);
+		if (nByte == 0x7E) {
+			if (!pClient->m_bTxResponse && pClient->m_txFrame.haveTelemetryPoll()) {
+				transmit(pClient);
+			} else {
+				pClient->m_stats.m_nTxDiscarded += pClient->m_baTxFrame.size();
+				pClient->m_baTxFrame.clear();
+				pClient->m_bTxResponse = false;
+			}
+		} else if (pClient->m_baTxFrame.isEmpty()) {
+			// Give the buffer the frame start and a physical ID, so it
+			//	counts the rest of the frame (they aren't transmitted):
+			pClient->m_bTxResponse = true;
+			pClient->m_txFrame.pushByte(0x7E);
+			pClient->m_txFrame.pushByte(0x00);
+		}
+		pClient->m_baTxFrame.append(nByte);
+		pClient->m_txFrame.pushByte(nByte);
+		if (pClient->m_txFrame.haveCompletePacket()) transmit(pClient);
+	}
+
+	// A poll is complete when nothing follows its physical ID:
+	if (!pClient->m_bTxResponse && pClient->m_txFrame.haveTelemetryPoll()) transmit(pClient);
+}
+
+void CFrskySportHub::transmit(TClient *pClient)
+{
+	bool bTransmit = true;
+	if (pClient->m_bTxResponse) {
+		if (m_bPollWaiting) {
+			++pClient->m_stats.m_nTxResponses;
+		} else {
+			++pClient->m_stats.m_nTxRejected;
+			bTransmit = false;
+		}
+	} else {
+		++pClient->m_stats.m_nTxFrames;
+	}
+
+	if (bTransmit) {
+		m_bPollWaiting = false;			// The poll has been answered, or the bus taken by a new frame
+		m_frskySportIO.port().write(pClient->m_baTxFrame);
+		m_nTxBytes += pClient->m_baTxFrame.size();
+		if (m_bLocalEcho) fanOut(pClient->m_baTxFrame, pClient->m_baTxFrame.size());
+	}
+
+	pClient->m_baTxFrame.clear();
+	pClient->m_txFrame.reset();
+	pClient->m_bTxResponse = false;
+}
+
+// ============================================================================
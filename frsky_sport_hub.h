@@ -0,0 +1,139 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#ifndef FRSKY_SPORT_HUB_H
+#define FRSKY_SPORT_HUB_H
+
+#include "frsky_sport_io.h"
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QList>
+
+// Forward Declarations
+class QLocalServer;
+class QLocalSocket;
+
+// ============================================================================
+
+//
+// Shares one Sport port between several clients.  The hub is the only
+//	reader of the port (nothing else may connect to its readyRead), and
+//	fans what it receives out to every client connected to its local
+//	socket (a Unix domain socket, or named pipe on Windows).  Clients
+//	see the bus as they would on the port itself, but only ever in whole
+//	frames: the received bytes are passed on at frame boundaries, and a
+//	poll as soon as it arrives, so clients can answer it.  A client that
+//	falls too far behind has whole frames dropped rather than holding up
+//	the others.
+//
+//	What clients write is transmitted on the port, arbitrated a frame at
+//	a time so transmits from different clients never interleave.  Frames
+//	(and polls) are transmitted in the order they arrive.  A poll response
+//	(the frame bytes after the 0x7E and physical ID, as the telemetry
+//	handler's pushes are written) is only transmitted if a poll is waiting
+//	for one, and only the first client's response to each poll is, so
+//	two clients can't answer the same poll on top of each other.
+//
+class CFrskySportHub : public QObject
+{
+	Q_OBJECT
+
+public:
+	static constexpr int DEFAULT_MAX_BACKLOG = 65536;		// Default bytes a client can fall behind before frames are dropped
+
+	struct TClientStats {
+		qint64 m_nBytesSent = 0;			// Bus bytes sent to the client
+		qint64 m_nBytesDropped = 0;			// Bus bytes dropped because the client fell behind
+		qint64 m_nTxFrames = 0;				// Frames and polls from the client transmitted
+		qint64 m_nTxResponses = 0;			// Poll responses from the client transmitted
+		qint64 m_nTxRejected = 0;			// Poll responses not transmitted: no poll waiting, or another client answered first
+		qint64 m_nTxDiscarded = 0;			// Bytes from the client discarded as incomplete frames
+	};
+
+	explicit CFrskySportHub(CFrskySportIO &frskySportIO, QObject *pParent = nullptr);
+	virtual ~CFrskySportHub();
+
+	// Starts listening for clients on the named local socket, replacing a
+	//	stale socket left by a previous hub.  Names that aren't a path are
+	//	created in the temp directory, see QLocalServer::listen():
+	bool listen(const QString &strSocketName, QString *pstrError = nullptr);
+	QString serverName() const;			// Full path of the socket listened on
+
+	void setMaxBacklog(int nBytes) { m_nMaxBacklog = nBytes; }
+	// Sends what the clients transmit to all of the clients too, for
+	//	adapters that don't echo their transmits back:
+	void setLocalEcho(bool bLocalEcho) { m_bLocalEcho = bLocalEcho; }
+
+	int clientCount() const { return m_lstClients.size(); }
+	qint64 rxBytes() const { return m_nRxBytes; }
+	qint64 txBytes() const { return m_nTxBytes; }
+
+signals:
+	void clientConnected(const QString &strClient);
+	void clientDisconnected(const QString &strClient, const QString &strSummary);
+
+	// Private:
+	void dataAvailable();
+
+protected slots:
+	void en_readyRead();
+	void en_receive();
+	// ----
+	void en_newConnection();
+
+protected:
+	struct TClient {
+		QString m_strName;
+		QLocalSocket *m_pSocket = nullptr;
+		CSportRxBuffer m_txFrame;			// Frame being received from the client for transmit
+		QByteArray m_baTxFrame;				// Raw bytes of m_txFrame, as they are transmitted
+		bool m_bTxResponse = false;			// m_txFrame is a poll response (no 0x7E and physical ID)
+		TClientStats m_stats;
+	};
+
+	void fanOut(const QByteArray &baData, int nSize);		// Sends the first nSize bytes of baData to all clients
+	void clientReceive(TClient *pClient);
+	void transmit(TClient *pClient);		// Transmits pClient's m_baTxFrame, if allowed
+	void removeClient(TClient *pClient);
+	static QString clientSummary(const TClient *pClient);
+
+protected:
+	CFrskySportIO &m_frskySportIO;			// Serial Port handler for Sport I/O
+	QLocalServer *m_pServer = nullptr;
+	QList<TClient *> m_lstClients;
+	int m_nNextClient = 1;					// Number of the next client to connect, for its name
+	int m_nMaxBacklog = DEFAULT_MAX_BACKLOG;
+	bool m_bLocalEcho = false;
+	// ----
+	CSportRxBuffer m_rxBuffer;				// Receive Sport Packet buffer, to find the frame boundaries
+	QByteArray m_baRxPending;				// Received bytes of a frame not yet complete, not yet sent to clients
+	bool m_bPollWaiting = false;			// The last thing received was a poll that hasn't been answered
+	qint64 m_nRxBytes = 0;
+	qint64 m_nTxBytes = 0;
+};
+
+// ============================================================================
+
+#endif	// FRSKY_SPORT_HUB_H
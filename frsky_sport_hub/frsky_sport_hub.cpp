@@ -0,0 +1,224 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#include <PersistentSettings.h>
+#include <frsky_sport_io.h>
+#include <frsky_sport_hub.h>
+
+#include <QCoreApplication>
+#include <QSerialPort>
+#include <QStringList>
+
+#include <iostream>
+
+#include <version.h>
+
+// ============================================================================
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	QString strREV = GIT_REV;
+	QString strTAG = GIT_TAG;
+	QString strBRANCH = GIT_BRANCH;
+
+	QString strVersion;
+	if (!strTAG.isEmpty()) {
+		strVersion = strTAG;
+	} else {
+		strVersion = QString("%1/%2").arg(strBRANCH, strREV);
+	}
+
+	app.setApplicationVersion(strVersion);
+	app.setApplicationName("frsky_sport_tool");		// Note: use package name here instead of this app so we can use its common settings
+	app.setOrganizationName("Dewtronics");
+	app.setOrganizationDomain("dewtronics.com");
+
+	CPersistentSettings::instance()->loadSettings();
+
+	QString strSocketName = "frsky_sport_hub";
+	SPORT_ID_ENUM nSport = CPersistentSettings::instance()->getDataConfigSportPort();
+	QString strPort = CPersistentSettings::instance()->getDeviceSerialPort(nSport);
+	bool bHavePortNameSetting =!strPort.isEmpty();
+	int nBaudRate = CPersistentSettings::instance()->getDeviceBaudRate(nSport);
+	int nDataBits = CPersistentSettings::instance()->getDeviceDataBits(nSport);
+	char chParity = CPersistentSettings::instance()->getDeviceParity(nSport);
+	int nStopBits = CPersistentSettings::instance()->getDeviceStopBits(nSport);
+	int nMaxBacklog = CFrskySportHub::DEFAULT_MAX_BACKLOG;
+	bool bLocalEcho = false;
+	bool bNeedUsage = false;
+	int nArgsFound = 0;
+
+	QStringList lstDefaultPortSettings;
+	lstDefaultPortSettings.append(QString("%1").arg(nDataBits));
+	lstDefaultPortSettings.append(QString("%1").arg(QChar(chParity)));
+	lstDefaultPortSettings.append(QString("%1").arg(nStopBits));
+
+	for (int ndx = 1; ndx < argc; ++ndx) {
+		QString strArg = argv[ndx];
+		if (!strArg.startsWith("-")) {
+			switch (nArgsFound) {
+				case 0:
+					strPort = strArg;
+					break;
+				default:
+					bNeedUsage = true;
+					break;
+			}
+			++nArgsFound;
+		} else if (strArg.startsWith("-b")) {
+			if ((strArg == "-b") && (argc > ndx+1)) {
+				nBaudRate = strtoul(argv[ndx+1], nullptr, 0);
+				++ndx;
+			} else {
+				nBaudRate = strtoul(strArg.mid(2).toUtf8().data(), nullptr, 0);
+			}
+		} else if (strArg.startsWith("-s")) {
+			QString strPortSettings;
+			if ((strArg == "-s") && (argc > ndx+1)) {
+				strPortSettings = argv[ndx+1];
+				++ndx;
+			} else {
+				strPortSettings = strArg.mid(2);
+			}
+			QStringList lstPortSettings = strPortSettings.split(",", Qt::KeepEmptyParts);
+			if (lstPortSettings.size() >= 1) {
+				nDataBits = strtoul(lstPortSettings.at(0).toUtf8().data(), nullptr, 0);
+			}
+			if (lstPortSettings.size() >= 2) {
+				if (lstPortSettings.at(1).size() > 0) chParity = lstPortSettings.at(1).toUpper().at(0).toLatin1();
+			}
+			if (lstPortSettings.size() >= 3) {
+				nStopBits = strtoul(lstPortSettings.at(2).toUtf8().data(), nullptr, 0);
+			}
+		} else if (strArg.startsWith("-n")) {
+			if ((strArg == "-n") && (argc > ndx+1)) {
+				strSocketName = argv[ndx+1];
+				++ndx;
+			} else {
+				strSocketName = strArg.mid(2);
+			}
+		} else if (strArg.startsWith("-k")) {
+			if ((strArg == "-k") && (argc > ndx+1)) {
+				nMaxBacklog = strtoul(argv[ndx+1], nullptr, 0) * 1024;
+				++ndx;
+			} else {
+				nMaxBacklog = strtoul(strArg.mid(2).toUtf8().data(), nullptr, 0) * 1024;
+			}
+		} else if (strArg == "-e") {
+			bLocalEcho = true;
+		} else {
+			bNeedUsage = true;
+		}
+	}
+	if (strPort.isEmpty() || strSocketName.isEmpty()) bNeedUsage = true;
+
+	if (bNeedUsage) {
+		std::cerr << "Frsky Sport Bus Hub" << std::endl;
+		std::cerr << "Version: " << strVersion.toUtf8().data() << std::endl << std::endl;
+		if (bHavePortNameSetting) {
+			std::cerr << "Usage: frsky_sport_hub [options] [<port>]" << std::endl;
+		} else {
+			std::cerr << "Usage: frsky_sport_hub [options] <port>" << std::endl;
+		}
+		std::cerr << std::endl;
+		std::cerr << "Shares one serial port between several programs, connected to its" << std::endl;
+		std::cerr << "local socket.  Each one sees everything received on the port, and" << std::endl;
+		std::cerr << "what each one writes is transmitted a frame at a time." << std::endl;
+		std::cerr << std::endl;
+		std::cerr << "Where:" << std::endl;
+		std::cerr << "    <port> = Serial Port to use ";
+		if (bHavePortNameSetting) {
+			std::cerr	<< "(Optional, will use current setting"  << std::endl
+						<< "             of \"" << CPersistentSettings::instance()->getDeviceSerialPort(nSport).toUtf8().data() << "\" if not specified)" << std::endl;
+		} else {
+			std::cerr << "(required)" << std::endl;
+		}
+		std::cerr << std::endl;
+		std::cerr << "Options:" << std::endl;
+		std::cerr << "    -b <baudrate> = optional baud-rate specifier" << std::endl;
+		std::cerr << "                    (if omitted, will use the current setting of " << CPersistentSettings::instance()->getDeviceBaudRate(nSport) << ")" << std::endl;
+		std::cerr << "    -s <port-settings> = where port-settings is a comma separated list of" << std::endl;
+		std::cerr << "                    \"DataBit,Parity,StopBit\", such as \"8,E,2\"" << std::endl;
+		std::cerr << "                    If omitted, will use current setting of \"" << lstDefaultPortSettings.join(',').toUtf8().data() << "\"" << std::endl;
+		std::cerr << "    -n <socket-name> = local socket for clients to connect to, a path or" << std::endl;
+		std::cerr << "                    a name for one in the temp directory" << std::endl;
+		std::cerr << "                    (if omitted, will use \"frsky_sport_hub\")" << std::endl;
+		std::cerr << "    -k <backlog-KB> = how far a client can fall behind, in KB, before frames" << std::endl;
+		std::cerr << "                    to it are dropped (if omitted, will use "
+					<< (CFrskySportHub::DEFAULT_MAX_BACKLOG/1024) << ")" << std::endl;
+		std::cerr << "    -e = send what clients transmit to all clients, for adapters that" << std::endl;
+		std::cerr << "                    don't echo transmits" << std::endl;
+		std::cerr << std::endl << std::endl;
+
+		return -1;
+	}
+
+	std::cerr << "frsky_sport_hub version: " << strVersion.toUtf8().data() << std::endl;
+
+	CFrskySportIO sport(nSport);
+	if (!sport.openPort(strPort, nBaudRate, nDataBits, chParity, nStopBits)) {
+		std::cerr << "Failed to open serial port" << std::endl;
+		std::cerr << sport.getLastError().toUtf8().data() << std::endl;
+		return -2;
+	}
+
+	QStringList lstPortSettings;
+	lstPortSettings.append(QString("%1").arg(sport.dataBits()));
+	lstPortSettings.append(QString("%1").arg(QChar(sport.parity())));
+	lstPortSettings.append(QString("%1").arg(sport.stopBits()));
+
+	std::cerr << "Serial Port: " << strPort.toUtf8().data() << std::endl;
+	std::cerr << "Baud Rate: " << sport.baudRate() << std::endl;
+	std::cerr << "Port Settings: " << lstPortSettings.join(',').toUtf8().data() << std::endl;
+
+	CFrskySportHub hub(sport);
+	hub.setMaxBacklog(nMaxBacklog);
+	hub.setLocalEcho(bLocalEcho);
+	QString strError;
+	if (!hub.listen(strSocketName, &strError)) {
+		std::cerr << strError.toUtf8().data() << std::endl;
+		return -3;
+	}
+	std::cerr << "Local Socket: " << hub.serverName().toUtf8().data() << std::endl;
+	if (bLocalEcho) std::cerr << "Local Echo: True" << std::endl;
+
+	QObject::connect(&hub, &CFrskySportHub::clientConnected, &app, [](const QString &strClient)->void {
+		std::cerr << strClient.toUtf8().data() << ": Connected" << std::endl;
+	});
+	QObject::connect(&hub, &CFrskySportHub::clientDisconnected, &app, [](const QString &strClient, const QString &strSummary)->void {
+		std::cerr << strClient.toUtf8().data() << ": Disconnected, " << strSummary.toUtf8().data() << std::endl;
+	});
+	// Exit if the adapter is unplugged:
+	QObject::connect(&sport.port(), &QSerialPort::errorOccurred, &app, [&app, &sport](QSerialPort::SerialPortError nError)->void {
+		if (nError != QSerialPort::ResourceError) return;
+		std::cerr << "Serial port error: " << sport.port().errorString().toUtf8().data() << std::endl;
+		app.exit(-4);
+	});
+
+	int nResult = app.exec();
+	std::cerr << "Received " << hub.rxBytes() << " bytes, transmitted " << hub.txBytes() << " bytes" << std::endl;
+	return nResult;
+}
+
+// ============================================================================
@@ -24,14 +24,13 @@
 
 #include "crc.h"
 
+#include <QStringList>
+#include <QMutexLocker>
+#include <QRegularExpression>
+
 // ============================================================================
 
 namespace {
-	struct TDataIDNames {
-		uint16_t m_nFirstID;
-		uint16_t m_nLastID;
-		QString m_strName;
-	};
 	static const TDataIDNames conarrDataIDNames[] =
 	{
 		{ DATA_ID_ALT_FIRST, DATA_ID_ALT_LAST, "ALT" },
@@ -102,6 +101,11 @@ namespace {
 
 // ============================================================================
 
+const TDataIDNames *telemetryDataIDNames()
+{
+	return conarrDataIDNames;
+}
+
 static constexpr uint8_t BIT(uint8_t x, int index) { return (((x) >> index) & 0x01); }
 uint8_t physicalIdWithCRC(uint8_t physicalId)
 {
@@ -772,6 +776,15 @@ QString CSportFirmwarePacket::logDetails() const
 
 // ============================================================================
 
+namespace {
+	// Frame fingerprints are the 64-bit FNV-1a hash of the unstuffed
+	//	frame, from the physical ID through the CRC:
+	constexpr uint64_t FINGERPRINT_BASIS = 0xCBF29CE484222325ull;
+	constexpr uint64_t FINGERPRINT_PRIME = 0x00000100000001B3ull;
+};
+
+// ----------------------------------------------------------------------------
+
 void CSportTxBuffer::pushByte(uint8_t byte)
 {
 	m_data.append(byte);
@@ -787,6 +800,24 @@ void CSportTxBuffer::pushByteWithByteStuffing(uint8_t byte)
 	}
 }
 
+uint64_t CSportTxBuffer::fingerprint() const
+{
+	uint64_t nHash = FINGERPRINT_BASIS;
+	bool bInEscape = false;
+	for (int i = 0; i < m_data.size(); ++i) {
+		uint8_t byte = m_data.at(i);
+		if (bInEscape) {
+			byte ^= 0x20;
+			bInEscape = false;
+		} else if (byte == 0x7D) {
+			bInEscape = true;
+			continue;
+		}
+		nHash = (nHash ^ byte) * FINGERPRINT_PRIME;
+	}
+	return nHash;
+}
+
 // ----------------------------------------------------------------------------
 
 QByteArray CSportRxBuffer::pushByte(uint8_t byte)
@@ -834,6 +865,15 @@ QByteArray CSportRxBuffer::pushByte(uint8_t byte)
 	return baExtraneous;
 }
 
+uint64_t CSportRxBuffer::fingerprint() const
+{
+	uint64_t nHash = FINGERPRINT_BASIS;
+	for (int i = 0; i < m_size; ++i) {
+		nHash = (nHash ^ m_data[i]) * FINGERPRINT_PRIME;
+	}
+	return nHash;
+}
+
 // ----------------------------------------------------------------------------
 
 QString CSportRxBuffer::logDetails() const
@@ -851,10 +891,157 @@ QString CSportRxBuffer::logDetails() const
 
 // ============================================================================
 
+namespace {
+	struct TLogFilterKey {
+		const char *m_pszKey;
+		uint32_t m_nValues;			// Number of values (bits) for the key
+	};
+	const TLogFilterKey conarrLogFilterKeys[CSportLogFilter::FK_COUNT] = {
+		{ "port", SPIDE_COUNT },
+		{ "type", CFrskySportIO::LT_STATS+1 },
+		{ "phys", 32 },
+		{ "prim", 256 },
+		{ "data", 65536 },
+	};
+
+	// Log type names for the filter spec, in LOG_TYPE order:
+	const char *conarrLogTypeNames[CFrskySportIO::LT_STATS+1] = {
+		"rx",
+		"tx",
+		"echo",
+		"push",
+		"poll",
+		"stat",
+	};
+
+	void setMaskBits(uint64_t *pMask, uint32_t nFirst, uint32_t nLast, bool bSet)
+	{
+		for (uint32_t nBit = nFirst; nBit <= nLast; ++nBit) {
+			if (bSet) {
+				pMask[nBit >> 6] |= (1ull << (nBit & 63));
+			} else {
+				pMask[nBit >> 6] &= ~(1ull << (nBit & 63));
+			}
+		}
+	}
+
+	bool parseFilterValue(CSportLogFilter::FILTER_KEY nKey, const QString &strValue, uint32_t &nValue)
+	{
+		if (nKey == CSportLogFilter::FK_LOG_TYPE) {
+			for (uint32_t i = 0; i < _countof(conarrLogTypeNames); ++i) {
+				if (strValue.compare(conarrLogTypeNames[i], Qt::CaseInsensitive) == 0) {
+					nValue = i;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool bOK = false;
+		nValue = strValue.toUInt(&bOK, 0);
+		if (bOK && (nKey == CSportLogFilter::FK_PORT)) {
+			// Ports are numbered from 1, same as the log prefix:
+			if (nValue == 0) return false;
+			--nValue;
+		} else if (bOK && (nKey == CSportLogFilter::FK_PHYS_ID) && (nValue < 256)) {
+			// Allow the raw byte with its CRC bits, as it appears in the log:
+			nValue &= 0x1F;
+		}
+		return (bOK && (nValue < conarrLogFilterKeys[nKey].m_nValues));
+	}
+};
+
+// ----------------------------------------------------------------------------
+
+void CSportLogFilter::reset()
+{
+	m_strSpec.clear();
+	m_bAcceptAll = true;
+	for (int nKey = 0; nKey < FK_COUNT; ++nKey) {
+		setMaskBits(mask(static_cast<FILTER_KEY>(nKey)), 0, conarrLogFilterKeys[nKey].m_nValues-1, true);
+	}
+}
+
+uint64_t *CSportLogFilter::mask(FILTER_KEY nKey)
+{
+	switch (nKey) {
+		case FK_PORT:
+			return m_arrPortMask;
+		case FK_LOG_TYPE:
+			return m_arrLogTypeMask;
+		case FK_PHYS_ID:
+			return m_arrPhysIdMask;
+		case FK_PRIM_ID:
+			return m_arrPrimIdMask;
+		case FK_DATA_ID:
+		default:
+			return m_arrDataIdMask;
+	}
+}
+
+bool CSportLogFilter::parse(const QString &strSpec, QString *pstrError)
+{
+	CSportLogFilter filter;
+	bool arrRestricted[FK_COUNT] = { };		// Set when a key's first "=" clause has cleared its mask
+
+	const QStringList lstClauses = strSpec.split(QRegularExpression("[\\s;]+"), Qt::SkipEmptyParts);
+	for (const QString &strClause : lstClauses) {
+		int nEqual = strClause.indexOf('=');
+		bool bExclude = ((nEqual > 0) && (strClause.at(nEqual-1) == '!'));
+		QString strKey = strClause.left(bExclude ? nEqual-1 : nEqual);
+		int nKey = 0;
+		while ((nKey < FK_COUNT) && (strKey.compare(conarrLogFilterKeys[nKey].m_pszKey, Qt::CaseInsensitive) != 0)) ++nKey;
+		if ((nEqual <= 0) || (nKey == FK_COUNT)) {
+			if (pstrError) *pstrError = QObject::tr("Invalid log filter clause \"%1\"", "CSportLogFilter").arg(strClause);
+			return false;
+		}
+
+		uint64_t *pMask = filter.mask(static_cast<FILTER_KEY>(nKey));
+		if (!bExclude && !arrRestricted[nKey]) {
+			setMaskBits(pMask, 0, conarrLogFilterKeys[nKey].m_nValues-1, false);
+			arrRestricted[nKey] = true;
+		}
+
+		const QStringList lstItems = strClause.mid(nEqual+1).split(',', Qt::SkipEmptyParts);
+		for (const QString &strItem : lstItems) {
+			int nDash = strItem.indexOf('-');
+			uint32_t nFirst;
+			uint32_t nLast;
+			if (!parseFilterValue(static_cast<FILTER_KEY>(nKey), (nDash < 0) ? strItem : strItem.left(nDash), nFirst) ||
+				!parseFilterValue(static_cast<FILTER_KEY>(nKey), (nDash < 0) ? strItem : strItem.mid(nDash+1), nLast) ||
+				(nLast < nFirst)) {
+				if (pstrError) *pstrError = QObject::tr("Invalid log filter %1 value \"%2\"", "CSportLogFilter").arg(strKey, strItem);
+				return false;
+			}
+			setMaskBits(pMask, nFirst, nLast, !bExclude);
+		}
+	}
+
+	filter.m_strSpec = lstClauses.join(' ');
+	filter.m_bAcceptAll = true;
+	for (int nKey = 0; nKey < FK_COUNT; ++nKey) {
+		const uint64_t *pMask = filter.mask(static_cast<FILTER_KEY>(nKey));
+		for (uint32_t nBit = 0; filter.m_bAcceptAll && (nBit < conarrLogFilterKeys[nKey].m_nValues); ++nBit) {
+			if (!testBit(pMask, nBit)) filter.m_bAcceptAll = false;
+		}
+	}
+
+	*this = filter;
+	return true;
+}
+
+// ============================================================================
+
 CFrskySportIO::CFrskySportIO(SPORT_ID_ENUM nSport, QObject *pParent)
 	:	QObject(pParent),
 		m_nSportID(nSport)
 {
+	// Receive runs in the thread of the serial port, which the monitor and
+	//	Lua threads move without moving this object:
+	connect(&m_serialPort, &QSerialPort::readyRead, &m_serialPort, [this]() { en_readyRead(); });
+	connect(this, &CFrskySportIO::dataAvailable, &m_serialPort, [this]() { en_receive(); }, Qt::QueuedConnection);
+
+	m_tmrElapsed.start();
 }
 
 CFrskySportIO::~CFrskySportIO()
@@ -932,6 +1119,10 @@ bool CFrskySportIO::openPort(const QString &strSerialPort, int nBaudRate, int nD
 		return false;
 	}
 
+	resetTxInFlight();
+	m_bTxEchoSeen = false;
+	resetTxEchoStats();
+
 	return true;
 }
 
@@ -964,6 +1155,9 @@ void CFrskySportIO::logMessage(LOG_TYPE nLT, const QByteArray &baMsg, const QStr
 		case LT_TELEPOLL:
 			strLogMsg += "Poll: ";
 			break;
+		case LT_STATS:
+			strLogMsg += "Stat: ";
+			break;
 	}
 
 	for (int i = 0; i < baMsg.size(); ++i) {
@@ -977,10 +1171,280 @@ void CFrskySportIO::logMessage(LOG_TYPE nLT, const QByteArray &baMsg, const QStr
 		strLogMsg += QString("%1").arg((uint8_t)(baMsg.at(i)), 2, 16, QChar('0')).toUpper();
 	}
 
-	if (!strExtraMsg.isEmpty()) strLogMsg += "  " + strExtraMsg;
+	if (!strExtraMsg.isEmpty()) strLogMsg += (baMsg.isEmpty() ? "" : "  ") + strExtraMsg;
 
 	emit writeLogString(m_nSportID, strLogMsg);
 }
 
+// ----------------------------------------------------------------------------
+
+void CFrskySportIO::addRxHandler(CSportRxHandler *pHandler, uint32_t nKinds)
+{
+	assert(pHandler != nullptr);
+	removeRxHandler(pHandler);
+	if (m_arrRxHandlers.isEmpty()) {
+		// Nothing has been reading the port, so start clean:
+		m_rxBuffer.reset();
+		m_nReadyReadNsecs = -1;
+		resetTxInFlight();
+	}
+
+	TRxHandler handler;
+	handler.m_pHandler = pHandler;
+	handler.m_nKinds = nKinds;
+	m_arrRxHandlers.append(handler);
+	for (int nKind = 0; nKind < SRFK_COUNT; ++nKind) {
+		if (nKinds & (1 << nKind)) m_arrRxDispatch[nKind].append(pHandler);
+	}
+}
+
+void CFrskySportIO::removeRxHandler(CSportRxHandler *pHandler)
+{
+	for (int ndx = 0; ndx < m_arrRxHandlers.size(); ++ndx) {
+		if (m_arrRxHandlers.at(ndx).m_pHandler == pHandler) {
+			m_arrRxHandlers.remove(ndx);
+			break;
+		}
+	}
+	for (int nKind = 0; nKind < SRFK_COUNT; ++nKind) {
+		m_arrRxDispatch[nKind].removeOne(pHandler);
+	}
+}
+
+void CFrskySportIO::writeFrame(const CSportTxBuffer &txFrame, bool bIsPushResponse)
+{
+	if (bIsPushResponse) {
+		m_serialPort.write(txFrame.data().mid(1));		// For push, drop the PhysicalId (the SOF isn't in txFrame)
+	} else {
+		QByteArray arrBytes(1, 0x7E);	// Start of Frame
+		arrBytes.append(txFrame.data());
+		m_serialPort.write(arrBytes);
+	}
+	m_serialPort.flush();
+
+	qint64 nSentNsecs = m_tmrElapsed.nsecsElapsed();
+	if (m_nTxInFlightCount == TX_ECHO_QUEUE_SIZE) dropTxInFlight(1, nSentNsecs, true);
+	TTxInFlight &txInFlight = m_arrTxInFlight[(m_nTxInFlightHead + m_nTxInFlightCount) % TX_ECHO_QUEUE_SIZE];
+	txInFlight.m_nFingerprint = txFrame.fingerprint();
+	txInFlight.m_nSentNsecs = nSentNsecs;
+	++m_nTxInFlightCount;
+	QMutexLocker locker(&m_mutexTxEcho);
+	++m_txEchoStats.m_nTxFrames;
+}
+
+qint64 CFrskySportIO::matchTxEcho(uint64_t nFingerprint, qint64 nArrivalNsecs)
+{
+	for (int ndx = 0; ndx < m_nTxInFlightCount; ++ndx) {
+		const TTxInFlight &txInFlight = m_arrTxInFlight[(m_nTxInFlightHead + ndx) % TX_ECHO_QUEUE_SIZE];
+		if (txInFlight.m_nFingerprint != nFingerprint) continue;
+
+		// Note: the bytes can be noticed before the write returns:
+		qint64 nLatencyNsecs = qMax(nArrivalNsecs - txInFlight.m_nSentNsecs, qint64(0));
+		dropTxInFlight(ndx, nArrivalNsecs, true);		// Echoes are in order, so any ahead of it were lost
+		dropTxInFlight(1, nArrivalNsecs, false);
+		m_bTxEchoSeen = true;
+
+		QMutexLocker locker(&m_mutexTxEcho);
+		if ((m_txEchoStats.m_nEchos == 0) || (nLatencyNsecs < m_txEchoStats.m_nMinLatencyNsecs)) {
+			m_txEchoStats.m_nMinLatencyNsecs = nLatencyNsecs;
+		}
+		if (nLatencyNsecs > m_txEchoStats.m_nMaxLatencyNsecs) m_txEchoStats.m_nMaxLatencyNsecs = nLatencyNsecs;
+		m_txEchoStats.m_nTotalLatencyNsecs += nLatencyNsecs;
+		++m_txEchoStats.m_nEchos;
+		return nLatencyNsecs;
+	}
+
+	return -1;
+}
+
+void CFrskySportIO::dropTxInFlight(int nCount, qint64 nNowNsecs, bool bMissing)
+{
+	if (nCount <= 0) return;
+	assert(nCount <= m_nTxInFlightCount);
+
+	qint64 nOldestSentNsecs = m_arrTxInFlight[m_nTxInFlightHead].m_nSentNsecs;
+	m_nTxInFlightHead = (m_nTxInFlightHead + nCount) % TX_ECHO_QUEUE_SIZE;
+	m_nTxInFlightCount -= nCount;
+
+	// Until an echo is seen, the adapter may just not echo:
+	if (!bMissing || !m_bTxEchoSeen) return;
+	{
+		QMutexLocker locker(&m_mutexTxEcho);
+		m_txEchoStats.m_nMissing += nCount;
+	}
+	logMessage(LT_TXECHO, QByteArray(), QString("*** No echo of %1 transmitted frame(s), oldest sent %2 ms before")
+				.arg(nCount).arg((nNowNsecs - nOldestSentNsecs)/1000000.0, 0, 'f', 2));
+	emit txEchoMissing(m_nSportID, nCount);
+}
+
+CFrskySportIO::TTxEchoStats CFrskySportIO::txEchoStats() const
+{
+	QMutexLocker locker(&m_mutexTxEcho);
+	return m_txEchoStats;
+}
+
+void CFrskySportIO::resetTxEchoStats()
+{
+	QMutexLocker locker(&m_mutexTxEcho);
+	m_txEchoStats = TTxEchoStats();
+}
+
+QString CFrskySportIO::txEchoSummary() const
+{
+	TTxEchoStats stats = txEchoStats();
+	if (stats.m_nEchos == 0) {
+		return QString("Echo: none of %1 frames").arg(stats.m_nTxFrames);
+	}
+
+	return QString("Echo: %1 of %2 frames, %3 missing, latency avg/min/max: %4/%5/%6 ms")
+			.arg(stats.m_nEchos)
+			.arg(stats.m_nTxFrames)
+			.arg(stats.m_nMissing)
+			.arg(stats.m_nTotalLatencyNsecs/stats.m_nEchos/1000000.0, 0, 'f', 2)
+			.arg(stats.m_nMinLatencyNsecs/1000000.0, 0, 'f', 2)
+			.arg(stats.m_nMaxLatencyNsecs/1000000.0, 0, 'f', 2);
+}
+
+// ----------------------------------------------------------------------------
+
+// This function gets triggered whenever the serial port
+//	has data.  Here, we emit a queued connection function
+//	that handles the read.  We do that rather than read
+//	the data here to avoid a race condition between reading
+//	the data and getting another event from the serial device.
+void CFrskySportIO::en_readyRead()
+{
+	if (m_arrRxHandlers.isEmpty()) return;
+	if (m_nReadyReadNsecs < 0) m_nReadyReadNsecs = m_tmrElapsed.nsecsElapsed();		// Timing is from when the bytes arrived, not when they are read
+	emit dataAvailable();
+}
+
+// This function gets triggered by the readyRead queued
+//	connection with dataAvailable.  Here, we read what's been
+//	received, which might be bytes from the devices or bytes
+//	we are sending being echoed since it's a half-duplex,
+//	single-wire connection, and pass each frame on to the
+//	handlers.  With no handlers, the bytes are left for
+//	whatever else reads the port (such as the hub):
+void CFrskySportIO::en_receive()
+{
+	if (m_arrRxHandlers.isEmpty()) return;
+
+	QByteArray arrBytes = m_serialPort.readAll();
+	qint64 nArrivalNsecs = (m_nReadyReadNsecs >= 0) ? m_nReadyReadNsecs : m_tmrElapsed.nsecsElapsed();
+	m_nReadyReadNsecs = -1;
+	if (arrBytes.isEmpty()) return;
+
+	// Note: a copy, since a handler can remove itself when called:
+	const QVector<TRxHandler> arrRxHandlers = m_arrRxHandlers;
+	for (int ndx = 0; ndx < arrRxHandlers.size(); ++ndx) {
+		arrRxHandlers.at(ndx).m_pHandler->rxBytes(arrBytes.size(), nArrivalNsecs);
+	}
+
+	bool bWantPolls = !m_arrRxDispatch[SRFK_TELEMETRY_POLL].isEmpty();
+	for (int ndx = 0; ndx < arrBytes.size(); ++ndx) {
+		QByteArray baExtraneous = m_rxBuffer.pushByte(arrBytes.at(ndx));
+		if (!baExtraneous.isEmpty()) {
+			logMessage(LT_RX, baExtraneous, "*** Extraneous Bytes");
+		}
+		if (bWantPolls && (ndx == arrBytes.size()-1) && m_rxBuffer.haveTelemetryPoll()) {
+			dispatchFrame(SRFK_TELEMETRY_POLL, nArrivalNsecs, -1);
+		} else if (m_rxBuffer.haveCompletePacket()) {
+			qint64 nEchoLatencyNsecs = m_nTxInFlightCount ? matchTxEcho(m_rxBuffer.fingerprint(), nArrivalNsecs) : -1;
+			if (m_rxBuffer.isFirmwarePacket()) {
+				dispatchFrame(SRFK_FIRMWARE, nArrivalNsecs, nEchoLatencyNsecs);
+			} else if (m_rxBuffer.isTelemetryPacket()) {
+				dispatchFrame(SRFK_TELEMETRY, nArrivalNsecs, nEchoLatencyNsecs);
+			} else {
+				QByteArray baUnexpected(1, 0x7E);		// Add the 0x7E since it's eaten by the RxBuffer
+				baUnexpected.append(m_rxBuffer.rawData());
+				logMessage((nEchoLatencyNsecs >= 0) ? LT_TXECHO : LT_RX, baUnexpected, "*** Unexpected/Unknown packet");
+			}
+
+			m_rxBuffer.reset();
+		}
+	}
+
+	// Expire the frames in flight whose echoes should have been in what
+	//	was read by now:
+	int nExpired = 0;
+	while ((nExpired < m_nTxInFlightCount) &&
+		   ((nArrivalNsecs - m_arrTxInFlight[(m_nTxInFlightHead + nExpired) % TX_ECHO_QUEUE_SIZE].m_nSentNsecs) > TX_ECHO_TIMEOUT_NSECS)) {
+		++nExpired;
+	}
+	dropTxInFlight(nExpired, nArrivalNsecs, true);
+}
+
+void CFrskySportIO::dispatchFrame(SPORT_RX_FRAME_KIND nKind, qint64 nArrivalNsecs, qint64 nEchoLatencyNsecs)
+{
+	bool bIsPoll = (nKind == SRFK_TELEMETRY_POLL);
+	uint8_t nExpectedCRC = 0;
+	if (!bIsPoll) {
+		nExpectedCRC = (nKind == SRFK_FIRMWARE) ? m_rxBuffer.firmwarePacket().crc() : m_rxBuffer.telemetryPacket().crc();
+	}
+	TSportRxFrame frame = { nKind, m_rxBuffer, (nEchoLatencyNsecs >= 0),
+							(bIsPoll || (nExpectedCRC == m_rxBuffer.crc())), nExpectedCRC, nArrivalNsecs, nEchoLatencyNsecs };
+	// Note: a copy, since a handler can remove itself (or another) when
+	//	called, and the removed ones are skipped for the rest of the frame:
+	const QVector<CSportRxHandler *> arrHandlers = m_arrRxDispatch[nKind];
+	auto isCurrent = [this, nKind](CSportRxHandler *pHandler)->bool {
+		return m_arrRxDispatch[nKind].contains(pHandler);
+	};
+
+	// Note: check the filter before building any of the log message:
+	bool bLogEchos = false;
+	if (frame.m_bIsEcho) {
+		for (int ndx = 0; ndx < m_arrRxHandlers.size(); ++ndx) {
+			if (m_arrRxHandlers.at(ndx).m_pHandler->logTxEchos()) {
+				bLogEchos = true;
+				break;
+			}
+		}
+	}
+	LOG_TYPE nLT = frame.m_bIsEcho ? LT_TXECHO : (bIsPoll ? LT_TELEPOLL : LT_RX);
+	bool bLog = (!frame.m_bCrcValid ||
+				 ((bLogEchos || !frame.m_bIsEcho) && logWanted(nLT, m_rxBuffer.data(), m_rxBuffer.size())));
+
+	QByteArray baMessage;
+	if (bLog) {
+		baMessage = QByteArray(1, 0x7E);		// Add the 0x7E since it's eaten by the RxBuffer
+		baMessage.append(m_rxBuffer.rawData());
+	}
+
+	if (bIsPoll) {
+		// Log the poll BEFORE the handlers see it, so that it's
+		//	logged before the response they transmit:
+		if (bLog) logMessage(nLT, baMessage, m_rxBuffer.logDetails());
+		for (int ndx = 0; ndx < arrHandlers.size(); ++ndx) {
+			if (isCurrent(arrHandlers.at(ndx))) arrHandlers.at(ndx)->rxFrame(frame, nullptr);
+		}
+	} else {
+		QString strExtraMessage;
+		for (int ndx = 0; ndx < arrHandlers.size(); ++ndx) {
+			if (!isCurrent(arrHandlers.at(ndx))) continue;
+			QString strLogDetail;
+			arrHandlers.at(ndx)->rxFrame(frame, bLog ? &strLogDetail : nullptr);
+			if (!strLogDetail.isEmpty()) {
+				if (!strExtraMessage.isEmpty()) strExtraMessage += "  ";
+				strExtraMessage += strLogDetail;
+			}
+		}
+		if (bLog) {
+			if (!frame.m_bCrcValid) {
+				QString strCRCError = QString("*** Expected CRC of 0x%1, Received CRC of 0x%2")
+							.arg(QString("%1").arg(nExpectedCRC, 2, 16, QChar('0')).toUpper(),
+								QString("%1").arg(m_rxBuffer.crc(), 2, 16, QChar('0')).toUpper());
+				if (!strExtraMessage.isEmpty()) strExtraMessage += "  ";
+				strExtraMessage += strCRCError;
+			}
+			logMessage(nLT, baMessage, strExtraMessage);
+		}
+	}
+
+	for (int ndx = 0; ndx < arrHandlers.size(); ++ndx) {
+		if (isCurrent(arrHandlers.at(ndx))) arrHandlers.at(ndx)->rxFrameDone(frame);
+	}
+}
+
 // ============================================================================
 
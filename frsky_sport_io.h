@@ -30,10 +30,14 @@
 #include <QObject>
 #include <QString>
 #include <QByteArray>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QMutex>
 
 #include <QSerialPort>
 
 #include <assert.h>
+#include <string.h>
 
 // ============================================================================
 
@@ -265,6 +269,13 @@ constexpr uint8_t PRIM_DATA_CRC_ERR =	0x84;		// CRC Error
 
 extern uint8_t physicalIdWithCRC(uint8_t physicalId);
 
+struct TDataIDNames {
+	uint16_t m_nFirstID;
+	uint16_t m_nLastID;
+	QString m_strName;
+};
+extern const TDataIDNames *telemetryDataIDNames();		// Known DATA_ID ranges, terminated by an entry with m_nFirstID of 0
+
 typedef uint8_t CSportRawPacket[8];
 
 PACK(union CSportTelemetryPacket
@@ -417,6 +428,7 @@ public:
 
 	int size() const { return m_data.size(); }
 	const QByteArray &data() const { return m_data; }
+	uint64_t fingerprint() const;		// Of the unstuffed frame, to match its echo with CSportRxBuffer::fingerprint()
 
 	void pushByte(uint8_t byte);
 	void pushByteWithByteStuffing(uint8_t byte);
@@ -513,6 +525,8 @@ public:
 
 	QByteArray pushByte(uint8_t byte);		// Returns any extraneous discarded bytes from before a valid receive so they can be logged
 
+	uint64_t fingerprint() const;		// Of the unstuffed frame, to match it to the CSportTxBuffer::fingerprint() it echoes
+
 	QString logDetails() const;			// Called by processFrame() functions to annotate log information
 
 protected:
@@ -530,6 +544,133 @@ protected:
 };
 
 
+// ============================================================================
+
+//
+// Log filter, checked before a frame's log message is built, so frames that
+//	aren't wanted cost only a few bit tests.  The port, LOG_TYPE, physical ID
+//	(the 5-bit ID, without its CRC bits), PRIM ID and DATA_ID each have a
+//	bitmask of the values to log, all set by default.  The DATA_ID is only
+//	checked on telemetry frames, since on firmware frames those bytes are the
+//	flash command and data.  Frames with errors (CRC errors, unexpected
+//	packets and extraneous bytes) are logged regardless of the filter.
+//
+//	The spec string is a space or semicolon separated list of "<key>=<list>"
+//	clauses, to log only those values, or "<key>!=<list>" to exclude them.
+//	Key is port, type, phys, prim or data, and the list is comma separated
+//	values or "<first>-<last>" ranges.  Ports are 1 and 2, types are rx, tx,
+//	echo, push, poll and stat, and the others are numbers (0x for hex), such
+//	as "type!=poll,echo data=0x0100-0x01FF".  A physical ID can be given as
+//	either the 5-bit ID or the byte with its CRC bits, as it's logged.
+//
+class CSportLogFilter
+{
+public:
+	enum FILTER_KEY {
+		FK_PORT = 0,
+		FK_LOG_TYPE = 1,
+		FK_PHYS_ID = 2,
+		FK_PRIM_ID = 3,
+		FK_DATA_ID = 4,
+		// ----
+		FK_COUNT
+	};
+
+	CSportLogFilter()
+	{
+		reset();
+	}
+
+	void reset();			// Log everything
+	bool parse(const QString &strSpec, QString *pstrError = nullptr);		// On error, the filter is unchanged
+	const QString &spec() const { return m_strSpec; }
+	bool acceptsAll() const { return m_bAcceptAll; }
+
+	// pFrame is the unstuffed frame starting with the physical ID (without
+	//	the 0x7E), or nullptr for messages without a frame:
+	bool accepts(int nSport, int nLogType, const uint8_t *pFrame = nullptr, int nSize = 0) const
+	{
+		if (m_bAcceptAll) return true;
+		if (!testBit(m_arrPortMask, nSport) || !testBit(m_arrLogTypeMask, nLogType)) return false;
+		if ((pFrame == nullptr) || (nSize < 1)) return true;
+		if (!testBit(m_arrPhysIdMask, pFrame[0] & 0x1F)) return false;
+		if (nSize < 2) return true;
+		if (!testBit(m_arrPrimIdMask, pFrame[1])) return false;
+		if ((nSize < 4) || (pFrame[1] == PRIM_ID_FIRMWARE_FRAME)) return true;
+		return testBit(m_arrDataIdMask, pFrame[2] | (pFrame[3] << 8));
+	}
+
+protected:
+	static bool testBit(const uint64_t *pMask, uint32_t nBit) { return ((pMask[nBit >> 6] >> (nBit & 63)) & 1); }
+	uint64_t *mask(FILTER_KEY nKey);
+
+	QString m_strSpec;
+	bool m_bAcceptAll;
+	uint64_t m_arrPortMask[1];
+	uint64_t m_arrLogTypeMask[1];
+	uint64_t m_arrPhysIdMask[1];
+	uint64_t m_arrPrimIdMask[256/64];
+	uint64_t m_arrDataIdMask[65536/64];
+};
+
+// ============================================================================
+
+//
+// Receive dispatch.  CFrskySportIO is the only reader of its port, and the
+//	device handlers using it (firmware flasher, device emulator, telemetry)
+//	register with it for the kinds of frames they want, so handlers sharing
+//	a port each see every frame, instead of whichever reads first taking
+//	the bytes.  Each frame is unstuffed, CRC checked, classified and checked
+//	for being the echo of one of the port's transmits once, before being passed
+//	to its handlers, and is logged once, after they've added their detail to
+//	its log message.  Extraneous bytes and unknown frames are logged without
+//	being dispatched.
+//
+//	A telemetry poll is only recognized at the end of what's been read, and
+//	only when a handler wants polls, since a device's response to the poll
+//	follows it without a new frame start.  The poll's frame continues with
+//	the response, dispatched as a telemetry frame when it's complete.
+//
+enum SPORT_RX_FRAME_KIND {
+	SRFK_TELEMETRY_POLL = 0,
+	SRFK_TELEMETRY = 1,
+	SRFK_FIRMWARE = 2,
+	// ----
+	SRFK_COUNT
+};
+
+// Masks of the frame kinds for CFrskySportIO::addRxHandler():
+constexpr uint32_t SRFK_MASK_FRAMES = (1 << SRFK_TELEMETRY) | (1 << SRFK_FIRMWARE);
+constexpr uint32_t SRFK_MASK_ALL = SRFK_MASK_FRAMES | (1 << SRFK_TELEMETRY_POLL);
+
+struct TSportRxFrame
+{
+	SPORT_RX_FRAME_KIND m_nKind;
+	const CSportRxBuffer &m_rxBuffer;	// The frame, only valid during the dispatch
+	bool m_bIsEcho;						// Echo of a frame transmitted on the port (never for polls)
+	bool m_bCrcValid;					// Always true for polls
+	uint8_t m_nExpectedCRC;
+	qint64 m_nArrivalNsecs;				// CFrskySportIO::elapsedNsecs() time the bytes arrived
+	qint64 m_nEchoLatencyNsecs;			// Time from transmit to echo, -1 if not an echo
+};
+
+class CSportRxHandler
+{
+public:
+	virtual ~CSportRxHandler() { }
+
+	// Each read from the port, before its frames:
+	virtual void rxBytes(int nBytes, qint64 nArrivalNsecs) { Q_UNUSED(nBytes); Q_UNUSED(nArrivalNsecs); }
+	// Each frame of the kinds registered for, with pstrLogDetail set if the
+	//	frame is being logged, to append any detail to its log message:
+	virtual void rxFrame(const TSportRxFrame &frame, QString *pstrLogDetail) = 0;
+	// After the frame has been logged, to act on it, such as advancing a
+	//	state machine, after the frame in the log:
+	virtual void rxFrameDone(const TSportRxFrame &frame) { Q_UNUSED(frame); }
+	// True if echoes of the port's transmits should be logged:
+	virtual bool logTxEchos() const { return false; }
+};
+
 // ============================================================================
 
 class CFrskySportIO : public QObject
@@ -542,6 +683,7 @@ public:
 		LT_TXECHO = 2,		// Transmit Echo Message Log
 		LT_TXPUSH = 3,		// Transmit Push Message Log (data pushed by device in response to Telemetry Poll)
 		LT_TELEPOLL = 4,	// Telemetry Poll Log
+		LT_STATS = 5,		// Statistics Summary Log (no message bytes)
 	};
 
 	CFrskySportIO(SPORT_ID_ENUM nSport, QObject *pParent = nullptr);
@@ -578,15 +720,93 @@ public:
 
 	QString getLastError() const { return m_strLastError; }
 
+	CSportLogFilter &logFilter() { return m_logFilter; }
+	const CSportLogFilter &logFilter() const { return m_logFilter; }
+	bool logWanted(LOG_TYPE nLT, const uint8_t *pFrame = nullptr, int nSize = 0) const { return m_logFilter.accepts(m_nSportID, nLT, pFrame, nSize); }
+
 	void logMessage(LOG_TYPE nLT, const QByteArray &baMsg, const QString &strExtraMsg = QString());
 
+	// Receive dispatch (see CSportRxHandler).  nKinds is a mask of
+	//	(1 << SPORT_RX_FRAME_KIND) bits, such as SRFK_MASK_FRAMES:
+	void addRxHandler(CSportRxHandler *pHandler, uint32_t nKinds);
+	void removeRxHandler(CSportRxHandler *pHandler);
+	qint64 elapsedNsecs() const { return m_tmrElapsed.nsecsElapsed(); }		// Time base of the arrival times
+
+	// Transmits a frame, remembering it to recognize its echo.  A response
+	//	pushed to a telemetry poll is written without the frame start and
+	//	physical ID, which are the poll's:
+	void writeFrame(const CSportTxBuffer &txFrame, bool bIsPushResponse = false);
+
+	// Transmit echo correlation.  The half-duplex bus adapter echoes each
+	//	frame transmitted, so each frame written is kept in a small queue of
+	//	frames in flight, as a 64-bit fingerprint and the time it was sent,
+	//	until its echo is received.  Echoes come back in the order sent, so a
+	//	received frame matching an entry is its echo, and the entries ahead of
+	//	it were lost.  Entries also expire if not echoed within the timeout,
+	//	or when the queue overflows.  The echo latency is the time from the
+	//	write to when the end of the echo is read, so is the adapter and
+	//	driver latency plus the frame time.  Since not all adapters echo,
+	//	frames not echoed are only counted as missing (and logged, and
+	//	signaled with txEchoMissing as a sign of a bus or adapter fault) once
+	//	an echo has been received since the port was opened.  The queue is
+	//	only used on the port's thread, but the stats are also read from
+	//	others (such as the GUI's bus statistics), so are kept under a mutex:
+	static constexpr int TX_ECHO_QUEUE_SIZE = 8;					// Frames in flight kept for echo matching
+	static constexpr qint64 TX_ECHO_TIMEOUT_NSECS = 100000000;		// Time to wait for an echo
+
+	struct TTxEchoStats {
+		uint32_t m_nTxFrames = 0;				// Frames written with writeFrame()
+		uint32_t m_nEchos = 0;					// Echoes received
+		uint32_t m_nMissing = 0;				// Frames not echoed
+		int64_t m_nTotalLatencyNsecs = 0;
+		int64_t m_nMinLatencyNsecs = 0;
+		int64_t m_nMaxLatencyNsecs = 0;
+	};
+	TTxEchoStats txEchoStats() const;			// Consistent snapshot, callable from any thread
+	void resetTxEchoStats();
+	QString txEchoSummary() const;				// Single line summary for logging and display
+
 signals:
 	void writeLogString(SPORT_ID_ENUM nSport, const QString &strLogString);
+	void txEchoMissing(SPORT_ID_ENUM nSport, int nCount);		// Transmitted frames that weren't echoed
+
+	// Private:
+	void dataAvailable();
+
+protected:
+	void en_readyRead();
+	void en_receive();
+	void dispatchFrame(SPORT_RX_FRAME_KIND nKind, qint64 nArrivalNsecs, qint64 nEchoLatencyNsecs);
+	qint64 matchTxEcho(uint64_t nFingerprint, qint64 nArrivalNsecs);		// Returns the echo latency, -1 if not an echo
+	void dropTxInFlight(int nCount, qint64 nNowNsecs, bool bMissing);		// Removes the oldest nCount frames in flight
+	void resetTxInFlight() { m_nTxInFlightHead = 0; m_nTxInFlightCount = 0; }
 
 protected:
 	QString m_strLastError;
 	SPORT_ID_ENUM m_nSportID;
 	QSerialPort m_serialPort;
+	CSportLogFilter m_logFilter;
+
+	struct TRxHandler {
+		CSportRxHandler *m_pHandler;
+		uint32_t m_nKinds;
+	};
+	QVector<TRxHandler> m_arrRxHandlers;	// All registered handlers
+	QVector<CSportRxHandler *> m_arrRxDispatch[SRFK_COUNT];		// Handlers of each frame kind
+	QElapsedTimer m_tmrElapsed;
+	qint64 m_nReadyReadNsecs = -1;			// m_tmrElapsed time of the first readyRead whose data hasn't been read yet, -1 if none
+	CSportRxBuffer m_rxBuffer;				// Receive Sport Packet buffer from serial en_receive events
+
+	struct TTxInFlight {
+		uint64_t m_nFingerprint;			// CSportTxBuffer::fingerprint() of the frame
+		qint64 m_nSentNsecs;				// m_tmrElapsed time it was written
+	};
+	TTxInFlight m_arrTxInFlight[TX_ECHO_QUEUE_SIZE];	// Frames transmitted and not yet echoed, oldest at m_nTxInFlightHead
+	int m_nTxInFlightHead = 0;
+	int m_nTxInFlightCount = 0;
+	bool m_bTxEchoSeen = false;				// An echo has been received since the port was opened
+	mutable QMutex m_mutexTxEcho;			// Guards m_txEchoStats
+	TTxEchoStats m_txEchoStats;
 };
 
 // ============================================================================
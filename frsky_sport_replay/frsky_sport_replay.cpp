@@ -0,0 +1,465 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#include <PersistentSettings.h>
+#include <LogFile.h>
+#include <frsky_sport_io.h>
+#include <frsky_sport_telemetry.h>
+#include <frsky_sport_replayer.h>
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QStringList>
+
+#include <iostream>
+#include <time.h>
+#include <unistd.h>
+
+#include <version.h>
+
+// ============================================================================
+
+namespace {
+	constexpr int BENCHMARK_CHECK_MSECS = 50;		// Interval for checking if the benchmark is done
+	constexpr int BENCHMARK_IDLE_MSECS = 1000;		// Time with nothing received, after the replay, to give up on the rest
+
+	int64_t threadCpuNsecs()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+		return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+	}
+
+	// Runs the replay on its own thread, so the receive path under test
+	//	has the main thread and its event loop to itself:
+	class CSportReplayThread : public QThread
+	{
+	public:
+		CSportReplayThread(CSportReplayer &replayer, int fd)
+			:	m_replayer(replayer),
+				m_fd(fd)
+		{
+		}
+
+		bool success() const { return m_bSuccess; }
+		const QString &error() const { return m_strError; }
+
+	protected:
+		virtual void run() override
+		{
+			m_bSuccess = m_replayer.replay(m_fd, &m_strError);
+		}
+
+	private:
+		CSportReplayer &m_replayer;
+		int m_fd;
+		bool m_bSuccess = false;
+		QString m_strError;
+	};
+};
+
+// ============================================================================
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	QString strREV = GIT_REV;
+	QString strTAG = GIT_TAG;
+	QString strBRANCH = GIT_BRANCH;
+
+	QString strVersion;
+	if (!strTAG.isEmpty()) {
+		strVersion = strTAG;
+	} else {
+		strVersion = QString("%1/%2").arg(strBRANCH, strREV);
+	}
+
+	app.setApplicationVersion(strVersion);
+	app.setApplicationName("frsky_sport_tool");		// Note: use package name here instead of this app so we can use its common settings
+	app.setOrganizationName("Dewtronics");
+	app.setOrganizationDomain("dewtronics.com");
+
+	CPersistentSettings::instance()->loadSettings();
+
+	QString strCapture;
+	QString strPort;
+	QString strLogFile;
+	QString strLogFilter = CPersistentSettings::instance()->getLogFileFilter();
+	SPORT_ID_ENUM nSport = CPersistentSettings::instance()->getDataConfigSportPort();
+	int nBaudRate = CPersistentSettings::instance()->getDeviceBaudRate(nSport);
+	int nDataBits = CPersistentSettings::instance()->getDeviceDataBits(nSport);
+	char chParity = CPersistentSettings::instance()->getDeviceParity(nSport);
+	int nStopBits = CPersistentSettings::instance()->getDeviceStopBits(nSport);
+	CSportReplayer::INPUT_FORMAT nInputFormat = CSportReplayer::IF_AUTO;
+	int nCapturePort = -1;
+	double nSpeed = 1.0;
+	bool bOnRequest = false;
+	bool bEcho = false;
+	bool bLoop = false;
+	bool bBenchmark = false;
+	bool bNeedUsage = false;
+	int nArgsFound = 0;
+
+	QStringList lstDefaultPortSettings;
+	lstDefaultPortSettings.append(QString("%1").arg(nDataBits));
+	lstDefaultPortSettings.append(QString("%1").arg(QChar(chParity)));
+	lstDefaultPortSettings.append(QString("%1").arg(nStopBits));
+
+	for (int ndx = 1; ndx < argc; ++ndx) {
+		QString strArg = argv[ndx];
+		if (!strArg.startsWith("-")) {
+			switch (nArgsFound) {
+				case 0:
+					strCapture = strArg;
+					break;
+				case 1:
+					strPort = strArg;
+					break;
+				default:
+					bNeedUsage = true;
+					break;
+			}
+			++nArgsFound;
+		} else if (strArg.startsWith("-b")) {
+			if ((strArg == "-b") && (argc > ndx+1)) {
+				nBaudRate = strtoul(argv[ndx+1], nullptr, 0);
+				++ndx;
+			} else {
+				nBaudRate = strtoul(strArg.mid(2).toUtf8().data(), nullptr, 0);
+			}
+		} else if (strArg.startsWith("-s")) {
+			QString strPortSettings;
+			if ((strArg == "-s") && (argc > ndx+1)) {
+				strPortSettings = argv[ndx+1];
+				++ndx;
+			} else {
+				strPortSettings = strArg.mid(2);
+			}
+			QStringList lstPortSettings = strPortSettings.split(",", Qt::KeepEmptyParts);
+			if (lstPortSettings.size() >= 1) {
+				nDataBits = strtoul(lstPortSettings.at(0).toUtf8().data(), nullptr, 0);
+			}
+			if (lstPortSettings.size() >= 2) {
+				if (lstPortSettings.at(1).size() > 0) chParity = lstPortSettings.at(1).toUpper().at(0).toLatin1();
+			}
+			if (lstPortSettings.size() >= 3) {
+				nStopBits = strtoul(lstPortSettings.at(2).toUtf8().data(), nullptr, 0);
+			}
+		} else if (strArg.startsWith("-t")) {
+			QString strType;
+			if ((strArg == "-t") && (argc > ndx+1)) {
+				strType = argv[ndx+1];
+				++ndx;
+			} else {
+				strType = strArg.mid(2);
+			}
+			if (strType.compare("auto", Qt::CaseInsensitive) == 0) {
+				nInputFormat = CSportReplayer::IF_AUTO;
+			} else if (strType.compare("raw", Qt::CaseInsensitive) == 0) {
+				nInputFormat = CSportReplayer::IF_RAW;
+			} else if (strType.compare("pcapng", Qt::CaseInsensitive) == 0) {
+				nInputFormat = CSportReplayer::IF_PCAPNG;
+			} else if (strType.compare("log", Qt::CaseInsensitive) == 0) {
+				nInputFormat = CSportReplayer::IF_TEXTLOG;
+			} else if (strType.compare("slog", Qt::CaseInsensitive) == 0) {
+				nInputFormat = CSportReplayer::IF_BINLOG;
+			} else {
+				bNeedUsage = true;
+			}
+		} else if (strArg.startsWith("-P")) {
+			if ((strArg == "-P") && (argc > ndx+1)) {
+				nCapturePort = strtoul(argv[ndx+1], nullptr, 0);
+				++ndx;
+			} else {
+				nCapturePort = strtoul(strArg.mid(2).toUtf8().data(), nullptr, 0);
+			}
+		} else if (strArg.startsWith("-r")) {
+			QString strRate;
+			if ((strArg == "-r") && (argc > ndx+1)) {
+				strRate = argv[ndx+1];
+				++ndx;
+			} else {
+				strRate = strArg.mid(2);
+			}
+			if (strRate.compare("max", Qt::CaseInsensitive) == 0) {
+				nSpeed = CSportReplayer::SPEED_MAX;
+			} else if (strRate.compare("request", Qt::CaseInsensitive) == 0) {
+				bOnRequest = true;
+			} else {
+				bool bOK = false;
+				nSpeed = strRate.toDouble(&bOK);
+				if (!bOK || (nSpeed <= 0.0)) bNeedUsage = true;
+			}
+		} else if (strArg.startsWith("-l")) {
+			if ((strArg == "-l") && (argc > ndx+1)) {
+				strLogFile = argv[ndx+1];
+				++ndx;
+			} else {
+				strLogFile = strArg.mid(2);
+			}
+		} else if (strArg.startsWith("-F")) {
+			if ((strArg == "-F") && (argc > ndx+1)) {
+				strLogFilter = argv[ndx+1];
+				++ndx;
+			} else {
+				strLogFilter = strArg.mid(2);
+			}
+		} else if (strArg == "-e") {
+			bEcho = true;
+		} else if (strArg == "-L") {
+			bLoop = true;
+		} else if (strArg == "-B") {
+			bBenchmark = true;
+		} else {
+			bNeedUsage = true;
+		}
+	}
+	if (strCapture.isEmpty()) bNeedUsage = true;
+	// The benchmark is the tools' own receive path on a pty, so it can't
+	//	have a port, and must have an end and nothing to answer:
+	if (bBenchmark && (!strPort.isEmpty() || bOnRequest || bLoop)) bNeedUsage = true;
+	if (!bBenchmark && !strLogFile.isEmpty()) bNeedUsage = true;
+
+	if (bNeedUsage) {
+		std::cerr << "Frsky Sport Capture Replay Tool" << std::endl;
+		std::cerr << "Version: " << strVersion.toUtf8().data() << std::endl << std::endl;
+		std::cerr << "Usage: frsky_sport_replay [options] <capture-file> [<port>]" << std::endl;
+		std::cerr << std::endl;
+		std::cerr << "Where:" << std::endl;
+		std::cerr << "    <capture-file> = Capture to replay (required), which can be a raw byte dump" << std::endl;
+		std::cerr << "                    of the Sport bus, a pcapng capture of the serial data, or" << std::endl;
+		std::cerr << "                    a communications log file (text or .slog) from the other" << std::endl;
+		std::cerr << "                    tools, of which what the tool received is replayed" << std::endl;
+		std::cerr << "    <port> = Serial port to replay into.  If omitted, a pty is created and" << std::endl;
+		std::cerr << "                    its name printed, for the tool under test to open" << std::endl;
+		std::cerr << std::endl;
+		std::cerr << "Options:" << std::endl;
+		std::cerr << "    -b <baudrate> = optional baud-rate specifier, also used for the timing" << std::endl;
+		std::cerr << "                    of raw captures" << std::endl;
+		std::cerr << "                    (if omitted, will use the current setting of " << CPersistentSettings::instance()->getDeviceBaudRate(nSport) << ")" << std::endl;
+		std::cerr << "    -s <port-settings> = where port-settings is a comma separated list of" << std::endl;
+		std::cerr << "                    \"DataBit,Parity,StopBit\", such as \"8,E,2\"" << std::endl;
+		std::cerr << "                    If omitted, will use current setting of \"" << lstDefaultPortSettings.join(',').toUtf8().data() << "\"" << std::endl;
+		std::cerr << "    -t <type> = capture type, \"auto\" (the default), \"raw\", \"pcapng\", \"log\" or \"slog\"" << std::endl;
+		std::cerr << "    -P <port-number> = port (or session) number to replay from a log with more" << std::endl;
+		std::cerr << "                    than one (if omitted, will use the first one found)" << std::endl;
+		std::cerr << "    -r <rate> = replay rate, a multiple of the captured timing (like 2 or 10)," << std::endl;
+		std::cerr << "                    \"max\" to write as fast as the tool reads, or \"request\" to" << std::endl;
+		std::cerr << "                    only answer the polls and firmware commands the tool sends" << std::endl;
+		std::cerr << "                    with the responses captured for them (default is 1)" << std::endl;
+		std::cerr << "    -e = echo what the tool writes, as a half-duplex Sport bus does" << std::endl;
+		std::cerr << "    -L = loop, repeating the capture until the tool closes the port" << std::endl;
+		std::cerr << "    -B = benchmark the receive path, by replaying into this tool's own" << std::endl;
+		std::cerr << "                    telemetry handler on a pty, reporting the receive rate and" << std::endl;
+		std::cerr << "                    any frames lost.  Can't be used with a port, -L or \"request\"" << std::endl;
+		std::cerr << "    -l <logfile> = log file of what the benchmark receives (-B only)" << std::endl;
+		std::cerr << "    -F <log-filter> = optional log filter, such as \"type=rx,tx;phys!=0x1B\"" << std::endl;
+		std::cerr << "                    (keys: port, type, phys, prim, data; errors are always logged)" << std::endl;
+		std::cerr << std::endl << std::endl;
+
+		return -1;
+	}
+
+	std::cerr << "frsky_sport_replay version: " << strVersion.toUtf8().data() << std::endl;
+
+	CSportReplayer replayer;
+	replayer.setByteTime(nBaudRate, 1 + nDataBits + ((chParity != 'N') ? 1 : 0) + nStopBits);
+	replayer.setSpeed(nSpeed);
+	replayer.setOnRequest(bOnRequest);
+	replayer.setEcho(bEcho);
+	replayer.setLoop(bLoop);
+
+	QString strError;
+	if (!replayer.loadCapture(strCapture, nInputFormat, nCapturePort, &strError)) {
+		std::cerr << "Failed to load \"" << strCapture.toUtf8().data() << "\"" << std::endl;
+		std::cerr << strError.toUtf8().data() << std::endl;
+		return -3;
+	}
+
+	std::cerr << "Capture File: " << strCapture.toUtf8().data() << std::endl;
+	std::cerr << "Capture Type: " << CSportReplayer::inputFormatName(replayer.inputFormat()).toUtf8().data() << std::endl;
+	if (replayer.capturePort() != -1) std::cerr << "Capture Port: " << replayer.capturePort() << std::endl;
+	std::cerr << "Capture: " << replayer.byteCount() << " bytes, " << replayer.eventCount() << " writes, "
+				<< replayer.telemetryFrameCount() << " telemetry frames, "
+				<< (replayer.durationNsecs() / 1000000) << " msecs" << std::endl;
+	if (bOnRequest) {
+		std::cerr << "Replay Rate: On Request, " << replayer.responseCount() << " responses" << std::endl;
+	} else if (nSpeed <= CSportReplayer::SPEED_MAX) {
+		std::cerr << "Replay Rate: Max" << std::endl;
+	} else {
+		std::cerr << "Replay Rate: " << nSpeed << "x" << std::endl;
+	}
+
+	// ------------------------------------------------------------------------
+
+	if (bBenchmark) {
+		QString strSlave;
+		int fdMaster = CSportReplayer::openPty(strSlave, &strError);
+		if (fdMaster < 0) {
+			std::cerr << strError.toUtf8().data() << std::endl;
+			return -2;
+		}
+
+		CFrskySportIO sport(nSport);
+		QString strFilterError;
+		if (!sport.logFilter().parse(strLogFilter, &strFilterError)) {
+			std::cerr << "Invalid log filter: " << strFilterError.toUtf8().data() << std::endl;
+			::close(fdMaster);
+			return -1;
+		}
+		if (!sport.openPort(strSlave, nBaudRate, nDataBits, chParity, nStopBits)) {
+			std::cerr << "Failed to open pty \"" << strSlave.toUtf8().data() << "\"" << std::endl;
+			std::cerr << sport.getLastError().toUtf8().data() << std::endl;
+			::close(fdMaster);
+			return -2;
+		}
+
+		CLogFile logFile;
+		if (!strLogFile.isEmpty()) {
+			std::cerr << "Log File: " << strLogFile.toUtf8().data() << std::endl;
+			if (!sport.logFilter().acceptsAll()) std::cerr << "Log Filter: " << sport.logFilter().spec().toUtf8().data() << std::endl;
+			logFile.setFlushInterval(CPersistentSettings::instance()->getLogFileFlushInterval());
+			logFile.setRotation(static_cast<qint64>(CPersistentSettings::instance()->getLogFileRotateSize())*1024*1024,
+								static_cast<qint64>(CPersistentSettings::instance()->getLogFileRotateMinutes())*60000,
+								CPersistentSettings::instance()->getLogFileRotateKeep());
+			if (!logFile.openLogFile(strLogFile, QIODevice::WriteOnly)) {
+				std::cerr << "Failed to open \"" << strLogFile.toUtf8().data() << "\" for writing" << std::endl;
+				std::cerr << logFile.getLastError().toUtf8().data() << std::endl;
+				::close(fdMaster);
+				return -5;
+			}
+			QObject::connect(&sport, &CFrskySportIO::writeLogString, &sport,
+								[&logFile](SPORT_ID_ENUM nSport, const QString &strMessage)->void {
+									Q_UNUSED(nSport);
+									logFile.writeLogString(strMessage);
+								});
+		}
+
+		CFrskySportDeviceTelemetry telemetry(sport);
+		qint64 nFramesReceived = 0;
+		QElapsedTimer tmrBenchmark;
+		qint64 nLastRxMsecs = 0;
+		telemetry.setRxPacketSink([&nFramesReceived, &nLastRxMsecs, &tmrBenchmark](const CSportTelemetryPacket &packet)->void {
+			Q_UNUSED(packet);
+			++nFramesReceived;
+			nLastRxMsecs = tmrBenchmark.elapsed();
+		});
+
+		CSportReplayThread threadReplay(replayer, fdMaster);
+		QTimer tmrCheck;
+		QObject::connect(&tmrCheck, &QTimer::timeout, &app, [&]()->void {
+			if (!threadReplay.isFinished()) return;
+			// The last of the replay may still be in the pty, so wait for
+			//	the receiver to catch up, or stop receiving:
+			if ((nFramesReceived >= replayer.telemetryFrameCount()) ||
+				!threadReplay.success() ||
+				((tmrBenchmark.elapsed() - nLastRxMsecs) >= BENCHMARK_IDLE_MSECS)) {
+				app.quit();
+			}
+		});
+
+		int64_t nCpuStartNsecs = threadCpuNsecs();
+		tmrBenchmark.start();
+		threadReplay.start();
+		tmrCheck.start(BENCHMARK_CHECK_MSECS);
+		app.exec();
+		qint64 nElapsedMsecs = (nLastRxMsecs ? nLastRxMsecs : tmrBenchmark.elapsed());
+		int64_t nCpuNsecs = threadCpuNsecs() - nCpuStartNsecs;
+
+		threadReplay.wait();
+		sport.closePort();
+		::close(fdMaster);
+		logFile.closeLogFile();
+
+		std::cerr << replayer.summary().toUtf8().data() << std::endl;
+		if (!threadReplay.success()) {
+			std::cerr << "Replay failed: " << threadReplay.error().toUtf8().data() << std::endl;
+			return -4;
+		}
+
+		double nSecs = std::max<qint64>(nElapsedMsecs, 1) / 1000.0;
+		std::cerr << "Frames Received: " << nFramesReceived << " of " << replayer.telemetryFrameCount()
+					<< ", CRC Errors: " << telemetry.crcErrorCount() << std::endl;
+		std::cerr << "Receive Rate: " << static_cast<qint64>(nFramesReceived / nSecs) << " frames/sec, "
+					<< static_cast<qint64>(replayer.stats().m_nBytesWritten / nSecs) << " bytes/sec, in "
+					<< nElapsedMsecs << " msecs" << std::endl;
+		std::cerr << "Receive CPU: " << (nCpuNsecs / 1000000) << " msecs ("
+					<< QString::number(nCpuNsecs / 10000000.0 / nSecs, 'f', 1).toUtf8().data() << "%)" << std::endl;
+
+		if (nFramesReceived < replayer.telemetryFrameCount()) {
+			std::cerr << "*** " << (replayer.telemetryFrameCount() - nFramesReceived) << " frames lost" << std::endl;
+			return -6;
+		}
+		return 0;
+	}
+
+	// ------------------------------------------------------------------------
+
+	bool bSuccess;
+	if (strPort.isEmpty()) {
+		QString strSlave;
+		int fdMaster = CSportReplayer::openPty(strSlave, &strError);
+		if (fdMaster < 0) {
+			std::cerr << strError.toUtf8().data() << std::endl;
+			return -2;
+		}
+		std::cout << "Pty: " << strSlave.toUtf8().data() << std::endl;
+		std::cerr << "Waiting for the tool under test to open the pty..." << std::endl;
+		replayer.waitForPeer(fdMaster);
+		bSuccess = replayer.replay(fdMaster, &strError);
+		::close(fdMaster);
+	} else {
+		CFrskySportIO sport(nSport);
+		if (!sport.openPort(strPort, nBaudRate, nDataBits, chParity, nStopBits)) {
+			std::cerr << "Failed to open serial port" << std::endl;
+			std::cerr << sport.getLastError().toUtf8().data() << std::endl;
+			return -2;
+		}
+
+		QStringList lstPortSettings;
+		lstPortSettings.append(QString("%1").arg(sport.dataBits()));
+		lstPortSettings.append(QString("%1").arg(QChar(sport.parity())));
+		lstPortSettings.append(QString("%1").arg(sport.stopBits()));
+
+		std::cerr << "Serial Port: " << strPort.toUtf8().data() << std::endl;
+		std::cerr << "Baud Rate: " << sport.baudRate() << std::endl;
+		std::cerr << "Port Settings: " << lstPortSettings.join(',').toUtf8().data() << std::endl;
+
+		// The replay has the port's descriptor to itself, as there's
+		//	no event loop running for QSerialPort to read it:
+		bSuccess = replayer.replay(sport.port().handle(), &strError);
+		sport.closePort();
+	}
+
+	std::cerr << replayer.summary().toUtf8().data() << std::endl;
+	if (!bSuccess) {
+		std::cerr << "Replay failed: " << strError.toUtf8().data() << std::endl;
+		return -4;
+	}
+
+	return 0;
+}
+
+// ============================================================================
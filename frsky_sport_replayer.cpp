@@ -0,0 +1,576 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#include "frsky_sport_replayer.h"
+#include "frsky_sport_decoder.h"
+#include "LogFileReader.h"
+
+#include <QFile>
+
+#include <algorithm>
+#include <vector>
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+// ============================================================================
+
+namespace {
+	constexpr int MAX_WRITE_SIZE = 65536;				// Largest single write when untimed
+	constexpr int READ_BUFFER_SIZE = 4096;
+	constexpr int64_t STOP_CHECK_NSECS = 100000000;		// Longest wait before checking for stop()
+
+	int64_t monotonicNsecs()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+	}
+
+	// Text log timestamp, "<msecs>[.<fraction>]":
+	int64_t parseMsecs(const char *p, const char *pEnd)
+	{
+		int64_t nNsecs = 0;
+		while ((p < pEnd) && (*p >= '0') && (*p <= '9')) nNsecs = nNsecs*10 + (*p++ - '0');
+		nNsecs *= 1000000;
+		if ((p < pEnd) && (*p == '.')) {
+			++p;
+			for (int64_t nScale = 100000; (nScale > 0) && (p < pEnd) && (*p >= '0') && (*p <= '9'); nScale /= 10) {
+				nNsecs += (*p++ - '0') * nScale;
+			}
+		}
+		return nNsecs;
+	}
+
+	// Primitives a device sends in response to a poll:
+	bool isPollResponsePrim(uint8_t nPrimId)
+	{
+		return ((nPrimId == PRIM_ID_DATA_FRAME) ||
+				(nPrimId == PRIM_ID_SERVER_RESP_CAL_FRAME) ||
+				(nPrimId == PRIM_ID_DEVICE_PRESENT_FRAME));
+	}
+};
+
+// ============================================================================
+
+CSportReplayer::CSportReplayer()
+	:	m_bStop(false)
+{
+	setByteTime(57600);
+}
+
+CSportReplayer::~CSportReplayer()
+{
+}
+
+void CSportReplayer::setByteTime(int nBaudRate, int nBitsPerByte)
+{
+	m_nByteNsecs = (nBaudRate > 0) ? (static_cast<int64_t>(nBitsPerByte) * 1000000000 / nBaudRate) : 0;
+}
+
+int CSportReplayer::responseCount() const
+{
+	int nCount = m_firmwareResponses.m_arrResponses.size();
+	for (const auto &queue : m_arrPollResponses) nCount += queue.m_arrResponses.size();
+	return nCount;
+}
+
+CSportReplayer::INPUT_FORMAT CSportReplayer::detectFormat(const uchar *pData, qint64 nSize)
+{
+	if ((nSize >= static_cast<qint64>(sizeof(BinaryLog::FILE_MAGIC))) &&
+		(memcmp(pData, BinaryLog::FILE_MAGIC, sizeof(BinaryLog::FILE_MAGIC)) == 0)) return IF_BINLOG;
+	return static_cast<INPUT_FORMAT>(CSportCaptureDecoder::detectFormat(pData, nSize));
+}
+
+QString CSportReplayer::inputFormatName(INPUT_FORMAT nFormat)
+{
+	if (nFormat == IF_BINLOG) return "binary log";
+	return CSportCaptureDecoder::inputFormatName(static_cast<CSportCaptureDecoder::INPUT_FORMAT>(nFormat));
+}
+
+QString CSportReplayer::summary() const
+{
+	QString strSummary = QString("Replayed %1 bytes in %2 passes (%3 msecs), read %4 bytes")
+			.arg(m_stats.m_nBytesWritten)
+			.arg(m_stats.m_nPasses)
+			.arg(m_stats.m_nElapsedNsecs / 1000000)
+			.arg(m_stats.m_nBytesRead);
+	if (m_bOnRequest) {
+		strSummary += QString(", %1 requests, %2 answered, %3 unanswered")
+				.arg(m_stats.m_nRequests)
+				.arg(m_stats.m_nResponses)
+				.arg(m_stats.m_nUnanswered);
+	} else if ((m_nSpeed > SPEED_MAX) && m_stats.m_nEvents) {
+		strSummary += QString(", writes late by %1 usecs avg, %2 usecs max")
+				.arg(static_cast<double>(m_stats.m_nTotalLateNsecs) / m_stats.m_nEvents / 1000.0, 0, 'f', 1)
+				.arg(static_cast<double>(m_stats.m_nMaxLateNsecs) / 1000.0, 0, 'f', 1);
+	}
+	if (m_stats.m_bPeerClosed) strSummary += ", closed by the tool under test";
+	return strSummary;
+}
+
+// ----------------------------------------------------------------------------
+
+bool CSportReplayer::loadCapture(const QString &strFilename, INPUT_FORMAT nFormat, int nPort, QString *pstrError)
+{
+	m_baStream.clear();
+	m_arrEvents.clear();
+	m_nCapturePort = nPort;
+
+	QFile fileInput(strFilename);
+	if (!fileInput.open(QIODevice::ReadOnly)) {
+		if (pstrError) *pstrError = fileInput.errorString();
+		return false;
+	}
+
+	qint64 nFileSize = fileInput.size();
+	const uchar *pFileData = nullptr;
+	if (nFileSize > 0) {
+		pFileData = fileInput.map(0, nFileSize);
+		if (pFileData == nullptr) {
+			if (pstrError) *pstrError = fileInput.errorString();
+			return false;
+		}
+	}
+
+	m_nInputFormat = (nFormat == IF_AUTO) ? detectFormat(pFileData, nFileSize) : nFormat;
+	switch (m_nInputFormat) {
+		case IF_RAW:
+			addStream(0, pFileData, nFileSize);
+			break;
+
+		case IF_PCAPNG:
+		{
+			std::vector<uchar> vecStream;
+			QVector<CSportCaptureDecoder::TPcapSegment> arrSegments;
+			if (!CSportCaptureDecoder::readPcapng(pFileData, nFileSize, vecStream, arrSegments, pstrError)) return false;
+			int64_t nFirstNsecs = -1;
+			int64_t nNextNsecs = 0;			// Time after the previous packet, for packets without timestamps
+			for (int i = 0; i < arrSegments.size(); ++i) {
+				const CSportCaptureDecoder::TPcapSegment &segment = arrSegments.at(i);
+				qint64 nSize = ((i+1 < arrSegments.size()) ? arrSegments.at(i+1).m_nStreamOffset : static_cast<qint64>(vecStream.size())) -
+								segment.m_nStreamOffset;
+				int64_t nTimeNsecs = nNextNsecs;
+				if (segment.m_nTimestampNsecs >= 0) {
+					if (nFirstNsecs < 0) nFirstNsecs = segment.m_nTimestampNsecs;
+					nTimeNsecs = segment.m_nTimestampNsecs - nFirstNsecs;
+				}
+				addStream(nTimeNsecs, vecStream.data() + segment.m_nStreamOffset, nSize);
+				nNextNsecs = nTimeNsecs + nSize * m_nByteNsecs;
+			}
+			break;
+		}
+
+		case IF_TEXTLOG:
+		{
+			const char *pData = reinterpret_cast<const char *>(pFileData);
+			qint64 nLineStart = 0;
+			while (nLineStart < nFileSize) {
+				const void *pFound = memchr(pData + nLineStart, '\n', nFileSize - nLineStart);
+				qint64 nLineEnd = pFound ? (static_cast<const char *>(pFound) - pData) : nFileSize;
+				const char *p = pData + nLineStart;
+				const char *pEnd = pData + nLineEnd;
+				nLineStart = nLineEnd + 1;
+				if ((pEnd > p) && (*(pEnd-1) == '\r')) --pEnd;
+
+				// "<msecs>: <message>"
+				while ((p < pEnd) && (*p == ' ')) ++p;
+				const char *pTime = p;
+				while ((p < pEnd) && (((*p >= '0') && (*p <= '9')) || (*p == '.'))) ++p;
+				if ((p == pTime) || (pEnd - p < 2) || (p[0] != ':') || (p[1] != ' ')) continue;
+				addLogMessage(parseMsecs(pTime, p), p + 2, pEnd);
+			}
+			break;
+		}
+
+		case IF_BINLOG:
+		{
+			CLogFileReader reader;
+			if (!reader.open(strFilename, pstrError)) return false;
+			CLogFileReader::TMessage msg;
+			for (qint64 nOffset = reader.firstMessage(); nOffset >= 0; nOffset = reader.nextMessage(nOffset)) {
+				if (!reader.readMessage(nOffset, msg)) break;
+				if ((msg.m_nLogType != CFrskySportIO::LT_RX) && (msg.m_nLogType != CFrskySportIO::LT_TXPUSH)) continue;
+				addLogMessage(msg.m_nTimestampNsecs, msg.m_baText.constData(), msg.m_baText.constData() + msg.m_baText.size());
+			}
+			break;
+		}
+
+		default:
+			if (pstrError) *pstrError = "Unknown capture format";
+			return false;
+	}
+
+	if (m_arrEvents.isEmpty()) {
+		if (pstrError) {
+			*pstrError = "No device traffic found in the capture";
+			if (nPort >= 0) *pstrError += QString(" for port %1").arg(nPort);
+		}
+		return false;
+	}
+
+	// Times from the first event, never going backwards:
+	int64_t nBaseNsecs = m_arrEvents.first().m_nTimeNsecs;
+	int64_t nPrevNsecs = 0;
+	for (auto &event : m_arrEvents) {
+		event.m_nTimeNsecs = std::max(event.m_nTimeNsecs - nBaseNsecs, nPrevNsecs);
+		nPrevNsecs = event.m_nTimeNsecs;
+	}
+
+	buildResponses();
+
+	return true;
+}
+
+void CSportReplayer::addEvent(int64_t nTimeNsecs, const uchar *pBytes, int nSize)
+{
+	TEvent event;
+	event.m_nTimeNsecs = nTimeNsecs;
+	event.m_nOffset = m_baStream.size();
+	event.m_nSize = nSize;
+	m_arrEvents.append(event);
+	m_baStream.append(reinterpret_cast<const char *>(pBytes), nSize);
+}
+
+void CSportReplayer::addStream(int64_t nTimeNsecs, const uchar *pBytes, qint64 nSize)
+{
+	qint64 nStart = 0;
+	while (nStart < nSize) {
+		const void *pFound = (nSize - nStart > 1) ? memchr(pBytes + nStart + 1, 0x7E, nSize - nStart - 1) : nullptr;
+		qint64 nEnd = pFound ? (static_cast<const uchar *>(pFound) - pBytes) : nSize;
+		addEvent(nTimeNsecs + nStart * m_nByteNsecs, pBytes + nStart, static_cast<int>(nEnd - nStart));
+		nStart = nEnd;
+	}
+}
+
+bool CSportReplayer::addLogMessage(int64_t nTimeNsecs, const char *p, const char *pEnd)
+{
+	CSportCaptureDecoder::TLogMessage msg;
+	if (!CSportCaptureDecoder::parseLogMessage(p, pEnd, msg)) return false;
+	if ((msg.m_nLogType != CFrskySportIO::LT_RX) && (msg.m_nLogType != CFrskySportIO::LT_TXPUSH)) return false;
+	if (msg.m_nBytes == 0) return false;
+	if (m_nCapturePort < 0) m_nCapturePort = msg.m_nPort;
+	if (msg.m_nPort != m_nCapturePort) return false;
+	addEvent(nTimeNsecs, msg.m_arrBytes, msg.m_nBytes);
+	return true;
+}
+
+void CSportReplayer::buildResponses()
+{
+	for (auto &queue : m_arrPollResponses) queue = TResponseQueue();
+	m_firmwareResponses = TResponseQueue();
+	m_nTelemetryFrames = 0;
+
+	const uchar *pData = reinterpret_cast<const uchar *>(m_baStream.constData());
+	int nSize = m_baStream.size();
+	const void *pFound = memchr(pData, 0x7E, nSize);
+	int nStart = pFound ? static_cast<int>(static_cast<const uchar *>(pFound) - pData) : nSize;
+	while (nStart < nSize) {
+		pFound = memchr(pData + nStart + 1, 0x7E, nSize - nStart - 1);
+		int nEnd = pFound ? static_cast<int>(static_cast<const uchar *>(pFound) - pData) : nSize;
+
+		CSportRxBuffer rxBuffer;
+		for (int i = nStart; i < nEnd; ++i) rxBuffer.pushByte(pData[i]);
+
+		// Poll responses are sent after the poll's "0x7E <physical ID>",
+		//	which the tool under test sends itself, but firmware responses
+		//	are complete frames of their own:
+		if (rxBuffer.haveTelemetryPoll()) {
+			m_arrPollResponses[rxBuffer.telemetryPollPacket().getPhysicalId()].m_arrResponses.append({ nStart+2, 0 });
+		} else if (rxBuffer.isFirmwarePacket()) {
+			if (rxBuffer.firmwarePacket().m_physicalId == PHYS_ID_FIRMRSP) {
+				m_firmwareResponses.m_arrResponses.append({ nStart, nEnd-nStart });
+			}
+		} else if (rxBuffer.isTelemetryPacket()) {
+			++m_nTelemetryFrames;
+			const CSportTelemetryPacket &packet = rxBuffer.telemetryPacket();
+			if ((packet.getPhysicalId() < TELEMETRY_PHYS_ID_COUNT) && packet.physicalIdValid() &&
+				isPollResponsePrim(packet.getPrimId())) {
+				m_arrPollResponses[packet.getPhysicalId()].m_arrResponses.append({ nStart+2, nEnd-nStart-2 });
+			}
+		}
+
+		nStart = nEnd;
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+int CSportReplayer::openPty(QString &strSlaveName, QString *pstrError)
+{
+	int fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if ((fd < 0) || (grantpt(fd) != 0) || (unlockpt(fd) != 0) || (ptsname(fd) == nullptr)) {
+		if (pstrError) *pstrError = QString("Failed to create pty: %1").arg(strerror(errno));
+		if (fd >= 0) ::close(fd);
+		return -1;
+	}
+	strSlaveName = QString::fromLocal8Bit(ptsname(fd));
+
+	// Raw mode, so the line discipline passes the bytes through unchanged,
+	//	even before the tool under test sets up the port.  The setting stays
+	//	with the pty while the master is open:
+	int fdSlave = ::open(ptsname(fd), O_RDWR | O_NOCTTY);
+	struct termios tios;
+	bool bRaw = ((fdSlave >= 0) && (tcgetattr(fdSlave, &tios) == 0));
+	if (bRaw) {
+		cfmakeraw(&tios);
+		bRaw = (tcsetattr(fdSlave, TCSANOW, &tios) == 0);
+	}
+	if (!bRaw) {
+		if (pstrError) *pstrError = QString("Failed to set up pty \"%1\": %2").arg(strSlaveName, strerror(errno));
+		if (fdSlave >= 0) ::close(fdSlave);
+		::close(fd);
+		return -1;
+	}
+	::close(fdSlave);
+
+	return fd;
+}
+
+bool CSportReplayer::waitForPeer(int fdPtyMaster)
+{
+	// The master reports a hang-up until the slave is opened again:
+	while (!m_bStop) {
+		struct pollfd pfd;
+		pfd.fd = fdPtyMaster;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		int nResult = poll(&pfd, 1, 0);
+		if ((nResult < 0) && (errno != EINTR)) return false;
+		if ((nResult == 0) || ((nResult > 0) && !(pfd.revents & POLLHUP))) return true;
+		usleep(STOP_CHECK_NSECS / 1000);
+	}
+	return false;
+}
+
+bool CSportReplayer::replay(int fd, QString *pstrError)
+{
+	m_fd = fd;
+	m_stats = TReplayStats();
+	m_strError.clear();
+	m_baInput.clear();
+	m_rxRequest.reset();
+	m_bRequestDone = true;
+	for (auto &queue : m_arrPollResponses) queue.m_nNext = 0;
+	m_firmwareResponses.m_nNext = 0;
+
+	int nFlags = fcntl(fd, F_GETFL);
+	if ((nFlags < 0) || (fcntl(fd, F_SETFL, nFlags | O_NONBLOCK) < 0)) {
+		if (pstrError) *pstrError = QString("Failed to set non-blocking mode: %1").arg(strerror(errno));
+		m_fd = -1;
+		return false;
+	}
+
+	auto fnResponsesLeft = [this]()->bool {
+		if (m_firmwareResponses.m_nNext < m_firmwareResponses.m_arrResponses.size()) return true;
+		for (const auto &queue : m_arrPollResponses) {
+			if (queue.m_nNext < queue.m_arrResponses.size()) return true;
+		}
+		return false;
+	};
+
+	auto fnWaitInput = [this](int64_t nTimeoutNsecs)->bool {
+		int nEvents = waitFd(POLLIN, nTimeoutNsecs);
+		if (nEvents < 0) return false;
+		if (nEvents && (!readInput() || !processInput())) return false;
+		if (nEvents & (POLLHUP | POLLERR | POLLNVAL)) m_stats.m_bPeerClosed = true;
+		return true;
+	};
+
+	int64_t nStartNsecs = monotonicNsecs();
+	bool bSuccess = true;
+	if (m_bOnRequest) {
+		if (responseCount() == 0) {
+			m_strError = "The capture has no responses to replay on request";
+			bSuccess = false;
+		}
+		while (bSuccess && !m_bStop && !m_stats.m_bPeerClosed && (m_bLoop || fnResponsesLeft())) {
+			bSuccess = fnWaitInput(STOP_CHECK_NSECS);
+		}
+		if (bSuccess && !fnResponsesLeft()) ++m_stats.m_nPasses;
+	} else {
+		do {
+			int64_t nPassStartNsecs = monotonicNsecs();
+			if (m_nSpeed <= SPEED_MAX) {
+				// The events are contiguous in m_baStream, so write it in large blocks:
+				for (int nOffset = 0; bSuccess && !m_bStop && !m_stats.m_bPeerClosed && (nOffset < m_baStream.size()); nOffset += MAX_WRITE_SIZE) {
+					bSuccess = writeAll(m_baStream.constData() + nOffset, std::min(MAX_WRITE_SIZE, m_baStream.size() - nOffset)) && processInput();
+				}
+				if (bSuccess && !m_bStop && !m_stats.m_bPeerClosed) m_stats.m_nEvents += m_arrEvents.size();
+			} else {
+				for (int i = 0; bSuccess && !m_bStop && !m_stats.m_bPeerClosed && (i < m_arrEvents.size()); ++i) {
+					const TEvent &event = m_arrEvents.at(i);
+					int64_t nDueNsecs = nPassStartNsecs + static_cast<int64_t>(event.m_nTimeNsecs / m_nSpeed);
+					int64_t nNowNsecs = monotonicNsecs();
+					while (bSuccess && !m_bStop && !m_stats.m_bPeerClosed && (nNowNsecs < nDueNsecs)) {
+						bSuccess = fnWaitInput(std::min(nDueNsecs - nNowNsecs, STOP_CHECK_NSECS));
+						nNowNsecs = monotonicNsecs();
+					}
+					if (!bSuccess || m_bStop || m_stats.m_bPeerClosed) break;
+					m_stats.m_nTotalLateNsecs += nNowNsecs - nDueNsecs;
+					m_stats.m_nMaxLateNsecs = std::max(m_stats.m_nMaxLateNsecs, nNowNsecs - nDueNsecs);
+					bSuccess = writeAll(m_baStream.constData() + event.m_nOffset, event.m_nSize);
+					++m_stats.m_nEvents;
+				}
+			}
+			if (bSuccess && !m_bStop && !m_stats.m_bPeerClosed) ++m_stats.m_nPasses;
+		} while (bSuccess && m_bLoop && !m_bStop && !m_stats.m_bPeerClosed);
+	}
+	m_stats.m_nElapsedNsecs = monotonicNsecs() - nStartNsecs;
+
+	if (!bSuccess && pstrError) *pstrError = m_strError;
+	m_fd = -1;
+	return bSuccess;
+}
+
+// ----------------------------------------------------------------------------
+
+bool CSportReplayer::writeAll(const char *pData, int nSize)
+{
+	while (nSize > 0) {
+		ssize_t nWritten = ::write(m_fd, pData, nSize);
+		if (nWritten > 0) {
+			pData += nWritten;
+			nSize -= static_cast<int>(nWritten);
+			m_stats.m_nBytesWritten += nWritten;
+			continue;
+		}
+		if ((nWritten < 0) && (errno == EINTR)) continue;
+		if ((nWritten < 0) && (errno == EIO)) {
+			m_stats.m_bPeerClosed = true;
+			return true;
+		}
+		if ((nWritten < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+			m_strError = QString("Write failed: %1").arg(strerror(errno));
+			return false;
+		}
+
+		// Full, so wait for room, taking in what the tool under test writes
+		//	meanwhile, so that neither side stalls:
+		int nEvents = waitFd(POLLOUT | POLLIN, STOP_CHECK_NSECS);
+		if (nEvents < 0) return false;
+		if ((nEvents & POLLIN) && !readInput()) return false;
+		if (nEvents & (POLLHUP | POLLERR | POLLNVAL)) {
+			m_stats.m_bPeerClosed = true;
+			return true;
+		}
+		if (m_bStop) return true;
+	}
+	return true;
+}
+
+bool CSportReplayer::readInput()
+{
+	char buf[READ_BUFFER_SIZE];
+	for (;;) {
+		ssize_t nRead = ::read(m_fd, buf, sizeof(buf));
+		if (nRead > 0) {
+			m_baInput.append(buf, static_cast<int>(nRead));
+			m_stats.m_nBytesRead += nRead;
+			continue;
+		}
+		// Note: a tty in raw mode returns 0 when there's nothing to read,
+		//	and a pty master fails with EIO once its slave is closed:
+		if (nRead == 0) return true;
+		if (errno == EINTR) continue;
+		if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) return true;
+		if (errno == EIO) {
+			m_stats.m_bPeerClosed = true;
+			return true;
+		}
+		m_strError = QString("Read failed: %1").arg(strerror(errno));
+		return false;
+	}
+}
+
+bool CSportReplayer::processInput()
+{
+	if (m_baInput.isEmpty()) return true;
+
+	QByteArray baInput;
+	baInput.swap(m_baInput);		// writeAll() can read more into m_baInput
+	if (m_bEcho && !writeAll(baInput.constData(), baInput.size())) return false;
+	if (!m_bOnRequest) return true;
+
+	auto fnAnswerPoll = [this]()->bool {
+		if (m_bRequestDone || !m_rxRequest.haveTelemetryPoll()) return true;
+		m_bRequestDone = true;
+		return respond(m_arrPollResponses[m_rxRequest.telemetryPollPacket().getPhysicalId()]);
+	};
+
+	for (char ch : baInput) {
+		uint8_t nByte = static_cast<uint8_t>(ch);
+		if (nByte == 0x7E) {
+			if (!fnAnswerPoll()) return false;			// A poll is complete when the next frame starts
+			m_bRequestDone = false;
+		}
+		m_rxRequest.pushByte(nByte);
+		if (!m_bRequestDone && m_rxRequest.haveCompletePacket()) {
+			m_bRequestDone = true;
+			if (m_rxRequest.isFirmwarePacket() && (m_rxRequest.firmwarePacket().m_physicalId == PHYS_ID_FIRMCMD)) {
+				if (!respond(m_firmwareResponses)) return false;
+			}
+		}
+	}
+
+	// Polls are written on their own, with the rest of the frame left to
+	//	the device, so one at the end of what's been read is complete:
+	return fnAnswerPoll();
+}
+
+bool CSportReplayer::respond(TResponseQueue &queue)
+{
+	++m_stats.m_nRequests;
+	if (queue.m_nNext >= queue.m_arrResponses.size()) {
+		if (!m_bLoop || queue.m_arrResponses.isEmpty()) {
+			++m_stats.m_nUnanswered;
+			return true;
+		}
+		queue.m_nNext = 0;
+	}
+	const TResponse &response = queue.m_arrResponses.at(queue.m_nNext++);
+	++m_stats.m_nResponses;
+	return writeAll(m_baStream.constData() + response.m_nOffset, response.m_nSize);
+}
+
+int CSportReplayer::waitFd(short nEvents, int64_t nTimeoutNsecs)
+{
+	struct pollfd pfd;
+	pfd.fd = m_fd;
+	pfd.events = nEvents;
+	pfd.revents = 0;
+	struct timespec ts;
+	ts.tv_sec = static_cast<time_t>(nTimeoutNsecs / 1000000000);
+	ts.tv_nsec = static_cast<long>(nTimeoutNsecs % 1000000000);
+	int nResult = ppoll(&pfd, 1, &ts, nullptr);
+	if (nResult > 0) return pfd.revents;
+	if ((nResult == 0) || (errno == EINTR)) return 0;
+	m_strError = QString("Poll failed: %1").arg(strerror(errno));
+	return -1;
+}
+
+// ============================================================================
@@ -0,0 +1,178 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#ifndef FRSKY_SPORT_REPLAYER_H
+#define FRSKY_SPORT_REPLAYER_H
+
+#include "frsky_sport_io.h"
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+
+#include <stdint.h>
+#include <atomic>
+
+// ============================================================================
+
+//
+// Replays a captured Sport session into a serial port or pty as the device
+//	side of the bus, to reproduce field problems against the tool, and as a
+//	regression harness for its receive path.  The capture can be a raw byte
+//	dump of the bus, a pcapng capture of the serial data, or a text or binary
+//	(".slog") log from the tools.  Byte streams are replayed as captured,
+//	timed from the pcapng packet timestamps and the baud rate.  From logs,
+//	only what the logging tool received (its "Recv:" and "Push:" messages on
+//	one port) is replayed, at the times it was logged.
+//
+//	The timing can be scaled (2x, 10x, etc) or dropped to write as fast as
+//	the other side reads.  In on-request mode, nothing is written until the
+//	tool under test asks for it instead: each telemetry poll is answered with
+//	the next response captured for that physical ID (or nothing, if the
+//	captured poll went unanswered), and each firmware command frame with the
+//	next captured firmware response.
+//
+//	replay() is a blocking loop on the file descriptor, timed with ppoll(),
+//	that also reads (and optionally echoes) what the tool under test writes,
+//	so it never stalls on a full pty buffer.
+//
+class CSportReplayer
+{
+public:
+	enum INPUT_FORMAT {			// Same values as CSportCaptureDecoder::INPUT_FORMAT, plus IF_BINLOG
+		IF_AUTO = 0,			// Detect from file content
+		IF_RAW = 1,				// Raw byte dump of the bus
+		IF_PCAPNG = 2,			// pcapng capture of the serial byte stream
+		IF_TEXTLOG = 3,			// CLogFile text log
+		IF_BINLOG = 4,			// CLogFile binary log
+	};
+
+	static constexpr double SPEED_MAX = 0.0;		// setSpeed() value to write without timing
+
+	struct TReplayStats {
+		qint64 m_nEvents = 0;					// Timed writes
+		qint64 m_nBytesWritten = 0;
+		qint64 m_nBytesRead = 0;				// Bytes written by the tool under test
+		qint64 m_nRequests = 0;					// Polls and firmware commands received in on-request mode
+		qint64 m_nResponses = 0;				// Requests answered from the capture (including silent polls)
+		qint64 m_nUnanswered = 0;				// Requests with no captured response left
+		int64_t m_nTotalLateNsecs = 0;			// Total time timed writes were made after their time
+		int64_t m_nMaxLateNsecs = 0;			// Latest a timed write was made
+		int m_nPasses = 0;						// Passes made through the capture
+		bool m_bPeerClosed = false;				// The pty was closed by the tool under test
+		int64_t m_nElapsedNsecs = 0;
+	};
+
+	CSportReplayer();
+	~CSportReplayer();
+
+	// nPort selects the port (or session) of a log with more than one,
+	//	-1 to use the port of the first message replayed:
+	bool loadCapture(const QString &strFilename, INPUT_FORMAT nFormat = IF_AUTO, int nPort = -1, QString *pstrError = nullptr);
+
+	void setByteTime(int nBaudRate, int nBitsPerByte = 10);		// Byte timing of byte streams, set before loadCapture()
+	void setSpeed(double nSpeed) { m_nSpeed = nSpeed; }			// 1.0 = captured timing, SPEED_MAX = untimed
+	void setOnRequest(bool bOnRequest) { m_bOnRequest = bOnRequest; }
+	void setEcho(bool bEcho) { m_bEcho = bEcho; }				// Echo what the tool writes, like a half-duplex bus adapter
+	void setLoop(bool bLoop) { m_bLoop = bLoop; }				// Repeat the capture (or its responses) until stopped
+
+	INPUT_FORMAT inputFormat() const { return m_nInputFormat; }
+	int capturePort() const { return m_nCapturePort; }			// Port replayed from a log, -1 if none
+	int eventCount() const { return m_arrEvents.size(); }
+	qint64 byteCount() const { return m_baStream.size(); }
+	int64_t durationNsecs() const { return m_arrEvents.isEmpty() ? 0 : m_arrEvents.last().m_nTimeNsecs; }
+	int telemetryFrameCount() const { return m_nTelemetryFrames; }	// Complete telemetry frames replayed per pass
+	int responseCount() const;									// Responses available to on-request mode
+
+	// Replays to fd, which is switched to non-blocking, until done, stopped,
+	//	or (on a pty master) the tool under test closes its side:
+	bool replay(int fd, QString *pstrError = nullptr);
+	bool waitForPeer(int fdPtyMaster);		// Waits until the tool under test opens the pty, false if stopped
+	void stop() { m_bStop = true; }			// From any thread
+	bool isStopped() const { return m_bStop; }
+
+	const TReplayStats &stats() const { return m_stats; }
+	QString summary() const;				// Single line summary for display
+
+	// Creates a pty in raw mode, returning the master file descriptor,
+	//	or -1 on error, and the name of the slave for the tool under test:
+	static int openPty(QString &strSlaveName, QString *pstrError = nullptr);
+
+	static INPUT_FORMAT detectFormat(const uchar *pData, qint64 nSize);
+	static QString inputFormatName(INPUT_FORMAT nFormat);
+
+private:
+	struct TEvent {
+		int64_t m_nTimeNsecs;		// Time from the start of the capture
+		int m_nOffset;				// Bytes in m_baStream
+		int m_nSize;
+	};
+
+	struct TResponse {
+		int m_nOffset;				// Bytes in m_baStream
+		int m_nSize;				// 0 for a poll that went unanswered
+	};
+
+	struct TResponseQueue {
+		QVector<TResponse> m_arrResponses;
+		int m_nNext = 0;
+	};
+
+	void addEvent(int64_t nTimeNsecs, const uchar *pBytes, int nSize);
+	void addStream(int64_t nTimeNsecs, const uchar *pBytes, qint64 nSize);	// Split into events at frame starts
+	bool addLogMessage(int64_t nTimeNsecs, const char *p, const char *pEnd);		// Device side messages of m_nCapturePort
+	void buildResponses();
+
+	bool writeAll(const char *pData, int nSize);
+	bool readInput();						// Reads what's available into m_baInput
+	bool processInput();					// Echoes m_baInput and answers its requests
+	bool respond(TResponseQueue &queue);
+	int waitFd(short nEvents, int64_t nTimeoutNsecs);	// ppoll() of m_fd, returns revents, -1 on error
+
+	INPUT_FORMAT m_nInputFormat = IF_AUTO;
+	int m_nCapturePort = -1;
+	int64_t m_nByteNsecs = 0;
+	double m_nSpeed = 1.0;
+	bool m_bOnRequest = false;
+	bool m_bEcho = false;
+	bool m_bLoop = false;
+
+	// Capture, the device side bytes in order and the times to write them:
+	QByteArray m_baStream;
+	QVector<TEvent> m_arrEvents;
+	int m_nTelemetryFrames = 0;
+	TResponseQueue m_arrPollResponses[TELEMETRY_PHYS_ID_COUNT];
+	TResponseQueue m_firmwareResponses;
+
+	// Replay state:
+	std::atomic<bool> m_bStop;
+	int m_fd = -1;
+	QString m_strError;
+	QByteArray m_baInput;					// Bytes read from the tool under test, not yet processed
+	CSportRxBuffer m_rxRequest;				// Request frame from the tool under test
+	bool m_bRequestDone = false;			// Current request frame has been answered
+	TReplayStats m_stats;
+};
+
+// ============================================================================
+
+#endif	// FRSKY_SPORT_REPLAYER_H
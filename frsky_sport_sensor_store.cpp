@@ -0,0 +1,280 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#include "frsky_sport_sensor_store.h"
+
+#include <string.h>
+#include <vector>
+
+// ============================================================================
+
+namespace {
+	// Perfect hash of the DATA_ID types in telemetryDataIDNames(), built
+	//	once by searching for a multiplier that maps every key to its own
+	//	bucket.  Single IDs are keyed by the ID itself and the 16 ID ranges
+	//	by their first ID, so a lookup is at most two probes.  The few wider
+	//	ranges (DIY) don't fit that and are checked directly:
+	class CDataIdHash
+	{
+	public:
+		CDataIdHash()
+		{
+			std::vector<TEntry> arrEntries;
+			const TDataIDNames *pDataIDName = telemetryDataIDNames();
+			for (int nType = 0; pDataIDName->m_nFirstID != 0; ++pDataIDName, ++nType) {
+				if (pDataIDName->m_nFirstID == pDataIDName->m_nLastID) {
+					arrEntries.push_back({ pDataIDName->m_nFirstID, false, static_cast<uint8_t>(nType) });
+				} else if (((pDataIDName->m_nFirstID & 0x000F) == 0) &&
+							(pDataIDName->m_nLastID == (pDataIDName->m_nFirstID | 0x000F))) {
+					arrEntries.push_back({ pDataIDName->m_nFirstID, true, static_cast<uint8_t>(nType) });
+				} else {
+					m_arrWideTypes.push_back(nType);
+				}
+			}
+
+			uint32_t nMultiplier = 0x9E3779B1;
+			for (int nTry = 0; nTry < MAX_TRIES; ++nTry) {
+				for (auto &entry : m_arrTable) entry.m_nType = NO_TYPE;
+				bool bCollision = false;
+				for (auto const &entry : arrEntries) {
+					TEntry &bucket = m_arrTable[hash(entry.m_nKey, nMultiplier)];
+					if (bucket.m_nType != NO_TYPE) {
+						bCollision = true;
+						break;
+					}
+					bucket = entry;
+				}
+				if (!bCollision) {
+					m_nMultiplier = nMultiplier;
+					return;
+				}
+				nMultiplier = (nMultiplier * 1664525u + 1013904223u) | 1u;
+			}
+
+			// No perfect hash found (only if the table outgrows the buckets), so
+			//	fall back to checking every type:
+			m_arrWideTypes.clear();
+			for (auto const &entry : arrEntries) m_arrWideTypes.push_back(entry.m_nType);
+		}
+
+		int find(uint16_t nDataId) const
+		{
+			if (m_nMultiplier) {
+				const TEntry &exact = m_arrTable[hash(nDataId, m_nMultiplier)];
+				if ((exact.m_nType != NO_TYPE) && (exact.m_nKey == nDataId)) return exact.m_nType;
+				uint16_t nRangeKey = (nDataId & 0xFFF0);
+				const TEntry &range = m_arrTable[hash(nRangeKey, m_nMultiplier)];
+				if ((range.m_nType != NO_TYPE) && range.m_bRanged && (range.m_nKey == nRangeKey)) return range.m_nType;
+			}
+			const TDataIDNames *pDataIDNames = telemetryDataIDNames();
+			for (int nType : m_arrWideTypes) {
+				if ((nDataId >= pDataIDNames[nType].m_nFirstID) &&
+					(nDataId <= pDataIDNames[nType].m_nLastID)) return nType;
+			}
+			return -1;
+		}
+
+	private:
+		static constexpr int HASH_BITS = 8;
+		static constexpr int MAX_TRIES = 100000;
+		static constexpr uint8_t NO_TYPE = 0xFF;
+
+		struct TEntry {
+			uint16_t m_nKey;
+			bool m_bRanged;				// Key is the first ID of a 16 ID range
+			uint8_t m_nType;			// Index in telemetryDataIDNames(), NO_TYPE if the bucket is empty
+		};
+
+		static int hash(uint16_t nKey, uint32_t nMultiplier) { return static_cast<int>((nKey * nMultiplier) >> (32 - HASH_BITS)); }
+
+		uint32_t m_nMultiplier = 0;		// 0 if there's no perfect hash
+		TEntry m_arrTable[1 << HASH_BITS];
+		std::vector<int> m_arrWideTypes;
+	};
+
+	const CDataIdHash &dataIdHash()
+	{
+		static const CDataIdHash hash;
+		return hash;
+	}
+};
+
+// ============================================================================
+
+CSportSensorStore::CSportSensorStore()
+	:	m_nDropped(0)
+{
+	for (auto &physIdSlots : m_arrPhysIdSlots) {
+		for (auto &slot : physIdSlots.m_arrSlots) slot.m_nSeq.store(0, std::memory_order_relaxed);
+	}
+	reset();
+	dataIdHash();		// Build it here rather than on the first update
+}
+
+int CSportSensorStore::dataIdType(uint16_t nDataId)
+{
+	return dataIdHash().find(nDataId);
+}
+
+QString CSportSensorStore::dataIdName(uint16_t nDataId)
+{
+	int nType = dataIdType(nDataId);
+	return (nType >= 0) ? telemetryDataIDNames()[nType].m_strName : QString();
+}
+
+int CSportSensorStore::directoryIndex(uint16_t nDataId)
+{
+	int nType = dataIdType(nDataId);
+	return ((nType >= 0) && (nType < DIRECTORY_SIZE-1)) ? nType : (DIRECTORY_SIZE-1);
+}
+
+int CSportSensorStore::findSlot(const TPhysIdSlots &physIdSlots, int nDirectoryIndex, uint16_t nDataId)
+{
+	uint8_t nSlot = physIdSlots.m_arrDirectory[nDirectoryIndex].load(std::memory_order_acquire);
+	while (nSlot != NO_SLOT) {
+		const TSlot &slot = physIdSlots.m_arrSlots[nSlot];
+		if (slot.m_nDataId.load(std::memory_order_relaxed) == nDataId) return nSlot;
+		nSlot = slot.m_nNextSlot.load(std::memory_order_relaxed);
+	}
+	return -1;
+}
+
+// ----------------------------------------------------------------------------
+
+void CSportSensorStore::update(const CSportTelemetryPacket &packet, int64_t nNowNsecs)
+{
+	if (packet.getPrimId() != PRIM_ID_DATA_FRAME) return;
+	uint8_t nPhysId = packet.getPhysicalId();
+	uint16_t nDataId = packet.getDataId();
+	if ((nPhysId >= TELEMETRY_PHYS_ID_COUNT) || (nDataId == 0)) return;
+
+	TPhysIdSlots &physIdSlots = m_arrPhysIdSlots[nPhysId];
+	int nDirectoryIndex = directoryIndex(nDataId);
+	int nSlot = findSlot(physIdSlots, nDirectoryIndex, nDataId);
+	bool bNewSlot = (nSlot < 0);
+	if (bNewSlot) {
+		nSlot = physIdSlots.m_nSlotCount.load(std::memory_order_relaxed);
+		if (nSlot >= SLOTS_PER_PHYS_ID) {
+			m_nDropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+	}
+
+	TSlot &slot = physIdSlots.m_arrSlots[nSlot];
+	uint32_t nSeq = slot.m_nSeq.load(std::memory_order_relaxed);
+	slot.m_nSeq.store(nSeq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	TSensorValue &value = slot.m_value;
+	int32_t nSignedValue = static_cast<int32_t>(packet.getValue());
+	if (bNewSlot) {
+		value = TSensorValue();
+		value.m_nPhysicalId = nPhysId;
+		value.m_nDataId = nDataId;
+		value.m_nMinValue = nSignedValue;
+		value.m_nMaxValue = nSignedValue;
+	} else {
+		int64_t nIntervalNsecs = nNowNsecs - value.m_nTimestampNsecs;
+		if (value.m_nAvgIntervalNsecs == 0) {
+			value.m_nAvgIntervalNsecs = nIntervalNsecs;
+		} else {
+			value.m_nAvgIntervalNsecs += (nIntervalNsecs - value.m_nAvgIntervalNsecs) / (1 << RATE_AVERAGE_SHIFT);
+		}
+		if (nSignedValue < value.m_nMinValue) value.m_nMinValue = nSignedValue;
+		if (nSignedValue > value.m_nMaxValue) value.m_nMaxValue = nSignedValue;
+	}
+	value.m_nValue = packet.getValue();
+	value.m_nTimestampNsecs = nNowNsecs;
+	++value.m_nUpdateCount;
+
+	slot.m_nSeq.store(nSeq + 2, std::memory_order_release);
+
+	if (bNewSlot) {
+		// Link it in, publishing it to readers last:
+		slot.m_nDataId.store(nDataId, std::memory_order_relaxed);
+		slot.m_nNextSlot.store(physIdSlots.m_arrDirectory[nDirectoryIndex].load(std::memory_order_relaxed), std::memory_order_relaxed);
+		physIdSlots.m_arrDirectory[nDirectoryIndex].store(static_cast<uint8_t>(nSlot), std::memory_order_release);
+		physIdSlots.m_nSlotCount.store(nSlot + 1, std::memory_order_release);
+	}
+}
+
+void CSportSensorStore::reset()
+{
+	for (auto &physIdSlots : m_arrPhysIdSlots) {
+		physIdSlots.m_nSlotCount.store(0, std::memory_order_release);
+		for (auto &nSlot : physIdSlots.m_arrDirectory) nSlot.store(NO_SLOT, std::memory_order_release);
+		for (auto &slot : physIdSlots.m_arrSlots) {
+			slot.m_nDataId.store(0, std::memory_order_relaxed);
+			slot.m_nNextSlot.store(NO_SLOT, std::memory_order_relaxed);
+		}
+	}
+	m_nDropped.store(0, std::memory_order_relaxed);
+}
+
+// ----------------------------------------------------------------------------
+
+void CSportSensorStore::readSlot(const TSlot &slot, TSensorValue &value)
+{
+	uint32_t nSeq;
+	do {
+		while ((nSeq = slot.m_nSeq.load(std::memory_order_acquire)) & 1) { }		// Writer is mid-update
+		memcpy(&value, &slot.m_value, sizeof(value));
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while (slot.m_nSeq.load(std::memory_order_relaxed) != nSeq);
+}
+
+bool CSportSensorStore::value(uint8_t nPhysicalId, uint16_t nDataId, TSensorValue &value) const
+{
+	if (nPhysicalId >= TELEMETRY_PHYS_ID_COUNT) return false;
+	const TPhysIdSlots &physIdSlots = m_arrPhysIdSlots[nPhysicalId];
+	int nSlot = findSlot(physIdSlots, directoryIndex(nDataId), nDataId);
+	if (nSlot < 0) return false;
+	readSlot(physIdSlots.m_arrSlots[nSlot], value);
+	return true;
+}
+
+QVector<CSportSensorStore::TSensorValue> CSportSensorStore::snapshot() const
+{
+	QVector<TSensorValue> arrValues;
+	arrValues.reserve(sensorCount());
+	for (auto const &physIdSlots : m_arrPhysIdSlots) {
+		int nCount = physIdSlots.m_nSlotCount.load(std::memory_order_acquire);
+		for (int nSlot = 0; nSlot < nCount; ++nSlot) {
+			TSensorValue value;
+			readSlot(physIdSlots.m_arrSlots[nSlot], value);
+			arrValues.append(value);
+		}
+	}
+	return arrValues;
+}
+
+int CSportSensorStore::sensorCount() const
+{
+	int nCount = 0;
+	for (auto const &physIdSlots : m_arrPhysIdSlots) {
+		nCount += physIdSlots.m_nSlotCount.load(std::memory_order_acquire);
+	}
+	return nCount;
+}
+
+// ============================================================================
+
@@ -0,0 +1,113 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#ifndef FRSKY_SPORT_SENSOR_STORE_H
+#define FRSKY_SPORT_SENSOR_STORE_H
+
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+
+#include <stdint.h>
+
+#include "frsky_sport_io.h"
+
+// ============================================================================
+
+//
+// Last-value table of the telemetry sensors seen on the bus, so consumers
+//	don't each have to parse the received packets to know the current state
+//	of the bus.  It's a flat array of sensor slots for each physical ID,
+//	found through a per-ID directory indexed by the DATA_ID's type (its
+//	entry in telemetryDataIDNames(), looked up with a perfect hash built
+//	once from that table).  Slots are only ever added, so the table never
+//	allocates after construction.
+//
+// There's a single writer, update(), called from the telemetry receive
+//	path.  Every slot is guarded by a sequence lock, so value() and
+//	snapshot() can be called from any thread without blocking the writer,
+//	retrying instead if they catch a slot mid-update.  reset() must only be
+//	called from the writer's thread.
+//
+class CSportSensorStore
+{
+public:
+	static constexpr int SLOTS_PER_PHYS_ID = 16;		// Distinct DATA_IDs tracked for each physical ID, extra ones are dropped
+	static constexpr int DIRECTORY_SIZE = 96;			// DATA_ID types with their own directory entry, the last entry is shared by unknown types and any beyond it
+	static constexpr int RATE_AVERAGE_SHIFT = 3;		// Update interval is averaged over about 2^N updates
+
+	struct TSensorValue {
+		uint8_t m_nPhysicalId = 0;
+		uint16_t m_nDataId = 0;
+		uint32_t m_nValue = 0;					// Last raw value
+		int32_t m_nMinValue = 0;				// Minimum and maximum of the values, taken as signed
+		int32_t m_nMaxValue = 0;
+		int64_t m_nTimestampNsecs = 0;			// Time of the last update, on the caller's time base
+		int64_t m_nAvgIntervalNsecs = 0;		// Average time between updates, 0 until there have been two
+		uint32_t m_nUpdateCount = 0;
+
+		double updateRate() const { return m_nAvgIntervalNsecs ? (1.0e9 / m_nAvgIntervalNsecs) : 0.0; }	// Updates per second
+		QString name() const { return dataIdName(m_nDataId); }
+	};
+
+	CSportSensorStore();
+
+	// Writer:
+	void update(const CSportTelemetryPacket &packet, int64_t nNowNsecs);	// Only data frames for telemetry physical IDs are stored
+	void reset();
+
+	// Readers:
+	bool value(uint8_t nPhysicalId, uint16_t nDataId, TSensorValue &value) const;	// Returns false if this sensor hasn't been seen
+	QVector<TSensorValue> snapshot() const;		// All sensors seen, ordered by physical ID and then first seen
+	int sensorCount() const;
+	uint32_t droppedCount() const { return m_nDropped.load(std::memory_order_relaxed); }		// Updates lost because a physical ID had no free slots
+
+	static int dataIdType(uint16_t nDataId);	// Index of nDataId's entry in telemetryDataIDNames(), or -1 if unknown
+	static QString dataIdName(uint16_t nDataId);
+
+private:
+	static constexpr uint8_t NO_SLOT = 0xFF;
+
+	struct TSlot {
+		std::atomic<uint32_t> m_nSeq;			// Sequence lock, odd while being written
+		std::atomic<uint16_t> m_nDataId;		// DATA_ID this slot holds, constant once the slot is in use
+		std::atomic<uint8_t> m_nNextSlot;		// Next slot with the same DATA_ID type, or NO_SLOT
+		TSensorValue m_value;
+	};
+	struct TPhysIdSlots {
+		std::atomic<int> m_nSlotCount;			// Slots in use, published after the slot is initialised
+		TSlot m_arrSlots[SLOTS_PER_PHYS_ID];
+		std::atomic<uint8_t> m_arrDirectory[DIRECTORY_SIZE];	// First slot for each DATA_ID type, or NO_SLOT
+	};
+
+	static int directoryIndex(uint16_t nDataId);
+	static int findSlot(const TPhysIdSlots &physIdSlots, int nDirectoryIndex, uint16_t nDataId);
+	static void readSlot(const TSlot &slot, TSensorValue &value);
+
+	TPhysIdSlots m_arrPhysIdSlots[TELEMETRY_PHYS_ID_COUNT];
+	std::atomic<uint32_t> m_nDropped;
+};
+
+// ============================================================================
+
+#endif	// FRSKY_SPORT_SENSOR_STORE_H
@@ -0,0 +1,225 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#ifndef FRSKY_SPORT_SHM_H
+#define FRSKY_SPORT_SHM_H
+
+/*
+ * Layout of the shared memory that CSportShmPublisher publishes received
+ *	telemetry in, and functions for reading it.  This is plain C (C99), so
+ *	other programs can include it on its own, without Qt or the rest of the
+ *	tool, and read the telemetry with no system calls after mapping it:
+ *
+ *		size_t nSize;
+ *		struct frsky_shm_header *pShm = frsky_shm_map("/frsky_sport1", &nSize);
+ *		struct frsky_shm_sensor sensor;
+ *		struct frsky_shm_frame frame;
+ *		if (frsky_shm_find_sensor(pShm, 0x00, 0x0100, &sensor)) ...	// Last altitude from physical ID 0x00
+ *		frsky_shm_ring_attach(pShm);
+ *		while (frsky_shm_ring_pop(pShm, &frame)) ...					// Each frame since attaching
+ *		frsky_shm_unmap(pShm, nSize);
+ *
+ *	The sensor table holds the last value of each DATA_ID on each physical
+ *	ID, like CSportSensorStore, in slots that are only ever added.  Each slot
+ *	is guarded by a sequence lock, so any number of readers can read it
+ *	without blocking the publisher.  The frame ring is every telemetry frame
+ *	received with a good CRC, in order, for one reader at a time: it's a
+ *	single producer, single consumer ring, whose reader position is kept
+ *	here too.  When the ring is full, new frames are dropped (and counted),
+ *	so a reader that stops reading only loses frames itself.
+ *
+ *	Times are CLOCK_MONOTONIC nanoseconds.  Physical IDs are the 5-bit IDs,
+ *	without their CRC bits.  The memory is removed when the publisher
+ *	closes, and a new one created if it starts again, so a reader that
+ *	outlives the publisher should map it again when publisher_pid changes.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define FRSKY_SHM_LOAD_RELAXED(p)		__atomic_load_n((p), __ATOMIC_RELAXED)
+#define FRSKY_SHM_LOAD_ACQUIRE(p)		__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define FRSKY_SHM_STORE_RELAXED(p, v)	__atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define FRSKY_SHM_STORE_RELEASE(p, v)	__atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define FRSKY_SHM_FENCE_ACQUIRE()		__atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define FRSKY_SHM_FENCE_RELEASE()		__atomic_thread_fence(__ATOMIC_RELEASE)
+#else
+#error "frsky_sport_shm.h needs the GCC/Clang __atomic builtins"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ======================================================================== */
+
+#define FRSKY_SHM_MAGIC					"FRSKYSHM"
+#define FRSKY_SHM_VERSION				1
+#define FRSKY_SHM_PHYS_ID_COUNT			28		/* Telemetry physical IDs, 0x00-0x1B */
+#define FRSKY_SHM_SLOTS_PER_PHYS_ID		16		/* Sensors (DATA_IDs) kept for each physical ID */
+
+struct frsky_shm_sensor {					/* 24 bytes */
+	uint32_t seq;							/* Sequence lock, odd while the slot is being written */
+	uint16_t data_id;
+	uint8_t phys_id;
+	uint8_t reserved;
+	uint32_t value;							/* Last raw value */
+	uint32_t update_count;
+	int64_t timestamp_ns;					/* Time of the last update */
+};
+
+struct frsky_shm_frame {					/* 16 bytes */
+	int64_t timestamp_ns;					/* Time received */
+	uint8_t phys_id;
+	uint8_t prim_id;
+	uint16_t data_id;
+	uint32_t value;
+};
+
+struct frsky_shm_header {
+	char magic[8];							/* FRSKY_SHM_MAGIC, set last by the publisher */
+	uint32_t version;						/* FRSKY_SHM_VERSION */
+	uint32_t header_size;					/* sizeof(struct frsky_shm_header), where the ring's frames start */
+	uint32_t ring_size;						/* Frames in the ring, a power of two */
+	uint32_t publisher_pid;
+	uint64_t sensor_dropped;				/* Sensor updates lost because their physical ID had no free slot */
+	uint8_t slot_count[FRSKY_SHM_PHYS_ID_COUNT];	/* Slots in use for each physical ID, set after the slot is */
+	uint8_t reserved0[4];
+	/* Publisher's side of the ring, on its own cache line: */
+	uint64_t ring_head;						/* Frames written */
+	uint64_t ring_dropped;					/* Frames dropped because the ring was full */
+	uint8_t reserved1[48];
+	/* Reader's side of the ring: */
+	uint64_t ring_tail;						/* Frames read */
+	uint8_t reserved2[56];
+	struct frsky_shm_sensor sensors[FRSKY_SHM_PHYS_ID_COUNT][FRSKY_SHM_SLOTS_PER_PHYS_ID];
+	/* Followed by struct frsky_shm_frame frames[ring_size] */
+};
+
+static inline struct frsky_shm_frame *frsky_shm_frames(struct frsky_shm_header *shm)
+{
+	return (struct frsky_shm_frame *)((char *)shm + shm->header_size);
+}
+
+static inline size_t frsky_shm_size(uint32_t ring_size)
+{
+	return sizeof(struct frsky_shm_header) + ring_size * sizeof(struct frsky_shm_frame);
+}
+
+/* ======================================================================== */
+
+/* Maps the named shared memory (like "/frsky_sport1"), returning NULL if it
+ *	doesn't exist or isn't the expected layout.  It's mapped writable, since
+ *	the ring's reader position is kept in it: */
+static inline struct frsky_shm_header *frsky_shm_map(const char *name, size_t *size)
+{
+	struct frsky_shm_header *shm;
+	struct stat st;
+	int fd = shm_open(name, O_RDWR, 0);
+	if (fd < 0) return NULL;
+	if ((fstat(fd, &st) < 0) || (st.st_size < (off_t)sizeof(struct frsky_shm_header))) {
+		close(fd);
+		return NULL;
+	}
+	shm = (struct frsky_shm_header *)mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shm == (struct frsky_shm_header *)MAP_FAILED) return NULL;
+	FRSKY_SHM_FENCE_ACQUIRE();
+	if ((memcmp(shm->magic, FRSKY_SHM_MAGIC, sizeof(shm->magic)) != 0) ||
+		(shm->version != FRSKY_SHM_VERSION) ||
+		(shm->header_size != sizeof(struct frsky_shm_header)) ||
+		((size_t)st.st_size < frsky_shm_size(shm->ring_size))) {
+		munmap(shm, (size_t)st.st_size);
+		return NULL;
+	}
+	*size = (size_t)st.st_size;
+	return shm;
+}
+
+static inline void frsky_shm_unmap(struct frsky_shm_header *shm, size_t size)
+{
+	munmap(shm, size);
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* Reads a consistent copy of a sensor slot, returning 0 if the slot isn't
+ *	in use.  Slots are filled in order for each physical ID: */
+static inline int frsky_shm_read_sensor(const struct frsky_shm_header *shm, unsigned phys_id, unsigned slot,
+										struct frsky_shm_sensor *sensor)
+{
+	const struct frsky_shm_sensor *src;
+	uint32_t seq;
+	if ((phys_id >= FRSKY_SHM_PHYS_ID_COUNT) || (slot >= FRSKY_SHM_LOAD_ACQUIRE(&shm->slot_count[phys_id]))) return 0;
+	src = &shm->sensors[phys_id][slot];
+	do {
+		while ((seq = FRSKY_SHM_LOAD_ACQUIRE(&src->seq)) & 1) { }		/* Publisher is mid-update */
+		memcpy(sensor, src, sizeof(*sensor));
+		FRSKY_SHM_FENCE_ACQUIRE();
+	} while (FRSKY_SHM_LOAD_RELAXED(&src->seq) != seq);
+	return 1;
+}
+
+/* Finds and reads the sensor for a DATA_ID, returning 0 if it hasn't been
+ *	received: */
+static inline int frsky_shm_find_sensor(const struct frsky_shm_header *shm, unsigned phys_id, uint16_t data_id,
+										struct frsky_shm_sensor *sensor)
+{
+	unsigned slot;
+	for (slot = 0; frsky_shm_read_sensor(shm, phys_id, slot, sensor); ++slot) {
+		if (sensor->data_id == data_id) return 1;
+	}
+	return 0;
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* Starts reading the ring from the next frame received, skipping any frames
+ *	left unread by a previous reader: */
+static inline void frsky_shm_ring_attach(struct frsky_shm_header *shm)
+{
+	FRSKY_SHM_STORE_RELEASE(&shm->ring_tail, FRSKY_SHM_LOAD_ACQUIRE(&shm->ring_head));
+}
+
+/* Reads the next frame from the ring, returning 0 if there isn't one: */
+static inline int frsky_shm_ring_pop(struct frsky_shm_header *shm, struct frsky_shm_frame *frame)
+{
+	uint64_t tail = FRSKY_SHM_LOAD_RELAXED(&shm->ring_tail);
+	if (tail == FRSKY_SHM_LOAD_ACQUIRE(&shm->ring_head)) return 0;
+	*frame = frsky_shm_frames(shm)[tail & (shm->ring_size - 1)];
+	FRSKY_SHM_STORE_RELEASE(&shm->ring_tail, tail + 1);
+	return 1;
+}
+
+/* ======================================================================== */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* FRSKY_SPORT_SHM_H */
@@ -0,0 +1,261 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#include "frsky_sport_shm_publisher.h"
+
+#include <QtGlobal>
+
+#ifdef Q_OS_UNIX
+#include "frsky_sport_shm.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#endif
+
+// ============================================================================
+
+#ifdef Q_OS_UNIX
+
+// Check that the layout is the same as the header says, for the readers:
+static_assert(sizeof(frsky_shm_sensor) == 24, "frsky_shm_sensor layout is broken!");
+static_assert(sizeof(frsky_shm_frame) == 16, "frsky_shm_frame layout is broken!");
+static_assert(offsetof(frsky_shm_header, ring_head) == 64, "frsky_shm_header layout is broken!");
+static_assert(offsetof(frsky_shm_header, ring_tail) == 128, "frsky_shm_header layout is broken!");
+static_assert((sizeof(frsky_shm_header) % 64) == 0, "frsky_shm_header layout is broken!");
+static_assert(FRSKY_SHM_PHYS_ID_COUNT == TELEMETRY_PHYS_ID_COUNT, "frsky_shm_header layout is broken!");
+
+namespace {
+	int64_t monotonicNsecs()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+	}
+
+	// Process ID of the publisher of an existing shared memory, if that
+	//	process is still running, or zero if there's none or it's stale.
+	//	One without a valid header is taken as stale, as is one from a
+	//	process that's gone (kill() with no signal just checks for it):
+	pid_t livePublisherPid(const char *pName)
+	{
+		size_t nSize = 0;
+		frsky_shm_header *pShm = frsky_shm_map(pName, &nSize);
+		if (pShm == nullptr) return 0;
+		pid_t nPid = static_cast<pid_t>(pShm->publisher_pid);
+		frsky_shm_unmap(pShm, nSize);
+		if (nPid <= 0) return 0;
+		if ((kill(nPid, 0) < 0) && (errno == ESRCH)) return 0;
+		return nPid;
+	}
+};
+
+CSportShmPublisher::CSportShmPublisher()
+{
+}
+
+CSportShmPublisher::~CSportShmPublisher()
+{
+	close();
+}
+
+bool CSportShmPublisher::open(const QString &strName, int nRingSize, QString *pstrError)
+{
+	close();
+
+	uint32_t nRing = 2;
+	while (nRing < static_cast<uint32_t>(nRingSize)) nRing <<= 1;
+
+	QString strShmName = strName.startsWith('/') ? strName : (QString("/") + strName);
+	QByteArray baName = strShmName.toLocal8Bit();
+	size_t nSize = frsky_shm_size(nRing);
+
+	// Replace a stale one from a publisher that didn't close, but never
+	//	take the name from one that's still running, which would orphan
+	//	its readers:
+	pid_t nLivePid = livePublisherPid(baName.constData());
+	if (nLivePid != 0) {
+		if (pstrError) *pstrError = QString("Shared memory \"%1\" is in use by process %2").arg(strShmName).arg(nLivePid);
+		return false;
+	}
+	shm_unlink(baName.constData());
+	int fd = shm_open(baName.constData(), O_RDWR | O_CREAT | O_EXCL, 0660);
+	if (fd < 0) {
+		if (pstrError) *pstrError = QString("Failed to create shared memory \"%1\": %2").arg(strShmName, strerror(errno));
+		return false;
+	}
+	void *pMem = MAP_FAILED;
+	if (ftruncate(fd, static_cast<off_t>(nSize)) == 0) {
+		pMem = mmap(nullptr, nSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	int nError = errno;
+	::close(fd);
+	if (pMem == MAP_FAILED) {
+		if (pstrError) *pstrError = QString("Failed to map shared memory \"%1\": %2").arg(strShmName, strerror(nError));
+		shm_unlink(baName.constData());
+		return false;
+	}
+
+	// Note: ftruncate() zero fills it, which is the state of an empty
+	//	table and ring, so just the header remains:
+	m_pShm = static_cast<frsky_shm_header *>(pMem);
+	m_pShm->version = FRSKY_SHM_VERSION;
+	m_pShm->header_size = sizeof(frsky_shm_header);
+	m_pShm->ring_size = nRing;
+	m_pShm->publisher_pid = static_cast<uint32_t>(getpid());
+	FRSKY_SHM_FENCE_RELEASE();
+	memcpy(m_pShm->magic, FRSKY_SHM_MAGIC, sizeof(m_pShm->magic));
+
+	m_pFrames = frsky_shm_frames(m_pShm);
+	m_nSize = nSize;
+	m_nRingMask = nRing - 1;
+	m_strName = strShmName;
+	return true;
+}
+
+void CSportShmPublisher::close()
+{
+	if (m_pShm == nullptr) return;
+	munmap(m_pShm, m_nSize);
+	shm_unlink(m_strName.toLocal8Bit().constData());
+	m_pShm = nullptr;
+	m_pFrames = nullptr;
+	m_nSize = 0;
+	m_strName.clear();
+}
+
+// ----------------------------------------------------------------------------
+
+void CSportShmPublisher::publish(const CSportTelemetryPacket &packet)
+{
+	if (m_pShm == nullptr) return;
+	int64_t nNowNsecs = monotonicNsecs();
+	uint8_t nPhysId = packet.getPhysicalId();
+	uint16_t nDataId = packet.getDataId();
+
+	// Frame ring:
+	uint64_t nHead = FRSKY_SHM_LOAD_RELAXED(&m_pShm->ring_head);
+	if ((nHead - FRSKY_SHM_LOAD_ACQUIRE(&m_pShm->ring_tail)) > m_nRingMask) {
+		FRSKY_SHM_STORE_RELAXED(&m_pShm->ring_dropped, m_pShm->ring_dropped + 1);
+	} else {
+		frsky_shm_frame &frame = m_pFrames[nHead & m_nRingMask];
+		frame.timestamp_ns = nNowNsecs;
+		frame.phys_id = nPhysId;
+		frame.prim_id = packet.getPrimId();
+		frame.data_id = nDataId;
+		frame.value = packet.getValue();
+		FRSKY_SHM_STORE_RELEASE(&m_pShm->ring_head, nHead + 1);
+	}
+
+	// Sensor table, only data frames, like CSportSensorStore:
+	if ((packet.getPrimId() != PRIM_ID_DATA_FRAME) || (nPhysId >= TELEMETRY_PHYS_ID_COUNT) || (nDataId == 0)) return;
+
+	frsky_shm_sensor *arrSensors = m_pShm->sensors[nPhysId];
+	int nSlotCount = m_pShm->slot_count[nPhysId];		// Only written here
+	int nSlot = 0;
+	while ((nSlot < nSlotCount) && (arrSensors[nSlot].data_id != nDataId)) ++nSlot;
+	bool bNewSlot = (nSlot == nSlotCount);
+	if (bNewSlot && (nSlotCount >= FRSKY_SHM_SLOTS_PER_PHYS_ID)) {
+		FRSKY_SHM_STORE_RELAXED(&m_pShm->sensor_dropped, m_pShm->sensor_dropped + 1);
+		return;
+	}
+
+	frsky_shm_sensor &sensor = arrSensors[nSlot];
+	uint32_t nSeq = sensor.seq;
+	FRSKY_SHM_STORE_RELAXED(&sensor.seq, nSeq + 1);
+	FRSKY_SHM_FENCE_RELEASE();
+	if (bNewSlot) {
+		sensor.data_id = nDataId;
+		sensor.phys_id = nPhysId;
+	}
+	sensor.value = packet.getValue();
+	++sensor.update_count;
+	sensor.timestamp_ns = nNowNsecs;
+	FRSKY_SHM_STORE_RELEASE(&sensor.seq, nSeq + 2);
+
+	// A new slot is published to readers last:
+	if (bNewSlot) FRSKY_SHM_STORE_RELEASE(&m_pShm->slot_count[nPhysId], static_cast<uint8_t>(nSlotCount + 1));
+}
+
+// ----------------------------------------------------------------------------
+
+uint64_t CSportShmPublisher::framesPublished() const
+{
+	return m_pShm ? FRSKY_SHM_LOAD_RELAXED(&m_pShm->ring_head) : 0;
+}
+
+uint64_t CSportShmPublisher::framesDropped() const
+{
+	return m_pShm ? FRSKY_SHM_LOAD_RELAXED(&m_pShm->ring_dropped) : 0;
+}
+
+uint64_t CSportShmPublisher::sensorsDropped() const
+{
+	return m_pShm ? FRSKY_SHM_LOAD_RELAXED(&m_pShm->sensor_dropped) : 0;
+}
+
+#else	// !Q_OS_UNIX
+
+CSportShmPublisher::CSportShmPublisher()
+{
+}
+
+CSportShmPublisher::~CSportShmPublisher()
+{
+}
+
+bool CSportShmPublisher::open(const QString &strName, int nRingSize, QString *pstrError)
+{
+	Q_UNUSED(strName);
+	Q_UNUSED(nRingSize);
+	if (pstrError) *pstrError = "Shared memory publishing needs POSIX shared memory, which isn't available on this platform";
+	return false;
+}
+
+void CSportShmPublisher::close()
+{
+}
+
+void CSportShmPublisher::publish(const CSportTelemetryPacket &packet)
+{
+	Q_UNUSED(packet);
+}
+
+uint64_t CSportShmPublisher::framesPublished() const
+{
+	return 0;
+}
+
+uint64_t CSportShmPublisher::framesDropped() const
+{
+	return 0;
+}
+
+uint64_t CSportShmPublisher::sensorsDropped() const
+{
+	return 0;
+}
+
+#endif	// Q_OS_UNIX
+
+// ============================================================================
@@ -0,0 +1,84 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#ifndef FRSKY_SPORT_SHM_PUBLISHER_H
+#define FRSKY_SPORT_SHM_PUBLISHER_H
+
+#include "frsky_sport_io.h"
+
+#include <QString>
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Forward Declarations
+struct frsky_shm_header;
+struct frsky_shm_frame;
+
+// ============================================================================
+
+//
+// Publishes received telemetry in POSIX shared memory, for other programs
+//	on the machine to read without any sockets or serialisation: a sequence
+//	locked last-value table of the sensors and a ring of the frames.  The
+//	layout, and the functions for reading it, are in frsky_sport_shm.h,
+//	which is plain C for use outside of this tool.
+//
+// Fed from CFrskySportDeviceTelemetry (see setShmPublisher()), with every
+//	telemetry packet received with a good CRC.  There's a single writer, so
+//	only one telemetry handler at a time may publish to it.  Only available
+//	on platforms with POSIX shared memory, open() fails on others.
+//
+class CSportShmPublisher
+{
+public:
+	static constexpr int DEFAULT_RING_SIZE = 4096;		// Frames in the ring, several seconds of a busy bus
+
+	CSportShmPublisher();
+	~CSportShmPublisher();
+
+	// Creates the shared memory, replacing any left by a publisher that
+	//	didn't close it, but failing if its publisher is still running.
+	//	Names are like "/frsky_sport1", a leading "/" is added if missing.
+	//	nRingSize is rounded up to a power of two:
+	bool open(const QString &strName, int nRingSize = DEFAULT_RING_SIZE, QString *pstrError = nullptr);
+	void close();						// Removes the shared memory
+	bool isOpen() const { return (m_pShm != nullptr); }
+	QString name() const { return m_strName; }
+
+	void publish(const CSportTelemetryPacket &packet);
+
+	uint64_t framesPublished() const;	// Frames written to the ring
+	uint64_t framesDropped() const;		// Frames dropped because the ring's reader fell behind (or there's no reader)
+	uint64_t sensorsDropped() const;	// Sensor updates dropped because their physical ID had no free slot
+
+private:
+	frsky_shm_header *m_pShm = nullptr;
+	frsky_shm_frame *m_pFrames = nullptr;
+	size_t m_nSize = 0;
+	uint32_t m_nRingMask = 0;
+	QString m_strName;
+};
+
+// ============================================================================
+
+#endif	// FRSKY_SPORT_SHM_PUBLISHER_H
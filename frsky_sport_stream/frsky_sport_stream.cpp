@@ -0,0 +1,549 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#include <PersistentSettings.h>
+#include <frsky_sport_io.h>
+#include <frsky_sport_telemetry.h>
+#include <frsky_sport_stream_server.h>
+
+#include <QCoreApplication>
+#include <QSerialPort>
+#include <QTcpSocket>
+#include <QUdpSocket>
+#include <QHostInfo>
+#include <QTimer>
+#include <QFile>
+#include <QElapsedTimer>
+#include <QStringList>
+
+#include <iostream>
+#include <algorithm>
+#include <ctime>
+
+#include <version.h>
+
+// ============================================================================
+
+namespace {
+	constexpr int REPORT_INTERVAL = 1000;		// Msecs between client rate reports
+
+	QString cpuSummary(std::clock_t nCpuTicks, qint64 nElapsedMsecs)
+	{
+		double nCpuMsecs = 1000.0 * nCpuTicks / CLOCKS_PER_SEC;
+		return QString("CPU: %1 msecs (%2%)")
+				.arg(nCpuMsecs, 0, 'f', 0)
+				.arg(100.0 * nCpuMsecs / std::max<qint64>(nElapsedMsecs, 1), 0, 'f', 1);
+	}
+
+	// ------------------------------------------------------------------------
+
+	struct TClientStats {
+		qint64 m_nMessages = 0;
+		qint64 m_nFrames = 0;
+		qint64 m_nBytes = 0;				// Including the TCP framing
+		qint64 m_nLost = 0;					// Messages missing from the sequence (lost datagrams)
+		qint64 m_nDropped = 0;				// Frames the server reported dropping
+		qint64 m_nErrors = 0;				// Messages that couldn't be decoded
+
+		QString rates(const TClientStats &prev, qint64 nMsecs) const
+		{
+			double nSecs = std::max<qint64>(nMsecs, 1) / 1000.0;
+			qint64 nFrames = m_nFrames - prev.m_nFrames;
+			qint64 nBytes = m_nBytes - prev.m_nBytes;
+			return QString("%1 frames/sec, %2 messages/sec, %3 bytes/sec (%4 bytes/frame), %5 lost, %6 dropped")
+					.arg(static_cast<qint64>(nFrames / nSecs))
+					.arg(static_cast<qint64>((m_nMessages - prev.m_nMessages) / nSecs))
+					.arg(static_cast<qint64>(nBytes / nSecs))
+					.arg(nFrames ? (static_cast<double>(nBytes) / nFrames) : 0.0, 0, 'f', 1)
+					.arg(m_nLost - prev.m_nLost)
+					.arg(m_nDropped - prev.m_nDropped);
+		}
+	};
+
+	// Receives the stream as a subscriber, for testing the server and
+	//	measuring what it sustains, optionally writing the frames out:
+	class CStreamClient
+	{
+	public:
+		explicit CStreamClient(QIODevice *pCsvOutput)
+			:	m_pCsvOutput(pCsvOutput)
+		{
+			if (m_pCsvOutput) m_pCsvOutput->write("time_ms,port,phys_id,prim,data_id,value\n");
+		}
+
+		// Returns false if the server rejected the subscription:
+		bool processMessage(const QByteArray &baMessage, int nFramingBytes = 0)
+		{
+			QString strError;
+			m_stats.m_nBytes += baMessage.size() + nFramingBytes;
+			if (!CSportStreamCodec::decodeMessage(baMessage, m_message, &strError)) {
+				++m_stats.m_nErrors;
+				if (m_stats.m_nErrors == 1) std::cerr << "Invalid message: " << strError.toUtf8().data() << std::endl;
+				return true;
+			}
+			if (m_message.m_nType == SportStream::SMT_ERROR) {
+				std::cerr << "Server error: " << m_message.m_strText.toUtf8().data() << std::endl;
+				return false;
+			}
+			if (m_message.m_nType != SportStream::SMT_FRAMES) return true;
+
+			++m_stats.m_nMessages;
+			if (m_message.m_nSequence > m_nNextSequence) m_stats.m_nLost += m_message.m_nSequence - m_nNextSequence;
+			m_nNextSequence = m_message.m_nSequence + 1;
+			m_stats.m_nDropped += m_message.m_nDropped;
+			m_stats.m_nFrames += m_message.m_arrFrames.size();
+
+			if (m_pCsvOutput) {
+				QByteArray baLines;
+				for (const TSportStreamFrame &frame : m_message.m_arrFrames) {
+					baLines.append(QString("%1,%2,%3,%4,%5,%6\n")
+									.arg(frame.m_nTimeNsecs / 1000000.0, 0, 'f', 3)
+									.arg(m_message.m_nSport + 1)
+									.arg(frame.m_nPhysId)
+									.arg(frame.m_nPrimId)
+									.arg(frame.m_nDataId)
+									.arg(frame.m_nValue).toUtf8());
+				}
+				m_pCsvOutput->write(baLines);
+			}
+			return true;
+		}
+
+		const TClientStats &stats() const { return m_stats; }
+
+	private:
+		QIODevice *m_pCsvOutput;
+		TSportStreamMessage m_message;
+		uint64_t m_nNextSequence = 0;
+		TClientStats m_stats;
+	};
+
+	// ------------------------------------------------------------------------
+
+	int runClient(QCoreApplication &app, const QString &strServer, bool bUdp, const QString &strFilter,
+					const QString &strCsvFile, int nRunSecs)
+	{
+		QString strHost = "localhost";
+		QString strPort = strServer;
+		int nColon = strServer.lastIndexOf(':');
+		if (nColon >= 0) {
+			strHost = strServer.left(nColon);
+			strPort = strServer.mid(nColon+1);
+		}
+		bool bOK = false;
+		quint16 nPort = strPort.toUShort(&bOK);
+		if (!bOK || (nPort == 0)) {
+			std::cerr << "Invalid server port \"" << strPort.toUtf8().data() << "\"" << std::endl;
+			return -1;
+		}
+		QHostInfo hostInfo = QHostInfo::fromName(strHost);
+		if (hostInfo.addresses().isEmpty()) {
+			std::cerr << "Failed to find host \"" << strHost.toUtf8().data() << "\": " << hostInfo.errorString().toUtf8().data() << std::endl;
+			return -2;
+		}
+		// The server listens on IPv4, so prefer that for names like "localhost":
+		QHostAddress address = hostInfo.addresses().first();
+		for (const QHostAddress &addr : hostInfo.addresses()) {
+			if (addr.protocol() == QAbstractSocket::IPv4Protocol) {
+				address = addr;
+				break;
+			}
+		}
+
+		QFile fileCsv;
+		if (!strCsvFile.isEmpty()) {
+			bool bOpened;
+			if (strCsvFile == "-") {
+				bOpened = fileCsv.open(stdout, QIODevice::WriteOnly);
+			} else {
+				fileCsv.setFileName(strCsvFile);
+				bOpened = fileCsv.open(QIODevice::WriteOnly);
+			}
+			if (!bOpened) {
+				std::cerr << "Failed to open \"" << strCsvFile.toUtf8().data() << "\" for writing" << std::endl;
+				return -3;
+			}
+		}
+
+		std::cerr << "Server: " << address.toString().toUtf8().data() << ":" << nPort << (bUdp ? " (UDP)" : " (TCP)") << std::endl;
+		if (!strFilter.isEmpty()) std::cerr << "Filter: " << strFilter.toUtf8().data() << std::endl;
+
+		CStreamClient client(fileCsv.isOpen() ? &fileCsv : nullptr);
+		QTcpSocket socketTcp;
+		QUdpSocket socketUdp;
+		QTimer tmrRenew;
+		QByteArray baStream;
+		int nResult = 0;
+
+		if (bUdp) {
+			if (!socketUdp.bind()) {
+				std::cerr << "Failed to bind UDP socket: " << socketUdp.errorString().toUtf8().data() << std::endl;
+				return -4;
+			}
+			QObject::connect(&socketUdp, &QUdpSocket::readyRead, &app, [&]()->void {
+				while (socketUdp.hasPendingDatagrams()) {
+					QByteArray baMessage;
+					baMessage.resize(static_cast<int>(qMax<qint64>(socketUdp.pendingDatagramSize(), 0)));
+					qint64 nSize = socketUdp.readDatagram(baMessage.data(), baMessage.size());
+					if (nSize < 0) break;
+					baMessage.resize(static_cast<int>(nSize));
+					if (!client.processMessage(baMessage)) {
+						nResult = -5;
+						app.quit();
+					}
+				}
+			});
+			// The subscription has to be renewed to keep it:
+			QObject::connect(&tmrRenew, &QTimer::timeout, &app, [&]()->void {
+				socketUdp.writeDatagram(CSportStreamCodec::subscribeMessage(strFilter), address, nPort);
+			});
+			socketUdp.writeDatagram(CSportStreamCodec::subscribeMessage(strFilter), address, nPort);
+			tmrRenew.start(SportStream::SUBSCRIPTION_TIMEOUT/4);
+		} else {
+			QObject::connect(&socketTcp, &QTcpSocket::readyRead, &app, [&]()->void {
+				baStream.append(socketTcp.readAll());
+				QByteArray baMessage;
+				bool bError = false;
+				int nStreamSize = baStream.size();
+				while (CSportStreamCodec::takeStreamMessage(baStream, baMessage, bError)) {
+					int nFramingBytes = nStreamSize - baStream.size() - baMessage.size();
+					nStreamSize = baStream.size();
+					if (!client.processMessage(baMessage, nFramingBytes)) {
+						nResult = -5;
+						app.quit();
+					}
+				}
+				if (bError) {
+					std::cerr << "Corrupt stream from server" << std::endl;
+					nResult = -6;
+					app.quit();
+				}
+			});
+			QObject::connect(&socketTcp, &QTcpSocket::disconnected, &app, [&]()->void {
+				std::cerr << "Server closed the connection" << std::endl;
+				app.quit();
+			});
+			QObject::connect(&socketTcp, &QTcpSocket::errorOccurred, &app, [&](QAbstractSocket::SocketError nError)->void {
+				if (nError == QAbstractSocket::RemoteHostClosedError) return;		// Reported by disconnected
+				std::cerr << "Connection error: " << socketTcp.errorString().toUtf8().data() << std::endl;
+				nResult = -4;
+				app.quit();
+			});
+			socketTcp.connectToHost(address, nPort);
+			if (!strFilter.isEmpty()) {
+				QByteArray baSubscribe;
+				CSportStreamCodec::appendStreamMessage(baSubscribe, CSportStreamCodec::subscribeMessage(strFilter));
+				socketTcp.write(baSubscribe);		// Buffered until connected
+			}
+		}
+
+		QElapsedTimer tmrElapsed;
+		tmrElapsed.start();
+		std::clock_t nCpuStart = std::clock();
+
+		QTimer tmrReport;
+		TClientStats statsLast;
+		qint64 nLastMsecs = 0;
+		QObject::connect(&tmrReport, &QTimer::timeout, &app, [&]()->void {
+			qint64 nMsecs = tmrElapsed.elapsed();
+			std::cerr << client.stats().rates(statsLast, nMsecs - nLastMsecs).toUtf8().data() << std::endl;
+			statsLast = client.stats();
+			nLastMsecs = nMsecs;
+		});
+		tmrReport.start(REPORT_INTERVAL);
+		if (nRunSecs > 0) QTimer::singleShot(nRunSecs*1000, &app, &QCoreApplication::quit);
+
+		app.exec();
+
+		qint64 nElapsedMsecs = tmrElapsed.elapsed();
+		std::clock_t nCpuTicks = std::clock() - nCpuStart;
+		if (bUdp) {
+			socketUdp.writeDatagram(CSportStreamCodec::unsubscribeMessage(), address, nPort);
+		}
+		fileCsv.close();
+
+		const TClientStats &stats = client.stats();
+		std::cerr << "Received " << stats.m_nFrames << " frames in " << stats.m_nMessages << " messages, "
+					<< stats.m_nBytes << " bytes, in " << nElapsedMsecs << " msecs" << std::endl;
+		std::cerr << "Average: " << client.stats().rates(TClientStats(), nElapsedMsecs).toUtf8().data() << std::endl;
+		if (stats.m_nErrors) std::cerr << "*** " << stats.m_nErrors << " invalid messages" << std::endl;
+		std::cerr << "Client " << cpuSummary(nCpuTicks, nElapsedMsecs).toUtf8().data() << std::endl;
+		if ((nResult == 0) && (stats.m_nLost || stats.m_nDropped)) nResult = -7;
+		return nResult;
+	}
+
+	// ------------------------------------------------------------------------
+
+	int runServer(QCoreApplication &app, CFrskySportIO &sport, quint16 nStreamPort, int nBatchInterval, int nRunSecs)
+	{
+		CFrskySportDeviceTelemetry telemetry(sport);
+		CSportStreamServer server;
+		server.setBatchInterval(nBatchInterval);
+		QString strError;
+		if (!server.listen(nStreamPort, QHostAddress(QHostAddress::LocalHost), &strError)) {
+			std::cerr << strError.toUtf8().data() << std::endl;
+			return -3;
+		}
+		telemetry.setStreamQueue(&server.queue());
+		std::cerr << "Stream Port: " << server.port() << " (TCP and UDP)" << std::endl;
+		std::cerr << "Batch Interval: " << nBatchInterval << " msecs" << std::endl;
+
+		QObject::connect(&server, &CSportStreamServer::subscriberAdded, &app, [](const QString &strSubscriber)->void {
+			std::cerr << strSubscriber.toUtf8().data() << ": Subscribed" << std::endl;
+		});
+		QObject::connect(&server, &CSportStreamServer::subscriberRemoved, &app, [](const QString &strSubscriber, const QString &strSummary)->void {
+			std::cerr << strSubscriber.toUtf8().data() << ": Unsubscribed, " << strSummary.toUtf8().data() << std::endl;
+		});
+		// Exit if the adapter is unplugged:
+		QObject::connect(&sport.port(), &QSerialPort::errorOccurred, &app, [&app, &sport](QSerialPort::SerialPortError nError)->void {
+			if (nError != QSerialPort::ResourceError) return;
+			std::cerr << "Serial port error: " << sport.port().errorString().toUtf8().data() << std::endl;
+			app.exit(-4);
+		});
+		if (nRunSecs > 0) QTimer::singleShot(nRunSecs*1000, &app, &QCoreApplication::quit);
+
+		QElapsedTimer tmrElapsed;
+		tmrElapsed.start();
+		std::clock_t nCpuStart = std::clock();
+
+		int nResult = app.exec();
+
+		qint64 nElapsedMsecs = tmrElapsed.elapsed();
+		std::clock_t nCpuTicks = std::clock() - nCpuStart;
+		telemetry.setStreamQueue(nullptr);
+		std::cerr << server.summary().toUtf8().data() << std::endl;
+		server.stop();
+		std::cerr << telemetry.busStatsSummary().toUtf8().data() << std::endl;
+		std::cerr << "Server " << cpuSummary(nCpuTicks, nElapsedMsecs).toUtf8().data() << std::endl;
+		return nResult;
+	}
+};
+
+// ============================================================================
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	QString strREV = GIT_REV;
+	QString strTAG = GIT_TAG;
+	QString strBRANCH = GIT_BRANCH;
+
+	QString strVersion;
+	if (!strTAG.isEmpty()) {
+		strVersion = strTAG;
+	} else {
+		strVersion = QString("%1/%2").arg(strBRANCH, strREV);
+	}
+
+	app.setApplicationVersion(strVersion);
+	app.setApplicationName("frsky_sport_tool");		// Note: use package name here instead of this app so we can use its common settings
+	app.setOrganizationName("Dewtronics");
+	app.setOrganizationDomain("dewtronics.com");
+
+	CPersistentSettings::instance()->loadSettings();
+
+	SPORT_ID_ENUM nSport = CPersistentSettings::instance()->getDataConfigSportPort();
+	QString strPort = CPersistentSettings::instance()->getDeviceSerialPort(nSport);
+	bool bHavePortNameSetting =!strPort.isEmpty();
+	int nBaudRate = CPersistentSettings::instance()->getDeviceBaudRate(nSport);
+	int nDataBits = CPersistentSettings::instance()->getDeviceDataBits(nSport);
+	char chParity = CPersistentSettings::instance()->getDeviceParity(nSport);
+	int nStopBits = CPersistentSettings::instance()->getDeviceStopBits(nSport);
+	int nStreamPort = CPersistentSettings::instance()->getDataConfigStreamPort();
+	if (nStreamPort <= 0) nStreamPort = CSportStreamServer::DEFAULT_PORT;
+	int nBatchInterval = CSportStreamServer::DEFAULT_BATCH_INTERVAL;
+	int nRunSecs = 0;
+	bool bClient = false;
+	bool bUdp = false;
+	QString strFilter;
+	QString strCsvFile;
+	QString strServer;
+	bool bNeedUsage = false;
+	int nArgsFound = 0;
+
+	QStringList lstDefaultPortSettings;
+	lstDefaultPortSettings.append(QString("%1").arg(nDataBits));
+	lstDefaultPortSettings.append(QString("%1").arg(QChar(chParity)));
+	lstDefaultPortSettings.append(QString("%1").arg(nStopBits));
+
+	for (int ndx = 1; ndx < argc; ++ndx) {
+		QString strArg = argv[ndx];
+		if (!strArg.startsWith("-")) {
+			switch (nArgsFound) {
+				case 0:
+					strPort = strArg;
+					strServer = strArg;
+					break;
+				default:
+					bNeedUsage = true;
+					break;
+			}
+			++nArgsFound;
+		} else if (strArg.startsWith("-b")) {
+			if ((strArg == "-b") && (argc > ndx+1)) {
+				nBaudRate = strtoul(argv[ndx+1], nullptr, 0);
+				++ndx;
+			} else {
+				nBaudRate = strtoul(strArg.mid(2).toUtf8().data(), nullptr, 0);
+			}
+		} else if (strArg.startsWith("-s")) {
+			QString strPortSettings;
+			if ((strArg == "-s") && (argc > ndx+1)) {
+				strPortSettings = argv[ndx+1];
+				++ndx;
+			} else {
+				strPortSettings = strArg.mid(2);
+			}
+			QStringList lstPortSettings = strPortSettings.split(",", Qt::KeepEmptyParts);
+			if (lstPortSettings.size() >= 1) {
+				nDataBits = strtoul(lstPortSettings.at(0).toUtf8().data(), nullptr, 0);
+			}
+			if (lstPortSettings.size() >= 2) {
+				if (lstPortSettings.at(1).size() > 0) chParity = lstPortSettings.at(1).toUpper().at(0).toLatin1();
+			}
+			if (lstPortSettings.size() >= 3) {
+				nStopBits = strtoul(lstPortSettings.at(2).toUtf8().data(), nullptr, 0);
+			}
+		} else if (strArg.startsWith("-p")) {
+			if ((strArg == "-p") && (argc > ndx+1)) {
+				nStreamPort = strtoul(argv[ndx+1], nullptr, 0);
+				++ndx;
+			} else {
+				nStreamPort = strtoul(strArg.mid(2).toUtf8().data(), nullptr, 0);
+			}
+		} else if (strArg.startsWith("-i")) {
+			if ((strArg == "-i") && (argc > ndx+1)) {
+				nBatchInterval = strtoul(argv[ndx+1], nullptr, 0);
+				++ndx;
+			} else {
+				nBatchInterval = strtoul(strArg.mid(2).toUtf8().data(), nullptr, 0);
+			}
+		} else if (strArg.startsWith("-t")) {
+			if ((strArg == "-t") && (argc > ndx+1)) {
+				nRunSecs = strtoul(argv[ndx+1], nullptr, 0);
+				++ndx;
+			} else {
+				nRunSecs = strtoul(strArg.mid(2).toUtf8().data(), nullptr, 0);
+			}
+		} else if (strArg.startsWith("-f")) {
+			if ((strArg == "-f") && (argc > ndx+1)) {
+				strFilter = argv[ndx+1];
+				++ndx;
+			} else {
+				strFilter = strArg.mid(2);
+			}
+		} else if (strArg.startsWith("-o")) {
+			if ((strArg == "-o") && (argc > ndx+1)) {
+				strCsvFile = argv[ndx+1];
+				++ndx;
+			} else {
+				strCsvFile = strArg.mid(2);
+			}
+		} else if (strArg == "-c") {
+			bClient = true;
+		} else if (strArg == "-u") {
+			bUdp = true;
+		} else {
+			bNeedUsage = true;
+		}
+	}
+	if (bClient) {
+		if (strServer.isEmpty()) strServer = QString::number(nStreamPort);
+	} else {
+		if (strPort.isEmpty() || (nStreamPort <= 0) || (nStreamPort > 65535) || (nBatchInterval <= 0)) bNeedUsage = true;
+	}
+
+	if (bNeedUsage) {
+		std::cerr << "Frsky Sport Telemetry Stream Server and Client" << std::endl;
+		std::cerr << "Version: " << strVersion.toUtf8().data() << std::endl << std::endl;
+		if (bHavePortNameSetting) {
+			std::cerr << "Usage: frsky_sport_stream [options] [<port>]" << std::endl;
+		} else {
+			std::cerr << "Usage: frsky_sport_stream [options] <port>" << std::endl;
+		}
+		std::cerr << "   or: frsky_sport_stream -c [options] [[<host>:]<stream-port>]" << std::endl;
+		std::cerr << std::endl;
+		std::cerr << "Monitors the telemetry on a serial port and streams it to subscribers" << std::endl;
+		std::cerr << "on a local TCP and UDP port.  With \"-c\", subscribes to a stream instead," << std::endl;
+		std::cerr << "reporting the rate received each second, for testing the server's load." << std::endl;
+		std::cerr << "The client exits with -7 if any frames were lost or dropped." << std::endl;
+		std::cerr << std::endl;
+		std::cerr << "Where:" << std::endl;
+		std::cerr << "    <port> = Serial Port to use ";
+		if (bHavePortNameSetting) {
+			std::cerr	<< "(Optional, will use current setting"  << std::endl
+						<< "             of \"" << CPersistentSettings::instance()->getDeviceSerialPort(nSport).toUtf8().data() << "\" if not specified)" << std::endl;
+		} else {
+			std::cerr << "(required)" << std::endl;
+		}
+		std::cerr << "    <host>:<stream-port> = server to subscribe to with \"-c\"" << std::endl;
+		std::cerr << "                    (if omitted, will use localhost and the \"-p\" port)" << std::endl;
+		std::cerr << std::endl;
+		std::cerr << "Options:" << std::endl;
+		std::cerr << "    -b <baudrate> = optional baud-rate specifier" << std::endl;
+		std::cerr << "                    (if omitted, will use the current setting of " << CPersistentSettings::instance()->getDeviceBaudRate(nSport) << ")" << std::endl;
+		std::cerr << "    -s <port-settings> = where port-settings is a comma separated list of" << std::endl;
+		std::cerr << "                    \"DataBit,Parity,StopBit\", such as \"8,E,2\"" << std::endl;
+		std::cerr << "                    If omitted, will use current setting of \"" << lstDefaultPortSettings.join(',').toUtf8().data() << "\"" << std::endl;
+		std::cerr << "    -p <stream-port> = TCP and UDP port to stream on" << std::endl;
+		std::cerr << "                    (if omitted, will use the GUI's setting, or " << CSportStreamServer::DEFAULT_PORT << ")" << std::endl;
+		std::cerr << "    -i <batch-msecs> = time between batches of frames sent (if omitted, will" << std::endl;
+		std::cerr << "                    use " << CSportStreamServer::DEFAULT_BATCH_INTERVAL << ")" << std::endl;
+		std::cerr << "    -t <secs>     = exit after this time (default 0 = run until stopped)" << std::endl;
+		std::cerr << std::endl;
+		std::cerr << "Client Options:" << std::endl;
+		std::cerr << "    -c            = subscribe to a stream, instead of serving one" << std::endl;
+		std::cerr << "    -u            = subscribe with UDP instead of TCP" << std::endl;
+		std::cerr << "    -f <filter>   = subscribe only to the frames passing this filter, such as" << std::endl;
+		std::cerr << "                    \"phys=0x00-0x03;data=0x0100\" (same syntax as the log filter)" << std::endl;
+		std::cerr << "    -o <csv-file> = write the frames received to this file as CSV (\"-\" for" << std::endl;
+		std::cerr << "                    stdout)" << std::endl;
+		std::cerr << std::endl << std::endl;
+
+		return -1;
+	}
+
+	std::cerr << "frsky_sport_stream version: " << strVersion.toUtf8().data() << std::endl;
+
+	if (bClient) return runClient(app, strServer, bUdp, strFilter, strCsvFile, nRunSecs);
+
+	CFrskySportIO sport(nSport);
+	if (!sport.openPort(strPort, nBaudRate, nDataBits, chParity, nStopBits)) {
+		std::cerr << "Failed to open serial port" << std::endl;
+		std::cerr << sport.getLastError().toUtf8().data() << std::endl;
+		return -2;
+	}
+
+	QStringList lstPortSettings;
+	lstPortSettings.append(QString("%1").arg(sport.dataBits()));
+	lstPortSettings.append(QString("%1").arg(QChar(sport.parity())));
+	lstPortSettings.append(QString("%1").arg(sport.stopBits()));
+
+	std::cerr << "Serial Port: " << strPort.toUtf8().data() << std::endl;
+	std::cerr << "Baud Rate: " << sport.baudRate() << std::endl;
+	std::cerr << "Port Settings: " << lstPortSettings.join(',').toUtf8().data() << std::endl;
+
+	return runServer(app, sport, static_cast<quint16>(nStreamPort), nBatchInterval, nRunSecs);
+}
+
+// ============================================================================
@@ -0,0 +1,229 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#include "frsky_sport_stream_protocol.h"
+
+#include <QtEndian>
+
+// ============================================================================
+
+namespace {
+	constexpr int MAX_VARINT_SIZE = 10;					// Bytes of a 64-bit varint
+	constexpr int MAX_FRAME_SIZE = MAX_VARINT_SIZE + 8;	// Encoded frame with its largest time delta
+
+	void appendText(QByteArray &baData, const QString &strText)
+	{
+		QByteArray baText = strText.toUtf8();
+		CSportStreamCodec::appendVarint(baData, baText.size());
+		baData.append(baText);
+	}
+
+	bool readText(const uint8_t *&pData, const uint8_t *pEnd, QString &strText)
+	{
+		uint64_t nSize;
+		if (!CSportStreamCodec::readVarint(pData, pEnd, nSize) || (nSize > static_cast<uint64_t>(pEnd - pData))) return false;
+		strText = QString::fromUtf8(reinterpret_cast<const char *>(pData), static_cast<int>(nSize));
+		pData += nSize;
+		return true;
+	}
+
+	QByteArray messageStart(SportStream::STREAM_MESSAGE_TYPE nType)
+	{
+		QByteArray baMessage;
+		baMessage.append(static_cast<char>(SportStream::PROTOCOL_VERSION));
+		baMessage.append(static_cast<char>(nType));
+		return baMessage;
+	}
+};
+
+// ============================================================================
+
+void CSportStreamCodec::appendVarint(QByteArray &baData, uint64_t nValue)
+{
+	while (nValue >= 0x80) {
+		baData.append(static_cast<char>((nValue & 0x7F) | 0x80));
+		nValue >>= 7;
+	}
+	baData.append(static_cast<char>(nValue));
+}
+
+bool CSportStreamCodec::readVarint(const uint8_t *&pData, const uint8_t *pEnd, uint64_t &nValue)
+{
+	nValue = 0;
+	for (int nShift = 0; (pData < pEnd) && (nShift < 64); nShift += 7) {
+		uint8_t nByte = *pData++;
+		nValue |= static_cast<uint64_t>(nByte & 0x7F) << nShift;
+		if ((nByte & 0x80) == 0) return true;
+	}
+	return false;
+}
+
+// ----------------------------------------------------------------------------
+
+int CSportStreamCodec::appendFramesMessage(QByteArray &baData, SPORT_ID_ENUM nSport, uint64_t nSequence, uint64_t nDropped,
+											const TSportStreamFrame *pFrames, int nCount, int nMaxSize)
+{
+	int nStart = baData.size();
+	baData.append(static_cast<char>(SportStream::PROTOCOL_VERSION));
+	baData.append(static_cast<char>(SportStream::SMT_FRAMES));
+	baData.append(static_cast<char>(nSport));
+	appendVarint(baData, nSequence);
+	appendVarint(baData, nDropped);
+	int64_t nLastUsecs = (nCount ? (pFrames[0].m_nTimeNsecs / 1000) : 0);
+	appendVarint(baData, nLastUsecs);
+
+	int ndx = 0;
+	for ( ; ndx < nCount; ++ndx) {
+		if ((ndx > 0) && ((baData.size() - nStart + MAX_FRAME_SIZE) > nMaxSize)) break;
+		const TSportStreamFrame &frame = pFrames[ndx];
+		int64_t nUsecs = frame.m_nTimeNsecs / 1000;
+		appendVarint(baData, (nUsecs > nLastUsecs) ? (nUsecs - nLastUsecs) : 0);
+		nLastUsecs = nUsecs;
+		char arrFields[8];
+		arrFields[0] = static_cast<char>(frame.m_nPhysId);
+		arrFields[1] = static_cast<char>(frame.m_nPrimId);
+		qToLittleEndian<quint16>(frame.m_nDataId, arrFields+2);
+		qToLittleEndian<quint32>(frame.m_nValue, arrFields+4);
+		baData.append(arrFields, sizeof(arrFields));
+	}
+	return ndx;
+}
+
+QByteArray CSportStreamCodec::subscribeMessage(const QString &strFilter)
+{
+	QByteArray baMessage = messageStart(SportStream::SMT_SUBSCRIBE);
+	appendText(baMessage, strFilter);
+	return baMessage;
+}
+
+QByteArray CSportStreamCodec::unsubscribeMessage()
+{
+	return messageStart(SportStream::SMT_UNSUBSCRIBE);
+}
+
+QByteArray CSportStreamCodec::errorMessage(const QString &strError)
+{
+	QByteArray baMessage = messageStart(SportStream::SMT_ERROR);
+	appendText(baMessage, strError);
+	return baMessage;
+}
+
+// ----------------------------------------------------------------------------
+
+bool CSportStreamCodec::decodeMessage(const QByteArray &baMessage, TSportStreamMessage &message, QString *pstrError)
+{
+	const uint8_t *pData = reinterpret_cast<const uint8_t *>(baMessage.constData());
+	const uint8_t *pEnd = pData + baMessage.size();
+
+	if (baMessage.size() < 2) {
+		if (pstrError) *pstrError = "Truncated message";
+		return false;
+	}
+	if (pData[0] != SportStream::PROTOCOL_VERSION) {
+		if (pstrError) *pstrError = QString("Unsupported protocol version %1").arg(pData[0]);
+		return false;
+	}
+	message.m_nType = static_cast<SportStream::STREAM_MESSAGE_TYPE>(pData[1]);
+	pData += 2;
+	message.m_arrFrames.clear();
+	message.m_strText.clear();
+
+	bool bValid = true;
+	switch (message.m_nType) {
+		case SportStream::SMT_FRAMES:
+		{
+			uint64_t nUsecs;
+			bValid = ((pData < pEnd) && (*pData < SPIDE_COUNT));
+			if (bValid) message.m_nSport = static_cast<SPORT_ID_ENUM>(*pData++);
+			bValid = bValid && readVarint(pData, pEnd, message.m_nSequence) &&
+						readVarint(pData, pEnd, message.m_nDropped) &&
+						readVarint(pData, pEnd, nUsecs);
+			while (bValid && (pData < pEnd)) {
+				uint64_t nDeltaUsecs;
+				bValid = readVarint(pData, pEnd, nDeltaUsecs) && ((pEnd - pData) >= 8);
+				if (!bValid) break;
+				nUsecs += nDeltaUsecs;
+				TSportStreamFrame frame;
+				frame.m_nTimeNsecs = static_cast<int64_t>(nUsecs) * 1000;
+				frame.m_nPhysId = pData[0];
+				frame.m_nPrimId = pData[1];
+				frame.m_nDataId = qFromLittleEndian<quint16>(pData+2);
+				frame.m_nValue = qFromLittleEndian<quint32>(pData+4);
+				pData += 8;
+				message.m_arrFrames.append(frame);
+			}
+			break;
+		}
+
+		case SportStream::SMT_SUBSCRIBE:
+		case SportStream::SMT_ERROR:
+			bValid = readText(pData, pEnd, message.m_strText);
+			break;
+
+		case SportStream::SMT_UNSUBSCRIBE:
+			break;
+
+		default:
+			if (pstrError) *pstrError = QString("Unknown message type %1").arg(message.m_nType);
+			return false;
+	}
+
+	if (!bValid) {
+		if (pstrError) *pstrError = "Truncated message";
+		return false;
+	}
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+void CSportStreamCodec::appendStreamMessage(QByteArray &baStream, const QByteArray &baMessage)
+{
+	appendVarint(baStream, baMessage.size());
+	baStream.append(baMessage);
+}
+
+bool CSportStreamCodec::takeStreamMessage(QByteArray &baStream, QByteArray &baMessage, bool &bError)
+{
+	const uint8_t *pData = reinterpret_cast<const uint8_t *>(baStream.constData());
+	const uint8_t *pEnd = pData + baStream.size();
+	uint64_t nSize;
+
+	bError = false;
+	if (!readVarint(pData, pEnd, nSize)) {
+		// Incomplete, unless it's already longer than any valid length:
+		bError = (baStream.size() >= MAX_VARINT_SIZE);
+		return false;
+	}
+	if (nSize > static_cast<uint64_t>(SportStream::MAX_MESSAGE_SIZE)) {
+		bError = true;
+		return false;
+	}
+	if (nSize > static_cast<uint64_t>(pEnd - pData)) return false;
+
+	int nHeader = static_cast<int>(pData - reinterpret_cast<const uint8_t *>(baStream.constData()));
+	baMessage = baStream.mid(nHeader, static_cast<int>(nSize));
+	baStream.remove(0, nHeader + static_cast<int>(nSize));
+	return true;
+}
+
+// ============================================================================
@@ -0,0 +1,180 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#ifndef FRSKY_SPORT_STREAM_PROTOCOL_H
+#define FRSKY_SPORT_STREAM_PROTOCOL_H
+
+#include "frsky_sport_io.h"
+#include "SpscRingBuffer.h"
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QElapsedTimer>
+
+#include <stdint.h>
+
+// ============================================================================
+
+//
+// Wire format of the telemetry stream served by CSportStreamServer.  Each
+//	message starts with the protocol version and message type bytes.  Over
+//	UDP, a message is one datagram.  Over TCP, each message is preceded by
+//	its length as a varint.  Varints are unsigned LEB128 (7 bits a byte,
+//	low bits first), and fixed size fields are little endian:
+//
+//	SMT_FRAMES (server to subscriber), a batch of frames from one port:
+//		u8		port (0 = Sport #1)
+//		varint	sequence number of the message to this subscriber, from 0,
+//				so lost datagrams show up as gaps
+//		varint	frames dropped for this subscriber since its last message,
+//				because the server or the subscriber fell behind
+//		varint	time of the first frame, in usecs since the server started
+//		then frames to the end of the message, each:
+//			varint	usecs since the previous frame (0 for the first)
+//			u8		physical ID (5 bits, without its CRC bits)
+//			u8		primitive ID
+//			u16		DATA_ID
+//			u32		value
+//
+//	SMT_SUBSCRIBE (subscriber to server), sets the subscriber's filter:
+//		varint	length, then the UTF-8 filter, in the CSportLogFilter
+//				syntax (such as "phys=0x00-0x03;data=0x0100"), empty for
+//				everything
+//
+//	SMT_UNSUBSCRIBE (subscriber to server), no more frames, no body
+//
+//	SMT_ERROR (server to subscriber), a subscribe that was rejected:
+//		varint	length, then the UTF-8 error message
+//
+// TCP subscribers get everything from when they connect, until they
+//	send a filter.  UDP subscribers get nothing until they subscribe, and
+//	must send their subscribe again at least every SUBSCRIPTION_TIMEOUT
+//	msecs to keep getting frames.
+//
+namespace SportStream {
+	constexpr uint8_t PROTOCOL_VERSION = 1;
+	constexpr int MAX_DATAGRAM_SIZE = 1400;			// Keeps UDP messages within an Ethernet MTU, for non-loopback use
+	constexpr int MAX_MESSAGE_SIZE = 65536;			// Largest message accepted from the stream
+	constexpr int SUBSCRIPTION_TIMEOUT = 10000;		// Msecs a UDP subscription lasts without being renewed
+
+	enum STREAM_MESSAGE_TYPE {
+		SMT_FRAMES = 1,
+		SMT_SUBSCRIBE = 2,
+		SMT_UNSUBSCRIBE = 3,
+		SMT_ERROR = 4,
+	};
+};
+
+// ----------------------------------------------------------------------------
+
+struct TSportStreamFrame
+{
+	int64_t m_nTimeNsecs = 0;		// Time received, on the server's clock
+	uint8_t m_nPhysId = 0;
+	uint8_t m_nPrimId = 0;
+	uint16_t m_nDataId = 0;
+	uint32_t m_nValue = 0;
+};
+
+// A decoded message:
+struct TSportStreamMessage
+{
+	SportStream::STREAM_MESSAGE_TYPE m_nType = SportStream::SMT_FRAMES;
+	SPORT_ID_ENUM m_nSport = SPIDE_SPORT1;
+	uint64_t m_nSequence = 0;
+	uint64_t m_nDropped = 0;
+	QVector<TSportStreamFrame> m_arrFrames;
+	QString m_strText;				// Filter of SMT_SUBSCRIBE, message of SMT_ERROR
+};
+
+class CSportStreamCodec
+{
+public:
+	static void appendVarint(QByteArray &baData, uint64_t nValue);
+	static bool readVarint(const uint8_t *&pData, const uint8_t *pEnd, uint64_t &nValue);
+
+	// Appends an SMT_FRAMES message with as many of the nCount frames as fit
+	//	in nMaxSize bytes (but at least one), returning the number of them:
+	static int appendFramesMessage(QByteArray &baData, SPORT_ID_ENUM nSport, uint64_t nSequence, uint64_t nDropped,
+									const TSportStreamFrame *pFrames, int nCount, int nMaxSize = SportStream::MAX_MESSAGE_SIZE);
+	static QByteArray subscribeMessage(const QString &strFilter);
+	static QByteArray unsubscribeMessage();
+	static QByteArray errorMessage(const QString &strError);
+
+	static bool decodeMessage(const QByteArray &baMessage, TSportStreamMessage &message, QString *pstrError = nullptr);
+
+	// TCP stream framing.  takeStreamMessage() removes the first complete
+	//	message from baStream, returning false if it isn't all there yet, or
+	//	on a corrupt length (with bError set, and the stream unusable):
+	static void appendStreamMessage(QByteArray &baStream, const QByteArray &baMessage);
+	static bool takeStreamMessage(QByteArray &baStream, QByteArray &baMessage, bool &bError);
+};
+
+// ----------------------------------------------------------------------------
+
+//
+// Hand-off of received frames from the telemetry handlers to the stream
+//	server.  Each port has its own lock-free ring, so the handler on each
+//	port's I/O thread only copies the frame in, and never waits on the
+//	server or its subscribers.  Frames are timestamped on push, on a clock
+//	shared by all of the ports.  Only one telemetry handler at a time may
+//	push to each port's ring.
+//
+class CSportStreamQueue
+{
+public:
+	static constexpr size_t QUEUE_SIZE = 4096;		// Frames each port can get ahead of the server, several seconds of a busy bus
+
+	CSportStreamQueue()
+	{
+		m_tmrElapsed.start();
+	}
+
+	// Producer side (the port's telemetry handler):
+	bool push(SPORT_ID_ENUM nSport, const CSportTelemetryPacket &packet)
+	{
+		TSportStreamFrame frame;
+		frame.m_nTimeNsecs = m_tmrElapsed.nsecsElapsed();
+		frame.m_nPhysId = packet.getPhysicalId();
+		frame.m_nPrimId = packet.getPrimId();
+		frame.m_nDataId = packet.getDataId();
+		frame.m_nValue = packet.getValue();
+		return m_arrQueues[nSport].push(frame);
+	}
+
+	// Consumer side (the server):
+	bool pop(SPORT_ID_ENUM nSport, TSportStreamFrame &frame) { return m_arrQueues[nSport].pop(frame); }
+	qint64 elapsedNsecs() const { return m_tmrElapsed.nsecsElapsed(); }
+
+	// Statistics (either side):
+	uint32_t pushedCount(SPORT_ID_ENUM nSport) const { return m_arrQueues[nSport].pushedCount(); }
+	uint32_t droppedCount(SPORT_ID_ENUM nSport) const { return m_arrQueues[nSport].droppedCount(); }
+
+private:
+	QElapsedTimer m_tmrElapsed;
+	CSpscRingBuffer<TSportStreamFrame, QUEUE_SIZE> m_arrQueues[SPIDE_COUNT];
+};
+
+// ============================================================================
+
+#endif	// FRSKY_SPORT_STREAM_PROTOCOL_H
@@ -0,0 +1,365 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#include "frsky_sport_stream_server.h"
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUdpSocket>
+#include <QTimer>
+
+// ============================================================================
+
+CSportStreamServer::CSportStreamServer(QObject *pParent)
+	:	QThread(pParent)
+{
+}
+
+CSportStreamServer::~CSportStreamServer()
+{
+	stop();
+}
+
+// ----------------------------------------------------------------------------
+
+bool CSportStreamServer::listen(quint16 nPort, const QHostAddress &address, QString *pstrError)
+{
+	if (isRunning()) {
+		if (pstrError) *pstrError = QString("Stream server is already listening on port %1").arg(m_nPort);
+		return false;
+	}
+
+	// The sockets are bound here, so errors are reported to the caller,
+	//	and then pushed to the server thread, which owns them from then on:
+	m_pTcpServer = new QTcpServer;
+	m_pUdpSocket = new QUdpSocket;
+	QString strError;
+	if (!m_pTcpServer->listen(address, nPort)) {
+		strError = QString("Failed to listen for TCP on port %1: %2").arg(nPort).arg(m_pTcpServer->errorString());
+	} else if (!m_pUdpSocket->bind(address, m_pTcpServer->serverPort())) {
+		strError = QString("Failed to bind UDP port %1: %2").arg(m_pTcpServer->serverPort()).arg(m_pUdpSocket->errorString());
+	}
+	if (!strError.isEmpty()) {
+		if (pstrError) *pstrError = strError;
+		delete m_pTcpServer;
+		m_pTcpServer = nullptr;
+		delete m_pUdpSocket;
+		m_pUdpSocket = nullptr;
+		return false;
+	}
+
+	m_nPort = m_pTcpServer->serverPort();
+	m_pTcpServer->moveToThread(this);
+	m_pUdpSocket->moveToThread(this);
+	start();
+	return true;
+}
+
+void CSportStreamServer::stop()
+{
+	quit();
+	wait();
+}
+
+// ----------------------------------------------------------------------------
+
+qint64 CSportStreamServer::framesQueued() const
+{
+	qint64 nFrames = 0;
+	for (int nSport = 0; nSport < SPIDE_COUNT; ++nSport) {
+		nFrames += m_queue.pushedCount(static_cast<SPORT_ID_ENUM>(nSport));
+	}
+	return nFrames;
+}
+
+qint64 CSportStreamServer::framesDropped() const
+{
+	qint64 nFrames = 0;
+	for (int nSport = 0; nSport < SPIDE_COUNT; ++nSport) {
+		nFrames += m_queue.droppedCount(static_cast<SPORT_ID_ENUM>(nSport));
+	}
+	return nFrames;
+}
+
+QString CSportStreamServer::summary() const
+{
+	return QString("Stream port %1: %2 subscribers, %3 frames queued, %4 dropped, %5 messages and %6 bytes sent")
+			.arg(m_nPort)
+			.arg(subscriberCount())
+			.arg(framesQueued())
+			.arg(framesDropped())
+			.arg(messagesSent())
+			.arg(bytesSent());
+}
+
+// ============================================================================
+
+void CSportStreamServer::run()
+{
+	// Note: the sockets (and the timer) live on this thread, so they are
+	//	the context objects of their connections, to run them here:
+	connect(m_pTcpServer, &QTcpServer::newConnection, m_pTcpServer, [this]()->void {
+		while (m_pTcpServer->hasPendingConnections()) {
+			TSubscriber *pSubscriber = new TSubscriber;
+			QTcpSocket *pSocket = m_pTcpServer->nextPendingConnection();
+			pSubscriber->m_pSocket = pSocket;
+			pSubscriber->m_strName = QString("tcp:%1:%2").arg(pSocket->peerAddress().toString()).arg(pSocket->peerPort());
+			pSocket->setSocketOption(QAbstractSocket::LowDelayOption, 1);		// Already batched, don't delay them more
+			connect(pSocket, &QTcpSocket::readyRead, pSocket, [this, pSubscriber]()->void {
+				tcpReceive(pSubscriber);
+			});
+			// Note: queued, since the socket can disconnect in the middle of
+			//	a sendBatches() write, while m_lstSubscribers is being iterated:
+			connect(pSocket, &QTcpSocket::disconnected, pSocket, [this, pSubscriber]()->void {
+				removeSubscriber(pSubscriber);
+			}, Qt::QueuedConnection);
+			addSubscriber(pSubscriber);
+		}
+	});
+	connect(m_pUdpSocket, &QUdpSocket::readyRead, m_pUdpSocket, [this]()->void {
+		udpReceive();
+	});
+
+	QTimer tmrBatch;
+	connect(&tmrBatch, &QTimer::timeout, &tmrBatch, [this]()->void {
+		sendBatches();
+	});
+	tmrBatch.start(m_nBatchInterval);
+
+	exec();
+
+	tmrBatch.stop();
+	while (!m_lstSubscribers.isEmpty()) {
+		removeSubscriber(m_lstSubscribers.first());
+	}
+	delete m_pTcpServer;
+	m_pTcpServer = nullptr;
+	delete m_pUdpSocket;
+	m_pUdpSocket = nullptr;
+}
+
+// ----------------------------------------------------------------------------
+
+void CSportStreamServer::sendBatches()
+{
+	qint64 nNowNsecs = m_queue.elapsedNsecs();
+	for (int ndx = m_lstSubscribers.size()-1; ndx >= 0; --ndx) {
+		TSubscriber *pSubscriber = m_lstSubscribers.at(ndx);
+		if (pSubscriber->m_pSocket) continue;
+		if ((nNowNsecs - pSubscriber->m_nRenewNsecs) > static_cast<qint64>(SportStream::SUBSCRIPTION_TIMEOUT)*1000000) {
+			removeSubscriber(pSubscriber);
+		}
+	}
+
+	for (int nSport = 0; nSport < SPIDE_COUNT; ++nSport) {
+		SPORT_ID_ENUM nSportId = static_cast<SPORT_ID_ENUM>(nSport);
+		m_arrFrames.clear();
+		TSportStreamFrame frame;
+		// Limited to a queue's worth, so a port being pushed to as fast as
+		//	it's popped can't hold up the other:
+		for (size_t nFrames = 0; (nFrames < CSportStreamQueue::QUEUE_SIZE) && m_queue.pop(nSportId, frame); ++nFrames) {
+			m_arrFrames.append(frame);
+		}
+		uint32_t nDropped = m_queue.droppedCount(nSportId) - m_arrDroppedSent[nSport];
+		m_arrDroppedSent[nSport] += nDropped;
+		if (m_arrFrames.isEmpty() && (nDropped == 0)) continue;
+
+		for (TSubscriber *pSubscriber : m_lstSubscribers) {
+			pSubscriber->m_nDroppedUnreported += nDropped;
+			pSubscriber->m_stats.m_nDropped += nDropped;
+			sendFrames(pSubscriber, nSportId, m_arrFrames);
+		}
+	}
+}
+
+void CSportStreamServer::sendFrames(TSubscriber *pSubscriber, SPORT_ID_ENUM nSport, const QVector<TSportStreamFrame> &arrFrames)
+{
+	const QVector<TSportStreamFrame> *pFrames = &arrFrames;
+	if (!pSubscriber->m_filter.acceptsAll()) {
+		m_arrFiltered.clear();
+		for (const TSportStreamFrame &frame : arrFrames) {
+			// The filter takes the frame bytes, from the physical ID on:
+			uint8_t arrFrame[4] = { frame.m_nPhysId, frame.m_nPrimId,
+									static_cast<uint8_t>(frame.m_nDataId & 0xFF), static_cast<uint8_t>(frame.m_nDataId >> 8) };
+			if (pSubscriber->m_filter.accepts(nSport, CFrskySportIO::LT_RX, arrFrame, sizeof(arrFrame))) {
+				m_arrFiltered.append(frame);
+			}
+		}
+		pFrames = &m_arrFiltered;
+	}
+	if (pFrames->isEmpty() && (pSubscriber->m_nDroppedUnreported == 0)) return;
+
+	int nMaxSize = (pSubscriber->m_pSocket ? SportStream::MAX_MESSAGE_SIZE : SportStream::MAX_DATAGRAM_SIZE);
+	int ndx = 0;
+	do {
+		if (pSubscriber->m_pSocket && (pSubscriber->m_pSocket->bytesToWrite() > m_nMaxBacklog)) {
+			int nCount = pFrames->size() - ndx;
+			pSubscriber->m_nDroppedUnreported += nCount;
+			pSubscriber->m_stats.m_nDropped += nCount;
+			return;
+		}
+		m_baMessage.clear();
+		int nCount = CSportStreamCodec::appendFramesMessage(m_baMessage, nSport, pSubscriber->m_nSequence, pSubscriber->m_nDroppedUnreported,
+															pFrames->constData() + ndx, pFrames->size() - ndx, nMaxSize);
+		if (sendMessage(pSubscriber, m_baMessage)) {
+			++pSubscriber->m_nSequence;
+			pSubscriber->m_nDroppedUnreported = 0;
+			pSubscriber->m_stats.m_nFrames += nCount;
+		} else {
+			pSubscriber->m_nDroppedUnreported += nCount;
+			pSubscriber->m_stats.m_nDropped += nCount;
+		}
+		ndx += nCount;
+	} while (ndx < pFrames->size());
+}
+
+bool CSportStreamServer::sendMessage(TSubscriber *pSubscriber, const QByteArray &baMessage)
+{
+	qint64 nBytes = baMessage.size();
+	if (pSubscriber->m_pSocket) {
+		if (pSubscriber->m_pSocket->state() != QAbstractSocket::ConnectedState) return false;
+		QByteArray baLength;
+		CSportStreamCodec::appendVarint(baLength, baMessage.size());
+		pSubscriber->m_pSocket->write(baLength);
+		pSubscriber->m_pSocket->write(baMessage);
+		nBytes += baLength.size();
+	} else {
+		if (m_pUdpSocket->writeDatagram(baMessage, pSubscriber->m_address, pSubscriber->m_nPort) != baMessage.size()) return false;
+	}
+	++pSubscriber->m_stats.m_nMessages;
+	pSubscriber->m_stats.m_nBytes += nBytes;
+	m_nMessagesSent.fetch_add(1, std::memory_order_relaxed);
+	m_nBytesSent.fetch_add(nBytes, std::memory_order_relaxed);
+	return true;
+}
+
+// ============================================================================
+
+void CSportStreamServer::udpReceive()
+{
+	while (m_pUdpSocket->hasPendingDatagrams()) {
+		QByteArray baMessage;
+		baMessage.resize(static_cast<int>(qMax<qint64>(m_pUdpSocket->pendingDatagramSize(), 0)));
+		QHostAddress address;
+		quint16 nPort = 0;
+		qint64 nSize = m_pUdpSocket->readDatagram(baMessage.data(), baMessage.size(), &address, &nPort);
+		if (nSize < 0) break;
+		baMessage.resize(static_cast<int>(nSize));
+
+		TSportStreamMessage message;
+		if (!CSportStreamCodec::decodeMessage(baMessage, message)) continue;		// Not for us
+
+		TSubscriber *pSubscriber = nullptr;
+		for (TSubscriber *pUdpSubscriber : m_lstSubscribers) {
+			if (!pUdpSubscriber->m_pSocket && (pUdpSubscriber->m_nPort == nPort) && (pUdpSubscriber->m_address == address)) {
+				pSubscriber = pUdpSubscriber;
+				break;
+			}
+		}
+
+		if (message.m_nType == SportStream::SMT_SUBSCRIBE) {
+			CSportLogFilter filter;
+			QString strError;
+			if (!filter.parse(message.m_strText, &strError)) {
+				m_pUdpSocket->writeDatagram(CSportStreamCodec::errorMessage(strError), address, nPort);
+				continue;
+			}
+			if (pSubscriber == nullptr) {
+				pSubscriber = new TSubscriber;
+				pSubscriber->m_strName = QString("udp:%1:%2").arg(address.toString()).arg(nPort);
+				pSubscriber->m_address = address;
+				pSubscriber->m_nPort = nPort;
+				addSubscriber(pSubscriber);
+			}
+			pSubscriber->m_filter = filter;
+			pSubscriber->m_nRenewNsecs = m_queue.elapsedNsecs();
+		} else if ((message.m_nType == SportStream::SMT_UNSUBSCRIBE) && pSubscriber) {
+			removeSubscriber(pSubscriber);
+		}
+	}
+}
+
+void CSportStreamServer::tcpReceive(TSubscriber *pSubscriber)
+{
+	pSubscriber->m_baRxStream.append(pSubscriber->m_pSocket->readAll());
+
+	QByteArray baMessage;
+	bool bError = false;
+	while (CSportStreamCodec::takeStreamMessage(pSubscriber->m_baRxStream, baMessage, bError)) {
+		subscriberMessage(pSubscriber, baMessage);
+	}
+	if (bError) {
+		pSubscriber->m_baRxStream.clear();
+		pSubscriber->m_pSocket->abort();		// Removed on its disconnected signal
+	}
+}
+
+void CSportStreamServer::subscriberMessage(TSubscriber *pSubscriber, const QByteArray &baMessage)
+{
+	TSportStreamMessage message;
+	QString strError;
+	if (!CSportStreamCodec::decodeMessage(baMessage, message, &strError)) {
+		sendMessage(pSubscriber, CSportStreamCodec::errorMessage(strError));
+		return;
+	}
+
+	if (message.m_nType == SportStream::SMT_SUBSCRIBE) {
+		if (!pSubscriber->m_filter.parse(message.m_strText, &strError)) {
+			sendMessage(pSubscriber, CSportStreamCodec::errorMessage(strError));
+		}
+	} else if (message.m_nType == SportStream::SMT_UNSUBSCRIBE) {
+		pSubscriber->m_pSocket->disconnectFromHost();		// Removed on its disconnected signal
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+void CSportStreamServer::addSubscriber(TSubscriber *pSubscriber)
+{
+	m_lstSubscribers.append(pSubscriber);
+	m_nSubscribers.store(m_lstSubscribers.size(), std::memory_order_relaxed);
+	emit subscriberAdded(pSubscriber->m_strName);
+}
+
+void CSportStreamServer::removeSubscriber(TSubscriber *pSubscriber)
+{
+	if (!m_lstSubscribers.removeOne(pSubscriber)) return;
+	m_nSubscribers.store(m_lstSubscribers.size(), std::memory_order_relaxed);
+	if (pSubscriber->m_pSocket) {
+		pSubscriber->m_pSocket->disconnect();
+		pSubscriber->m_pSocket->deleteLater();
+	}
+	emit subscriberRemoved(pSubscriber->m_strName, subscriberSummary(pSubscriber));
+	delete pSubscriber;
+}
+
+QString CSportStreamServer::subscriberSummary(const TSubscriber *pSubscriber)
+{
+	const TSubscriberStats &stats = pSubscriber->m_stats;
+	return QString("%1 messages, %2 frames and %3 bytes sent, %4 frames dropped")
+			.arg(stats.m_nMessages)
+			.arg(stats.m_nFrames)
+			.arg(stats.m_nBytes)
+			.arg(stats.m_nDropped);
+}
+
+// ============================================================================
@@ -0,0 +1,152 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#ifndef FRSKY_SPORT_STREAM_SERVER_H
+#define FRSKY_SPORT_STREAM_SERVER_H
+
+#include "frsky_sport_io.h"
+#include "frsky_sport_stream_protocol.h"
+
+#include <QThread>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QList>
+#include <QHostAddress>
+
+#include <atomic>
+
+// Forward Declarations
+class QTcpServer;
+class QTcpSocket;
+class QUdpSocket;
+
+// ============================================================================
+
+//
+// Streams received telemetry to other programs over TCP and UDP, as an
+//	alternative to CSportShmPublisher for programs that would rather use
+//	sockets, or are elsewhere.  The telemetry handlers push the frames they
+//	receive into queue() (see CFrskySportDeviceTelemetry::setStreamQueue()),
+//	and the server, on its own thread with its own event loop, sends them
+//	out in batches every batch interval, encoded as described in
+//	frsky_sport_stream_protocol.h.  The same port number is listened on
+//	for TCP and UDP.
+//
+//	Each subscriber can have a filter, in the CSportLogFilter syntax, so it
+//	only gets the physical IDs, DATA_IDs, etc, that it wants.  A TCP
+//	subscriber that falls too far behind, or a full queue, drops whole
+//	batches rather than holding anything up, and the drops are reported
+//	to the subscriber in its next message.
+//
+class CSportStreamServer : public QThread
+{
+	Q_OBJECT
+
+public:
+	static constexpr quint16 DEFAULT_PORT = 5761;
+	static constexpr int DEFAULT_BATCH_INTERVAL = 20;		// Default msecs between batches
+	static constexpr int DEFAULT_MAX_BACKLOG = 262144;		// Default bytes a TCP subscriber can fall behind before batches are dropped
+
+	struct TSubscriberStats {
+		qint64 m_nMessages = 0;				// Messages sent
+		qint64 m_nFrames = 0;				// Frames sent
+		qint64 m_nBytes = 0;				// Bytes sent, including the TCP framing
+		qint64 m_nDropped = 0;				// Frames dropped for the subscriber
+	};
+
+	explicit CSportStreamServer(QObject *pParent = nullptr);
+	virtual ~CSportStreamServer();
+
+	void setBatchInterval(int nMsecs) { m_nBatchInterval = nMsecs; }	// Set before listen()
+	void setMaxBacklog(int nBytes) { m_nMaxBacklog = nBytes; }			// Set before listen()
+
+	// Binds the TCP and UDP sockets and starts the server thread.  With
+	//	nPort 0, the system picks one, see port():
+	bool listen(quint16 nPort = DEFAULT_PORT, const QHostAddress &address = QHostAddress(QHostAddress::LocalHost), QString *pstrError = nullptr);
+	void stop();							// Ends the server thread, dropping all subscribers
+	bool isListening() const { return isRunning(); }
+	quint16 port() const { return m_nPort; }
+
+	CSportStreamQueue &queue() { return m_queue; }
+
+	// Statistics (any thread):
+	int subscriberCount() const { return m_nSubscribers.load(std::memory_order_relaxed); }
+	qint64 framesQueued() const;			// Frames pushed into the queue
+	qint64 framesDropped() const;			// Frames dropped because the queue was full
+	qint64 messagesSent() const { return m_nMessagesSent.load(std::memory_order_relaxed); }
+	qint64 bytesSent() const { return m_nBytesSent.load(std::memory_order_relaxed); }
+	QString summary() const;				// Single line summary for display
+
+signals:
+	// Emitted from the server thread:
+	void subscriberAdded(const QString &strSubscriber);
+	void subscriberRemoved(const QString &strSubscriber, const QString &strSummary);
+
+protected:
+	virtual void run() override;
+
+	struct TSubscriber {
+		QString m_strName;					// "tcp:address:port" or "udp:address:port"
+		QTcpSocket *m_pSocket = nullptr;	// TCP subscriber, nullptr for UDP
+		QHostAddress m_address;				// UDP subscriber address
+		quint16 m_nPort = 0;				// UDP subscriber port
+		CSportLogFilter m_filter;
+		QByteArray m_baRxStream;			// Bytes received from a TCP subscriber, not yet a whole message
+		qint64 m_nRenewNsecs = 0;			// Time of the UDP subscriber's last subscribe
+		uint64_t m_nSequence = 0;			// Sequence number of its next message
+		uint64_t m_nDroppedUnreported = 0;	// Frames dropped since its last message
+		TSubscriberStats m_stats;
+	};
+
+	void sendBatches();						// Runs every batch interval
+	void sendFrames(TSubscriber *pSubscriber, SPORT_ID_ENUM nSport, const QVector<TSportStreamFrame> &arrFrames);
+	bool sendMessage(TSubscriber *pSubscriber, const QByteArray &baMessage);
+	void subscriberMessage(TSubscriber *pSubscriber, const QByteArray &baMessage);	// From a TCP subscriber
+	void udpReceive();
+	void tcpReceive(TSubscriber *pSubscriber);
+	void addSubscriber(TSubscriber *pSubscriber);
+	void removeSubscriber(TSubscriber *pSubscriber);
+	static QString subscriberSummary(const TSubscriber *pSubscriber);
+
+private:
+	int m_nBatchInterval = DEFAULT_BATCH_INTERVAL;
+	int m_nMaxBacklog = DEFAULT_MAX_BACKLOG;
+	quint16 m_nPort = 0;
+	CSportStreamQueue m_queue;
+	// ---- Server thread only:
+	QTcpServer *m_pTcpServer = nullptr;
+	QUdpSocket *m_pUdpSocket = nullptr;
+	QList<TSubscriber *> m_lstSubscribers;
+	QVector<TSportStreamFrame> m_arrFrames;			// Frames of the batch being sent
+	QVector<TSportStreamFrame> m_arrFiltered;		// Frames of the batch accepted by a subscriber's filter
+	QByteArray m_baMessage;
+	uint32_t m_arrDroppedSent[SPIDE_COUNT] = { };	// Queue drops already added to the subscribers' counts
+	// ---- Statistics:
+	std::atomic<int> m_nSubscribers{0};
+	std::atomic<qint64> m_nMessagesSent{0};
+	std::atomic<qint64> m_nBytesSent{0};
+};
+
+// ============================================================================
+
+#endif	// FRSKY_SPORT_STREAM_SERVER_H
@@ -21,55 +21,127 @@
 ****************************************************************************/
 
 #include "frsky_sport_telemetry.h"
+#include "frsky_sport_shm_publisher.h"
+#include "frsky_sport_stream_protocol.h"
 #include "UICallback.h"
 
 // ============================================================================
 
-CFrskySportDeviceTelemetry::FrameProcessResult CFrskySportDeviceTelemetry::processFrame()
+void CFrskySportDeviceTelemetry::processFrame(const TSportRxFrame &frame)
 {
-	FrameProcessResult results;
+	const CSportRxBuffer &rxBuffer = frame.m_rxBuffer;
 
-	results.m_strLogDetail = m_rxBuffer.logDetails();
-
-	if (m_rxBuffer.haveTelemetryPoll()) {
-		uint8_t nPhysId = m_rxBuffer.telemetryPollPacket().getPhysicalId();
+	if (frame.m_nKind == SRFK_TELEMETRY_POLL) {
+		uint8_t nPhysId = rxBuffer.telemetryPollPacket().getPhysicalId();
 		if (nPhysId < TELEMETRY_PHYS_ID_COUNT) {
-			m_telemetryEndpoints[nPhysId].m_bReceivingPolls = true;
-			if (m_telemetryEndpoints[nPhysId].m_bInUse) {
-				// Push pending data for this poll:
-				txSportPacket(m_telemetryEndpoints[nPhysId].m_responsePacket, m_telemetryEndpoints[nPhysId].m_strLogDetail, true);
-				m_telemetryEndpoints[nPhysId].m_bInUse = false;
+			auto &endpoint = m_telemetryEndpoints[nPhysId];
+			endpoint.m_bReceivingPolls = true;
+			m_busStats.notePoll(nPhysId);
+			if (endpoint.m_nPushCount) {
+				// Push the oldest pending data for this poll:
+				const TPushEntry &entry = endpoint.m_arrPushQueue[endpoint.m_nPushHead];
+				qint64 nWait = m_frskySportIO.elapsedNsecs() - entry.m_nQueuedNsecs;
+				txSportPacket(entry.m_packet, entry.m_strLogDetail, true);
+				m_busStats.noteResponse(nPhysId, m_frskySportIO.elapsedNsecs() - m_nPollNsecs);		// Write to the port is complete
+				endpoint.m_nPushHead = (endpoint.m_nPushHead + 1) % TELEMETRY_PUSH_QUEUE_SIZE;
+				--endpoint.m_nPushCount;
+				++endpoint.m_pushStats.m_nSent;
+				endpoint.m_pushStats.m_nTotalWaitNsecs += nWait;
+				if (nWait > endpoint.m_pushStats.m_nMaxWaitNsecs) endpoint.m_pushStats.m_nMaxWaitNsecs = nWait;
 			}
 		}
-	} else if (m_rxBuffer.isTelemetryPacket()) {
-		emit rxSportPacket(m_rxBuffer.telemetryPacket());
+	} else if (frame.m_nKind == SRFK_TELEMETRY) {
+		if (frame.m_bCrcValid) {
+			qint64 nNowNsecs = m_frskySportIO.elapsedNsecs();
+			m_sensorStore.update(rxBuffer.telemetryPacket(), nNowNsecs);
+			if (m_pTimeSeriesStore) m_pTimeSeriesStore->insert(rxBuffer.telemetryPacket(), nNowNsecs);
+			if (m_pShmPublisher) m_pShmPublisher->publish(rxBuffer.telemetryPacket());
+			if (m_pStreamQueue) m_pStreamQueue->push(m_frskySportIO.getSportID(), rxBuffer.telemetryPacket());
+		}
+		if (m_fnRxPacketSink) m_fnRxPacketSink(rxBuffer.telemetryPacket());
+		emit rxSportPacket(rxBuffer.telemetryPacket());
 	}
-
-	return results;
 }
 
 void CFrskySportDeviceTelemetry::txSportPacket(const CSportTelemetryPacket &packet, const QString &strLogDetail, bool bIsPushResponse)
 {
-	m_txBufferLast.reset();
-	m_txBufferLast.pushPacketWithByteStuffing(packet);
-
-	QString strMsg = packet.logDetails();
-	if (!strMsg.isEmpty()) strMsg += " ";
-	strMsg += strLogDetail;
-	QByteArray arrBytes(1, 0x7E);	// Start of Frame
-	arrBytes.append(m_txBufferLast.data());
-	m_frskySportIO.logMessage(bIsPushResponse ? CFrskySportIO::LT_TXPUSH : CFrskySportIO::LT_TX, arrBytes, strMsg);
-	m_frskySportIO.port().write(bIsPushResponse ? arrBytes.mid(2) : arrBytes);	// For push, drop the SOF and PhysicalId
-	m_frskySportIO.port().flush();
+	if (!bIsPushResponse) {
+		for (int i = 0; i < TELEMETRY_PHYS_ID_COUNT; ++i) {
+			if (m_telemetryEndpoints[i].m_bReceivingPolls) {
+				++m_nUnpolledTxCount;
+				break;
+			}
+		}
+	}
+
+	CSportTxBuffer txBuffer;
+	txBuffer.pushPacketWithByteStuffing(packet);
+
+	CFrskySportIO::LOG_TYPE nLT = bIsPushResponse ? CFrskySportIO::LT_TXPUSH : CFrskySportIO::LT_TX;
+	if (m_frskySportIO.logWanted(nLT, packet.m_raw, sizeof(packet.m_raw))) {
+		QByteArray arrBytes(1, 0x7E);	// Start of Frame
+		arrBytes.append(txBuffer.data());
+		QString strMsg = packet.logDetails();
+		if (!strMsg.isEmpty()) strMsg += " ";
+		strMsg += strLogDetail;
+		m_frskySportIO.logMessage(nLT, arrBytes, strMsg);
+	}
+	m_frskySportIO.writeFrame(txBuffer, bIsPushResponse);
 }
 
 void CFrskySportDeviceTelemetry::pushTelemetryResponse(const CSportTelemetryPacket &packet, const QString &strLogDetail)
 {
 	uint8_t nPhysicalId = packet.getPhysicalId();
 	assert(nPhysicalId < TELEMETRY_PHYS_ID_COUNT);
-	m_telemetryEndpoints[nPhysicalId].m_responsePacket = packet;
-	m_telemetryEndpoints[nPhysicalId].m_bInUse = true;
-	m_telemetryEndpoints[nPhysicalId].m_strLogDetail = strLogDetail;
+	auto &endpoint = m_telemetryEndpoints[nPhysicalId];
+	if (endpoint.m_nPushCount >= TELEMETRY_PUSH_QUEUE_SIZE) {
+		++endpoint.m_pushStats.m_nRejected;		// Caller should have checked isTelemetryPushAvailable()
+		return;
+	}
+
+	TPushEntry &entry = endpoint.m_arrPushQueue[(endpoint.m_nPushHead + endpoint.m_nPushCount) % TELEMETRY_PUSH_QUEUE_SIZE];
+	entry.m_packet = packet;
+	entry.m_strLogDetail = strLogDetail;
+	entry.m_nQueuedNsecs = m_frskySportIO.elapsedNsecs();
+	++endpoint.m_nPushCount;
+	++endpoint.m_pushStats.m_nPushed;
+	if (endpoint.m_nPushCount > endpoint.m_pushStats.m_nMaxOccupancy) endpoint.m_pushStats.m_nMaxOccupancy = endpoint.m_nPushCount;
+}
+
+CFrskySportDeviceTelemetry::TPushQueueStats CFrskySportDeviceTelemetry::pushQueueStats(int nPhysicalId) const
+{
+	if (nPhysicalId >= 0) {
+		assert(nPhysicalId < TELEMETRY_PHYS_ID_COUNT);
+		return m_telemetryEndpoints[nPhysicalId].m_pushStats;
+	}
+
+	TPushQueueStats stats;
+	for (int i = 0; i < TELEMETRY_PHYS_ID_COUNT; ++i) {
+		const TPushQueueStats &statsID = m_telemetryEndpoints[i].m_pushStats;
+		stats.m_nPushed += statsID.m_nPushed;
+		stats.m_nRejected += statsID.m_nRejected;
+		stats.m_nSent += statsID.m_nSent;
+		if (statsID.m_nMaxOccupancy > stats.m_nMaxOccupancy) stats.m_nMaxOccupancy = statsID.m_nMaxOccupancy;
+		stats.m_nTotalWaitNsecs += statsID.m_nTotalWaitNsecs;
+		if (statsID.m_nMaxWaitNsecs > stats.m_nMaxWaitNsecs) stats.m_nMaxWaitNsecs = statsID.m_nMaxWaitNsecs;
+	}
+	return stats;
+}
+
+QString CFrskySportDeviceTelemetry::busStatsSummary() const
+{
+	QString strSummary = m_busStats.summary(m_frskySportIO.elapsedNsecs(), m_frskySportIO.baudRate());
+	if (m_frskySportIO.txEchoStats().m_nTxFrames) strSummary += "; " + m_frskySportIO.txEchoSummary();
+	return strSummary;
+}
+
+void CFrskySportDeviceTelemetry::setBusStatsLogInterval(int nMsecs)
+{
+	if (nMsecs > 0) {
+		m_tmrBusStatsLog.start(nMsecs);
+	} else {
+		m_tmrBusStatsLog.stop();
+	}
 }
 
 void CFrskySportDeviceTelemetry::en_userCancel()
@@ -80,76 +152,27 @@ void CFrskySportDeviceTelemetry::en_userCancel()
 
 // ----------------------------------------------------------------------------
 
-// This function gets triggered whenever the serial port
-//	has data.  Here, we emit a queued connection function
-//	that handles the read.  We do that rather than read
-//	the data here to avoid a race condition between reading
-//	the data and getting another event from the serial device.
-void CFrskySportDeviceTelemetry::en_readyRead()
+// Receive dispatch from m_frskySportIO.  Polls are logged before they
+//	get here, so they are logged before any response pushed to them:
+void CFrskySportDeviceTelemetry::rxBytes(int nBytes, qint64 nArrivalNsecs)
 {
-	emit dataAvailable();
+	m_busStats.noteRxBytes(nBytes, nArrivalNsecs);
 }
 
-// This function gets triggered by the readyRead queued
-//	connection with dataAvailable.  Here, we check to see if we
-//	have incoming bytes from the serial connection, which might
-//	be bytes from the device or bytes we are sending being
-//	echoed since it's a half-duplex, single-wire connection,
-//	and then if it's a message from the device, we post an
-//	event to process them:
-void CFrskySportDeviceTelemetry::en_receive()
+void CFrskySportDeviceTelemetry::rxFrame(const TSportRxFrame &frame, QString *pstrLogDetail)
 {
-	QByteArray arrBytes = m_frskySportIO.port().readAll();
-	if (!arrBytes.isEmpty()) {
-		for (int ndx = 0; ndx < arrBytes.size(); ++ndx) {
-			QByteArray baExtraneous = m_rxBuffer.pushByte(arrBytes.at(ndx));
-			if (!baExtraneous.isEmpty()) {
-				m_frskySportIO.logMessage(CFrskySportIO::LT_RX, baExtraneous, "*** Extraneous Bytes");
-			}
-			if ((ndx == arrBytes.size()-1) && m_rxBuffer.haveTelemetryPoll()) {
-				QByteArray baMessage(1, 0x7E);		// Add the 0x7E since it's eaten by the RxBuffer
-				baMessage.append(m_rxBuffer.rawData());
-				m_frskySportIO.logMessage(CFrskySportIO::LT_TELEPOLL, baMessage, m_rxBuffer.logDetails());
-				// Do the log above BEFORE calling processFrame so that things like the poll message
-				//	get logged before logging the transmitted response:
-				processFrame();
-			} else if (m_rxBuffer.haveCompletePacket()) {
-				bool bIsEcho = (QByteArray((char*)m_rxBuffer.data(), m_rxBuffer.size()) == m_txBufferLast.data());
-				m_txBufferLast.reset();
-
-				if (!m_rxBuffer.isFirmwarePacket() && !m_rxBuffer.isTelemetryPacket()) {
-					QByteArray baUnexpected(1, 0x7E);		// Add the 0x7E since it's eaten by the RxBuffer
-					baUnexpected.append(m_rxBuffer.rawData());
-					m_frskySportIO.logMessage(bIsEcho ? CFrskySportIO::LT_TXECHO : CFrskySportIO::LT_RX, baUnexpected, "*** Unexpected/Unknown packet");
-				} else {
-					uint8_t nExpectedCRC = m_rxBuffer.isFirmwarePacket() ? m_rxBuffer.firmwarePacket().crc() :
-															m_rxBuffer.telemetryPacket().crc();
-					FrameProcessResult procResults = processFrame();		// Process all packets
-
-					if (CPersistentSettings::instance()->getDataConfigLogTxEchos() ||
-						(!CPersistentSettings::instance()->getDataConfigLogTxEchos() && !bIsEcho) ||
-						(nExpectedCRC != m_rxBuffer.crc()) ||
-						!procResults.m_strLogDetail.isEmpty()) {
-						QByteArray baMessage(1, 0x7E);		// Add the 0x7E since it's eaten by the RxBuffer
-						baMessage.append(m_rxBuffer.rawData());
-						QString strExtraMessage = procResults.m_strLogDetail;
-						if (nExpectedCRC != m_rxBuffer.crc()) {
-							QString strCRCError = QString("*** Expected CRC of 0x%1, Received CRC of 0x%2")
-										.arg(QString("%1").arg(nExpectedCRC, 2, 16, QChar('0')).toUpper(),
-											QString("%1").arg(m_rxBuffer.crc(), 2, 16, QChar('0')).toUpper());
-							if (!strExtraMessage.isEmpty()) strExtraMessage += "  ";
-							strExtraMessage += strCRCError;
-						}
-						m_frskySportIO.logMessage(bIsEcho ? CFrskySportIO::LT_TXECHO : CFrskySportIO::LT_RX, baMessage, strExtraMessage);
-					}
-
-//					if (procResults.m_bAdvanceState) nextState();
-				}
-
-				m_rxBuffer.reset();
-			}
-		}
+	if (frame.m_nKind == SRFK_TELEMETRY_POLL) {
+		m_nPollNsecs = frame.m_nArrivalNsecs;		// Response latency is from when the poll arrived
+	} else if (!frame.m_bCrcValid) {
+		++m_nCrcErrorCount;
 	}
+	processFrame(frame);
+	if (pstrLogDetail) *pstrLogDetail = frame.m_rxBuffer.logDetails();
+}
+
+bool CFrskySportDeviceTelemetry::logTxEchos() const
+{
+	return CPersistentSettings::instance()->getDataConfigLogTxEchos();
 }
 
 // ============================================================================
@@ -160,8 +183,16 @@ CFrskySportDeviceTelemetry::CFrskySportDeviceTelemetry(CFrskySportIO &frskySport
 		m_frskySportIO(frskySportIO),
 		m_pUICallback(pUICallback)
 {
-	connect(&m_frskySportIO.port(), SIGNAL(readyRead()), this, SLOT(en_readyRead()));
-	connect(this, SIGNAL(dataAvailable()), this, SLOT(en_receive()), Qt::QueuedConnection);
+	m_frskySportIO.addRxHandler(this, SRFK_MASK_ALL);
+
+	m_busStats.reset(m_frskySportIO.elapsedNsecs());
+
+	connect(&m_tmrBusStatsLog, &QTimer::timeout, this, [this]()->void {
+		if (m_frskySportIO.logWanted(CFrskySportIO::LT_STATS)) {
+			m_frskySportIO.logMessage(CFrskySportIO::LT_STATS, QByteArray(), busStatsSummary());
+		}
+	});
+	setBusStatsLogInterval(DEFAULT_BUS_STATS_LOG_INTERVAL);
 
 	if (pUICallback) {
 		pUICallback->hookCancel(this, SLOT(en_userCancel()));
@@ -170,6 +201,7 @@ CFrskySportDeviceTelemetry::CFrskySportDeviceTelemetry(CFrskySportIO &frskySport
 
 CFrskySportDeviceTelemetry::~CFrskySportDeviceTelemetry()
 {
+	m_frskySportIO.removeRxHandler(this);
 }
 
 // ----------------------------------------------------------------------------
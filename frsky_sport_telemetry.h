@@ -24,20 +24,28 @@
 #define FRSKY_SPORT_TELEMETRY_H
 
 #include "frsky_sport_io.h"
+#include "frsky_sport_bus_stats.h"
+#include "frsky_sport_sensor_store.h"
+#include "frsky_sport_timeseries.h"
 
 #include <QObject>
 #include <QString>
 #include <QPointer>
 #include <QQueue>
+#include <QTimer>
+
+#include <functional>
 
 #include <assert.h>
 
 // Forward Declarations
 class CUICallback;
+class CSportShmPublisher;
+class CSportStreamQueue;
 
 // ============================================================================
 
-class CFrskySportDeviceTelemetry : public QObject
+class CFrskySportDeviceTelemetry : public QObject, public CSportRxHandler
 {
 	Q_OBJECT
 
@@ -57,54 +65,119 @@ public:
 	bool isTelemetryPushAvailable(int nPhysicalId) const
 	{
 		assert(nPhysicalId < TELEMETRY_PHYS_ID_COUNT);
-		return !m_telemetryEndpoints[nPhysicalId].m_bInUse;
+		return (m_telemetryEndpoints[nPhysicalId].m_nPushCount < TELEMETRY_PUSH_QUEUE_SIZE);
+	}
+	int telemetryPushQueued(int nPhysicalId) const		// Pushed packets waiting for polls of nPhysicalId
+	{
+		assert(nPhysicalId < TELEMETRY_PHYS_ID_COUNT);
+		return m_telemetryEndpoints[nPhysicalId].m_nPushCount;
 	}
 	void resetTelemetry()
 	{
 		for (int i = 0; i < TELEMETRY_PHYS_ID_COUNT; ++i) {
 			m_telemetryEndpoints[i].m_bReceivingPolls = false;
-			m_telemetryEndpoints[i].m_bInUse = false;
-			m_telemetryEndpoints[i].m_strLogDetail.clear();
+			m_telemetryEndpoints[i].m_nPushHead = 0;
+			m_telemetryEndpoints[i].m_nPushCount = 0;
+			m_telemetryEndpoints[i].m_pushStats = TPushQueueStats();
 		}
 	}
 
+	// Push queue statistics, for one physical ID, or for all of them
+	//	(nPhysicalId = -1):
+	struct TPushQueueStats {
+		uint32_t m_nPushed = 0;				// Packets queued for transmit on poll
+		uint32_t m_nRejected = 0;			// Packets rejected because the queue was full
+		uint32_t m_nSent = 0;				// Packets sent in response to polls
+		int m_nMaxOccupancy = 0;			// Most packets waiting at once
+		qint64 m_nTotalWaitNsecs = 0;		// Total time sent packets waited for their poll
+		qint64 m_nMaxWaitNsecs = 0;			// Longest time a sent packet waited for its poll
+	};
+	TPushQueueStats pushQueueStats(int nPhysicalId = -1) const;
+	uint32_t unpolledTxCount() const { return m_nUnpolledTxCount; }		// Immediate (un-polled) transmits while polls were being received -- these can collide with the polling
+	uint32_t crcErrorCount() const { return m_nCrcErrorCount; }			// Received packets with CRC errors
+
+	// Poll response latency and bus utilisation, see CSportBusStats.  The
+	//	summary is also logged periodically (as an LT_STATS log message):
+	static constexpr int DEFAULT_BUS_STATS_LOG_INTERVAL = 10000;		// Default summary log interval in msecs
+	const CSportBusStats &busStats() const { return m_busStats; }
+	QString busStatsSummary() const;					// Includes the port's transmit echo summary
+	void resetBusStats() { m_busStats.reset(m_frskySportIO.elapsedNsecs()); }
+	void setBusStatsLogInterval(int nMsecs);			// 0 = don't log
+
+	// Last value of each sensor received (data frames with good CRCs),
+	//	readable from any thread, see CSportSensorStore:
+	const CSportSensorStore &sensorStore() const { return m_sensorStore; }
+	void resetSensorStore() { m_sensorStore.reset(); }		// Only from this object's thread
+
+	// Optional sensor history, fed alongside the sensor store.  The store
+	//	is owned by the caller, so it can outlive this object and be shared
+	//	with the GUI.  Pass nullptr to stop recording:
+	void setTimeSeriesStore(CSportTimeSeriesStore *pStore) { m_pTimeSeriesStore = pStore; }
+	CSportTimeSeriesStore *timeSeriesStore() const { return m_pTimeSeriesStore; }
+
+	// Optional shared memory publisher, fed alongside the sensor store, for
+	//	other programs to read the telemetry.  Also owned by the caller.
+	//	Pass nullptr to stop publishing:
+	void setShmPublisher(CSportShmPublisher *pPublisher) { m_pShmPublisher = pPublisher; }
+	CSportShmPublisher *shmPublisher() const { return m_pShmPublisher; }
+
+	// Optional stream server queue (see CSportStreamServer::queue()), fed
+	//	alongside the sensor store, on this handler's port.  Also owned by
+	//	the caller.  Pass nullptr to stop streaming:
+	void setStreamQueue(CSportStreamQueue *pQueue) { m_pStreamQueue = pQueue; }
+	CSportStreamQueue *streamQueue() const { return m_pStreamQueue; }
+
+	// Direct receive consumer, called from processFrame() for each received
+	//	telemetry packet ahead of the rxSportPacket signal, without going
+	//	through signal/slot dispatch.  Pass nullptr to remove it:
+	typedef std::function<void (const CSportTelemetryPacket &packet)> TRxPacketSink;
+	void setRxPacketSink(const TRxPacketSink &fnSink) { m_fnRxPacketSink = fnSink; }
+
 public slots:
 	// Immediate Transmit:
 	void txSportPacket(const CSportTelemetryPacket &packet, const QString &strLogDetail = QString(), bool bIsPushResponse = false);
-	// Push Transmit:
+	// Push Transmit (queued until polled, see isTelemetryPushAvailable()):
 	void pushTelemetryResponse(const CSportTelemetryPacket &packet, const QString &strLogDetail = QString());
 
 signals:
-	void rxSportPacket(const CSportTelemetryPacket &packet);		// Emitted when m_rxBuffer has a Sport Telemetry packet for consumer (like Lua) to process
-
-	// Private:
-	void dataAvailable();
+	void rxSportPacket(const CSportTelemetryPacket &packet);		// Emitted when a Sport Telemetry packet is received for consumer (like Lua) to process
 
 protected slots:
-	void en_readyRead();
-	void en_receive();
-	// ----
 	void en_userCancel();
 
 protected:
-	struct FrameProcessResult				// Result from processFrame()
-	{
-//		bool m_bAdvanceState = false;		// If true, then call nextState to advance state-machine
-		QString m_strLogDetail;				// Additional log file detail to add to message being processed
-	};
-	FrameProcessResult processFrame();		// Process the current frame in m_rxBuffer
+	void processFrame(const TSportRxFrame &frame);		// Process a received frame
+
+	// CSportRxHandler:
+	virtual void rxBytes(int nBytes, qint64 nArrivalNsecs) override;
+	virtual void rxFrame(const TSportRxFrame &frame, QString *pstrLogDetail) override;
+	virtual bool logTxEchos() const override;
 
 protected:
 	// -----
-	CSportRxBuffer m_rxBuffer;				// Receive Sport Packet buffer from serial en_receive events
-	CSportTxBuffer m_txBufferLast;			// Last Transmit Sport Packet buffer -- used to detect echos
-
+	static constexpr int TELEMETRY_PUSH_QUEUE_SIZE = 8;		// Packets that can wait for polls on each physical ID
+	struct TPushEntry {
+		CSportTelemetryPacket m_packet;			// Packet to transmit in response to poll (such as Lua push)
+		QString m_strLogDetail;					// Detail to log when pushing it
+		qint64 m_nQueuedNsecs = 0;				// m_frskySportIO.elapsedNsecs() time it was queued
+	};
 	struct {
 		bool m_bReceivingPolls = false;			// True when this telemetry physical ID is receiving polls
-		CSportTelemetryPacket m_responsePacket;	// Packet to transmit in response to poll (such as Lua push)
-		QString m_strLogDetail;					// Detail to log when pushing it
-		bool m_bInUse = false;					// True when the response packet is in use (ready to be sent and not available to populate)
+		TPushEntry m_arrPushQueue[TELEMETRY_PUSH_QUEUE_SIZE];	// FIFO of packets to send, one per poll
+		int m_nPushHead = 0;					// Index of oldest packet in m_arrPushQueue
+		int m_nPushCount = 0;					// Number of packets in m_arrPushQueue
+		TPushQueueStats m_pushStats;
 	} m_telemetryEndpoints[TELEMETRY_PHYS_ID_COUNT];
+	qint64 m_nPollNsecs = 0;				// m_frskySportIO.elapsedNsecs() time the current poll arrived
+	CSportBusStats m_busStats;
+	CSportSensorStore m_sensorStore;		// Fed from processFrame()
+	CSportTimeSeriesStore *m_pTimeSeriesStore = nullptr;	// Optional history, fed from processFrame()
+	CSportShmPublisher *m_pShmPublisher = nullptr;		// Optional shared memory publisher, fed from processFrame()
+	CSportStreamQueue *m_pStreamQueue = nullptr;		// Optional stream server queue, fed from processFrame()
+	QTimer m_tmrBusStatsLog;				// Periodic bus statistics summary logging
+	uint32_t m_nUnpolledTxCount = 0;		// Immediate transmits made while receiving polls
+	uint32_t m_nCrcErrorCount = 0;			// Received packets with bad CRC
+	TRxPacketSink m_fnRxPacketSink;			// Optional direct consumer of received telemetry packets (like Lua)
 
 	QString m_strLastError;					// Last error to report
 	CFrskySportIO &m_frskySportIO;			// Serial Port handler for Sport I/O
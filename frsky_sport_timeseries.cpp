@@ -0,0 +1,376 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#include "frsky_sport_timeseries.h"
+#include "frsky_sport_sensor_store.h"
+
+#include <QMutexLocker>
+#include <QFile>
+#include <QTextStream>
+
+#include <algorithm>
+
+// ============================================================================
+
+int CSportTimeSeries::TRing::lowerBound(int64_t nTimestampNsecs) const
+{
+	int nLow = 0;
+	int nHigh = m_nCount;
+	while (nLow < nHigh) {
+		int nMid = (nLow + nHigh) / 2;
+		if (m_arrTimestamps.at(index(nMid)) < nTimestampNsecs) {
+			nLow = nMid + 1;
+		} else {
+			nHigh = nMid;
+		}
+	}
+	return nLow;
+}
+
+int64_t CSportTimeSeries::TRing::firstStart(int64_t nFromNsecs) const
+{
+	// Buckets starting up to a bucket width before nFromNsecs overlap it:
+	if (m_nBucketNsecs == 0) return nFromNsecs;
+	return (nFromNsecs > (INT64_MIN + m_nBucketNsecs)) ? (nFromNsecs - m_nBucketNsecs + 1) : INT64_MIN;
+}
+
+CSportTimeSeries::TPoint CSportTimeSeries::TRing::point(int nLogical) const
+{
+	TPoint pt;
+	int ndx = index(nLogical);
+	pt.m_nTimestampNsecs = m_arrTimestamps.at(ndx);
+	if (m_nBucketNsecs) {
+		pt.m_nMin = m_arrMin.at(ndx);
+		pt.m_nMax = m_arrMax.at(ndx);
+		pt.m_nSum = m_arrSum.at(ndx);
+		pt.m_nCount = m_arrCount.at(ndx);
+	} else {
+		pt.m_nMin = m_arrMin.at(ndx);
+		pt.m_nMax = pt.m_nMin;
+		pt.m_nSum = pt.m_nMin;
+		pt.m_nCount = 1;
+	}
+	return pt;
+}
+
+void CSportTimeSeries::TRing::push(const TPoint &point)
+{
+	int ndx;
+	if (m_nCount < capacity()) {
+		ndx = index(m_nCount++);
+	} else {
+		ndx = m_nHead;				// Overwrite the oldest
+		m_nHead = (m_nHead + 1) % capacity();
+	}
+	m_arrTimestamps[ndx] = point.m_nTimestampNsecs;
+	m_arrMin[ndx] = point.m_nMin;
+	if (m_nBucketNsecs) {
+		m_arrMax[ndx] = point.m_nMax;
+		m_arrSum[ndx] = point.m_nSum;
+		m_arrCount[ndx] = point.m_nCount;
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+CSportTimeSeries::CSportTimeSeries(int nRawCapacity)
+{
+	const int arrCapacity[TIER_COUNT] = { std::max(nRawCapacity, 1), DEFAULT_1S_CAPACITY, DEFAULT_1MIN_CAPACITY };
+	for (int nTier = 0; nTier < TIER_COUNT; ++nTier) {
+		TRing &ring = m_arrRings[nTier];
+		ring.m_nBucketNsecs = tierBucketNsecs(static_cast<TIER>(nTier));
+		ring.m_arrTimestamps.resize(arrCapacity[nTier]);
+		ring.m_arrMin.resize(arrCapacity[nTier]);
+		if (ring.m_nBucketNsecs) {
+			ring.m_arrMax.resize(arrCapacity[nTier]);
+			ring.m_arrSum.resize(arrCapacity[nTier]);
+			ring.m_arrCount.resize(arrCapacity[nTier]);
+		}
+	}
+}
+
+int64_t CSportTimeSeries::tierBucketNsecs(TIER nTier)
+{
+	switch (nTier) {
+		case TIER_1S:
+			return 1000000000LL;
+		case TIER_1MIN:
+			return 60000000000LL;
+		default:
+			return 0;
+	}
+}
+
+void CSportTimeSeries::insert(int64_t nTimestampNsecs, int32_t nValue)
+{
+	if (nTimestampNsecs < m_nLatestNsecs) nTimestampNsecs = m_nLatestNsecs;		// Keep the rings sorted
+	m_nLatestNsecs = nTimestampNsecs;
+	++m_nInsertCount;
+
+	TPoint pt;
+	pt.m_nTimestampNsecs = nTimestampNsecs;
+	pt.m_nMin = nValue;
+	m_arrRings[TIER_RAW].push(pt);
+
+	for (int nTier = TIER_RAW+1; nTier < TIER_COUNT; ++nTier) {
+		TRing &ring = m_arrRings[nTier];
+		int64_t nBucketStart = nTimestampNsecs - (nTimestampNsecs % ring.m_nBucketNsecs);
+		TPoint &current = ring.m_current;
+		if (current.m_nCount && (current.m_nTimestampNsecs != nBucketStart)) {
+			ring.push(current);
+			current.m_nCount = 0;
+		}
+		if (current.m_nCount == 0) {
+			current.m_nTimestampNsecs = nBucketStart;
+			current.m_nMin = nValue;
+			current.m_nMax = nValue;
+			current.m_nSum = 0;
+		} else {
+			if (nValue < current.m_nMin) current.m_nMin = nValue;
+			if (nValue > current.m_nMax) current.m_nMax = nValue;
+		}
+		current.m_nSum += nValue;
+		++current.m_nCount;
+	}
+}
+
+void CSportTimeSeries::clear()
+{
+	for (auto &ring : m_arrRings) {
+		ring.m_nHead = 0;
+		ring.m_nCount = 0;
+		ring.m_current = TPoint();
+	}
+	m_nLatestNsecs = -1;
+	m_nInsertCount = 0;
+}
+
+int CSportTimeSeries::size(TIER nTier) const
+{
+	const TRing &ring = m_arrRings[nTier];
+	return ring.m_nCount + (ring.m_current.m_nCount ? 1 : 0);
+}
+
+int64_t CSportTimeSeries::oldestTimestamp(TIER nTier) const
+{
+	const TRing &ring = m_arrRings[nTier];
+	if (ring.m_nCount) return ring.m_arrTimestamps.at(ring.m_nHead);
+	if (ring.m_current.m_nCount) return ring.m_current.m_nTimestampNsecs;
+	return -1;
+}
+
+size_t CSportTimeSeries::memoryUsage() const
+{
+	size_t nBytes = 0;
+	for (auto const &ring : m_arrRings) {
+		nBytes += ring.m_arrTimestamps.size() * sizeof(int64_t) +
+					ring.m_arrMin.size() * sizeof(int32_t) +
+					ring.m_arrMax.size() * sizeof(int32_t) +
+					ring.m_arrSum.size() * sizeof(int64_t) +
+					ring.m_arrCount.size() * sizeof(uint32_t);
+	}
+	return nBytes;
+}
+
+void CSportTimeSeries::range(TIER nTier, int64_t nFromNsecs, int64_t nToNsecs, QVector<TPoint> &arrPoints) const
+{
+	const TRing &ring = m_arrRings[nTier];
+	int64_t nFirstStart = ring.firstStart(nFromNsecs);
+	arrPoints.reserve(arrPoints.size() + rangeCount(nTier, nFromNsecs, nToNsecs));
+	for (int nLogical = ring.lowerBound(nFirstStart); nLogical < ring.m_nCount; ++nLogical) {
+		if (ring.m_arrTimestamps.at(ring.index(nLogical)) > nToNsecs) return;
+		arrPoints.append(ring.point(nLogical));
+	}
+	if (ring.m_current.m_nCount &&
+		(ring.m_current.m_nTimestampNsecs >= nFirstStart) &&
+		(ring.m_current.m_nTimestampNsecs <= nToNsecs)) {
+		arrPoints.append(ring.m_current);
+	}
+}
+
+int CSportTimeSeries::rangeCount(TIER nTier, int64_t nFromNsecs, int64_t nToNsecs) const
+{
+	const TRing &ring = m_arrRings[nTier];
+	if (nToNsecs < nFromNsecs) return 0;
+	int64_t nFirstStart = ring.firstStart(nFromNsecs);
+	int nCount = ring.lowerBound((nToNsecs < INT64_MAX) ? (nToNsecs + 1) : nToNsecs) - ring.lowerBound(nFirstStart);
+	if (ring.m_current.m_nCount &&
+		(ring.m_current.m_nTimestampNsecs >= nFirstStart) &&
+		(ring.m_current.m_nTimestampNsecs <= nToNsecs)) {
+		++nCount;
+	}
+	return nCount;
+}
+
+CSportTimeSeries::TIER CSportTimeSeries::tierFor(int64_t nFromNsecs, int64_t nToNsecs, int nMaxPoints) const
+{
+	for (int nTier = TIER_RAW; nTier < TIER_COUNT-1; ++nTier) {
+		int64_t nOldest = oldestTimestamp(static_cast<TIER>(nTier));
+		// A full ring has lost the start of the history:
+		bool bHoldsFrom = (m_arrRings[nTier].m_nCount < m_arrRings[nTier].capacity()) || (nOldest <= nFromNsecs);
+		if (bHoldsFrom && (rangeCount(static_cast<TIER>(nTier), nFromNsecs, nToNsecs) <= nMaxPoints)) {
+			return static_cast<TIER>(nTier);
+		}
+	}
+	return TIER_1MIN;
+}
+
+// ============================================================================
+
+CSportTimeSeriesStore::CSportTimeSeriesStore(int nRawCapacity)
+	:	m_nRawCapacity(nRawCapacity),
+		m_nInsertCount(0),
+		m_nDropped(0)
+{
+}
+
+QString CSportTimeSeriesStore::seriesName(uint32_t nKey)
+{
+	uint8_t nPhysId = seriesPhysicalId(nKey);
+	uint16_t nDataId = seriesDataId(nKey);
+	int nType = CSportSensorStore::dataIdType(nDataId);
+	if (nType < 0) return QString("0x%1(%2)").arg(nDataId, 4, 16, QChar('0')).arg(nPhysId);
+	const TDataIDNames &dataIDName = telemetryDataIDNames()[nType];
+	if (dataIDName.m_nFirstID != dataIDName.m_nLastID) {
+		return QString("%1(%2:%3)").arg(dataIDName.m_strName).arg(nPhysId).arg(nDataId - dataIDName.m_nFirstID);
+	}
+	return QString("%1(%2)").arg(dataIDName.m_strName).arg(nPhysId);
+}
+
+void CSportTimeSeriesStore::insert(const CSportTelemetryPacket &packet, int64_t nNowNsecs)
+{
+	if (packet.getPrimId() != PRIM_ID_DATA_FRAME) return;
+	if ((packet.getPhysicalId() >= TELEMETRY_PHYS_ID_COUNT) || (packet.getDataId() == 0)) return;
+
+	uint32_t nKey = seriesKey(packet.getPhysicalId(), packet.getDataId());
+	QMutexLocker locker(&m_mutex);
+	QSharedPointer<CSportTimeSeries> &pSeries = m_mapSeries[nKey];
+	if (pSeries.isNull()) {
+		if (m_mapSeries.size() > MAX_SERIES) {
+			m_mapSeries.remove(nKey);
+			m_nDropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		pSeries.reset(new CSportTimeSeries(m_nRawCapacity));
+	}
+	pSeries->insert(nNowNsecs, static_cast<int32_t>(packet.getValue()));
+	m_nInsertCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CSportTimeSeriesStore::clear()
+{
+	QMutexLocker locker(&m_mutex);
+	m_mapSeries.clear();
+	m_nInsertCount.store(0, std::memory_order_relaxed);
+	m_nDropped.store(0, std::memory_order_relaxed);
+}
+
+QList<uint32_t> CSportTimeSeriesStore::seriesKeys() const
+{
+	QMutexLocker locker(&m_mutex);
+	QList<uint32_t> lstKeys = m_mapSeries.keys();
+	std::sort(lstKeys.begin(), lstKeys.end());
+	return lstKeys;
+}
+
+int CSportTimeSeriesStore::seriesCount() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_mapSeries.size();
+}
+
+bool CSportTimeSeriesStore::range(uint32_t nKey, TIER nTier, int64_t nFromNsecs, int64_t nToNsecs, QVector<TPoint> &arrPoints) const
+{
+	QMutexLocker locker(&m_mutex);
+	auto itrSeries = m_mapSeries.constFind(nKey);
+	if (itrSeries == m_mapSeries.constEnd()) return false;
+	itrSeries.value()->range(nTier, nFromNsecs, nToNsecs, arrPoints);
+	return true;
+}
+
+CSportTimeSeriesStore::TIER CSportTimeSeriesStore::tierFor(uint32_t nKey, int64_t nFromNsecs, int64_t nToNsecs, int nMaxPoints) const
+{
+	QMutexLocker locker(&m_mutex);
+	auto itrSeries = m_mapSeries.constFind(nKey);
+	if (itrSeries == m_mapSeries.constEnd()) return CSportTimeSeries::TIER_RAW;
+	return itrSeries.value()->tierFor(nFromNsecs, nToNsecs, nMaxPoints);
+}
+
+int64_t CSportTimeSeriesStore::latestTimestamp() const
+{
+	QMutexLocker locker(&m_mutex);
+	int64_t nLatest = -1;
+	for (auto const &pSeries : m_mapSeries) {
+		nLatest = std::max(nLatest, pSeries->latestTimestamp());
+	}
+	return nLatest;
+}
+
+QString CSportTimeSeriesStore::summary() const
+{
+	QMutexLocker locker(&m_mutex);
+	size_t nBytes = 0;
+	for (auto const &pSeries : m_mapSeries) {
+		nBytes += pSeries->memoryUsage();
+	}
+	return QString("Time Series: %1 series, %2 samples, %3 dropped, %4 KB")
+				.arg(m_mapSeries.size())
+				.arg(insertCount())
+				.arg(droppedCount())
+				.arg(nBytes/1024);
+}
+
+bool CSportTimeSeriesStore::writeCsv(const QString &strFilename, TIER nTier, QString *pstrError) const
+{
+	QFile fileCsv(strFilename);
+	if (!fileCsv.open(QIODevice::WriteOnly | QIODevice::Text)) {
+		if (pstrError) *pstrError = fileCsv.errorString();
+		return false;
+	}
+
+	QTextStream tsCsv(&fileCsv);
+	tsCsv << "PhysId,DataId,Name,Time,Min,Max,Avg,Count\n";
+	for (uint32_t nKey : seriesKeys()) {
+		QVector<TPoint> arrPoints;
+		range(nKey, nTier, INT64_MIN, INT64_MAX, arrPoints);		// Locks per series, so the receive path isn't held up for the whole file
+		QString strPrefix = QString("%1,0x%2,\"%3\",").arg(seriesPhysicalId(nKey))
+								.arg(seriesDataId(nKey), 4, 16, QChar('0'))
+								.arg(seriesName(nKey));
+		for (auto const &pt : arrPoints) {
+			tsCsv << strPrefix
+					<< QString::number(pt.m_nTimestampNsecs/1.0e9, 'f', 6) << ","
+					<< pt.m_nMin << "," << pt.m_nMax << ","
+					<< QString::number(pt.avg(), 'f', 3) << ","
+					<< pt.m_nCount << "\n";
+		}
+	}
+	tsCsv.flush();
+	fileCsv.close();
+	if (fileCsv.error() != QFileDevice::NoError) {
+		if (pstrError) *pstrError = fileCsv.errorString();
+		return false;
+	}
+	return true;
+}
+
+// ============================================================================
+
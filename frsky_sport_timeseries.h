@@ -0,0 +1,172 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+#ifndef FRSKY_SPORT_TIMESERIES_H
+#define FRSKY_SPORT_TIMESERIES_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSharedPointer>
+
+#include <atomic>
+
+#include <stdint.h>
+
+#include "frsky_sport_io.h"
+
+// ============================================================================
+
+//
+// History of one telemetry sensor, kept as column rings (timestamps and
+//	values in separate arrays) of fixed size, so memory use doesn't grow
+//	with the length of the session.  Besides the raw samples, there are
+//	1 second and 1 minute tiers of min/max/avg buckets, updated as each
+//	sample is inserted, that keep history for much longer than the raw
+//	ring does.  Timestamps are nanoseconds on the caller's time base and
+//	must not go backwards (earlier ones are taken as the latest time).
+//
+// Not thread-safe on its own, see CSportTimeSeriesStore.
+//
+class CSportTimeSeries
+{
+public:
+	enum TIER {
+		TIER_RAW = 0,
+		TIER_1S = 1,
+		TIER_1MIN = 2,
+		// ----
+		TIER_COUNT
+	};
+
+	static constexpr int DEFAULT_RAW_CAPACITY = 16384;		// Raw samples, a few minutes at typical sensor rates
+	static constexpr int DEFAULT_1S_CAPACITY = 7200;		// 1 second buckets, 2 hours
+	static constexpr int DEFAULT_1MIN_CAPACITY = 1440;		// 1 minute buckets, 24 hours
+
+	struct TPoint {
+		int64_t m_nTimestampNsecs = 0;		// Sample time, or bucket start time
+		int32_t m_nMin = 0;
+		int32_t m_nMax = 0;
+		int64_t m_nSum = 0;
+		uint32_t m_nCount = 0;				// Samples in the bucket, 1 for raw samples
+
+		double avg() const { return m_nCount ? (static_cast<double>(m_nSum) / m_nCount) : 0.0; }
+	};
+
+	explicit CSportTimeSeries(int nRawCapacity = DEFAULT_RAW_CAPACITY);
+
+	void insert(int64_t nTimestampNsecs, int32_t nValue);
+	void clear();
+
+	static int64_t tierBucketNsecs(TIER nTier);		// 0 for TIER_RAW
+	int size(TIER nTier) const;						// Points held, including a partial bucket
+	int64_t oldestTimestamp(TIER nTier) const;		// Time of the oldest point held, -1 if none
+	int64_t latestTimestamp() const { return m_nLatestNsecs; }	// -1 if none
+	uint64_t insertCount() const { return m_nInsertCount; }
+	size_t memoryUsage() const;						// Bytes allocated for the rings
+
+	// Points of nTier covering nFromNsecs to nToNsecs (inclusive), oldest
+	//	first, appended to arrPoints.  Buckets are included if they
+	//	overlap the range at all, including the partial current bucket:
+	void range(TIER nTier, int64_t nFromNsecs, int64_t nToNsecs, QVector<TPoint> &arrPoints) const;
+	int rangeCount(TIER nTier, int64_t nFromNsecs, int64_t nToNsecs) const;
+	// Finest tier that both still holds nFromNsecs and has no more than
+	//	nMaxPoints points in the range, else TIER_1MIN:
+	TIER tierFor(int64_t nFromNsecs, int64_t nToNsecs, int nMaxPoints) const;
+
+private:
+	struct TRing {
+		int64_t m_nBucketNsecs = 0;				// 0 for the raw ring
+		QVector<int64_t> m_arrTimestamps;
+		QVector<int32_t> m_arrMin;				// Raw values for the raw ring
+		QVector<int32_t> m_arrMax;				// Empty for the raw ring, as are m_arrSum and m_arrCount
+		QVector<int64_t> m_arrSum;
+		QVector<uint32_t> m_arrCount;
+		int m_nHead = 0;						// Index of the oldest point
+		int m_nCount = 0;
+		TPoint m_current;						// Bucket being filled, when m_current.m_nCount != 0
+
+		int capacity() const { return m_arrTimestamps.size(); }
+		int index(int nLogical) const { return (m_nHead + nLogical) % capacity(); }
+		int64_t firstStart(int64_t nFromNsecs) const;		// Earliest start of a point overlapping nFromNsecs
+		int lowerBound(int64_t nTimestampNsecs) const;		// First logical index at or after nTimestampNsecs
+		TPoint point(int nLogical) const;
+		void push(const TPoint &point);
+	};
+
+	TRing m_arrRings[TIER_COUNT];
+	int64_t m_nLatestNsecs = -1;
+	uint64_t m_nInsertCount = 0;
+};
+
+// ============================================================================
+
+//
+// The telemetry history of every sensor seen (physical ID and DATA_ID
+//	pair), as CSportTimeSeries, for plots and post-session analysis.
+//	CFrskySportDeviceTelemetry feeds it from its receive path (see
+//	setTimeSeriesStore()), and it can be read from any thread, such as
+//	the GUI.  The number of series is capped, so memory use is bounded.
+//
+class CSportTimeSeriesStore
+{
+public:
+	static constexpr int MAX_SERIES = 128;		// Series beyond this are dropped
+
+	typedef CSportTimeSeries::TIER TIER;
+	typedef CSportTimeSeries::TPoint TPoint;
+
+	explicit CSportTimeSeriesStore(int nRawCapacity = CSportTimeSeries::DEFAULT_RAW_CAPACITY);
+
+	static uint32_t seriesKey(uint8_t nPhysicalId, uint16_t nDataId) { return (static_cast<uint32_t>(nPhysicalId) << 16) | nDataId; }
+	static uint8_t seriesPhysicalId(uint32_t nKey) { return static_cast<uint8_t>(nKey >> 16); }
+	static uint16_t seriesDataId(uint32_t nKey) { return static_cast<uint16_t>(nKey & 0xFFFF); }
+	static QString seriesName(uint32_t nKey);		// Such as "VFAS(2:0)"
+
+	void insert(const CSportTelemetryPacket &packet, int64_t nNowNsecs);	// Only data frames for telemetry physical IDs are stored
+	void clear();
+
+	QList<uint32_t> seriesKeys() const;		// Sorted
+	int seriesCount() const;
+	bool range(uint32_t nKey, TIER nTier, int64_t nFromNsecs, int64_t nToNsecs, QVector<TPoint> &arrPoints) const;	// False if there's no such series
+	TIER tierFor(uint32_t nKey, int64_t nFromNsecs, int64_t nToNsecs, int nMaxPoints) const;
+	int64_t latestTimestamp() const;		// Of all series, -1 if none
+
+	uint64_t insertCount() const { return m_nInsertCount.load(std::memory_order_relaxed); }		// Changes when there's new data, without locking
+	uint32_t droppedCount() const { return m_nDropped.load(std::memory_order_relaxed); }		// Samples dropped for exceeding MAX_SERIES
+
+	QString summary() const;
+	bool writeCsv(const QString &strFilename, TIER nTier, QString *pstrError = nullptr) const;
+
+private:
+	mutable QMutex m_mutex;
+	QHash<uint32_t, QSharedPointer<CSportTimeSeries> > m_mapSeries;
+	int m_nRawCapacity;
+	std::atomic<uint64_t> m_nInsertCount;
+	std::atomic<uint32_t> m_nDropped;
+};
+
+// ============================================================================
+
+#endif	// FRSKY_SPORT_TIMESERIES_H
@@ -0,0 +1,238 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+
+#include "LuaAllocator.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+
+CLuaAllocator::CLuaAllocator()
+	:	m_bPooling(true)
+{
+	for (auto & pFree : m_arrFreeLists) pFree = nullptr;
+	m_tmStart = std::chrono::steady_clock::now();
+}
+
+CLuaAllocator::~CLuaAllocator()
+{
+	reset();
+}
+
+void CLuaAllocator::reset()
+{
+	while (m_pPages) {
+		TPage *pPage = m_pPages;
+		m_pPages = pPage->m_pNext;
+		free(pPage);
+	}
+	m_pPageNext = nullptr;
+	m_pPageEnd = nullptr;
+	for (auto & pFree : m_arrFreeLists) pFree = nullptr;
+
+	m_bPooling = m_bUsePools;
+	m_stats = TStats();
+	m_nGcMark = 0;
+	m_tmStart = std::chrono::steady_clock::now();
+}
+
+double CLuaAllocator::allocationRate() const
+{
+	std::chrono::duration<double> dur = std::chrono::steady_clock::now() - m_tmStart;
+	if (dur.count() <= 0) return 0;
+	return m_stats.m_nTotalAllocBytes / dur.count();
+}
+
+void CLuaAllocator::noteGc(int64_t nNsecs, bool bFull)
+{
+	if (bFull) {
+		++m_stats.m_nGcFull;
+	} else {
+		++m_stats.m_nGcSteps;
+	}
+	m_stats.m_nGcTotalNsecs += nNsecs;
+	if (nNsecs > m_stats.m_nGcMaxNsecs) m_stats.m_nGcMaxNsecs = nNsecs;
+	m_nGcMark = m_stats.m_nTotalAllocBytes;
+}
+
+// ----------------------------------------------------------------------------
+
+void *CLuaAllocator::allocate(size_t nSize)
+{
+	if (!m_bPooling || (nSize > MAX_POOLED_SIZE)) {
+		void *pBlock = malloc(nSize);
+		if (pBlock) m_stats.m_nReservedBytes += nSize;
+		return pBlock;
+	}
+
+	size_t nClass = sizeClass(nSize);
+	TFreeBlock *pFree = m_arrFreeLists[nClass];
+	if (pFree) {
+		m_arrFreeLists[nClass] = pFree->m_pNext;
+		return pFree;
+	}
+
+	size_t nBlockSize = (nClass + 1) * SIZE_CLASS_GRANULE;
+	if (static_cast<size_t>(m_pPageEnd - m_pPageNext) < nBlockSize) {
+		// Give the rest of the current page to the free lists so it isn't wasted:
+		releaseRange(m_pPageNext, m_pPageEnd);
+		m_pPageNext = m_pPageEnd;
+
+		TPage *pPage = static_cast<TPage *>(malloc(PAGE_SIZE));
+		if (pPage == nullptr) return nullptr;
+		pPage->m_pNext = m_pPages;
+		m_pPages = pPage;
+		m_pPageNext = reinterpret_cast<char *>(pPage) + PAGE_HEADER_SIZE;
+		m_pPageEnd = reinterpret_cast<char *>(pPage) + PAGE_SIZE;
+		m_stats.m_nReservedBytes += PAGE_SIZE;
+	}
+
+	void *pBlock = m_pPageNext;
+	m_pPageNext += nBlockSize;
+	return pBlock;
+}
+
+void CLuaAllocator::release(void *pBlock, size_t nSize)
+{
+	if (!m_bPooling || (nSize > MAX_POOLED_SIZE)) {
+		free(pBlock);
+		m_stats.m_nReservedBytes -= nSize;
+		return;
+	}
+
+	size_t nClass = sizeClass(nSize);
+	TFreeBlock *pFree = static_cast<TFreeBlock *>(pBlock);
+	pFree->m_pNext = m_arrFreeLists[nClass];
+	m_arrFreeLists[nClass] = pFree;
+}
+
+void CLuaAllocator::releaseRange(char *pStart, char *pEnd)
+{
+	while (static_cast<size_t>(pEnd - pStart) >= SIZE_CLASS_GRANULE) {
+		size_t nSize = (static_cast<size_t>(pEnd - pStart) / SIZE_CLASS_GRANULE) * SIZE_CLASS_GRANULE;
+		if (nSize > MAX_POOLED_SIZE) nSize = MAX_POOLED_SIZE;
+		size_t nClass = sizeClass(nSize);
+		TFreeBlock *pFree = reinterpret_cast<TFreeBlock *>(pStart);
+		pFree->m_pNext = m_arrFreeLists[nClass];
+		m_arrFreeLists[nClass] = pFree;
+		pStart += nSize;
+	}
+}
+
+// Out of memory for a new page while shrinking a large (malloc'd) block to
+//	a pooled size.  Since it will be freed to the pools at that size, the
+//	block itself becomes a pool page, holding the shrunken block, with any
+//	space after it given to the free lists.  It's only grown (by less than
+//	a size class) if it's too small to also hold the page header:
+void *CLuaAllocator::adoptAsPage(void *pBlock, size_t nOldSize, size_t nNewSize)
+{
+	size_t nBlockSize = (sizeClass(nNewSize) + 1) * SIZE_CLASS_GRANULE;
+	size_t nPageSize = nOldSize;
+	if (nPageSize < (PAGE_HEADER_SIZE + nBlockSize)) {
+		nPageSize = PAGE_HEADER_SIZE + nBlockSize;
+		void *pGrown = realloc(pBlock, nPageSize);
+		if (pGrown == nullptr) return nullptr;
+		pBlock = pGrown;
+	}
+
+	char *pPageStart = static_cast<char *>(pBlock);
+	memmove(pPageStart + PAGE_HEADER_SIZE, pPageStart, nNewSize);
+	TPage *pPage = reinterpret_cast<TPage *>(pPageStart);
+	pPage->m_pNext = m_pPages;
+	m_pPages = pPage;
+	m_stats.m_nReservedBytes += nPageSize - nOldSize;
+	releaseRange(pPageStart + PAGE_HEADER_SIZE + nBlockSize, pPageStart + nPageSize);
+
+	return pPageStart + PAGE_HEADER_SIZE;
+}
+
+// ----------------------------------------------------------------------------
+
+void *CLuaAllocator::luaAlloc(void *pUserData, void *pBlock, size_t nOldSize, size_t nNewSize)
+{
+	CLuaAllocator *pThis = static_cast<CLuaAllocator *>(pUserData);
+	TStats &stats = pThis->m_stats;
+
+	// Note: when pBlock is nullptr, nOldSize is the Lua object type, not a size:
+	if (pBlock == nullptr) nOldSize = 0;
+
+	if (nNewSize == 0) {
+		if (pBlock) {
+			pThis->release(pBlock, nOldSize);
+			stats.m_nLiveBytes -= nOldSize;
+			++stats.m_nFreeCount;
+		}
+		return nullptr;
+	}
+
+	// Lua requires that shrinking never fails, so only growth counts against the limit:
+	if ((nNewSize > nOldSize) && pThis->m_nMemoryLimit &&
+		((stats.m_nLiveBytes - nOldSize + nNewSize) > pThis->m_nMemoryLimit)) {
+		++stats.m_nFailedCount;
+		return nullptr;
+	}
+
+	void *pNewBlock;
+	if (pBlock && pThis->m_bPooling && (nOldSize <= MAX_POOLED_SIZE) && (nNewSize <= MAX_POOLED_SIZE) &&
+		(sizeClass(nOldSize) == sizeClass(nNewSize))) {
+		pNewBlock = pBlock;				// Still fits in the same size class
+	} else if (pBlock && (!pThis->m_bPooling || ((nOldSize > MAX_POOLED_SIZE) && (nNewSize > MAX_POOLED_SIZE)))) {
+		pNewBlock = realloc(pBlock, nNewSize);
+		if (pNewBlock) stats.m_nReservedBytes += nNewSize - nOldSize;
+	} else {
+		pNewBlock = pThis->allocate(nNewSize);
+		if (pNewBlock && pBlock) {
+			memcpy(pNewBlock, pBlock, (nOldSize < nNewSize) ? nOldSize : nNewSize);
+			pThis->release(pBlock, nOldSize);
+		}
+	}
+
+	if ((pNewBlock == nullptr) && (nNewSize <= nOldSize)) {
+		// Out of system memory while shrinking.  Blocks are freed to the
+		//	pools or to free() by their size, so the block kept must be one
+		//	that's freed the same way at its new size:
+		if (pThis->m_bPooling && (nOldSize <= MAX_POOLED_SIZE)) {
+			pNewBlock = pBlock;			// Still big enough for the smaller size class's list it will be freed to
+		} else if (pThis->m_bPooling && (nNewSize <= MAX_POOLED_SIZE)) {
+			pNewBlock = pThis->adoptAsPage(pBlock, nOldSize, nNewSize);
+		} else {
+			pNewBlock = pBlock;			// Still malloc'd, reserved at the size it will be freed with
+			stats.m_nReservedBytes -= nOldSize - nNewSize;
+		}
+	}
+
+	if (pNewBlock == nullptr) {
+		++stats.m_nFailedCount;
+		return nullptr;
+	}
+
+	stats.m_nLiveBytes += nNewSize - nOldSize;
+	if (stats.m_nLiveBytes > stats.m_nPeakBytes) stats.m_nPeakBytes = stats.m_nLiveBytes;
+	if (nNewSize > nOldSize) stats.m_nTotalAllocBytes += nNewSize - nOldSize;
+	++stats.m_nAllocCount;
+
+	return pNewBlock;
+}
+
+// ============================================================================
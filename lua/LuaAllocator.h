@@ -0,0 +1,117 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+
+#ifndef LUA_ALLOCATOR_H
+#define LUA_ALLOCATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <chrono>
+
+// ============================================================================
+
+//
+// Memory allocator for the Lua state (the lua_Alloc given to lua_newstate).
+//	Lua allocates mostly small tables, strings, closures, and upvalues, and
+//	always tells the allocator the size of the block it's freeing, so blocks
+//	up to MAX_POOLED_SIZE are carved out of large pages into per size-class
+//	free lists with no per-block header.  Larger blocks go to malloc.
+//
+// It also does the memory accounting for the state (live/peak bytes and
+//	allocation totals), enforces an optional hard limit on the live bytes,
+//	like the radio's limited RAM, and tracks the allocation debt since the
+//	last garbage collection, which CLuaEngine uses to pace the GC.
+//
+class CLuaAllocator
+{
+public:
+	static constexpr size_t SIZE_CLASS_GRANULE = 16;		// Size classes are in multiples of this, which is also the block alignment
+	static constexpr size_t MAX_POOLED_SIZE = 256;			// Largest size allocated from the pools
+	static constexpr size_t NUM_SIZE_CLASSES = MAX_POOLED_SIZE/SIZE_CLASS_GRANULE;
+	static constexpr size_t PAGE_SIZE = 16384;				// Size of pages carved up for the pools
+
+	struct TStats {
+		size_t m_nLiveBytes = 0;			// Bytes currently allocated by Lua
+		size_t m_nPeakBytes = 0;			// High-water mark of m_nLiveBytes
+		size_t m_nReservedBytes = 0;		// Bytes of pool pages plus large blocks currently held from the system
+		uint64_t m_nTotalAllocBytes = 0;	// Total bytes ever allocated (or grown) by Lua
+		uint64_t m_nAllocCount = 0;			// Number of allocations (including reallocations)
+		uint64_t m_nFreeCount = 0;			// Number of frees
+		uint64_t m_nFailedCount = 0;		// Number of allocations refused by the memory limit (or the system)
+		// ----
+		uint64_t m_nGcSteps = 0;			// Number of incremental GC steps done
+		uint64_t m_nGcFull = 0;				// Number of full GC collections done
+		int64_t m_nGcTotalNsecs = 0;		// Total time spent in the GC
+		int64_t m_nGcMaxNsecs = 0;			// Longest single GC pause
+	};
+
+	CLuaAllocator();
+	~CLuaAllocator();
+
+	// The lua_Alloc function, pUserData being the CLuaAllocator:
+	static void *luaAlloc(void *pUserData, void *pBlock, size_t nOldSize, size_t nNewSize);
+
+	void reset();					// Releases all memory and clears the statistics -- only call once the Lua state using it is closed
+
+	void setUsePools(bool bUsePools) { m_bUsePools = bUsePools; }		// Pass everything through to malloc, for comparison (takes effect on reset)
+	bool usePools() const { return m_bUsePools; }
+	void setMemoryLimit(size_t nBytes) { m_nMemoryLimit = nBytes; }		// Hard limit on live bytes, 0 = unlimited
+	size_t memoryLimit() const { return m_nMemoryLimit; }
+
+	const TStats &stats() const { return m_stats; }
+	double allocationRate() const;	// Average bytes/sec allocated since reset
+
+	size_t gcDebt() const { return static_cast<size_t>(m_stats.m_nTotalAllocBytes - m_nGcMark); }	// Bytes allocated since the last noteGc()
+	void noteGc(int64_t nNsecs, bool bFull);	// Records a GC pause and clears the allocation debt
+
+protected:
+	void *allocate(size_t nSize);
+	void release(void *pBlock, size_t nSize);
+	void releaseRange(char *pStart, char *pEnd);		// Gives unused memory to the free lists, in the largest size classes that fit
+	void *adoptAsPage(void *pBlock, size_t nOldSize, size_t nNewSize);
+	static size_t sizeClass(size_t nSize) { return (nSize - 1) / SIZE_CLASS_GRANULE; }
+
+private:
+	struct TFreeBlock {
+		TFreeBlock *m_pNext;
+	};
+	struct TPage {
+		TPage *m_pNext;
+	};
+	static constexpr size_t PAGE_HEADER_SIZE = SIZE_CLASS_GRANULE;	// Keeps the blocks following the TPage aligned
+
+	bool m_bPooling;							// Pooling in effect for the current state (m_bUsePools at last reset)
+	bool m_bUsePools = true;
+	size_t m_nMemoryLimit = 0;
+	TFreeBlock *m_arrFreeLists[NUM_SIZE_CLASSES];	// Free blocks by size class
+	TPage *m_pPages = nullptr;					// All pages held, for releasing them on reset
+	char *m_pPageNext = nullptr;				// Unused part of the current page
+	char *m_pPageEnd = nullptr;
+	TStats m_stats;
+	uint64_t m_nGcMark = 0;						// m_stats.m_nTotalAllocBytes at last GC
+	std::chrono::steady_clock::time_point m_tmStart;
+};
+
+// ============================================================================
+
+#endif	// LUA_ALLOCATOR_H
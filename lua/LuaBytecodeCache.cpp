@@ -0,0 +1,208 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+
+#include "LuaBytecodeCache.h"
+
+extern "C" {
+#include <lua/lua.h>
+#include <lua/lualib.h>
+#include <lua/lauxlib.h>
+}
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDir>
+#include <QSaveFile>
+#include <QByteArray>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+
+#include <string.h>
+
+#ifndef LUA_VERSION_RELEASE_NUM
+#define LUA_VERSION_RELEASE_NUM (LUA_VERSION_NUM * 100)
+#endif
+
+// ============================================================================
+
+std::atomic<bool> CLuaBytecodeCache::g_bEnabled(true);
+std::atomic<int> CLuaBytecodeCache::g_nHits(0);
+std::atomic<int> CLuaBytecodeCache::g_nMisses(0);
+QMutex CLuaBytecodeCache::g_mutexMemory;
+QHash<QString, CLuaBytecodeCache::TMemoryEntry> CLuaBytecodeCache::g_mapMemory;
+
+namespace {
+	// Cache file layout is this header, followed by the UTF8 absolute
+	//	path of the script (m_nPathLength bytes), followed by the lua_dump
+	//	output.  The path is kept to guard against hash collisions:
+	struct TCacheHeader {
+		char m_szMagic[8];				// conszCacheMagic
+		uint32_t m_nLuaVersion;			// LUA_VERSION_RELEASE_NUM of the Lua that compiled it
+		uint32_t m_nPathLength;			// Length of the script path that follows
+		qint64 m_nMTime;				// Script's modification time in msecs since epoch
+		qint64 m_nSize;					// Script's size
+	};
+	const char conszCacheMagic[8] = "FSTLUAC";
+
+	int luaBytecodeWriter(lua_State *pState, const void *pData, size_t nSize, void *pUserData)
+	{
+		Q_UNUSED(pState);
+		static_cast<QByteArray *>(pUserData)->append(static_cast<const char *>(pData), nSize);
+		return 0;
+	}
+
+	bool isPrecompiled(const QString &strFilename)
+	{
+		QFile fileScript(strFilename);
+		char ch = 0;
+		return (fileScript.open(QIODevice::ReadOnly) && fileScript.getChar(&ch) && (ch == LUA_SIGNATURE[0]));
+	}
+};
+
+// ============================================================================
+
+QString CLuaBytecodeCache::cacheDir()
+{
+	return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/luac";
+}
+
+QString CLuaBytecodeCache::cacheFilename(const QString &strScriptPath)
+{
+	return cacheDir() + "/" +
+			QString::fromLatin1(QCryptographicHash::hash(strScriptPath.toUtf8(), QCryptographicHash::Sha1).toHex()) +
+			".luac";
+}
+
+bool CLuaBytecodeCache::clear()
+{
+	{
+		QMutexLocker locker(&g_mutexMemory);
+		g_mapMemory.clear();
+	}
+	return QDir(cacheDir()).removeRecursively();
+}
+
+bool CLuaBytecodeCache::findInMemory(const QString &strScriptPath, qint64 nMTime, qint64 nSize, QByteArray &baBytecode)
+{
+	QMutexLocker locker(&g_mutexMemory);
+	auto itr = g_mapMemory.constFind(strScriptPath);
+	if ((itr == g_mapMemory.constEnd()) ||
+		(itr->m_nMTime != nMTime) ||
+		(itr->m_nSize != nSize)) return false;
+	baBytecode = itr->m_baBytecode;		// Implicitly shared, so this doesn't copy the chunk
+	return true;
+}
+
+void CLuaBytecodeCache::addToMemory(const QString &strScriptPath, qint64 nMTime, qint64 nSize, const QByteArray &baBytecode)
+{
+	TMemoryEntry entry;
+	entry.m_nMTime = nMTime;
+	entry.m_nSize = nSize;
+	entry.m_baBytecode = baBytecode;
+	QMutexLocker locker(&g_mutexMemory);
+	g_mapMemory.insert(strScriptPath, entry);
+}
+
+int CLuaBytecodeCache::loadFile(lua_State *pState, const char *pFilename)
+{
+	QFileInfo fiScript(QString::fromUtf8(pFilename));
+	if (!g_bEnabled || !fiScript.isFile()) {
+		return luaL_loadfilex(pState, pFilename, nullptr);		// Let Lua handle it and report any error
+	}
+
+	QString strScriptPath = fiScript.absoluteFilePath();
+	QByteArray baPath = strScriptPath.toUtf8();
+	qint64 nMTime = fiScript.lastModified().toMSecsSinceEpoch();
+	qint64 nSize = fiScript.size();
+	QString strCacheFilename = cacheFilename(strScriptPath);
+	QByteArray baChunkName = "@" + QByteArray(pFilename);
+
+	// Try the memory cache, such as from another session running the same script:
+	QByteArray baMemory;
+	if (findInMemory(strScriptPath, nMTime, nSize, baMemory)) {
+		if (luaL_loadbufferx(pState, baMemory.constData(), baMemory.size(),
+								baChunkName.constData(), "b") == LUA_OK) {
+			++g_nHits;
+			return LUA_OK;
+		}
+		lua_pop(pState, 1);		// Pop error message -- fall back to the disk cache
+	}
+
+	// Try the disk cache:
+	QFile fileCache(strCacheFilename);
+	if (fileCache.open(QIODevice::ReadOnly)) {
+		QByteArray baCache = fileCache.readAll();
+		fileCache.close();
+
+		TCacheHeader hdr;
+		if (baCache.size() >= static_cast<int>(sizeof(hdr))) {
+			memcpy(&hdr, baCache.constData(), sizeof(hdr));
+			int nOffset = sizeof(hdr) + hdr.m_nPathLength;
+			if ((memcmp(hdr.m_szMagic, conszCacheMagic, sizeof(hdr.m_szMagic)) == 0) &&
+				(hdr.m_nLuaVersion == LUA_VERSION_RELEASE_NUM) &&
+				(hdr.m_nMTime == nMTime) &&
+				(hdr.m_nSize == nSize) &&
+				(hdr.m_nPathLength == static_cast<uint32_t>(baPath.size())) &&
+				(baCache.size() > nOffset) &&
+				(memcmp(baCache.constData() + sizeof(hdr), baPath.constData(), baPath.size()) == 0)) {
+				if (luaL_loadbufferx(pState, baCache.constData() + nOffset, baCache.size() - nOffset,
+										baChunkName.constData(), "b") == LUA_OK) {
+					addToMemory(strScriptPath, nMTime, nSize, baCache.mid(nOffset));
+					++g_nHits;
+					return LUA_OK;
+				}
+				lua_pop(pState, 1);		// Pop error message -- fall back to the source
+			}
+		}
+	}
+
+	// Compile the source and update the cache:
+	++g_nMisses;
+	int nStatus = luaL_loadfilex(pState, pFilename, nullptr);
+	if ((nStatus != LUA_OK) || isPrecompiled(fiScript.absoluteFilePath())) return nStatus;
+
+	QByteArray baBytecode;
+	TCacheHeader hdr;
+	memcpy(hdr.m_szMagic, conszCacheMagic, sizeof(hdr.m_szMagic));
+	hdr.m_nLuaVersion = LUA_VERSION_RELEASE_NUM;
+	hdr.m_nPathLength = baPath.size();
+	hdr.m_nMTime = nMTime;
+	hdr.m_nSize = nSize;
+	baBytecode.append(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+	baBytecode.append(baPath);
+	// Note: debug info is kept (strip == 0) so error messages still have line numbers:
+	if (lua_dump(pState, luaBytecodeWriter, &baBytecode, 0) == 0) {
+		addToMemory(strScriptPath, nMTime, nSize, baBytecode.mid(sizeof(hdr) + baPath.size()));
+		QDir().mkpath(cacheDir());
+		QSaveFile fileSave(strCacheFilename);
+		if (fileSave.open(QIODevice::WriteOnly)) {
+			fileSave.write(baBytecode);
+			fileSave.commit();		// Failing to cache isn't an error, it just means compiling again next time
+		}
+	}
+
+	return nStatus;
+}
+
+// ============================================================================
@@ -0,0 +1,89 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+
+#ifndef LUA_BYTECODE_CACHE_H
+#define LUA_BYTECODE_CACHE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+
+#include <atomic>
+
+// Forware Declarations
+struct lua_State;
+
+// ============================================================================
+
+//
+// On-disk cache of compiled Lua script chunks (from lua_dump), so that
+//	starting and switching scripts only has to read and undump them rather
+//	than parse the source.  Cache entries are keyed by the script's path,
+//	and are only used if the script's modification time and size and the
+//	Lua version all still match.  Scripts that are already precompiled are
+//	loaded as-is without caching.
+//
+// Chunks are also kept in memory, shared by all threads, so concurrent
+//	script sessions (such as one on each S.port) running the same script
+//	only compile or read it once.
+//
+class CLuaBytecodeCache
+{
+public:
+	// Loads the script file as a chunk on the top of the stack, the same as
+	//	luaL_loadfilex() does (including its return status and the error
+	//	message left on the stack for failures):
+	static int loadFile(lua_State *pState, const char *pFilename);
+
+	static void setEnabled(bool bEnabled) { g_bEnabled = bEnabled; }
+	static bool isEnabled() { return g_bEnabled; }
+
+	static QString cacheDir();			// Folder where the cached bytecode is stored
+	static bool clear();				// Removes all cached bytecode (both on-disk and in memory)
+
+	static int hits() { return g_nHits; }		// Number of loads satisfied from the cache
+	static int misses() { return g_nMisses; }	// Number of loads that had to compile the source
+
+protected:
+	static QString cacheFilename(const QString &strScriptPath);
+
+	struct TMemoryEntry {
+		qint64 m_nMTime = 0;			// Script's modification time in msecs since epoch
+		qint64 m_nSize = 0;				// Script's size
+		QByteArray m_baBytecode;		// lua_dump output
+	};
+	static bool findInMemory(const QString &strScriptPath, qint64 nMTime, qint64 nSize, QByteArray &baBytecode);
+	static void addToMemory(const QString &strScriptPath, qint64 nMTime, qint64 nSize, const QByteArray &baBytecode);
+
+private:
+	static std::atomic<bool> g_bEnabled;
+	static std::atomic<int> g_nHits;
+	static std::atomic<int> g_nMisses;
+	static QMutex g_mutexMemory;
+	static QHash<QString, TMemoryEntry> g_mapMemory;		// In memory chunks by absolute script path (guarded by g_mutexMemory)
+};
+
+// ============================================================================
+
+#endif	// LUA_BYTECODE_CACHE_H
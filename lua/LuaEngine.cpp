@@ -32,20 +32,33 @@ extern "C" {
 
 #include "defs.h"
 
-#include <QMessageBox>
 #include <QFile>
 #include <QByteArray>
+#include <QElapsedTimer>
+
+#include <algorithm>
 
 // Libraries to include:
 #include "LuaEvents.h"
 #include "LuaGeneral.h"
 #include "LuaLCD.h"
+#include "LuaBytecodeCache.h"
 
 // ============================================================================
 
 thread_local lua_State *CLuaEngine::g_pLSScripts = nullptr;
 thread_local CLuaEngine::InterpretterState CLuaEngine::g_luaState = CLuaEngine::INTERPRETER_NOT_RUNNING;
 thread_local QString CLuaEngine::g_strLuaStandaloneScriptPath;
+thread_local QPointer<CLuaEngine> CLuaEngine::g_luaEngine;
+thread_local CLuaAllocator CLuaEngine::g_luaAllocator;
+thread_local int CLuaEngine::g_nInstructionsLimit = CLuaEngine::DEFAULT_INSTRUCTIONS_LIMIT;
+thread_local qint64 CLuaEngine::g_nInstructionsCount = 0;
+thread_local int CLuaEngine::g_nInstructionsHookCount = 0;
+std::atomic<bool> CLuaEngine::g_bProfiling(false);
+thread_local CLuaProfiler CLuaEngine::g_luaProfiler;
+thread_local int CLuaEngine::g_nProfileInstructions = 0;
+QMutex CLuaEngine::g_mutexProfile;
+CLuaProfiler CLuaEngine::g_luaProfile;
 
 class CLuaPanic
 {
@@ -61,13 +74,58 @@ int CLuaEngine::luaPanic(lua_State *pState)
 	const char *msg = lua_tostring(pState, -1);
 	if (msg == nullptr) msg = "error object is not a string";
 
-	QMessageBox::critical(nullptr, QObject::tr("Lua Script Panic Error", "CLuaEngine"),
+	if (!g_luaEngine.isNull()) {
+		g_luaEngine->error(QObject::tr("Lua Script Panic Error", "CLuaEngine"),
 							QObject::tr("Lua Script Panic:", "CLuaEngine") + "\n\n" + msg);
+	}
 
 	throw CLuaPanic();
 	return 0;
 }
 
+void CLuaEngine::luaHook(lua_State *pState, lua_Debug *ar)
+{
+	if (ar->event == LUA_HOOKCOUNT) {
+		g_nInstructionsCount += g_nInstructionsHookCount;
+		if (g_bProfiling) {
+			// The hook interval depends on the limit, so sample on the
+			//	instructions executed, every SAMPLE_INTERVAL of them (the
+			//	interval is only longer than that if profiling was enabled
+			//	during the run):
+			g_nProfileInstructions += g_nInstructionsHookCount;
+			while (g_nProfileInstructions >= CLuaProfiler::SAMPLE_INTERVAL) {
+				g_nProfileInstructions -= CLuaProfiler::SAMPLE_INTERVAL;
+				g_luaProfiler.sample(pState);
+			}
+		}
+	}
+
+	if (luaInstructionsLimitExceeded()) {
+		// From now on, as soon as a line is executed, error, and
+		//	keep erroring until the script reaches the top (so that
+		//	a pcall() in the script can't keep it running):
+		lua_sethook(pState, luaHook, LUA_MASKLINE, 0);
+		luaL_error(pState, "CPU limit");
+	}
+}
+
+void CLuaEngine::luaSetInstructionsLimit(lua_State *pState, int nInstructions)
+{
+	// The hook is called every 1% of the limit, or every LUA_HOOK_COUNT_INTERVAL
+	//	instructions when unlimited, where it's only counting them for the run
+	//	statistics (so the count can be short by up to one interval), and at
+	//	least every profiler sample interval when profiling:
+	g_nInstructionsCount = 0;
+	g_nInstructionsHookCount = (nInstructions ? std::max(1, nInstructions/100) : LUA_HOOK_COUNT_INTERVAL);
+	if (g_bProfiling) g_nInstructionsHookCount = std::min(g_nInstructionsHookCount, int(CLuaProfiler::SAMPLE_INTERVAL));
+	lua_sethook(pState, luaHook, LUA_MASKCOUNT, g_nInstructionsHookCount);
+}
+
+bool CLuaEngine::luaInstructionsLimitExceeded()
+{
+	return (g_nInstructionsLimit && (g_nInstructionsCount > g_nInstructionsLimit));
+}
+
 void CLuaEngine::luaDisable()
 {
 	g_luaState = INTERPRETER_PANIC;
@@ -202,12 +260,12 @@ void CLuaEngine::luaRegisterLibraries(lua_State *pState)
 	my_luaL_openlibs(pState);
 	registerBitmapClass(pState);
 
-	// Load backward compatibility shims:
-	QFile file(":/lua/bit32.lua");
+	// Load backward compatibility shims (precompiled by luac during the build):
+	QFile file(":/lua/bit32.luac");
 	if (file.open(QIODevice::ReadOnly)) {
 		QByteArray baBit32 = file.readAll();
 		file.close();
-		int lstatus = luaL_loadbufferx(pState, baBit32.data(), baBit32.size(), "bit32", nullptr);
+		int lstatus = luaL_loadbufferx(pState, baBit32.data(), baBit32.size(), "bit32", "b");
 		if ((lstatus == LUA_OK) &&
 			((lstatus = lua_pcall(pState, 0, 1, 0)) == LUA_OK) &&
 			lua_istable(pState, -1)) {
@@ -217,12 +275,14 @@ void CLuaEngine::luaRegisterLibraries(lua_State *pState)
 			QString strMsg;
 			if (pMsg) strMsg = QString::fromUtf8(pMsg);		// TODO : UTF8 or Latin1 here?
 			if (strMsg.isEmpty()) strMsg = "???";
-			QMessageBox::critical(nullptr, QObject::tr("Lua Register Libraries Error", "CLuaEngine"),
+			if (!g_luaEngine.isNull()) {
+				g_luaEngine->error(QObject::tr("Lua Register Libraries Error", "CLuaEngine"),
 									QObject::tr("Failed to load internal bit32 compatibility library:", "CLuaEngine") + "\n\n" + strMsg);
+			}
 		}
-	} else {
-		QMessageBox::critical(nullptr, QObject::tr("Lua Register Libraries Error", "CLuaEngine"),
-								QObject::tr("Failed to load internal bit32 compatibility library from resources", "CLuaEngine"));
+	} else if (!g_luaEngine.isNull()) {
+		g_luaEngine->error(QObject::tr("Lua Register Libraries Error", "CLuaEngine"),
+							QObject::tr("Failed to load internal bit32 compatibility library from resources", "CLuaEngine"));
 	}
 }
 
@@ -241,8 +301,9 @@ CLuaEngine::ScriptState CLuaEngine::luaLoadScriptFileToState(lua_State *pState,
 	int lstatus;
 	ScriptState ret = SCRIPT_NOFILE;
 
-	// we don't pass <mode> on to loadfilex() because we want lua to load whatever file we specify, regardless of content
-	lstatus = luaL_loadfilex(pState, pFilename, nullptr);
+	// Like luaL_loadfilex() without <mode>, this loads whatever file we specify, regardless of content,
+	//	but uses the cached bytecode for source files that haven't changed since they were last compiled:
+	lstatus = CLuaBytecodeCache::loadFile(pState, pFilename);
 	if (lstatus == LUA_OK) {
 		ret = SCRIPT_OK;
 	} else {
@@ -266,6 +327,9 @@ CLuaEngine::ScriptState CLuaEngine::luaLoad(lua_State *pState, const char *pFile
 
 	sid.m_instructions = 0;
 	sid.m_state = SCRIPT_OK;
+	sid.m_runThread = 0;			// Any previous run thread went with the previous state
+	sid.m_pRunThread = nullptr;
+	sid.m_bRunSuspended = false;
 
 	if (sio) *sio = TScriptInputsOutputs();
 
@@ -273,9 +337,8 @@ CLuaEngine::ScriptState CLuaEngine::luaLoad(lua_State *pState, const char *pFile
 		return SCRIPT_PANIC;
 	}
 
-//	luaSetInstructionsLimit(L, MANUAL_SCRIPTS_MAX_INSTRUCTIONS);
-
 	LUA_TRY {
+		luaSetInstructionsLimit(pState, g_nInstructionsLimit);
 		sid.m_state = luaLoadScriptFileToState(pState, pFilename);
 		if ((sid.m_state == SCRIPT_OK) &&
 			((lstatus = lua_pcall(pState, 0, 1, 0)) == LUA_OK) &&
@@ -301,14 +364,15 @@ CLuaEngine::ScriptState CLuaEngine::luaLoad(lua_State *pState, const char *pFile
 			if (init) {
 				lua_rawgeti(pState, LUA_REGISTRYINDEX, init);
 				if (lua_pcall(pState, 0, 0, 0) != 0) {
-					sid.m_state = SCRIPT_SYNTAX_ERROR;
+					sid.m_state = (luaInstructionsLimitExceeded() ? SCRIPT_KILLED : SCRIPT_SYNTAX_ERROR);
 				}
 				luaL_unref(pState, LUA_REGISTRYINDEX, init);
 				lua_gc(pState, LUA_GCCOLLECT, 0);
 			}
 		} else if (sid.m_state == SCRIPT_OK) {
-			sid.m_state = SCRIPT_SYNTAX_ERROR;
+			sid.m_state = (luaInstructionsLimitExceeded() ? SCRIPT_KILLED : SCRIPT_SYNTAX_ERROR);
 		}
+		lua_sethook(pState, nullptr, 0, 0);
 	} LUA_CATCH(
 		luaDisable();
 		return SCRIPT_PANIC;
@@ -416,6 +480,7 @@ void CLuaEngine::luaFree(lua_State * pState, TScriptInternalData & sid)
 			luaL_unref(pState, LUA_REGISTRYINDEX, sid.m_background);
 			sid.m_background = 0;
 		}
+		luaReleaseRunThread(pState, sid);
 	} LUA_CATCH(
 		luaDisable();
 	)
@@ -427,10 +492,19 @@ void CLuaEngine::luaDoGc(lua_State * pState, bool bFull)
 {
 	if (pState) {
 		LUA_TRY {
-			if (bFull) {
-				lua_gc(pState, LUA_GCCOLLECT, 0);
-			} else {
-				lua_gc(pState, LUA_GCSTEP, 10);
+			// Incremental steps are paced by what the script actually
+			//	allocated since the last collection rather than a fixed
+			//	amount of work after every run:
+			size_t nDebt = g_luaAllocator.gcDebt();
+			if (bFull || (nDebt >= LUA_GC_MIN_DEBT)) {
+				QElapsedTimer tmrGc;
+				tmrGc.start();
+				if (bFull) {
+					lua_gc(pState, LUA_GCCOLLECT, 0);
+				} else {
+					lua_gc(pState, LUA_GCSTEP, static_cast<int>((nDebt + 1023) / 1024));	// Step as if the debt (in KB) was just allocated
+				}
+				g_luaAllocator.noteGc(tmrGc.nsecsElapsed(), bFull);
 			}
 		} LUA_CATCH(
 			// we disable Lua for the rest of the session
@@ -440,6 +514,16 @@ void CLuaEngine::luaDoGc(lua_State * pState, bool bFull)
 	}
 }
 
+void CLuaEngine::luaReleaseRunThread(lua_State * pState, TScriptInternalData & sid)
+{
+	if (sid.m_runThread) {
+		luaL_unref(pState, LUA_REGISTRYINDEX, sid.m_runThread);
+		sid.m_runThread = 0;
+	}
+	sid.m_pRunThread = nullptr;
+	sid.m_bRunSuspended = false;
+}
+
 // ----------------------------------------------------------------------------
 
 void CLuaEngine::luaInit()
@@ -447,9 +531,10 @@ void CLuaEngine::luaInit()
 //	std::function<void (lua_State *pState)> f_panic = [this](lua_State *pState) { luaPanic(pState); };
 
 	luaClose(&g_pLSScripts);
+	g_luaAllocator.reset();
 
 	if (g_luaState != INTERPRETER_PANIC) {
-		g_pLSScripts = luaL_newstate();
+		g_pLSScripts = lua_newstate(CLuaAllocator::luaAlloc, &g_luaAllocator);
 
 		if (g_pLSScripts) {
 			// install our panic handler
@@ -472,11 +557,17 @@ void CLuaEngine::luaInit()
 
 bool CLuaEngine::luaExec(const char *pFilename, TScriptInternalData &sid)
 {
+	QElapsedTimer tmrStartup;
+	tmrStartup.start();
+
 	init();
+	m_nLastInitNsecs = tmrStartup.nsecsElapsed();
+	m_nLastLoadNsecs = 0;
 
 	if (g_luaState != INTERPRETER_PANIC) {
 		sid.m_state = SCRIPT_NOFILE;
 		ScriptState result = luaLoad(g_pLSScripts, pFilename, sid);
+		m_nLastLoadNsecs = tmrStartup.nsecsElapsed() - m_nLastInitNsecs;
 		// TODO the same with run ...
 		if (result == SCRIPT_OK) {
 			g_luaState = INTERPRETER_RUNNING_STANDALONE_SCRIPT;
@@ -529,6 +620,11 @@ void CLuaEngine::luaError(lua_State * pState, ScriptState nError, const QString
 
 void CLuaEngine::init()
 {
+	// Apply this engine's limits to the thread's state before creating it:
+	g_luaAllocator.setMemoryLimit(m_nMemoryLimit);
+	g_luaAllocator.setUsePools(m_bUsePoolAllocator);
+	g_nInstructionsLimit = m_nInstructionsLimit;
+
 	luaInit();
 }
 
@@ -539,24 +635,30 @@ bool CLuaEngine::exec(const char *pFilename)
 
 void CLuaEngine::error(const QString &strTitle, const QString &strMessage, bool bAcknowledge)
 {
-	if (bAcknowledge) {
-		QMessageBox::warning(m_pParentWidget, strTitle, strMessage);
-	} else {
-		QMessageBox::warning(m_pParentWidget, strTitle, strMessage);		// TODO : Differentiate between Acknowledge true/false
-	}
+	// Note: The engine runs on its own thread, so the GUI must connect
+	//	with a queued connection and show the error on its own thread.
+	//	The engine doesn't wait for it to be acknowledged:
+	emit scriptError(strTitle, strMessage, bAcknowledge);
 }
 
 // ============================================================================
 
 
-CLuaEngine::CLuaEngine(QWidget *pParent)
-	:	QObject(pParent),
-		m_pParentWidget(pParent)
+CLuaEngine::CLuaEngine(QObject *pParent)
+	:	QObject(pParent)
 {
+	// Set the Lua Engine on this thread to be this one:
+	g_luaEngine = this;
 }
 
 CLuaEngine::~CLuaEngine()
 {
+	if (g_luaProfiler.sampleCount()) {
+		QMutexLocker locker(&g_mutexProfile);
+		g_luaProfile.merge(g_luaProfiler);
+		g_luaProfiler.clear();
+	}
+
 	if (g_pLSScripts) {
 		if (m_standaloneScript.m_state == SCRIPT_OK) {
 			luaFree(g_pLSScripts, m_standaloneScript);
@@ -565,7 +667,28 @@ CLuaEngine::~CLuaEngine()
 		luaDoGc(g_pLSScripts, true);
 
 		luaClose(&g_pLSScripts);
+		g_luaAllocator.reset();
+	}
+}
+
+// ============================================================================
+
+void CLuaEngine::setProfilingEnabled(bool bEnabled)
+{
+	if (bEnabled && !g_bProfiling) {
+		QMutexLocker locker(&g_mutexProfile);
+		g_luaProfile.clear();
+		g_luaProfiler.clear();
 	}
+	g_bProfiling = bEnabled;
+}
+
+CLuaProfiler CLuaEngine::profile()
+{
+	QMutexLocker locker(&g_mutexProfile);
+	CLuaProfiler profile = g_luaProfile;
+	profile.merge(g_luaProfiler);
+	return profile;
 }
 
 // ============================================================================
@@ -579,42 +702,114 @@ void CLuaEngine::execLuaScript(const QString &strFilename)
 
 void CLuaEngine::runLuaScript(event_t nEvt)
 {
-	QString strErrorMsg;
-
 	if (g_pLSScripts == nullptr) return;
 	if (m_standaloneScript.m_state != SCRIPT_OK) return;
 
+	if (m_standaloneScript.m_bRunSuspended) {
+		// The run function is waiting in sportRequest() and can't take
+		//	new events until it's resumed.  Only a forced exit gets through:
+		if (nEvt != EVT_KEY_LONG(KEY_EXIT)) return;
+		if (!CLuaGeneral::g_luaGeneral.isNull()) CLuaGeneral::g_luaGeneral->cancelSportRequests();
+		LUA_TRY {
+			luaReleaseRunThread(g_pLSScripts, m_standaloneScript);
+		} LUA_CATCH(
+			luaDisable();
+		)
+		emit killKeyEvent(nEvt);
+		m_standaloneScript.m_state = SCRIPT_NOFILE;
+		g_luaState = INTERPRETER_RELOAD_PERMANENT_SCRIPTS;
+		luaError(g_pLSScripts, m_standaloneScript.m_state, tr("Script force exit"));
+		return;
+	}
+
+	int nArgs = 0;
+	m_standaloneScript.m_nRunEvent = nEvt;
+
 	LUA_TRY {
 		if (m_standaloneScript.m_run) {
-//			luaSetInstructionsLimit(lsScripts, MANUAL_SCRIPTS_MAX_INSTRUCTIONS);
-			lua_rawgeti(g_pLSScripts, LUA_REGISTRYINDEX, m_standaloneScript.m_run);
-			lua_pushunsigned(g_pLSScripts, nEvt);
-			if (lua_pcall(g_pLSScripts, 1, 1, 0) == 0) {
-				if (!lua_isnumber(g_pLSScripts, -1)) {
-//					if (instructionsPercent > 100) {
-//						TRACE("Script killed");
-//						m_standaloneScript.m_state = SCRIPT_KILLED;
-//					} else
-					if (lua_isstring(g_pLSScripts, -1)) {
+			if (m_standaloneScript.m_pRunThread == nullptr) {
+				m_standaloneScript.m_pRunThread = lua_newthread(g_pLSScripts);
+				m_standaloneScript.m_runThread = luaL_ref(g_pLSScripts, LUA_REGISTRYINDEX);	// Pops thread
+			}
+			lua_rawgeti(m_standaloneScript.m_pRunThread, LUA_REGISTRYINDEX, m_standaloneScript.m_run);
+			lua_pushunsigned(m_standaloneScript.m_pRunThread, nEvt);
+			nArgs = 1;
+		}
+	} LUA_CATCH(
+		luaDisable();
+		return;
+	)
+
+	luaResumeRun(nArgs);
+}
+
+void CLuaEngine::resumeLuaScript()
+{
+	if (g_pLSScripts == nullptr) return;
+	if (!m_standaloneScript.m_bRunSuspended) return;
+
+	int nArgs = 0;
+	LUA_TRY {
+		if (!CLuaGeneral::g_luaGeneral.isNull()) {
+			nArgs = CLuaGeneral::g_luaGeneral->pushSportRequestResults(m_standaloneScript.m_pRunThread);
+		}
+	} LUA_CATCH(
+		luaDisable();
+		return;
+	)
+
+	luaResumeRun(nArgs);
+}
+
+void CLuaEngine::luaResumeRun(int nArgs)
+{
+	QString strErrorMsg;
+	event_t nEvt = m_standaloneScript.m_nRunEvent;
+
+	LUA_TRY {
+		lua_State *pThread = m_standaloneScript.m_pRunThread;
+		if (m_standaloneScript.m_run && pThread) {
+			int nResults = 0;
+			QElapsedTimer tmrRun;
+			luaSetInstructionsLimit(pThread, g_nInstructionsLimit);		// Each resume gets the full budget, since the event loop runs between them
+			tmrRun.start();
+			int nStatus = lua_resume(pThread, g_pLSScripts, nArgs, &nResults);
+			qint64 nRunNsecs = tmrRun.nsecsElapsed();
+			bool bKilled = ((nStatus != LUA_OK) && (nStatus != LUA_YIELD) && luaInstructionsLimitExceeded());
+			m_runStats.addRun(nRunNsecs, std::min<qint64>(g_nInstructionsCount, UINT32_MAX), bKilled);
+			if (g_nInstructionsLimit) m_standaloneScript.m_instructions = std::min<qint64>(g_nInstructionsCount * 100 / g_nInstructionsLimit, 255);
+			m_standaloneScript.m_bRunSuspended = (nStatus == LUA_YIELD);
+			if (nStatus == LUA_YIELD) {
+				// Waiting in sportRequest() for CLuaGeneral to signal resumeLuaScript():
+				lua_pop(pThread, nResults);
+			} else if (nStatus == LUA_OK) {
+				if (nResults == 0) lua_pushnil(pThread);
+				if (!lua_isnumber(pThread, -1)) {
+					if (lua_isstring(pThread, -1)) {
 						// TODO : Should this be UTF8 or Latin1?
-						QString strNextScript = QString::fromUtf8(lua_tostring(g_pLSScripts, -1));
+						QString strNextScript = QString::fromUtf8(lua_tostring(pThread, -1));
+						lua_settop(pThread, 0);
 						exec(strNextScript.toUtf8().data());
 					} else {
 						strErrorMsg = tr("Script run function returned unexpected value");
 						m_standaloneScript.m_state = SCRIPT_SYNTAX_ERROR;
 					}
 				} else {
-					int nScriptResult = lua_tointeger(g_pLSScripts, -1);
-					lua_pop(g_pLSScripts, 1);	//  pop returned value
+					int nScriptResult = lua_tointeger(pThread, -1);
+					lua_settop(pThread, 0);		// Leave the thread empty for reuse on the next run
 					if (nScriptResult != 0) {
 						strErrorMsg = tr("Script finished with status %1").arg(nScriptResult);
 						m_standaloneScript.m_state = SCRIPT_NOFILE;
 					}
 				}
+			} else if (bKilled) {
+				strErrorMsg = tr("Script exceeded its limit of %1 instructions per run").arg(g_nInstructionsLimit);
+				m_standaloneScript.m_state = SCRIPT_KILLED;
+				luaReleaseRunThread(g_pLSScripts, m_standaloneScript);		// A coroutine that errored is dead and can't be reused
 			} else {
-				strErrorMsg = tr("Script error: %1").arg(lua_tostring(g_pLSScripts, -1));
-//				m_standaloneScript.m_state = (instructionsPercent > 100 ? SCRIPT_KILLED : SCRIPT_SYNTAX_ERROR);
+				strErrorMsg = tr("Script error: %1").arg(lua_tostring(pThread, -1));
 				m_standaloneScript.m_state = SCRIPT_SYNTAX_ERROR;
+				luaReleaseRunThread(g_pLSScripts, m_standaloneScript);		// A coroutine that errored is dead and can't be reused
 			}
 
 			if (nEvt == EVT_KEY_LONG(KEY_EXIT)) {
@@ -632,6 +827,7 @@ void CLuaEngine::runLuaScript(event_t nEvt)
 
 	if (m_standaloneScript.m_state != SCRIPT_OK) {
 		g_luaState = INTERPRETER_RELOAD_PERMANENT_SCRIPTS;		// ??? Really want to do this?  Or only if m_state==SCRIPT_NOFILE ?
+		if (!CLuaGeneral::g_luaGeneral.isNull()) CLuaGeneral::g_luaGeneral->cancelSportRequests();
 		if (!strErrorMsg.isEmpty()) {
 			luaError(g_pLSScripts, m_standaloneScript.m_state, strErrorMsg);
 		}
@@ -641,6 +837,8 @@ void CLuaEngine::runLuaScript(event_t nEvt)
 	luaDoGc(g_pLSScripts, false);
 //	luaDoGc(g_pLSWidgets, false);		// TODO : Figure this out
 
+	// Publish whatever the script drew on this run:
+	if (!CLuaLCD::g_luaLCD.isNull()) CLuaLCD::g_luaLCD->endFrame();
 }
 
 
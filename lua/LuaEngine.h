@@ -26,12 +26,18 @@
 #include <QObject>
 #include <QString>
 #include <QPointer>
+#include <QMutex>
+
+#include <atomic>
 
 #include "LuaEvents.h"
+#include "LuaAllocator.h"
+#include "LuaRunStats.h"
+#include "LuaProfiler.h"
 
 // Forware Declarations
 struct lua_State;
-class QWidget;
+struct lua_Debug;
 
 // ============================================================================
 
@@ -76,7 +82,12 @@ public:
 		ScriptState m_state = SCRIPT_OK;
 		int m_run = 0;						// Run function in script
 		int m_background = 0;				// Background function in script
-		uint8_t m_instructions = 0;
+		uint8_t m_instructions = 0;			// Percent of the instructions limit used by the last run
+		// ----
+		int m_runThread = 0;				// Registry reference keeping m_pRunThread alive
+		lua_State *m_pRunThread = nullptr;	// Coroutine the run function executes in (reused between runs) so it can yield in sportRequest()
+		bool m_bRunSuspended = false;		// True if run function is suspended in sportRequest()
+		event_t m_nRunEvent = EVT_NONE;		// Event the current run function call was started with
 	};
 
 	enum luaScriptInputType {
@@ -110,7 +121,7 @@ public:
 	};
 
 public:
-	explicit CLuaEngine(QWidget *pParent = nullptr);
+	explicit CLuaEngine(QObject *pParent = nullptr);
 	virtual ~CLuaEngine();
 
 	static QString currentStandaloneScriptPath()
@@ -118,16 +129,54 @@ public:
 		return g_strLuaStandaloneScriptPath;
 	}
 
+	// Lua state memory of this thread's engine, see CLuaAllocator:
+	static const CLuaAllocator::TStats &memoryStats() { return g_luaAllocator.stats(); }
+	static double allocationRate() { return g_luaAllocator.allocationRate(); }		// Average bytes/sec since the state was created
+
+	// Limits of this engine.  Like the rest of the engine, these belong to
+	//	the engine's thread, so must be set from it (or before the engine
+	//	is used), and take effect on the next script exec, when the engine
+	//	applies them to its thread's Lua state:
+	void setMemoryLimit(size_t nBytes) { m_nMemoryLimit = nBytes; }		// 0 = unlimited
+	size_t memoryLimit() const { return m_nMemoryLimit; }
+	void setUsePoolAllocator(bool bUsePools) { m_bUsePoolAllocator = bUsePools; }
+	bool usePoolAllocator() const { return m_bUsePoolAllocator; }
+
+	// Per-run instruction budget, the script is killed if it executes more than
+	//	this many Lua instructions in one run (or init), 0 = unlimited:
+	static constexpr int DEFAULT_INSTRUCTIONS_LIMIT = 1000000;
+	void setInstructionsLimit(int nInstructions) { m_nInstructionsLimit = nInstructions; }
+	int instructionsLimit() const { return m_nInstructionsLimit; }
+	const CLuaRunStats &runStats() const { return m_runStats; }		// Run time and instruction count statistics for the script's runs
+
+	// Sampling profiler, see CLuaProfiler.  Profiling is enabled for
+	//	scripts on all threads.  Enabling it clears the previous samples,
+	//	and it applies from the next run on.  Each thread samples into its
+	//	own profiler, which is merged into the overall profile when its
+	//	engine is destroyed:
+	static void setProfilingEnabled(bool bEnabled);
+	static bool isProfilingEnabled() { return g_bProfiling; }
+	static CLuaProfiler profile();		// The overall profile plus this thread's samples
+
+	// Startup timing of the last script exec (including chained scripts):
+	qint64 lastInitNsecs() const { return m_nLastInitNsecs; }		// Creating the Lua state and registering the libraries
+	qint64 lastLoadNsecs() const { return m_nLastLoadNsecs; }		// Loading the script and running its init function
+
 public slots:
 	virtual void execLuaScript(const QString &strFilename = QString());		// Loads and inits the Lua Script file
 	virtual void runLuaScript(event_t nEvt);			// Does one run of the Lua Script's 'run' function
+	virtual void resumeLuaScript();						// Resumes the Lua Script's 'run' function if it's suspended in sportRequest()
 
 signals:
 	void killKeyEvent(event_t nEvent);					// Signal for parent CLuaEvents::killKeyEvent
 	void scriptFinished(int nStatus);					// Signal for when the script has finished execution (nStatus == ScriptState at completion)
+	void scriptError(const QString &strTitle, const QString &strMessage, bool bAcknowledge);	// Signal for reporting errors to the user (GUI message box or console)
 
 protected:
 	static int luaPanic(lua_State *pState);
+	static void luaHook(lua_State *pState, lua_Debug *ar);
+	static void luaSetInstructionsLimit(lua_State *pState, int nInstructions);	// Starts counting instructions for a run with the given budget (0 = unlimited)
+	static bool luaInstructionsLimitExceeded();
 
 	static void luaDisable();
 	static void luaClose(lua_State **ppState);
@@ -140,10 +189,12 @@ protected:
 	static int luaGetOutputs(lua_State * pState, TScriptInputsOutputs & sio);
 	static void luaFree(lua_State * pState, TScriptInternalData & sid);
 	static void luaDoGc(lua_State * pState, bool bFull);
+	static void luaReleaseRunThread(lua_State * pState, TScriptInternalData & sid);
 
 	static void luaInit();
 	bool luaExec(const char *pFilename, TScriptInternalData & sid);
 	void luaError(lua_State * pState, ScriptState nError, const QString &strExtraMsg = QString(), bool bAcknowledge = true);
+	void luaResumeRun(int nArgs);						// Starts or continues m_standaloneScript's run function with nArgs on its coroutine's stack
 
 	virtual void init();
 	virtual bool exec(const char *pFilename);
@@ -153,9 +204,28 @@ protected:	// Data:
 	static thread_local lua_State *g_pLSScripts;
 	static thread_local InterpretterState g_luaState;
 	static thread_local QString g_strLuaStandaloneScriptPath;
+	static thread_local CLuaAllocator g_luaAllocator;
+	static constexpr size_t LUA_GC_MIN_DEBT = 1024;		// Allocation debt in bytes needed before doing an incremental GC step after a run
+	static thread_local int g_nInstructionsLimit;		// Per-run instruction budget (0 = unlimited) of the current state, from m_nInstructionsLimit
+	static thread_local qint64 g_nInstructionsCount;	// Instructions executed by the current run (to a resolution of g_nInstructionsHookCount)
+	static thread_local int g_nInstructionsHookCount;	// Instructions between luaHook calls for the current run
+	static std::atomic<bool> g_bProfiling;
+	static thread_local CLuaProfiler g_luaProfiler;		// This thread's profile samples
+	static thread_local int g_nProfileInstructions;		// Instructions counted toward the next profiler sample
+	static QMutex g_mutexProfile;
+	static CLuaProfiler g_luaProfile;					// Overall profile of ended engines (guarded by g_mutexProfile)
+	static constexpr int LUA_HOOK_COUNT_INTERVAL = 10000;	// Instructions between luaHook calls when unlimited (just for the run statistics)
 	TScriptInternalData m_standaloneScript;
+	size_t m_nMemoryLimit = 0;
+	bool m_bUsePoolAllocator = true;
+	int m_nInstructionsLimit = DEFAULT_INSTRUCTIONS_LIMIT;
+	qint64 m_nLastInitNsecs = 0;
+	qint64 m_nLastLoadNsecs = 0;
+	CLuaRunStats m_runStats;
 
-	QPointer<QWidget> m_pParentWidget;
+public:
+	// Per thread Lua Engine -- used to route errors from static Lua handlers:
+	static thread_local QPointer<CLuaEngine> g_luaEngine;
 };
 
 
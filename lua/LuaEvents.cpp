@@ -41,6 +41,10 @@ CLuaEvents::CLuaEvents(QObject *pParent)
 {
 	connect(&m_tmrRefresh, SIGNAL(timeout()), this, SLOT(refreshEvent()));
 	m_tmrRefresh.start(LUA_REFRESH_RATE);
+
+	m_tmrWake.setSingleShot(true);
+	connect(&m_tmrWake, SIGNAL(timeout()), this, SLOT(en_wakeTimeout()));
+	m_tmrWakeWindow.start();
 }
 
 CLuaEvents::~CLuaEvents()
@@ -57,23 +61,7 @@ bool CLuaEvents::keyPressEvent(QKeyEvent *pEvent)
 	event_t nEvent = keyToEvent(pEvent->key());
 	if (nEvent == EVT_NONE) return false;			// Pass if it isn't an event we send to Lua
 
-	// Send event if the key hasn't been killed:
-	if (!m_setDeadKeyEvents.contains(nEvent)) {
-		// If we haven't seen the key, raise first seen event:
-		if (!m_setLiveKeyEvents.contains(nEvent)) {
-			m_setLiveKeyEvents.insert(nEvent);			// Add it before we emit in case callee wants to kill it, it will be in the set
-			emit luaEvent(EVT_KEY_FIRST(nEvent));
-		} else if (pEvent->isAutoRepeat()) {
-			// If this is an autoRepeat, the first time we will raise a long keypress:
-			if (!m_setLongKeyEvents.contains(nEvent)) {
-				m_setLongKeyEvents.insert(nEvent);		// Add it before we emit in case callee wants to kill it, it will be in the set
-				emit luaEvent(EVT_KEY_LONG(nEvent));
-			} else {
-				// After that, we raise a repeat:
-				emit luaEvent(EVT_KEY_REPT(nEvent));
-			}
-		}
-	}
+	keyPress(nEvent, pEvent->isAutoRepeat());
 
 	return true;
 }
@@ -86,15 +74,41 @@ bool CLuaEvents::keyReleaseEvent(QKeyEvent *pEvent)
 	event_t nEvent = keyToEvent(pEvent->key());
 	if (nEvent == EVT_NONE) return false;			// Pass if it isn't an event we send to Lua
 
-	bool bRaiseBreak = !m_setDeadKeyEvents.remove(nEvent) && m_setLiveKeyEvents.remove(nEvent);
-	m_setLongKeyEvents.remove(nEvent);
-
-	// If it was a release that wasn't dead, raise a break:
-	if (bRaiseBreak) emit luaEvent(EVT_KEY_BREAK(nEvent));
+	keyRelease(nEvent);
 
 	return true;
 }
 
+void CLuaEvents::keyPress(event_t nKey, bool bAutoRepeat)
+{
+	// Send event if the key hasn't been killed:
+	if (!m_setDeadKeyEvents.contains(nKey)) {
+		// If we haven't seen the key, raise first seen event:
+		if (!m_setLiveKeyEvents.contains(nKey)) {
+			m_setLiveKeyEvents.insert(nKey);			// Add it before we emit in case callee wants to kill it, it will be in the set
+			emit luaEvent(EVT_KEY_FIRST(nKey));
+		} else if (bAutoRepeat) {
+			// If this is an autoRepeat, the first time we will raise a long keypress:
+			if (!m_setLongKeyEvents.contains(nKey)) {
+				m_setLongKeyEvents.insert(nKey);		// Add it before we emit in case callee wants to kill it, it will be in the set
+				emit luaEvent(EVT_KEY_LONG(nKey));
+			} else {
+				// After that, we raise a repeat:
+				emit luaEvent(EVT_KEY_REPT(nKey));
+			}
+		}
+	}
+}
+
+void CLuaEvents::keyRelease(event_t nKey)
+{
+	bool bRaiseBreak = !m_setDeadKeyEvents.remove(nKey) && m_setLiveKeyEvents.remove(nKey);
+	m_setLongKeyEvents.remove(nKey);
+
+	// If it was a release that wasn't dead, raise a break:
+	if (bRaiseBreak) emit luaEvent(EVT_KEY_BREAK(nKey));
+}
+
 void CLuaEvents::killKeyEvent(event_t nEvent)
 {
 	if (m_setLiveKeyEvents.remove(nEvent)) {
@@ -105,9 +119,47 @@ void CLuaEvents::killKeyEvent(event_t nEvent)
 
 void CLuaEvents::refreshEvent()
 {
+	countRun();
+	emit luaEvent(EVT_REFRESH);
+}
+
+// ----------------------------------------------------------------------------
+
+void CLuaEvents::setWakeRate(int nMaxRunsPerMs)
+{
+	m_nWakeMaxRunsPerMs = qMax(nMaxRunsPerMs, 0);
+	if (m_nWakeMaxRunsPerMs == 0) m_tmrWake.stop();
+}
+
+void CLuaEvents::wakeEvent()
+{
+	if (m_nWakeMaxRunsPerMs == 0) return;
+	if (m_tmrWake.isActive()) return;		// Already have a run pending that will see this packet
+
+	// A zero timeout runs once the event loop has drained everything
+	//	already received, so a burst of packets causes only one run.
+	//	If this millisecond's budget is used up, defer to the next one:
+	bool bBudgetLeft = (m_tmrWakeWindow.elapsed() != m_nWakeWindowMs) ||
+						(m_nWakeWindowRuns < m_nWakeMaxRunsPerMs);
+	m_tmrWake.start(bBudgetLeft ? 0 : 1);
+}
+
+void CLuaEvents::en_wakeTimeout()
+{
+	countRun();
 	emit luaEvent(EVT_REFRESH);
 }
 
+void CLuaEvents::countRun()
+{
+	qint64 nNowMs = m_tmrWakeWindow.elapsed();
+	if (nNowMs != m_nWakeWindowMs) {
+		m_nWakeWindowMs = nNowMs;
+		m_nWakeWindowRuns = 0;
+	}
+	++m_nWakeWindowRuns;
+}
+
 // ----------------------------------------------------------------------------
 
 bool CLuaEvents::isMaskableKey(event_t nEvent)
@@ -170,4 +222,30 @@ event_t CLuaEvents::keyToEvent(int nQtKey)
 	return EVT_NONE;
 }
 
+event_t CLuaEvents::keyNameToKey(const QString &strName)
+{
+	static const struct {
+		const char *m_pName;
+		event_t m_nKey;
+	} arrKeyNames[] = {
+		{ "PGUP", KEY_PGUP },
+		{ "PGDN", KEY_PGDN },
+		{ "ENTER", KEY_ENTER },
+		{ "MODEL", KEY_MODEL },
+		{ "UP", KEY_UP },
+		{ "EXIT", KEY_EXIT },
+		{ "DOWN", KEY_DOWN },
+		{ "TELEM", KEY_TELEM },
+		{ "RIGHT", KEY_RIGHT },
+		{ "RADIO", KEY_RADIO },
+		{ "LEFT", KEY_LEFT },
+	};
+
+	for (auto const & key : arrKeyNames) {
+		if (strName.compare(key.m_pName, Qt::CaseInsensitive) == 0) return key.m_nKey;
+	}
+
+	return EVT_NONE;
+}
+
 // ============================================================================
@@ -28,6 +28,7 @@
 #include <QObject>
 #include <QSet>
 #include <QTimer>
+#include <QElapsedTimer>
 
 // Forward Declarations
 extern "C" struct luaR_value_entry;
@@ -116,18 +117,30 @@ public:
 	virtual bool keyPressEvent(QKeyEvent *pEvent);		// Inbound events from keyboard presses to trigger luaEvent emission, returns 'true' if the key was processed and shouldn't be sent to parent widget
 	virtual bool keyReleaseEvent(QKeyEvent *pEvent);	// Inbound events from keyboard releases to trigger luaEvent emission, returns 'true' if the key was processed and shouldn't be sent to parent widget
 
+	void keyPress(event_t nKey, bool bAutoRepeat = false);		// Press (or auto-repeat) of Lua key nKey (EnumLuaKeys), as from keyPressEvent, but usable without a widget (scripted input)
+	void keyRelease(event_t nKey);								// Release of Lua key nKey (EnumLuaKeys), as from keyReleaseEvent
+
+	void setWakeRate(int nMaxRunsPerMs);		// Enables wakeEvent() with runs coalesced to at most nMaxRunsPerMs per millisecond (0 = disabled, refresh timer only)
+	int wakeRate() const { return m_nWakeMaxRunsPerMs; }
+
 public slots:
 	virtual void killKeyEvent(event_t nEvent);			// Removes nEvent from m_setLiveKeyEvents, causing any pending keyReleaseEvent to be suppressed, adds it to m_setDeadKeyEvents to suppress mismatched press/release
 	virtual void refreshEvent();						// Refresh Timer trigger slot that fires luaEvent with EVT_REFRESH
+	virtual void wakeEvent();							// Received packet trigger slot that fires luaEvent with EVT_REFRESH as soon as the wake rate allows (no-op if wake rate is 0)
 
 signals:
 	void luaEvent(event_t nEvent);
 
 public:
 	static bool isMaskableKey(event_t nEvent);
+	static event_t keyNameToKey(const QString &strName);		// Converts Lua key name (like "ENTER" or "EXIT") to EnumLuaKeys value, or EVT_NONE if unknown
+	static event_t keyToEvent(int nQtKey);						// Converts Qt::Key value to EnumLuaKeys value, or EVT_NONE if it isn't a key sent to Lua
 
 protected:
-	event_t keyToEvent(int nQtKey);
+	void countRun();									// Counts a luaEvent(EVT_REFRESH) toward the wake rate for the current millisecond
+
+protected slots:
+	void en_wakeTimeout();
 
 private:
 	QSet<event_t> m_setLiveKeyEvents;		// Set of Key events firing (triggered by keyPressEvent, removed via keyReleaseEvent or killKeyEvent)
@@ -135,6 +148,12 @@ private:
 	QSet<event_t> m_setLongKeyEvents;		// Set of Key events that have triggered a Long from a repeat to prevent multiple long events when it's repeat events
 	// ----
 	QTimer m_tmrRefresh;
+	// ----
+	int m_nWakeMaxRunsPerMs = 0;			// Maximum number of wake runs per millisecond, 0 = wakeEvent disabled
+	QTimer m_tmrWake;						// Single-shot timer for pending wake run -- coalesces bursts of wakeEvent into one run
+	QElapsedTimer m_tmrWakeWindow;			// Time base for run counting
+	qint64 m_nWakeWindowMs = -1;			// Millisecond of m_tmrWakeWindow being counted
+	int m_nWakeWindowRuns = 0;				// Runs counted in m_nWakeWindowMs
 };
 
 // ----------------------------------------------------------------------------
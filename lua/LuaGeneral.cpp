@@ -48,8 +48,14 @@ CLuaGeneral::CLuaGeneral(CFrskySportDeviceTelemetry *pTelemetry, QObject *pParen
 			m_pTelemetry, SLOT(txSportPacket(const CSportTelemetryPacket&, const QString&)));	// Outgoing immediate
 	connect(this, SIGNAL(pushTxSportPacket(const CSportTelemetryPacket&, const QString&)),
 			m_pTelemetry, SLOT(pushTelemetryResponse(const CSportTelemetryPacket &, const QString&)));	// Outgoing push response
-	connect(m_pTelemetry, SIGNAL(rxSportPacket(const CSportTelemetryPacket&)),
-			this, SLOT(en_rxSportPacket(const CSportTelemetryPacket&)));						// Incoming
+	m_pTelemetry->setRxPacketSink([this](const CSportTelemetryPacket &packet)->void {
+		en_rxSportPacket(packet);																// Incoming
+	});
+
+	for (auto & nSent : m_arrRequestSentNsecs) nSent = -1;
+
+	m_tmrSportRequestTimeout.setSingleShot(true);
+	connect(&m_tmrSportRequestTimeout, &QTimer::timeout, this, &CLuaGeneral::sportRequestsFinished);
 
 	m_tmrTickTimer.start();			// Start the timer -- i.e. "turn on the radio"
 
@@ -59,6 +65,7 @@ CLuaGeneral::CLuaGeneral(CFrskySportDeviceTelemetry *pTelemetry, QObject *pParen
 
 CLuaGeneral::~CLuaGeneral()
 {
+	if (!m_pTelemetry.isNull()) m_pTelemetry->setRxPacketSink(nullptr);
 }
 
 bool CLuaGeneral::sportPortIsOpen() const
@@ -89,12 +96,164 @@ void CLuaGeneral::en_rxSportPacket(const CSportTelemetryPacket &packet)
 	//	using a data ID within 0x5000 to 0x50FF (frame ID == 0x10), as well as
 	//	packets with a frame ID equal 0x32 (regardless of the data ID) will be
 	//	passed to the LUA telemetry receive queue.
+	//	Responses to pending sportRequest() calls go to the suspended
+	//	script instead.
+	if ((packet.getPrimId() == PRIM_ID_SERVER_RESP_CAL_FRAME) &&
+		(packet.getPhysicalId() < TELEMETRY_PHYS_ID_COUNT)) {
+		TSportRequest &request = m_arrSportRequests[packet.getPhysicalId()];
+		if (request.m_bPending && !request.m_bResponded) {
+			request.m_bResponded = true;
+			request.m_response = packet;
+			noteResponseConsumed(packet);
+			if (--m_nSportRequestsOutstanding == 0) {
+				m_tmrSportRequestTimeout.stop();
+				emit sportRequestsFinished();
+			}
+			return;
+		}
+	}
+
 	if ((packet.getPrimId() == PRIM_ID_SERVER_RESP_CAL_FRAME) ||
 		((packet.getPrimId() == PRIM_ID_DATA_FRAME) &&
 		 (packet.getDataId() >= DATA_ID_DIY_STREAM_FIRST) &&
 		 (packet.getDataId() <= DATA_ID_DIY_STREAM_LAST))) {
-		m_queSportPackets.enqueue(packet);
+		if (m_ringSportPackets.push(packet)) emit rxSportPacketAvailable();
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+void CLuaGeneral::noteRequestSent(const CSportTelemetryPacket &packet)
+{
+	if (packet.getPhysicalId() >= TELEMETRY_PHYS_ID_COUNT) return;
+	if ((packet.getPrimId() != PRIM_ID_CLIENT_READ_CAL_FRAME) &&
+		(packet.getPrimId() != PRIM_ID_CLIENT_WRITE_CAL_FRAME)) return;
+
+	m_arrRequestSentNsecs[packet.getPhysicalId()] = m_tmrTickTimer.nsecsElapsed();
+}
+
+void CLuaGeneral::noteResponseConsumed(const CSportTelemetryPacket &packet)
+{
+	if (packet.getPhysicalId() >= TELEMETRY_PHYS_ID_COUNT) return;
+	if (packet.getPrimId() != PRIM_ID_SERVER_RESP_CAL_FRAME) return;
+
+	qint64 &nSent = m_arrRequestSentNsecs[packet.getPhysicalId()];
+	if (nSent < 0) return;		// Unsolicited or already counted
+
+	qint64 nElapsed = m_tmrTickTimer.nsecsElapsed() - nSent;
+	nSent = -1;
+
+	if ((m_requestTimingStats.m_nCount == 0) || (nElapsed < m_requestTimingStats.m_nMinNsecs)) {
+		m_requestTimingStats.m_nMinNsecs = nElapsed;
+	}
+	if (nElapsed > m_requestTimingStats.m_nMaxNsecs) m_requestTimingStats.m_nMaxNsecs = nElapsed;
+	m_requestTimingStats.m_nTotalNsecs += nElapsed;
+	++m_requestTimingStats.m_nCount;
+}
+
+// ----------------------------------------------------------------------------
+
+bool CLuaGeneral::sendSportPacket(const CSportTelemetryPacket &packet)
+{
+	if (haveTelemetryPoll(packet.getPhysicalId())) {
+		// sensor is found, we queue it to transmit on push.  If
+		//	its queue is full, the caller must retry later rather
+		//	than sending it un-polled, which would collide with
+		//	the polling on the half-duplex bus:
+		if (!isTelemetryPushAvailable(packet.getPhysicalId())) return false;
+		noteRequestSent(packet);
+		emit pushTxSportPacket(packet, "(from Lua Script)");
+	} else {
+		// sensor not found, we send the frame to the SPORT line
+		noteRequestSent(packet);
+		emit sendTxSportPacket(packet, "(from Lua Script)");
 	}
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool CLuaGeneral::startSportRequests(const CSportTelemetryPacket *pRequests, int nCount, bool bBatch, int nTimeout)
+{
+	assert(pRequests != nullptr);
+
+	cancelSportRequests();
+	if ((nCount < 1) || (nCount > TELEMETRY_PHYS_ID_COUNT)) return false;
+
+	for (int ndx = 0; ndx < nCount; ++ndx) {
+		uint8_t nPhysicalId = pRequests[ndx].getPhysicalId();
+		if ((nPhysicalId >= TELEMETRY_PHYS_ID_COUNT) ||
+			m_arrSportRequests[nPhysicalId].m_bPending) {
+			cancelSportRequests();
+			return false;
+		}
+		m_arrSportRequests[nPhysicalId].m_bPending = true;
+		m_arrSportRequestOrder[ndx] = nPhysicalId;
+	}
+	m_nSportRequestCount = nCount;
+	m_nSportRequestsOutstanding = nCount;
+	m_bSportRequestBatch = bBatch;
+
+	// Send them all before waiting on any so that the devices
+	//	process them concurrently.  Any that can't be queued because
+	//	its push queue is full will just time out:
+	for (int ndx = 0; ndx < nCount; ++ndx) {
+		sendSportPacket(pRequests[ndx]);
+	}
+
+	m_tmrSportRequestTimeout.start(nTimeout);
+
+	return true;
+}
+
+int CLuaGeneral::pushSportRequestResults(lua_State *L)
+{
+	auto &&fnPushResponse = [L](const CSportTelemetryPacket &packet)->void {
+		lua_pushnumber(L, packet.getPhysicalId());
+		lua_pushnumber(L, packet.getPrimId());
+		lua_pushnumber(L, packet.getDataId());
+		lua_pushunsigned(L, packet.getValue());
+	};
+
+	int nPushed = 0;
+	if (m_bSportRequestBatch) {
+		lua_createtable(L, m_nSportRequestCount, 0);
+		for (int ndx = 0; ndx < m_nSportRequestCount; ++ndx) {
+			const TSportRequest &request = m_arrSportRequests[m_arrSportRequestOrder[ndx]];
+			if (request.m_bResponded) {
+				lua_createtable(L, 4, 0);
+				fnPushResponse(request.m_response);
+				for (int nField = 4; nField >= 1; --nField) lua_rawseti(L, -(nField+1), nField);	// Pops values into table
+			} else {
+				lua_pushboolean(L, false);		// Timed out
+			}
+			lua_rawseti(L, -2, ndx+1);
+		}
+		nPushed = 1;
+	} else if (m_nSportRequestCount) {
+		const TSportRequest &request = m_arrSportRequests[m_arrSportRequestOrder[0]];
+		if (request.m_bResponded) {
+			fnPushResponse(request.m_response);
+			nPushed = 4;
+		} else {
+			lua_pushnil(L);			// Timed out
+			nPushed = 1;
+		}
+	}
+
+	cancelSportRequests();
+	return nPushed;
+}
+
+void CLuaGeneral::cancelSportRequests()
+{
+	m_tmrSportRequestTimeout.stop();
+	for (int ndx = 0; ndx < m_nSportRequestCount; ++ndx) {
+		m_arrSportRequests[m_arrSportRequestOrder[ndx]] = TSportRequest();
+	}
+	m_nSportRequestCount = 0;
+	m_nSportRequestsOutstanding = 0;
+	m_bSportRequestBatch = false;
 }
 
 // ============================================================================
@@ -156,8 +315,9 @@ static int luaSportTelemetryPop(lua_State * L)
 {
 	if (CLuaGeneral::g_luaGeneral.isNull()) return 0;
 
-	if (CLuaGeneral::g_luaGeneral->haveRxSportPacket()) {
-		CSportTelemetryPacket packet = CLuaGeneral::g_luaGeneral->popRxSportPacket();
+	CSportTelemetryPacket packet;
+	if (CLuaGeneral::g_luaGeneral->popRxSportPacket(packet)) {
+		CLuaGeneral::g_luaGeneral->noteResponseConsumed(packet);
 		lua_pushnumber(L, packet.getPhysicalId());
 		lua_pushnumber(L, packet.getPrimId());
 		lua_pushnumber(L, packet.getDataId());
@@ -169,6 +329,46 @@ static int luaSportTelemetryPop(lua_State * L)
 }
 
 
+// sportTelemetryPopAll([max])
+//
+// Pops all of the received SPORT packets from the queue at once, or up to
+//	max of them, with the same filtering as sportTelemetryPop().  This saves
+//	a Lua to C call per packet for scripts that drain the queue in a loop.
+//
+// retval: nil queue is empty
+//
+// retval: table array of packets in the order received, each being a table of:
+//			* [1] sensor ID (number)
+//			* [2] frame ID (number)
+//			* [3] data ID (number)
+//			* [4] value (number)
+static int luaSportTelemetryPopAll(lua_State * L)
+{
+	if (CLuaGeneral::g_luaGeneral.isNull()) return 0;
+
+	int nMax = luaL_optinteger(L, 1, CLuaGeneral::rxSportPacketCapacity());
+	int nCount = 0;
+	CSportTelemetryPacket packet;
+
+	while ((nCount < nMax) && CLuaGeneral::g_luaGeneral->popRxSportPacket(packet)) {
+		if (nCount == 0) lua_newtable(L);
+		CLuaGeneral::g_luaGeneral->noteResponseConsumed(packet);
+		lua_createtable(L, 4, 0);
+		lua_pushnumber(L, packet.getPhysicalId());
+		lua_rawseti(L, -2, 1);
+		lua_pushnumber(L, packet.getPrimId());
+		lua_rawseti(L, -2, 2);
+		lua_pushnumber(L, packet.getDataId());
+		lua_rawseti(L, -2, 3);
+		lua_pushunsigned(L, packet.getValue());
+		lua_rawseti(L, -2, 4);
+		lua_rawseti(L, -2, ++nCount);
+	}
+
+	return (nCount ? 1 : 0);
+}
+
+
 // sportTelemetryPush([sensorId, frameId, dataId, value])
 //
 // This functions allows for sending SPORT telemetry data toward the receiver,
@@ -211,16 +411,7 @@ static int luaSportTelemetryPush(lua_State * L)
 										luaL_checkunsigned(L, 3),	// DataId
 										luaL_checkunsigned(L, 4));	// Value
 
-		if (CLuaGeneral::g_luaGeneral->haveTelemetryPoll(nPhysicalId) &&
-			CLuaGeneral::g_luaGeneral->isTelemetryPushAvailable(nPhysicalId)) {
-			// sensor is found, we queue it to transmit on push
-			emit CLuaGeneral::g_luaGeneral->pushTxSportPacket(packet, "(from Lua Script)");
-		} else {
-			// sensor not found, we send the frame to the SPORT line
-			emit CLuaGeneral::g_luaGeneral->sendTxSportPacket(packet, "(from Lua Script)");
-		}
-
-		lua_pushboolean(L, true);
+		lua_pushboolean(L, CLuaGeneral::g_luaGeneral->sendSportPacket(packet));		// false if the output queue is full, as on the radio
 		return 1;
 	}
 
@@ -229,6 +420,88 @@ static int luaSportTelemetryPush(lua_State * L)
 }
 
 
+
+// sportRequest(sensorId, frameId, dataId, value [, timeout])
+// sportRequest(requests [, timeout])
+//
+// Sends a SPORT request frame and suspends the script until the device's
+//	response (frame ID 0x32) arrives, in place of a sportTelemetryPush()
+//	followed by sportTelemetryPop() polling over many run() calls.  The
+//	script's run function is resumed as soon as the response arrives.
+//	It can only be called from the script's run function.  While it's
+//	suspended, events other than a forced exit are not delivered.
+//
+// The second form takes a table of {sensorId, frameId, dataId, value}
+//	tables, each to a different sensor ID, sends them all at once, and
+//	waits for all of the responses.
+//
+//	timeout   (number) time to wait for response(s) in ms, defaults to 1000
+//
+// retval: multiple returns 4 values of the response:
+//			* sensor ID (number)
+//			* frame ID (number)
+//			* data ID (number)
+//			* value (number)
+//
+// retval: nil      timed out (or incorrect telemetry protocol)
+//
+// retval: table    for the table form, with one entry per request, either
+//			a table of the 4 response values or false if that request timed out
+static int luaSportRequest(lua_State * L)
+{
+	static constexpr int DEFAULT_TIMEOUT = 1000;
+
+	if (CLuaGeneral::g_luaGeneral.isNull() ||
+		!CLuaGeneral::g_luaGeneral->sportPortIsOpen()) {
+		lua_pushnil(L);
+		return 1;
+	}
+
+	if (!lua_isyieldable(L)) {
+		return luaL_error(L, "sportRequest can only be called from the script's run function");
+	}
+
+	// Note: Lua errors longjmp out of here, so no locals with destructors:
+	CSportTelemetryPacket arrRequests[TELEMETRY_PHYS_ID_COUNT];
+	int nCount = 0;
+	bool bBatch = lua_istable(L, 1);
+	int nTimeout;
+
+	if (bBatch) {
+		lua_Integer nRequests = luaL_len(L, 1);
+		luaL_argcheck(L, (nRequests > 0) && (nRequests <= TELEMETRY_PHYS_ID_COUNT), 1, "invalid number of requests");
+		for (lua_Integer ndx = 1; ndx <= nRequests; ++ndx) {
+			lua_rawgeti(L, 1, ndx);
+			luaL_checktype(L, -1, LUA_TTABLE);
+			for (int nField = 1; nField <= 4; ++nField) lua_rawgeti(L, -nField, nField);
+			lua_Unsigned nPhysicalId = luaL_checkunsigned(L, -4);
+			luaL_argcheck(L, nPhysicalId < TELEMETRY_PHYS_ID_COUNT, 1, "invalid sensor ID");
+			arrRequests[nCount++] = CSportTelemetryPacket(	nPhysicalId,				// PhysId
+															luaL_checkunsigned(L, -3),	// PrimId
+															luaL_checkunsigned(L, -2),	// DataId
+															luaL_checkunsigned(L, -1));	// Value
+			lua_pop(L, 5);
+		}
+		nTimeout = luaL_optinteger(L, 2, DEFAULT_TIMEOUT);
+	} else {
+		lua_Unsigned nPhysicalId = luaL_checkunsigned(L, 1);
+		luaL_argcheck(L, nPhysicalId < TELEMETRY_PHYS_ID_COUNT, 1, "invalid sensor ID");
+		arrRequests[nCount++] = CSportTelemetryPacket(	nPhysicalId,				// PhysId
+														luaL_checkunsigned(L, 2),	// PrimId
+														luaL_checkunsigned(L, 3),	// DataId
+														luaL_checkunsigned(L, 4));	// Value
+		nTimeout = luaL_optinteger(L, 5, DEFAULT_TIMEOUT);
+	}
+
+	if (!CLuaGeneral::g_luaGeneral->startSportRequests(arrRequests, nCount, bBatch, nTimeout)) {
+		return luaL_error(L, "sportRequest requests must each be to a different sensor ID");
+	}
+
+	// Resumed by CLuaEngine::resumeLuaScript() with the results from
+	//	CLuaGeneral::pushSportRequestResults() as our return values:
+	return lua_yield(L, 0);
+}
+
 // ============================================================================
 
 const luaL_Reg lua_opentx_generalLib[] = {
@@ -268,7 +541,9 @@ const luaL_Reg lua_opentx_generalLib[] = {
 //	{ "accessTelemetryPush", luaAccessTelemetryPush },
 #endif
 	{ "sportTelemetryPop", luaSportTelemetryPop },
+	{ "sportTelemetryPopAll", luaSportTelemetryPopAll },
 	{ "sportTelemetryPush", luaSportTelemetryPush },
+	{ "sportRequest", luaSportRequest },
 //	{ "setTelemetryValue", luaSetTelemetryValue },
 #if defined(CROSSFIRE)
 //	{ "crossfireTelemetryPop", luaCrossfireTelemetryPop },
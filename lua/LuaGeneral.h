@@ -26,15 +26,17 @@
 #include <QObject>
 #include <QPointer>
 #include <QElapsedTimer>
-#include <QQueue>
+#include <QTimer>
 
 #include "LuaEvents.h"
 
 #include "frsky_sport_io.h"
+#include "SpscRingBuffer.h"
 
 // Forward Declarations
 extern "C" struct luaR_value_entry;
 extern "C" struct luaL_Reg;
+struct lua_State;
 
 class CFrskySportDeviceTelemetry;
 
@@ -114,24 +116,63 @@ public:
 	uint32_t getTimer10ms() const;
 
 	bool sportPortIsOpen() const;
-	bool haveRxSportPacket() const { return !m_queSportPackets.isEmpty(); }
-	CSportTelemetryPacket popRxSportPacket() { return m_queSportPackets.dequeue(); }
+	bool popRxSportPacket(CSportTelemetryPacket &packet) { return m_ringSportPackets.pop(packet); }	// Returns false if no packet is available
+	uint32_t rxSportPacketsQueued() const { return m_ringSportPackets.pushedCount(); }		// Total packets queued for the script
+	uint32_t rxSportPacketsDropped() const { return m_ringSportPackets.droppedCount(); }	// Total packets dropped because the script wasn't keeping up
+	static constexpr size_t rxSportPacketCapacity() { return TRxSportPacketRing::capacity(); }
 	// ----
 	bool haveTelemetryPoll(int nPhysicalId) const;
 	bool isTelemetryPushAvailable(int nPhysicalId) const;
+	// ----
+	// Parameter request round-trip timing, from the script pushing a
+	//	read/write cal frame to the script popping the device's response:
+	struct TRequestTimingStats {
+		int m_nCount = 0;					// Number of completed request/response pairs
+		qint64 m_nTotalNsecs = 0;			// Sum of round-trip times
+		qint64 m_nMinNsecs = 0;				// Fastest round-trip
+		qint64 m_nMaxNsecs = 0;				// Slowest round-trip
+	};
+	void noteRequestSent(const CSportTelemetryPacket &packet);
+	void noteResponseConsumed(const CSportTelemetryPacket &packet);
+	const TRequestTimingStats &requestTimingStats() const { return m_requestTimingStats; }
+	// ----
+	bool sendSportPacket(const CSportTelemetryPacket &packet);		// Queues packet for a poll of its physical ID if it's being polled, else sends it immediately.  Returns false if the push queue is full
+	// ----
+	// Requests from sportRequest(), which suspends the script until
+	//	all of their responses arrive or nTimeout msecs elapse:
+	bool startSportRequests(const CSportTelemetryPacket *pRequests, int nCount, bool bBatch, int nTimeout);	// Returns false if a physical ID is invalid or repeated
+	int pushSportRequestResults(lua_State *L);			// Pushes results for the resumed sportRequest() and clears the requests, returns the number of values pushed
+	void cancelSportRequests();
 
 signals:
 	void killKeyEvent(event_t nEvent);					// Signal for parent CLuaEvents::killKeyEvent
+	void rxSportPacketAvailable();						// Signal for parent CLuaEvents::wakeEvent when a packet is queued for the script
+	void sportRequestsFinished();						// Signal for parent CLuaEngine::resumeLuaScript when sportRequest() responses are all in or have timed out
 	// ----
 	void sendTxSportPacket(const CSportTelemetryPacket &packet, const QString &strLogDetail = QString());
 	void pushTxSportPacket(const CSportTelemetryPacket &packet, const QString &strLogDetail = QString());
 
-private slots:
-	void en_rxSportPacket(const CSportTelemetryPacket &packet);
-
 private:
+	void en_rxSportPacket(const CSportTelemetryPacket &packet);		// Receive sink called directly by CFrskySportDeviceTelemetry
+
+	struct TSportRequest {
+		bool m_bPending = false;						// Request was sent to this physical ID
+		bool m_bResponded = false;						// Response has been received for it
+		CSportTelemetryPacket m_response;
+	};
+
 	QElapsedTimer m_tmrTickTimer;						// Used to provide the number of 10ms Ticks since "radio was started" for Lua getTime() function
-	QQueue<CSportTelemetryPacket> m_queSportPackets;	// Queue of received telemetry packets (filtered for luaSportTelemetryPop)
+	typedef CSpscRingBuffer<CSportTelemetryPacket, 256> TRxSportPacketRing;
+	TRxSportPacketRing m_ringSportPackets;				// Ring of received telemetry packets (filtered for luaSportTelemetryPop), newest dropped when full
+	qint64 m_arrRequestSentNsecs[TELEMETRY_PHYS_ID_COUNT];	// m_tmrTickTimer time of last outstanding request for each physical ID, -1 if none
+	TRequestTimingStats m_requestTimingStats;
+	// ----
+	TSportRequest m_arrSportRequests[TELEMETRY_PHYS_ID_COUNT];		// sportRequest() state by physical ID
+	uint8_t m_arrSportRequestOrder[TELEMETRY_PHYS_ID_COUNT];		// Physical IDs of the requests in the order given by the script
+	int m_nSportRequestCount = 0;						// Number of requests in m_arrSportRequestOrder
+	int m_nSportRequestsOutstanding = 0;				// Number of requests still waiting on a response
+	bool m_bSportRequestBatch = false;					// Batch (table) form of sportRequest() which returns a table of results
+	QTimer m_tmrSportRequestTimeout;
 	// ----
 	QPointer<CFrskySportDeviceTelemetry> m_pTelemetry;	// Sport Telemetry Serial Handler
 
@@ -21,7 +21,6 @@
 ****************************************************************************/
 
 #include "LuaLCD.h"
-#include "ui_LuaLCD.h"
 
 #include "LuaEngine.h"
 
@@ -44,7 +43,6 @@ extern "C" {
 #include <QSize>
 #include <QFontMetrics>
 #include <QFileInfo>
-#include <QResizeEvent>
 #include <assert.h>
 
 #include <limits>
@@ -57,16 +55,12 @@ thread_local QPointer<CLuaLCD> CLuaLCD::g_luaLCD;
 
 // ============================================================================
 
-CLuaLCD::CLuaLCD(QWidget *parent) :
-	QLabel(parent),
-	m_pixmap(LCD_W*LCD_RES_SCALING, LCD_H*LCD_RES_SCALING),
-	ui(new Ui::CLuaLCD)
+CLuaLCD::CLuaLCD(QObject *pParent) :
+	QObject(pParent),
+	m_image(LCD_W*LCD_RES_SCALING, LCD_H*LCD_RES_SCALING, QImage::Format_RGB32)
 {
-	ui->setupUi(this);
-
-	setPixmap(m_pixmap.scaled(width(), height(), Qt::KeepAspectRatio));
-
 	setTheme(static_cast<LCD_THEME_ENUM>(CPersistentSettings::instance()->getLuaScreenTheme()));
+	m_image.fill(QColor(QRgb(m_lcdColorTable[TEXT_BGCOLOR_INDEX])));
 
 	// Set the Lua LCD on this thread to be this one:
 	g_luaLCD = this;
@@ -74,7 +68,6 @@ CLuaLCD::CLuaLCD(QWidget *parent) :
 
 CLuaLCD::~CLuaLCD()
 {
-	delete ui;
 }
 
 // ----------------------------------------------------------------------------
@@ -206,29 +199,25 @@ QColor CLuaLCD::color(int ndx)
 
 // ----------------------------------------------------------------------------
 
-void CLuaLCD::resizeEvent(QResizeEvent *event)
-{
-	assert(event != nullptr);
-	setPixmap(m_pixmap.scaled(event->size().width(), event->size().height(), Qt::KeepAspectRatio));
-}
-
-void CLuaLCD::updateLCD()
+void CLuaLCD::endFrame()
 {
-	setPixmap(m_pixmap.scaled(width(), height(), Qt::KeepAspectRatio));
+	if (!m_bDirty) return;
+	m_bDirty = false;
+	emit frameReady(m_image);
 }
 
 // ----------------------------------------------------------------------------
 
 void CLuaLCD::clear(LcdFlags att)
 {
-	QPainter painter(&m_pixmap);
+	QPainter painter(&m_image);
 	painter.fillRect(0, 0, LCD_W*LCD_RES_SCALING, LCD_H*LCD_RES_SCALING, QColor(QRgb(m_lcdColorTable[COLOR_IDX(att)])));
 	updateLCD();
 }
 
 void CLuaLCD::drawPoint(coord_t x, coord_t y, LcdFlags att)
 {
-	QPainter painter(&m_pixmap);
+	QPainter painter(&m_image);
 	painter.setBrush(Qt::NoBrush);
 	painter.setPen(QPen(QColor(QRgb(m_lcdColorTable[COLOR_IDX(att)])), 1*LCD_RES_SCALING));
 	painter.drawPoint(x*LCD_RES_SCALING, y*LCD_RES_SCALING);
@@ -237,7 +226,7 @@ void CLuaLCD::drawPoint(coord_t x, coord_t y, LcdFlags att)
 
 void CLuaLCD::drawLine(coord_t x1, coord_t y1, coord_t x2, coord_t y2, uint8_t pat, LcdFlags att)
 {
-	QPainter painter(&m_pixmap);
+	QPainter painter(&m_image);
 	Qt::PenStyle ps = Qt::SolidLine;
 	switch (pat) {
 		case DOTTED:
@@ -261,7 +250,7 @@ static uint8_t getFontHeight(LcdFlags flags)
 
 void CLuaLCD::drawText(coord_t x, coord_t y, const char * s, LcdFlags att)
 {
-	QPainter painter(&m_pixmap);
+	QPainter painter(&m_image);
 	painter.setBrush(QBrush((att & INVERS) ? m_lcdColorTable[TEXT_INVERTED_BGCOLOR_INDEX] :
 											m_lcdColorTable[TEXT_BGCOLOR_INDEX], Qt::SolidPattern));
 	painter.setPen(QPen(QBrush(QColor(QRgb((att & INVERS) ? m_lcdColorTable[TEXT_INVERTED_COLOR_INDEX] :
@@ -289,19 +278,19 @@ void CLuaLCD::drawText(coord_t x, coord_t y, const char * s, LcdFlags att)
 	updateLCD();
 }
 
-void CLuaLCD::drawBitmap(coord_t x, coord_t y, const QPixmap &bm, const QRect &src, float scale)
+void CLuaLCD::drawBitmap(coord_t x, coord_t y, const QImage &bm, const QRect &src, float scale)
 {
-	QPainter painter(&m_pixmap);
+	QPainter painter(&m_image);
 	if (scale) {
 		painter.scale(scale, scale);
 	}
-	painter.drawPixmap(x*LCD_RES_SCALING, y*LCD_RES_SCALING, bm, src.x(), src.y(), src.width(), src.height());
+	painter.drawImage(x*LCD_RES_SCALING, y*LCD_RES_SCALING, bm, src.x(), src.y(), src.width(), src.height());
 	updateLCD();
 }
 
 void CLuaLCD::drawRect(coord_t x, coord_t y, coord_t w, coord_t h, uint8_t thickness, uint8_t pat, LcdFlags att)
 {
-	QPainter painter(&m_pixmap);
+	QPainter painter(&m_image);
 	Qt::PenStyle ps = Qt::SolidLine;
 	switch (pat) {
 		case DOTTED:
@@ -320,7 +309,7 @@ void CLuaLCD::drawRect(coord_t x, coord_t y, coord_t w, coord_t h, uint8_t thick
 void CLuaLCD::drawFilledRect(coord_t x, coord_t y, coord_t w, coord_t h, uint8_t pat, LcdFlags att)
 {
 	Q_UNUSED(pat);
-	QPainter painter(&m_pixmap);
+	QPainter painter(&m_image);
 	painter.fillRect(x*LCD_RES_SCALING, y*LCD_RES_SCALING, w*LCD_RES_SCALING, h*LCD_RES_SCALING, QBrush(QColor(QRgb(m_lcdColorTable[COLOR_IDX(att)]))));
 	updateLCD();
 }
@@ -343,18 +332,18 @@ int CLuaLCD::loadBitmap(const QString &strFilename)
 		strFN.prepend(fi.absolutePath() + "/");
 	}
 
-	m_lstBitmaps.append(QPixmap(strFN));
+	m_lstBitmaps.append(QImage(strFN));
 	return m_lstBitmaps.size()-1;
 }
 
 void CLuaLCD::freeBitmap(int ndx)
 {
 	if ((m_lstBitmaps.size() > ndx) && (ndx >= 0)) {
-		m_lstBitmaps[ndx] = QPixmap();
+		m_lstBitmaps[ndx] = QImage();
 	}
 }
 
-const QPixmap &CLuaLCD::bitmap(int ndx)
+const QImage &CLuaLCD::bitmap(int ndx)
 {
 	assert((m_lstBitmaps.size() > ndx) && (ndx >= 0));
 	return m_lstBitmaps.at(ndx);
@@ -815,7 +804,7 @@ static int luaLcdDrawBitmap(lua_State *L)
 	int b = checkBitmap(L, 1);
 
 	if (CLuaLCD::g_luaLCD->checkBitmap(b)) {
-		const QPixmap &bm = CLuaLCD::g_luaLCD->bitmap(b);
+		const QImage &bm = CLuaLCD::g_luaLCD->bitmap(b);
 		unsigned int x = luaL_checkunsigned(L, 2);
 		unsigned int y = luaL_checkunsigned(L, 3);
 		unsigned int scale = luaL_optunsigned(L, 4, 0);
@@ -23,13 +23,12 @@
 #ifndef LUA_LCD_H
 #define LUA_LCD_H
 
-#include <QLabel>
-#include <QPixmap>
+#include <QObject>
+#include <QImage>
+#include <QRect>
 #include <QPointer>
 #include <QColor>
 #include <QList>
-#include <QBitmap>
-#include <QPixmap>
 
 // Forward Declarations
 extern "C" struct luaR_value_entry;
@@ -299,20 +298,18 @@ extern void registerBitmapClass(lua_State * L);
 
 // ============================================================================
 
-namespace Ui {
-	class CLuaLCD;
-}
-
-class CLuaLCD : public QLabel
+// Off-screen LCD frame buffer that the Lua lcd functions draw on.  It has
+//	no widget dependency so it can be used headless.  Completed frames are
+//	published via frameReady() for the GUI (CLuaLCDWidget) or the headless
+//	runner to consume.
+class CLuaLCD : public QObject
 {
 	Q_OBJECT
 
 public:
-	explicit CLuaLCD(QWidget *parent = nullptr);
+	explicit CLuaLCD(QObject *pParent = nullptr);
 	~CLuaLCD();
 
-//	virtual QSize sizeHint() const override;
-
 	enum LCD_THEME_ENUM {
 		LCD_THEME_DEFAULT,
 		LCD_THEME_DARKBLUE,
@@ -330,27 +327,31 @@ public:
 	void drawPoint(coord_t x, coord_t y, LcdFlags att=0);
 	void drawLine(coord_t x1, coord_t y1, coord_t x2, coord_t y2, uint8_t pat=SOLID, LcdFlags att=0);
 	void drawText(coord_t x, coord_t y, const char * s, LcdFlags att=0);
-	void drawBitmap(coord_t x, coord_t y, const QPixmap &bm, const QRect &src, float scale = 0);
+	void drawBitmap(coord_t x, coord_t y, const QImage &bm, const QRect &src, float scale = 0);
 	void drawRect(coord_t x, coord_t y, coord_t w, coord_t h, uint8_t thickness=1, uint8_t pat=SOLID, LcdFlags att=0);
 	void drawFilledRect(coord_t x, coord_t y, coord_t w, coord_t h, uint8_t pat, LcdFlags att);
 
 	int loadBitmap(const QString &strFilename);
 	void freeBitmap(int ndx);
-	const QPixmap &bitmap(int ndx);
+	const QImage &bitmap(int ndx);
 	bool checkBitmap(int ndx);
 
-protected:
-	virtual void resizeEvent(QResizeEvent *event) override;
+	const QImage &frame() const { return m_image; }
 
-	void updateLCD();
+public slots:
+	void endFrame();			// Called at the end of each script run to publish the frame if it was drawn on
+
+signals:
+	void frameReady(const QImage &image);
 
 protected:
-	uint32_t m_lcdColorTable[LCD_COLOR_COUNT] = {};
-	QPixmap m_pixmap;
-	QList<QPixmap> m_lstBitmaps;
+	void updateLCD() { m_bDirty = true; }
 
-private:
-	Ui::CLuaLCD *ui;
+protected:
+	uint32_t m_lcdColorTable[LCD_COLOR_COUNT] = {};
+	QImage m_image;
+	QList<QImage> m_lstBitmaps;
+	bool m_bDirty = true;		// True if the frame has been drawn on since the last frameReady()
 
 public:
 	// Per thread Lua LCD -- one LCD screen on each thread running Lua:
@@ -0,0 +1,69 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+
+#include "LuaLCDWidget.h"
+#include "ui_LuaLCDWidget.h"
+
+#include "LuaLCD.h"
+
+#include <QResizeEvent>
+#include <assert.h>
+
+// ============================================================================
+
+CLuaLCDWidget::CLuaLCDWidget(QWidget *parent) :
+	QLabel(parent),
+	m_pixmap(LCD_W*LCD_RES_SCALING, LCD_H*LCD_RES_SCALING),
+	ui(new Ui::CLuaLCDWidget)
+{
+	ui->setupUi(this);
+
+	m_pixmap.fill(Qt::black);
+	updateLCD();
+}
+
+CLuaLCDWidget::~CLuaLCDWidget()
+{
+	delete ui;
+}
+
+// ----------------------------------------------------------------------------
+
+void CLuaLCDWidget::setFrame(const QImage &image)
+{
+	m_pixmap = QPixmap::fromImage(image);
+	updateLCD();
+}
+
+void CLuaLCDWidget::resizeEvent(QResizeEvent *event)
+{
+	assert(event != nullptr);
+	setPixmap(m_pixmap.scaled(event->size().width(), event->size().height(), Qt::KeepAspectRatio));
+}
+
+void CLuaLCDWidget::updateLCD()
+{
+	setPixmap(m_pixmap.scaled(width(), height(), Qt::KeepAspectRatio));
+}
+
+// ============================================================================
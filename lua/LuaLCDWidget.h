@@ -0,0 +1,63 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+
+#ifndef LUA_LCD_WIDGET_H
+#define LUA_LCD_WIDGET_H
+
+#include <QLabel>
+#include <QPixmap>
+#include <QImage>
+
+// ============================================================================
+
+namespace Ui {
+	class CLuaLCDWidget;
+}
+
+// Displays the frames rendered by CLuaLCD, scaled to the widget size
+class CLuaLCDWidget : public QLabel
+{
+	Q_OBJECT
+
+public:
+	explicit CLuaLCDWidget(QWidget *parent = nullptr);
+	~CLuaLCDWidget();
+
+public slots:
+	void setFrame(const QImage &image);
+
+protected:
+	virtual void resizeEvent(QResizeEvent *event) override;
+
+	void updateLCD();
+
+protected:
+	QPixmap m_pixmap;
+
+private:
+	Ui::CLuaLCDWidget *ui;
+};
+
+// ============================================================================
+
+#endif	// LUA_LCD_WIDGET_H
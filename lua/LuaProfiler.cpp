@@ -0,0 +1,114 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+
+#include "LuaProfiler.h"
+
+extern "C" {
+#include <lua/lua.h>
+#include <lua/lualib.h>
+#include <lua/lauxlib.h>
+}
+
+#include <QFile>
+#include <QStringList>
+#include <string.h>
+
+// ============================================================================
+
+void CLuaProfiler::sample(lua_State *pState)
+{
+	// Note: This is called from the Lua hook, but none of the Lua
+	//	calls here raise errors, so Qt objects are safe to use:
+	lua_Debug ar;
+	QStringList lstFrames;
+	QString strLeafLine;
+
+	for (int nLevel = 0; (nLevel < MAX_STACK_DEPTH) && lua_getstack(pState, nLevel, &ar); ++nLevel) {
+		if (!lua_getinfo(pState, "Sln", &ar)) break;
+
+		QString strName;
+		if (ar.name) {
+			strName = QString::fromUtf8(ar.name);
+		} else if (ar.what && (strcmp(ar.what, "main") == 0)) {
+			strName = "main chunk";
+		} else {
+			strName = "?";
+		}
+
+		QString strFrame;
+		if (ar.what && (strcmp(ar.what, "C") == 0)) {
+			strFrame = strName + " [C]";
+		} else {
+			strFrame = QString("%1 (%2:%3)").arg(strName).arg(QString::fromUtf8(ar.short_src)).arg(ar.linedefined);
+			if ((nLevel == 0) && (ar.currentline >= 0)) {
+				strLeafLine = QString("%1:%2").arg(QString::fromUtf8(ar.short_src)).arg(ar.currentline);
+			}
+		}
+		// Collapsed format uses ';' as the frame separator:
+		strFrame.replace(';', ':');
+		lstFrames.prepend(strFrame);
+	}
+	if (lstFrames.isEmpty()) return;
+	if (!strLeafLine.isEmpty()) lstFrames.append(strLeafLine.replace(';', ':'));
+
+	++m_mapStacks[lstFrames.join(';')];
+	++m_nSampleCount;
+}
+
+void CLuaProfiler::clear()
+{
+	m_mapStacks.clear();
+	m_nSampleCount = 0;
+}
+
+void CLuaProfiler::merge(const CLuaProfiler &profiler)
+{
+	for (auto itr = profiler.m_mapStacks.cbegin(); itr != profiler.m_mapStacks.cend(); ++itr) {
+		m_mapStacks[itr.key()] += itr.value();
+	}
+	m_nSampleCount += profiler.m_nSampleCount;
+}
+
+QString CLuaProfiler::collapsedStacks() const
+{
+	QStringList lstStacks;
+	for (auto itr = m_mapStacks.cbegin(); itr != m_mapStacks.cend(); ++itr) {
+		lstStacks.append(QString("%1 %2").arg(itr.key()).arg(itr.value()));
+	}
+	lstStacks.sort();
+	return lstStacks.join('\n') + (lstStacks.isEmpty() ? "" : "\n");
+}
+
+bool CLuaProfiler::writeCollapsedStacks(const QString &strFilename, QString *pstrError) const
+{
+	QFile fileProfile(strFilename);
+	if (!fileProfile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+		if (pstrError) *pstrError = fileProfile.errorString();
+		return false;
+	}
+	fileProfile.write(collapsedStacks().toUtf8());
+	fileProfile.close();
+	return true;
+}
+
+// ============================================================================
@@ -0,0 +1,70 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+
+#ifndef LUA_PROFILER_H
+#define LUA_PROFILER_H
+
+#include <QString>
+#include <QHash>
+
+// Forware Declarations
+struct lua_State;
+
+// ============================================================================
+
+//
+// Sampling profiler for Lua scripts.  CLuaEngine's instruction count hook
+//	calls sample() every SAMPLE_INTERVAL instructions while profiling is
+//	enabled, and the script's call stack at that point is counted.  The
+//	stacks are written in the "collapsed" format used by flamegraph tools
+//	(such as Brendan Gregg's flamegraph.pl, speedscope, or inferno), one
+//	line per unique stack with its frames root first, separated by ';',
+//	followed by a space and its sample count.
+//
+// Each function frame is "name (source:line-defined)", and the leaf is
+//	followed by a "source:current-line" frame for the line being executed.
+//
+class CLuaProfiler
+{
+public:
+	static constexpr int SAMPLE_INTERVAL = 1000;		// Lua instructions between samples
+	static constexpr int MAX_STACK_DEPTH = 64;			// Deeper stacks are truncated at the root end
+
+	void sample(lua_State *pState);
+	void clear();
+	void merge(const CLuaProfiler &profiler);		// Adds another profiler's samples (such as from another thread's scripts) to this one
+
+	int sampleCount() const { return m_nSampleCount; }
+	int stackCount() const { return m_mapStacks.size(); }
+
+	QString collapsedStacks() const;
+	bool writeCollapsedStacks(const QString &strFilename, QString *pstrError = nullptr) const;
+
+private:
+	QHash<QString, int> m_mapStacks;				// Sample count for each collapsed stack
+	int m_nSampleCount = 0;
+};
+
+// ============================================================================
+
+#endif	// LUA_PROFILER_H
@@ -0,0 +1,112 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+
+#include "LuaRunStats.h"
+
+// ============================================================================
+
+CLuaRunStats::CLuaRunStats()
+{
+	reset();
+}
+
+void CLuaRunStats::reset()
+{
+	m_nWindowNext = 0;
+	m_nWindowCount = 0;
+	for (int i = 0; i < NUM_BUCKETS; ++i) {
+		m_arrTimeHistogram[i] = 0;
+		m_arrInstructionsHistogram[i] = 0;
+	}
+	m_nTotalRuns = 0;
+	m_nKilledRuns = 0;
+	m_nTotalNsecs = 0;
+	m_nMaxNsecs = 0;
+	m_nMaxInstructions = 0;
+}
+
+int CLuaRunStats::bucket(uint64_t nValue)
+{
+	int nBucket = 0;
+	while (nValue && (nBucket < NUM_BUCKETS-1)) {
+		nValue >>= 1;
+		++nBucket;
+	}
+	return nBucket;
+}
+
+void CLuaRunStats::addRun(int64_t nNsecs, uint32_t nInstructions, bool bKilled)
+{
+	if (nNsecs < 0) nNsecs = 0;
+
+	TSample &sample = m_arrWindow[m_nWindowNext];
+	if (m_nWindowCount == WINDOW_SIZE) {
+		--m_arrTimeHistogram[sample.m_nTimeBucket];
+		--m_arrInstructionsHistogram[sample.m_nInstructionsBucket];
+	} else {
+		++m_nWindowCount;
+	}
+	sample.m_nTimeBucket = bucket(nNsecs/1000);
+	sample.m_nInstructionsBucket = bucket(nInstructions);
+	++m_arrTimeHistogram[sample.m_nTimeBucket];
+	++m_arrInstructionsHistogram[sample.m_nInstructionsBucket];
+	m_nWindowNext = (m_nWindowNext + 1) % WINDOW_SIZE;
+
+	++m_nTotalRuns;
+	if (bKilled) ++m_nKilledRuns;
+	m_nTotalNsecs += nNsecs;
+	if (nNsecs > m_nMaxNsecs) m_nMaxNsecs = nNsecs;
+	if (nInstructions > m_nMaxInstructions) m_nMaxInstructions = nInstructions;
+}
+
+int64_t CLuaRunStats::percentile(const int *pHistogram, int nPercentile) const
+{
+	if (m_nWindowCount == 0) return 0;
+
+	int nTarget = (m_nWindowCount * nPercentile + 99) / 100;
+	if (nTarget < 1) nTarget = 1;
+	int nCount = 0;
+	for (int nBucket = 0; nBucket < NUM_BUCKETS; ++nBucket) {
+		nCount += pHistogram[nBucket];
+		if (nCount >= nTarget) return (nBucket ? (int64_t(1) << nBucket) : 0);
+	}
+	return (int64_t(1) << (NUM_BUCKETS-1));
+}
+
+QString CLuaRunStats::summary() const
+{
+	if (m_nTotalRuns == 0) return QString("Runs: 0");
+
+	return QString("Runs: %1 (%2 killed), time avg/p50/p99/max: %3/%4/%5/%6 us, instructions p50/p99/max: %7/%8/%9")
+			.arg(m_nTotalRuns)
+			.arg(m_nKilledRuns)
+			.arg(m_nTotalNsecs/m_nTotalRuns/1000.0, 0, 'f', 1)
+			.arg(timePercentileUsecs(50))
+			.arg(timePercentileUsecs(99))
+			.arg(m_nMaxNsecs/1000.0, 0, 'f', 1)
+			.arg(instructionsPercentile(50))
+			.arg(instructionsPercentile(99))
+			.arg(m_nMaxInstructions);
+}
+
+// ============================================================================
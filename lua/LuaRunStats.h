@@ -0,0 +1,90 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+
+#ifndef LUA_RUN_STATS_H
+#define LUA_RUN_STATS_H
+
+#include <QString>
+
+#include <stdint.h>
+
+// ============================================================================
+
+//
+// Rolling statistics of the time taken and Lua instructions executed by
+//	each run of a script (each call or resume of its run function).  The
+//	histograms have power of two buckets and cover the last WINDOW_SIZE
+//	runs, with the oldest run's sample being removed as each new one is
+//	added.  The totals and maximums are for all runs since reset().
+//
+class CLuaRunStats
+{
+public:
+	static constexpr int WINDOW_SIZE = 1024;		// Number of most recent runs in the histograms
+	static constexpr int NUM_BUCKETS = 32;			// Bucket n counts samples in [2^(n-1), 2^n), bucket 0 counts zeros
+
+	CLuaRunStats();
+
+	void reset();
+	void addRun(int64_t nNsecs, uint32_t nInstructions, bool bKilled);
+
+	uint64_t totalRuns() const { return m_nTotalRuns; }
+	uint64_t killedRuns() const { return m_nKilledRuns; }
+	int windowRuns() const { return m_nWindowCount; }
+	int64_t maxNsecs() const { return m_nMaxNsecs; }
+	uint32_t maxInstructions() const { return m_nMaxInstructions; }
+
+	const int *timeHistogram() const { return m_arrTimeHistogram; }					// Buckets of run time in microseconds
+	const int *instructionsHistogram() const { return m_arrInstructionsHistogram; }	// Buckets of instruction counts
+
+	// Upper bound of the histogram bucket containing the given
+	//	percentile (0-100) of the runs in the window:
+	int64_t timePercentileUsecs(int nPercentile) const { return percentile(m_arrTimeHistogram, nPercentile); }
+	int64_t instructionsPercentile(int nPercentile) const { return percentile(m_arrInstructionsHistogram, nPercentile); }
+
+	QString summary() const;		// Single line summary for logging and display
+
+protected:
+	static int bucket(uint64_t nValue);
+	int64_t percentile(const int *pHistogram, int nPercentile) const;
+
+private:
+	struct TSample {
+		uint8_t m_nTimeBucket;
+		uint8_t m_nInstructionsBucket;
+	};
+	TSample m_arrWindow[WINDOW_SIZE];			// Ring of samples in the histograms
+	int m_nWindowNext = 0;						// Next slot of m_arrWindow to fill
+	int m_nWindowCount = 0;						// Number of valid samples in m_arrWindow
+	int m_arrTimeHistogram[NUM_BUCKETS];
+	int m_arrInstructionsHistogram[NUM_BUCKETS];
+	uint64_t m_nTotalRuns = 0;
+	uint64_t m_nKilledRuns = 0;
+	int64_t m_nTotalNsecs = 0;
+	int64_t m_nMaxNsecs = 0;
+	uint32_t m_nMaxInstructions = 0;
+};
+
+// ============================================================================
+
+#endif	// LUA_RUN_STATS_H
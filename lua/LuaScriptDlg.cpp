@@ -24,42 +24,53 @@
 #include "ui_LuaScriptDlg.h"
 
 #include "frsky_sport_io.h"
-#include "frsky_sport_telemetry.h"
 #include "LuaEvents.h"
-#include "LuaEngine.h"
-#include "LuaGeneral.h"
+#include "LuaScriptThread.h"
 
-#include <QTimer>
 #include <QKeyEvent>
+#include <QMessageBox>
 
 #include <assert.h>
 
 // ============================================================================
 
-CLuaScriptDlg::CLuaScriptDlg(CFrskySportIO &frskySportIO, const QString &strFilename, QWidget *parent) :
+CLuaScriptDlg::CLuaScriptDlg(CFrskySportIO &frskySportIO, const QString &strFilename, CSportTimeSeriesStore *pTimeSeriesStore, CSportShmPublisher *pShmPublisher, CSportStreamQueue *pStreamQueue, QWidget *parent) :
 	QDialog(parent),
-	m_pFrskyTelemetry(new CFrskySportDeviceTelemetry(frskySportIO, nullptr, this)),
-	m_pLuaEvents(new CLuaEvents(this)),
-	m_pLuaEngine(new CLuaEngine(this)),
-	m_pLuaGeneral(new CLuaGeneral(m_pFrskyTelemetry, this)),
+	m_pLuaThread(new CLuaScriptThread(frskySportIO, strFilename, pTimeSeriesStore, pShmPublisher, pStreamQueue, this)),
 	ui(new Ui::CLuaScriptDlg)
 {
 	ui->setupUi(this);
 
-	connect(m_pLuaEngine, SIGNAL(killKeyEvent(event_t)), m_pLuaEvents, SLOT(killKeyEvent(event_t)));
-	connect(m_pLuaGeneral, SIGNAL(killKeyEvent(event_t)), m_pLuaEvents, SLOT(killKeyEvent(event_t)));
-	connect(m_pLuaEvents, SIGNAL(luaEvent(event_t)), m_pLuaEngine, SLOT(runLuaScript(event_t)));
-
-	connect(m_pLuaEngine, SIGNAL(scriptFinished(int)), this, SLOT(done(int)));
-
-	// Delay a second before opening the script and executing it to give
-	//	time for communications to run, specifically the telemetry polling,
-	//	before running a script that sends messages, particularly via poll push:
-	if (!strFilename.isEmpty()) QTimer::singleShot(1000, m_pLuaEngine, [=]() { m_pLuaEngine->execLuaScript(strFilename); });
+	connect(m_pLuaThread, &CLuaScriptThread::frameAvailable, this, [this]() {
+		ui->luaLCD->setFrame(m_pLuaThread->takeFrame());
+	});
+	connect(m_pLuaThread, &CLuaScriptThread::scriptError, this, [this](const QString &strTitle, const QString &strMessage, bool bAcknowledge) {
+		if (bAcknowledge) {
+			QMessageBox::warning(this, strTitle, strMessage);
+		} else {
+			// Informational only, so don't block the dialog (and its LCD) with it:
+			QMessageBox *pMsgBox = new QMessageBox(QMessageBox::Warning, strTitle, strMessage, QMessageBox::Ok, this);
+			pMsgBox->setAttribute(Qt::WA_DeleteOnClose);
+			pMsgBox->setModal(false);
+			pMsgBox->show();
+		}
+	});
+	connect(m_pLuaThread, &CLuaScriptThread::runStatsChanged, ui->labelRunStats, &QLabel::setText);
+	connect(m_pLuaThread, SIGNAL(scriptFinished(int)), this, SLOT(done(int)));
+
+	// The port must be pushed to the worker from its current thread,
+	//	it's returned by the worker when the script ends:
+	frskySportIO.port().moveToThread(m_pLuaThread);
+	m_pLuaThread->start();
 }
 
 CLuaScriptDlg::~CLuaScriptDlg()
 {
+	if (m_pLuaThread) {
+		m_pLuaThread->quit();
+		m_pLuaThread->wait();
+	}
+
 	delete ui;
 	ui = nullptr;
 }
@@ -68,14 +79,26 @@ CLuaScriptDlg::~CLuaScriptDlg()
 
 void CLuaScriptDlg::keyPressEvent(QKeyEvent *pEvent)
 {
-	assert(!m_pLuaEvents.isNull());
-	if (!m_pLuaEvents->keyPressEvent(pEvent)) QDialog::keyPressEvent(pEvent);
+	assert(pEvent != nullptr);
+	assert(!m_pLuaThread.isNull());
+	event_t nKey = CLuaEvents::keyToEvent(pEvent->key());
+	if (nKey != EVT_NONE) {
+		emit m_pLuaThread->keyPressed(nKey, pEvent->isAutoRepeat());
+	} else {
+		QDialog::keyPressEvent(pEvent);
+	}
 }
 
 void CLuaScriptDlg::keyReleaseEvent(QKeyEvent *pEvent)
 {
-	assert(!m_pLuaEvents.isNull());
-	if (!m_pLuaEvents->keyReleaseEvent(pEvent)) QDialog::keyReleaseEvent(pEvent);
+	assert(pEvent != nullptr);
+	assert(!m_pLuaThread.isNull());
+	event_t nKey = CLuaEvents::keyToEvent(pEvent->key());
+	if (nKey != EVT_NONE) {
+		emit m_pLuaThread->keyReleased(nKey);
+	} else {
+		QDialog::keyReleaseEvent(pEvent);
+	}
 }
 
 // ----------------------------------------------------------------------------
@@ -30,11 +30,11 @@
 
 // Forware Declarations
 class QKeyEvent;
-class CLuaEvents;
-class CLuaEngine;
-class CLuaGeneral;
 class CFrskySportIO;
-class CFrskySportDeviceTelemetry;
+class CLuaScriptThread;
+class CSportTimeSeriesStore;
+class CSportShmPublisher;
+class CSportStreamQueue;
 
 // ----------------------------------------------------------------------------
 
@@ -47,7 +47,7 @@ class CLuaScriptDlg : public QDialog
 	Q_OBJECT
 
 public:
-	explicit CLuaScriptDlg(CFrskySportIO &frskySportIO, const QString &strFilename = QString(), QWidget *parent = nullptr);
+	explicit CLuaScriptDlg(CFrskySportIO &frskySportIO, const QString &strFilename = QString(), CSportTimeSeriesStore *pTimeSeriesStore = nullptr, CSportShmPublisher *pShmPublisher = nullptr, CSportStreamQueue *pStreamQueue = nullptr, QWidget *parent = nullptr);
 	virtual ~CLuaScriptDlg();
 
 protected:
@@ -55,10 +55,7 @@ protected:
 	virtual void keyReleaseEvent(QKeyEvent *pEvent) override;
 
 private:
-	QPointer<CFrskySportDeviceTelemetry> m_pFrskyTelemetry;
-	QPointer<CLuaEvents> m_pLuaEvents;
-	QPointer<CLuaEngine> m_pLuaEngine;
-	QPointer<CLuaGeneral> m_pLuaGeneral;
+	QPointer<CLuaScriptThread> m_pLuaThread;		// Worker thread running the script, see CLuaScriptThread
 	Ui::CLuaScriptDlg *ui;
 };
 
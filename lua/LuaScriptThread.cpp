@@ -0,0 +1,145 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+
+#include "LuaScriptThread.h"
+
+#include "frsky_sport_io.h"
+#include "frsky_sport_telemetry.h"
+#include "LuaEngine.h"
+#include "LuaGeneral.h"
+#include "LuaLCD.h"
+
+#include "PersistentSettings.h"
+
+#include <QTimer>
+
+#include <string.h>
+
+// ============================================================================
+
+CLuaScriptThread::CLuaScriptThread(CFrskySportIO &frskySportIO, const QString &strFilename, CSportTimeSeriesStore *pTimeSeriesStore, CSportShmPublisher *pShmPublisher, CSportStreamQueue *pStreamQueue, QObject *pParent)
+	:	QThread(pParent),
+		m_frskySportIO(frskySportIO),
+		m_strFilename(strFilename),
+		m_pTimeSeriesStore(pTimeSeriesStore),
+		m_pShmPublisher(pShmPublisher),
+		m_pStreamQueue(pStreamQueue),
+		m_pOwnerThread(frskySportIO.port().thread())
+{
+	qRegisterMetaType<event_t>("event_t");
+}
+
+CLuaScriptThread::~CLuaScriptThread()
+{
+	quit();
+	wait();
+}
+
+// ----------------------------------------------------------------------------
+
+void CLuaScriptThread::run()
+{
+	// The serial port is moved to this thread by the thread owner before
+	//	starting, since QObject::moveToThread must be called from the
+	//	object's current thread:
+	Q_ASSERT(m_frskySportIO.port().thread() == this);
+
+	{
+		CFrskySportDeviceTelemetry frskyTelemetry(m_frskySportIO);
+		frskyTelemetry.setTimeSeriesStore(m_pTimeSeriesStore);
+		frskyTelemetry.setShmPublisher(m_pShmPublisher);
+		frskyTelemetry.setStreamQueue(m_pStreamQueue);
+		CLuaEvents luaEvents;
+		CLuaEngine luaEngine;
+		CLuaGeneral luaGeneral(&frskyTelemetry);
+		CLuaLCD luaLCD;
+		QTimer tmrRunStats;
+
+		connect(&luaLCD, &CLuaLCD::frameReady, &luaLCD, [this](const QImage &image) { publishFrame(image); }, Qt::DirectConnection);
+		connect(&luaEngine, &CLuaEngine::scriptError, this, &CLuaScriptThread::scriptError);
+		connect(&luaEngine, &CLuaEngine::scriptFinished, this, &CLuaScriptThread::scriptFinished);
+
+		connect(this, &CLuaScriptThread::keyPressed, &luaEvents, [&luaEvents](event_t nKey, bool bAutoRepeat) { luaEvents.keyPress(nKey, bAutoRepeat); });
+		connect(this, &CLuaScriptThread::keyReleased, &luaEvents, [&luaEvents](event_t nKey) { luaEvents.keyRelease(nKey); });
+
+		connect(&luaEngine, SIGNAL(killKeyEvent(event_t)), &luaEvents, SLOT(killKeyEvent(event_t)));
+		connect(&luaGeneral, SIGNAL(killKeyEvent(event_t)), &luaEvents, SLOT(killKeyEvent(event_t)));
+		connect(&luaEvents, SIGNAL(luaEvent(event_t)), &luaEngine, SLOT(runLuaScript(event_t)));
+		connect(&luaGeneral, SIGNAL(rxSportPacketAvailable()), &luaEvents, SLOT(wakeEvent()));
+		connect(&luaGeneral, SIGNAL(sportRequestsFinished()), &luaEngine, SLOT(resumeLuaScript()));
+
+		// Limits belong to the engine's thread, so they are applied here rather than by the dialog:
+		luaEvents.setWakeRate(CPersistentSettings::instance()->getLuaWakeOnRxRate());
+		luaEngine.setMemoryLimit(CPersistentSettings::instance()->getLuaMemoryLimit() * 1024);
+		luaEngine.setInstructionsLimit(CPersistentSettings::instance()->getLuaInstructionsLimit());
+
+		connect(&tmrRunStats, &QTimer::timeout, &luaEngine, [this, &luaEngine]() {
+			emit runStatsChanged(luaEngine.runStats().summary());
+		});
+		tmrRunStats.start(1000);
+
+		// Delay a second before opening the script and executing it to give
+		//	time for communications to run, specifically the telemetry polling,
+		//	before running a script that sends messages, particularly via poll push:
+		if (!m_strFilename.isEmpty()) {
+			QTimer::singleShot(1000, &luaEngine, [this, &luaEngine]() { luaEngine.execLuaScript(m_strFilename); });
+		}
+
+		exec();
+	}
+
+	m_frskySportIO.port().moveToThread(m_pOwnerThread);
+}
+
+// ----------------------------------------------------------------------------
+
+void CLuaScriptThread::publishFrame(const QImage &image)
+{
+	// Reuse the back buffer when the frame geometry hasn't changed so a
+	//	steady stream of frames doesn't allocate:
+	if ((m_imgBack.size() == image.size()) &&
+		(m_imgBack.format() == image.format()) &&
+		(m_imgBack.bytesPerLine() == image.bytesPerLine())) {
+		memcpy(m_imgBack.bits(), image.constBits(), static_cast<size_t>(image.bytesPerLine()) * image.height());
+	} else {
+		m_imgBack = image.copy();
+	}
+
+	bool bNotify = false;
+	{
+		QMutexLocker locker(&m_mutexFrame);
+		m_imgFront.swap(m_imgBack);
+		bNotify = !m_bFramePending;
+		m_bFramePending = true;
+	}
+	if (bNotify) emit frameAvailable();
+}
+
+QImage CLuaScriptThread::takeFrame()
+{
+	QMutexLocker locker(&m_mutexFrame);
+	m_bFramePending = false;
+	return m_imgFront;
+}
+
+// ============================================================================
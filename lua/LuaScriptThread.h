@@ -0,0 +1,94 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+
+#ifndef LUA_SCRIPT_THREAD_H
+#define LUA_SCRIPT_THREAD_H
+
+#include <QThread>
+#include <QString>
+#include <QImage>
+#include <QMutex>
+
+#include "LuaEvents.h"
+
+// Forward Declarations
+class CFrskySportIO;
+class CSportTimeSeriesStore;
+class CSportShmPublisher;
+class CSportStreamQueue;
+
+// ============================================================================
+
+// Worker thread for running a Lua script.  The telemetry handler, events,
+//	engine, general and LCD objects are all created on and live on this
+//	thread, along with the serial port, which is moved here for the life
+//	of the script and moved back to its owner thread when it ends.  Since
+//	the Lua state is thread_local, nothing of it is shared with the GUI.
+//
+//	Completed LCD frames are handed to the GUI through a double buffer:
+//	the worker copies each frame into the back image and swaps it with the
+//	front image, signaling frameAvailable() only if the GUI has taken the
+//	previous one, so a slow or blocked GUI just drops intermediate frames
+//	instead of holding up script runs or poll responses.
+class CLuaScriptThread : public QThread
+{
+	Q_OBJECT
+
+public:
+	CLuaScriptThread(CFrskySportIO &frskySportIO, const QString &strFilename, CSportTimeSeriesStore *pTimeSeriesStore = nullptr, CSportShmPublisher *pShmPublisher = nullptr, CSportStreamQueue *pStreamQueue = nullptr, QObject *pParent = nullptr);
+	virtual ~CLuaScriptThread();
+
+	QImage takeFrame();				// Returns the latest completed LCD frame (call from frameAvailable() on the GUI thread)
+
+signals:
+	// Signals to the script (emit from the GUI thread):
+	void keyPressed(event_t nKey, bool bAutoRepeat);	// Lua key (EnumLuaKeys) press, see CLuaEvents::keyPress
+	void keyReleased(event_t nKey);						// Lua key (EnumLuaKeys) release, see CLuaEvents::keyRelease
+
+	// Signals from the script (queued to the GUI thread):
+	void frameAvailable();								// A new LCD frame is ready for takeFrame()
+	void runStatsChanged(const QString &strSummary);	// Periodic CLuaRunStats::summary() update
+	void scriptFinished(int nStatus);					// Forwarded CLuaEngine::scriptFinished
+	void scriptError(const QString &strTitle, const QString &strMessage, bool bAcknowledge);	// Forwarded CLuaEngine::scriptError
+
+protected:
+	virtual void run() override;
+	void publishFrame(const QImage &image);			// Called on the worker thread from CLuaLCD::frameReady
+
+private:
+	CFrskySportIO &m_frskySportIO;
+	QString m_strFilename;
+	CSportTimeSeriesStore *m_pTimeSeriesStore;		// Optional store to record the telemetry received in
+	CSportShmPublisher *m_pShmPublisher;			// Optional shared memory to publish the telemetry received in
+	CSportStreamQueue *m_pStreamQueue;				// Optional stream server queue to stream the telemetry received from
+	QThread *m_pOwnerThread;			// Thread to return the serial port to when the script ends
+	// ----
+	QImage m_imgBack;					// Frame being filled by the worker (worker thread only)
+	QMutex m_mutexFrame;				// Guards m_imgFront and m_bFramePending
+	QImage m_imgFront;					// Latest completed frame for the GUI
+	bool m_bFramePending = false;		// True if frameAvailable() was emitted and takeFrame() hasn't been called yet
+};
+
+// ============================================================================
+
+#endif	// LUA_SCRIPT_THREAD_H
@@ -59,3 +59,30 @@ target_compile_definitions(luaLib INTERFACE
 )
 add_dependencies(luaLib lua)
 target_include_directories(luaLib INTERFACE ${LUA_INCLUDE_DIR})
+
+# Lua's makefile 'all' target doesn't build luac, so bytecode is
+#	precompiled with this host tool, linked with the same Lua build:
+add_executable(lua_precompile ${CMAKE_CURRENT_LIST_DIR}/lua_precompile.cpp)
+target_link_libraries(lua_precompile PRIVATE luaLib)
+
+#
+# Precompile a Lua source file to bytecode, using lua_precompile from the
+#	same Lua build that's linked, and add it to a target's Qt resources
+#	as ":/<alias>".  The target must have AUTORCC enabled:
+#
+function(target_lua_bytecode_resource target source alias)
+	get_filename_component(luacName ${alias} NAME)
+	set(luacFile ${CMAKE_CURRENT_BINARY_DIR}/${luacName})
+	set(qrcFile ${CMAKE_CURRENT_BINARY_DIR}/${luacName}.qrc)
+	add_custom_command(OUTPUT ${luacFile}
+		COMMAND lua_precompile ${luacFile} ${source}
+		DEPENDS lua_precompile ${source}
+		COMMENT "Precompiling Lua ${alias}"
+	)
+	file(WRITE ${qrcFile}
+		"<!DOCTYPE RCC>\n<RCC version=\"1.0\">\n\t<qresource prefix=\"/\">\n"
+		"\t\t<file alias=\"${alias}\">${luacFile}</file>\n"
+		"\t</qresource>\n</RCC>\n"
+	)
+	target_sources(${target} PRIVATE ${luacFile} ${qrcFile})
+endfunction()
@@ -0,0 +1,82 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 Donna Whisnant, a.k.a. Dewtronics.
+** Contact: http://www.dewtronics.com/
+**
+** This file is part of the frsky_sport_tool Application.
+**
+** GNU General Public License Usage
+** This file may be used under the terms of the GNU General Public License
+** version 3.0 as published by the Free Software Foundation and appearing
+** in the file gpl-3.0.txt included in the packaging of this file. Please
+** review the following information to ensure the GNU General Public License
+** version 3.0 requirements will be met:
+** http://www.gnu.org/copyleft/gpl.html.
+**
+** Other Usage
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and
+** Dewtronics.
+**
+****************************************************************************/
+
+//
+// Build host tool that precompiles a Lua source file to stripped bytecode,
+//	like "luac -s", with the same Lua build the tools link (whose makefile
+//	doesn't build luac), so the bytecode format always matches.
+//
+
+#include <lua/lua.h>
+#include <lua/lauxlib.h>
+
+#include <stdio.h>
+#include <iostream>
+
+// ============================================================================
+
+static int writeChunk(lua_State *pState, const void *pData, size_t nSize, void *pUserData)
+{
+	(void)pState;
+	return ((nSize != 0) && (fwrite(pData, nSize, 1, static_cast<FILE *>(pUserData)) != 1));
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc != 3) {
+		std::cerr << "Usage: lua_precompile <output-file> <lua-source-file>" << std::endl;
+		return -1;
+	}
+
+	lua_State *pState = luaL_newstate();
+	if (pState == nullptr) {
+		std::cerr << "Failed to create Lua state" << std::endl;
+		return -2;
+	}
+
+	if (luaL_loadfile(pState, argv[2]) != LUA_OK) {
+		std::cerr << lua_tostring(pState, -1) << std::endl;
+		lua_close(pState);
+		return -3;
+	}
+
+	FILE *pFile = fopen(argv[1], "wb");
+	if (pFile == nullptr) {
+		std::cerr << "Failed to open \"" << argv[1] << "\" for writing" << std::endl;
+		lua_close(pState);
+		return -4;
+	}
+
+	bool bOK = (lua_dump(pState, writeChunk, pFile, 1) == 0);
+	bOK = ((fclose(pFile) == 0) && bOK);
+	lua_close(pState);
+
+	if (!bOK) {
+		std::cerr << "Failed to write \"" << argv[1] << "\"" << std::endl;
+		remove(argv[1]);
+		return -5;
+	}
+
+	return 0;
+}
+
+// ============================================================================
@@ -51,6 +51,7 @@ int main(int argc, char *argv[])
 	pApp->setOrganizationDomain("dewtronics.com");
 
 	qRegisterMetaType<QSerialPortInfo>("QSerialPortInfo");
+	qRegisterMetaType<SPORT_ID_ENUM>("SPORT_ID_ENUM");		// For writeLogString from ports being used on worker threads
 
 	Q_INIT_RESOURCE(frsky_sport_tool);
 